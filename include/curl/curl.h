@@ -286,6 +286,15 @@ typedef size_t (*curl_write_callback)(char *buffer,
                                       size_t nitems,
                                       void *outstream);
 
+/* Received data lent to the CURLOPT_BORROWFUNCTION callback. The callback
+   keeps it until it calls curl_borrow_release(). */
+struct curl_borrow;
+
+typedef size_t (*curl_borrow_callback)(char *buffer,
+                                       size_t nbytes,
+                                       struct curl_borrow *borrow,
+                                       void *userdata);
+
 /* This callback will be called when a new resolver request is made */
 typedef int (*curl_resolver_start_callback)(void *resolver_state,
                                             void *reserved, void *userdata);
@@ -1074,6 +1083,9 @@ typedef CURLSTScode (*curl_hstswrite_callback)(CURL *easy,
 #define CURLHSTS_ENABLE       (long)(1<<0)
 #define CURLHSTS_READONLYFILE (long)(1<<1)
 
+/* CURLURGENCY_INCREMENTAL is a bit for the CURLOPT_STREAM_URGENCY option */
+#define CURLURGENCY_INCREMENTAL (long)(1<<3)
+
 /* The CURLPROTO_ defines below are for the **deprecated** CURLOPT_*PROTOCOLS
    options. Do not use. */
 #define CURLPROTO_HTTP   (1<<0)
@@ -2261,6 +2273,31 @@ typedef enum {
   /* set TLS supported signature algorithms */
   CURLOPT(CURLOPT_SSL_SIGNATURE_ALGORITHMS, CURLOPTTYPE_STRINGPOINT, 328),
 
+  /* file to load and save SSL sessions in */
+  CURLOPT(CURLOPT_SSL_SESSION_FILE, CURLOPTTYPE_STRINGPOINT, 329),
+
+  /* callback that gets received body data without it being copied */
+  CURLOPT(CURLOPT_BORROWFUNCTION, CURLOPTTYPE_FUNCTIONPOINT, 330),
+
+  /* Data passed to the CURLOPT_BORROWFUNCTION callback */
+  CURLOPT(CURLOPT_BORROWDATA, CURLOPTTYPE_CBPOINT, 331),
+
+  /* seconds to remember that a name could not be resolved */
+  CURLOPT(CURLOPT_DNS_NEGATIVE_TIMEOUT, CURLOPTTYPE_LONG, 332),
+
+  /* seconds before expiry to refresh often used DNS cache entries */
+  CURLOPT(CURLOPT_DNS_REFRESH_AHEAD, CURLOPTTYPE_LONG, 333),
+
+  /* file to load the DNS cache from and to save it to */
+  CURLOPT(CURLOPT_DNS_CACHE_FILE, CURLOPTTYPE_STRINGPOINT, 334),
+
+  /* append cookie changes to the cookie jar file as they happen */
+  CURLOPT(CURLOPT_COOKIEJOURNAL, CURLOPTTYPE_LONG, 335),
+
+  /* RFC 9218 urgency of the stream, optionally OR'ed with
+     CURLURGENCY_INCREMENTAL */
+  CURLOPT(CURLOPT_STREAM_URGENCY, CURLOPTTYPE_LONG, 336),
+
   CURLOPT_LASTENTRY /* the last unused */
 } CURLoption;
 
@@ -2999,7 +3036,9 @@ typedef enum {
   CURLINFO_EARLYDATA_SENT_T = CURLINFO_OFF_T + 68,
   CURLINFO_HTTPAUTH_USED    = CURLINFO_LONG + 69,
   CURLINFO_PROXYAUTH_USED   = CURLINFO_LONG + 70,
-  CURLINFO_LASTONE          = 70
+  CURLINFO_HTTP2_WINDOW_T   = CURLINFO_OFF_T + 71,
+  CURLINFO_HTTP2_RTT_T      = CURLINFO_OFF_T + 72,
+  CURLINFO_LASTONE          = 72
 } CURLINFO;
 
 /* CURLINFO_RESPONSE_CODE is the new name for the option previously known as
@@ -3313,6 +3352,17 @@ CURL_EXTERN CURLcode curl_easy_ssls_export(CURL *handle,
                                            curl_ssls_export_cb *export_fn,
                                            void *userptr);
 
+/*
+ * NAME curl_borrow_release()
+ *
+ * DESCRIPTION
+ *
+ * The curl_borrow_release function gives back received data that a
+ * CURLOPT_BORROWFUNCTION callback has accepted. libcurl may reuse or free
+ * the memory afterwards.
+ */
+CURL_EXTERN void curl_borrow_release(struct curl_borrow *borrow);
+
 
 #ifdef  __cplusplus
 } /* end of extern "C" */
@@ -395,6 +395,18 @@ typedef enum {
   /* maximum number of concurrent streams to support on a connection */
   CURLOPT(CURLMOPT_MAX_CONCURRENT_STREAMS, CURLOPTTYPE_LONG, 16),
 
+  /* number of worker threads to run the transfers in */
+  CURLOPT(CURLMOPT_WORKER_THREADS, CURLOPTTYPE_LONG, 17),
+
+  /* maximum amount of memory for buffers of all connections */
+  CURLOPT(CURLMOPT_MAX_BUFFER_MEMORY, CURLOPTTYPE_OFF_T, 18),
+
+  /* maximum number of threads resolving names at the same time */
+  CURLOPT(CURLMOPT_MAX_RESOLVER_THREADS, CURLOPTTYPE_LONG, 19),
+
+  /* use epoll for the sockets of transfers in curl_multi_wait() */
+  CURLOPT(CURLMOPT_WAIT_EPOLL, CURLOPTTYPE_LONG, 20),
+
   CURLMOPT_LASTENTRY /* the last unused */
 } CURLMoption;
 
@@ -127,6 +127,9 @@
           if((option) == CURLOPT_TRAILERFUNCTION)                       \
             if(!curlcheck_trailer_cb(value))                            \
               _curl_easy_setopt_err_trailer_cb();                       \
+          if((option) == CURLOPT_BORROWFUNCTION)                        \
+            if(!curlcheck_borrow_cb(value))                             \
+              _curl_easy_setopt_err_borrow_cb();                        \
           if(curlcheck_cb_data_option(option))                          \
             if(!curlcheck_cb_data(value))                               \
               _curl_easy_setopt_err_cb_data();                          \
@@ -266,6 +269,8 @@ CURLWARNING(_curl_easy_setopt_err_prereq_cb,
             "curl_easy_setopt expects a curl_prereq_callback argument")
 CURLWARNING(_curl_easy_setopt_err_trailer_cb,
             "curl_easy_setopt expects a curl_trailerfunc_ok argument")
+CURLWARNING(_curl_easy_setopt_err_borrow_cb,
+            "curl_easy_setopt expects a curl_borrow_callback argument")
 CURLWARNING(_curl_easy_setopt_err_error_buffer,
             "curl_easy_setopt expects a "
             "char buffer of CURL_ERROR_SIZE as argument")
@@ -335,6 +340,7 @@ CURLWARNING(_curl_easy_getinfo_err_curl_off_t,
    (option) == CURLOPT_CRLFILE ||                                       \
    (option) == CURLOPT_CUSTOMREQUEST ||                                 \
    (option) == CURLOPT_DEFAULT_PROTOCOL ||                              \
+   (option) == CURLOPT_DNS_CACHE_FILE ||                                \
    (option) == CURLOPT_DNS_INTERFACE ||                                 \
    (option) == CURLOPT_DNS_LOCAL_IP4 ||                                 \
    (option) == CURLOPT_DNS_LOCAL_IP6 ||                                 \
@@ -403,6 +409,7 @@ CURLWARNING(_curl_easy_getinfo_err_curl_off_t,
    (option) == CURLOPT_SSLKEYTYPE ||                                    \
    (option) == CURLOPT_SSL_CIPHER_LIST ||                               \
    (option) == CURLOPT_SSL_EC_CURVES ||                                 \
+   (option) == CURLOPT_SSL_SESSION_FILE ||                              \
    (option) == CURLOPT_SSL_SIGNATURE_ALGORITHMS ||                      \
    (option) == CURLOPT_TLS13_CIPHERS ||                                 \
    (option) == CURLOPT_TLSAUTH_PASSWORD ||                              \
@@ -430,7 +437,8 @@ CURLWARNING(_curl_easy_getinfo_err_curl_off_t,
 
 /* evaluates to true if option takes a data argument to pass to a callback */
 #define curlcheck_cb_data_option(option)                                      \
-  ((option) == CURLOPT_CHUNK_DATA ||                                          \
+  ((option) == CURLOPT_BORROWDATA ||                                          \
+   (option) == CURLOPT_CHUNK_DATA ||                                          \
    (option) == CURLOPT_CLOSESOCKETDATA ||                                     \
    (option) == CURLOPT_DEBUGDATA ||                                           \
    (option) == CURLOPT_FNMATCH_DATA ||                                        \
@@ -864,4 +872,9 @@ typedef size_t (*_curl_interleave_callback2)(char *p, size_t s,
   (curlcheck_NULL(expr) ||                                            \
    curlcheck_cb_compatible((expr), curl_trailer_callback))
 
+/* evaluates to true if expr is of type curl_borrow_callback */
+#define curlcheck_borrow_cb(expr)                                     \
+  (curlcheck_NULL(expr) ||                                            \
+   curlcheck_cb_compatible((expr), curl_borrow_callback))
+
 #endif /* CURLINC_TYPECHECK_GCC_H */
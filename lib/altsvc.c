@@ -55,6 +55,11 @@
 
 #define H3VERSION "h3"
 
+/* room for an origin key: alpn id, host and port */
+#define MAX_ALTSVC_KEYLEN (MAX_ALTSVC_HOSTLEN + 16)
+
+#define ALTSVC_ORIGIN_SLOTS 63
+
 /* Given the ALPN ID, return the name */
 const char *Curl_alpnid2str(enum alpnid id)
 {
@@ -78,6 +83,116 @@ static void altsvc_free(struct altsvc *as)
   free(as);
 }
 
+/* the alternatives of one source origin, in the order they were added */
+struct altsvc_origin {
+  struct Curl_llist list;
+};
+
+static void altsvc_origin_dtor(void *entry)
+{
+  struct altsvc_origin *o = entry;
+  /* the entries are owned by altsvcinfo->list */
+  free(o);
+}
+
+/*
+ * Create the key of the origin in 'buf', ignoring a trailing dot and the
+ * case of the hostname. Returns the length of the key, 0 if the host does
+ * not fit.
+ */
+static size_t altsvc_origin_key(char *buf, enum alpnid alpnid,
+                                const char *host, size_t hlen,
+                                unsigned short port)
+{
+  size_t klen;
+
+  if(hlen && (host[hlen - 1] == '.'))
+    hlen--;
+  if(!hlen || (hlen > MAX_ALTSVC_HOSTLEN))
+    return 0;
+  klen = msnprintf(buf, MAX_ALTSVC_KEYLEN, "%d:%u:", (int)alpnid, port);
+  Curl_strntolower(&buf[klen], host, hlen);
+  return klen + hlen;
+}
+
+static struct altsvc_origin *altsvc_origin_get(struct altsvcinfo *asi,
+                                               enum alpnid alpnid,
+                                               const char *host,
+                                               unsigned short port)
+{
+  char key[MAX_ALTSVC_KEYLEN];
+  size_t klen = altsvc_origin_key(key, alpnid, host, strlen(host), port);
+  if(!klen)
+    return NULL;
+  return Curl_hash_pick(&asi->origins, key, klen);
+}
+
+/* remove the entry from the cache and free it */
+static void altsvc_remove(struct altsvcinfo *asi, struct altsvc *as)
+{
+  struct Curl_llist *olist = Curl_node_llist(&as->onode);
+
+  Curl_node_remove(&as->node);
+  Curl_node_remove(&as->enode);
+  Curl_node_remove(&as->onode);
+  if(olist && !Curl_llist_count(olist)) {
+    /* the last alternative of the origin is gone */
+    char key[MAX_ALTSVC_KEYLEN];
+    size_t klen = altsvc_origin_key(key, as->src.alpnid, as->src.host,
+                                    strlen(as->src.host), as->src.port);
+    if(klen)
+      Curl_hash_delete(&asi->origins, key, klen);
+  }
+  altsvc_free(as);
+}
+
+/*
+ * Add the new entry to the cache. The expiry list is sorted and most entries
+ * expire last, so the place is searched from the end. Returns FALSE and
+ * frees the entry on failure.
+ */
+static bool altsvc_insert(struct altsvcinfo *asi, struct altsvc *as)
+{
+  char key[MAX_ALTSVC_KEYLEN];
+  size_t klen = altsvc_origin_key(key, as->src.alpnid, as->src.host,
+                                  strlen(as->src.host), as->src.port);
+  struct altsvc_origin *o;
+  struct Curl_llist_node *e;
+
+  if(!klen) {
+    altsvc_free(as);
+    return FALSE;
+  }
+  o = Curl_hash_pick(&asi->origins, key, klen);
+  if(!o) {
+    o = calloc(1, sizeof(*o));
+    if(!o) {
+      altsvc_free(as);
+      return FALSE;
+    }
+    Curl_llist_init(&o->list, NULL);
+    if(!Curl_hash_add(&asi->origins, key, klen, o)) {
+      free(o);
+      altsvc_free(as);
+      return FALSE;
+    }
+    /* keep the chains short, a failure to grow only makes lookups slower */
+    if(Curl_hash_count(&asi->origins) > (asi->origins.slots * 2))
+      (void)Curl_hash_resize(&asi->origins, (asi->origins.slots * 4) + 1);
+  }
+  Curl_llist_append(&o->list, as, &as->onode);
+  Curl_llist_append(&asi->list, as, &as->node);
+
+  for(e = Curl_llist_tail(&asi->expiry); e; e = Curl_node_prev(e)) {
+    struct altsvc *prev = Curl_node_elem(e);
+    if(prev->expires <= as->expires)
+      break;
+  }
+  /* without a node to insert after, the entry goes first */
+  Curl_llist_insert_next(&asi->expiry, e, as, &as->enode);
+  return TRUE;
+}
+
 static struct altsvc *altsvc_createid(const char *srchost,
                                       size_t hlen,
                                       const char *dsthost,
@@ -201,7 +316,8 @@ static CURLcode altsvc_add(struct altsvcinfo *asi, const char *line)
       as->expires = expires;
       as->prio = 0; /* not supported to just set zero */
       as->persist = persist ? 1 : 0;
-      Curl_llist_append(&asi->list, as, &as->node);
+      if(!altsvc_insert(asi, as))
+        return CURLE_OUT_OF_MEMORY;
     }
   }
 
@@ -303,6 +419,9 @@ struct altsvcinfo *Curl_altsvc_init(void)
   if(!asi)
     return NULL;
   Curl_llist_init(&asi->list, NULL);
+  Curl_llist_init(&asi->expiry, NULL);
+  Curl_hash_init(&asi->origins, ALTSVC_ORIGIN_SLOTS, Curl_hash_str,
+                 curlx_str_key_compare, altsvc_origin_dtor);
 
   /* set default behavior */
   asi->flags = CURLALTSVC_H1
@@ -350,6 +469,7 @@ void Curl_altsvc_cleanup(struct altsvcinfo **altsvcp)
       n = Curl_node_next(e);
       altsvc_free(as);
     }
+    Curl_hash_destroy(&altsvc->origins);
     free(altsvc->filename);
     free(altsvc);
     *altsvcp = NULL; /* clear the pointer */
@@ -403,37 +523,20 @@ CURLcode Curl_altsvc_save(struct Curl_easy *data,
   return result;
 }
 
-/* hostcompare() returns true if 'host' matches 'check'. The first host
- * argument may have a trailing dot present that will be ignored.
- */
-static bool hostcompare(const char *host, const char *check)
-{
-  size_t hlen = strlen(host);
-  size_t clen = strlen(check);
-
-  if(hlen && (host[hlen - 1] == '.'))
-    hlen--;
-  if(hlen != clen)
-    /* they cannot match if they have different lengths */
-    return FALSE;
-  return strncasecompare(host, check, hlen);
-}
-
 /* altsvc_flush() removes all alternatives for this source origin from the
-   list */
+   cache */
 static void altsvc_flush(struct altsvcinfo *asi, enum alpnid srcalpnid,
                          const char *srchost, unsigned short srcport)
 {
-  struct Curl_llist_node *e;
-  struct Curl_llist_node *n;
-  for(e = Curl_llist_head(&asi->list); e; e = n) {
-    struct altsvc *as = Curl_node_elem(e);
-    n = Curl_node_next(e);
-    if((srcalpnid == as->src.alpnid) &&
-       (srcport == as->src.port) &&
-       hostcompare(srchost, as->src.host)) {
-      Curl_node_remove(e);
-      altsvc_free(as);
+  struct altsvc_origin *o = altsvc_origin_get(asi, srcalpnid, srchost,
+                                              srcport);
+  if(o) {
+    struct Curl_llist_node *e;
+    /* removing the last one frees the origin */
+    size_t count = Curl_llist_count(&o->list);
+    while(count--) {
+      e = Curl_llist_head(&o->list);
+      altsvc_remove(asi, Curl_node_elem(e));
     }
   }
 }
@@ -602,10 +705,10 @@ CURLcode Curl_altsvc_parse(struct Curl_easy *data,
             else
               as->expires = maxage + secs;
             as->persist = persist;
-            Curl_llist_append(&asi->list, as, &as->node);
-            infof(data, "Added alt-svc: %.*s:%d over %s",
-                  (int)curlx_strlen(&dsthost), curlx_str(&dsthost),
-                  dstport, Curl_alpnid2str(dstalpnid));
+            if(altsvc_insert(asi, as))
+              infof(data, "Added alt-svc: %.*s:%d over %s",
+                    (int)curlx_strlen(&dsthost), curlx_str(&dsthost),
+                    dstport, Curl_alpnid2str(dstalpnid));
           }
         }
       }
@@ -639,28 +742,32 @@ bool Curl_altsvc_lookup(struct altsvcinfo *asi,
                         const int versions) /* one or more bits */
 {
   struct Curl_llist_node *e;
-  struct Curl_llist_node *n;
+  struct altsvc_origin *o;
   time_t now = time(NULL);
   DEBUGASSERT(asi);
   DEBUGASSERT(srchost);
   DEBUGASSERT(dstentry);
 
-  for(e = Curl_llist_head(&asi->list); e; e = n) {
+  /* remove the expired entries, they are first in the expiry list */
+  for(e = Curl_llist_head(&asi->expiry); e;
+      e = Curl_llist_head(&asi->expiry)) {
     struct altsvc *as = Curl_node_elem(e);
-    n = Curl_node_next(e);
-    if(as->expires < now) {
-      /* an expired entry, remove */
-      Curl_node_remove(e);
-      altsvc_free(as);
-      continue;
-    }
-    if((as->src.alpnid == srcalpnid) &&
-       hostcompare(srchost, as->src.host) &&
-       (as->src.port == srcport) &&
-       (versions & (int)as->dst.alpnid)) {
-      /* match */
-      *dstentry = as;
-      return TRUE;
+    if(as->expires >= now)
+      break;
+    altsvc_remove(asi, as);
+  }
+
+  if((srcport < 0) || (srcport > 0xffff))
+    return FALSE;
+  o = altsvc_origin_get(asi, srcalpnid, srchost, (unsigned short)srcport);
+  if(o) {
+    for(e = Curl_llist_head(&o->list); e; e = Curl_node_next(e)) {
+      struct altsvc *as = Curl_node_elem(e);
+      if(versions & (int)as->dst.alpnid) {
+        /* match */
+        *dstentry = as;
+        return TRUE;
+      }
     }
   }
   return FALSE;
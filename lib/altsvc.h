@@ -28,6 +28,7 @@
 #if !defined(CURL_DISABLE_HTTP) && !defined(CURL_DISABLE_ALTSVC)
 #include <curl/curl.h>
 #include "llist.h"
+#include "hash.h"
 
 struct althost {
   char *host;
@@ -39,14 +40,18 @@ struct altsvc {
   struct althost src;
   struct althost dst;
   time_t expires;
-  struct Curl_llist_node node;
+  struct Curl_llist_node node;  /* in altsvcinfo->list */
+  struct Curl_llist_node onode; /* in the list of its source origin */
+  struct Curl_llist_node enode; /* in altsvcinfo->expiry */
   unsigned int prio;
   BIT(persist);
 };
 
 struct altsvcinfo {
   char *filename;
-  struct Curl_llist list; /* list of entries */
+  struct Curl_llist list; /* list of entries, in the order they were added */
+  struct Curl_llist expiry; /* the entries, the first one to expire first */
+  struct Curl_hash origins; /* entry lists by source alpn, host and port */
   long flags; /* the publicly set bitmask */
 };
 
@@ -176,6 +176,7 @@ void Curl_async_shutdown(struct Curl_easy *data)
 #ifndef CURL_DISABLE_DOH
   Curl_doh_cleanup(data);
 #endif
+  Curl_resolv_pending_drop(data);
   Curl_safefree(data->state.async.hostname);
 }
 
@@ -190,6 +191,7 @@ void Curl_async_destroy(struct Curl_easy *data)
 #ifndef CURL_DISABLE_DOH
   Curl_doh_cleanup(data);
 #endif
+  Curl_resolv_pending_drop(data);
   Curl_safefree(data->state.async.hostname);
 }
 
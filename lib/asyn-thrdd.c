@@ -64,6 +64,7 @@
 #include "inet_ntop.h"
 #include "curl_threads.h"
 #include "strdup.h"
+#include "select.h"
 
 #ifdef USE_ARES
 #include <ares.h>
@@ -114,19 +115,82 @@ CURLcode Curl_async_get_impl(struct Curl_easy *data, void **impl)
   return CURLE_OK;
 }
 
-/* Destroy context of threaded resolver */
+/* slots in the hash of unfinished lookups */
+#define ASYNC_THRDD_POOL_HASH_SIZE  31
+
+/* A thread of the resolver pool */
+struct async_thrdd_worker {
+  struct Curl_llist_node node;   /* in the pool's `workers` */
+  struct async_thrdd_pool *pool;
+  curl_thread_t thread_hnd;
+  BIT(busy);                     /* resolving a name */
+  BIT(done);                     /* the thread has finished */
+};
+
+/* The resolver threads of a multi handle. Threads are started when
+ * lookups are queued, up to the maximum of the multi handle, and end
+ * when the queue is empty. */
+struct async_thrdd_pool {
+  curl_mutex_t mutx;
+  struct Curl_hash lookups;  /* unfinished lookups by host, port and hints */
+  struct Curl_llist queue;   /* lookups waiting for a thread */
+  struct Curl_llist workers; /* started threads */
+  unsigned int nworkers;     /* threads not finished */
+  int ref_count;             /* the multi, the threads and the lookups */
+  BIT(closed);               /* the multi handle is gone */
+#ifdef UNITTESTS
+  BIT(hold);                 /* threads wait before resolving */
+#endif
+};
+
+static void lookups_dtor(void *p)
+{
+  /* the lookups are reference counted, the hash does not own them */
+  (void)p;
+}
+
+static struct async_thrdd_pool *pool_create(void)
+{
+  struct async_thrdd_pool *pool = calloc(1, sizeof(*pool));
+  if(!pool)
+    return NULL;
+  Curl_mutex_init(&pool->mutx);
+  Curl_hash_init(&pool->lookups, ASYNC_THRDD_POOL_HASH_SIZE,
+                 Curl_hash_str, curlx_str_key_compare, lookups_dtor);
+  Curl_llist_init(&pool->queue, NULL);
+  Curl_llist_init(&pool->workers, NULL);
+  pool->ref_count = 1;
+  return pool;
+}
+
+static void pool_free(struct async_thrdd_pool *pool)
+{
+  struct Curl_llist_node *e;
+
+  DEBUGASSERT(!pool->ref_count);
+  DEBUGASSERT(!Curl_llist_count(&pool->queue));
+  /* threads were joined or detached when the pool closed */
+  for(e = Curl_llist_head(&pool->workers); e;
+      e = Curl_llist_head(&pool->workers))
+    free(Curl_node_take_elem(e));
+  Curl_hash_destroy(&pool->lookups);
+  Curl_mutex_destroy(&pool->mutx);
+  free(pool);
+}
+
+/* Destroy context of threaded resolver, pool mutex held */
 static void addr_ctx_destroy(struct async_thrdd_addr_ctx *addr_ctx)
 {
   if(addr_ctx) {
     DEBUGASSERT(!addr_ctx->ref_count);
-    Curl_mutex_destroy(&addr_ctx->mutx);
+    free(addr_ctx->key);
     free(addr_ctx->hostname);
     if(addr_ctx->res)
       Curl_freeaddrinfo(addr_ctx->res);
 #ifndef CURL_DISABLE_SOCKETPAIR
   /*
    * close one end of the socket pair (may be done in resolver thread);
-   * the other end (for reading) is always closed in the parent thread.
+   * the other end (for reading) is closed by the last transfer.
    */
 #ifndef USE_EVENTFD
   if(addr_ctx->sock_pair[1] != CURL_SOCKET_BAD) {
@@ -138,16 +202,31 @@ static void addr_ctx_destroy(struct async_thrdd_addr_ctx *addr_ctx)
   }
 }
 
-/* Initialize context for threaded resolver */
+/* Release a reference to the lookup, pool mutex held. Returns TRUE when
+ * this released the last reference to the pool. */
+static bool addr_ctx_unref(struct async_thrdd_addr_ctx *addr_ctx)
+{
+  struct async_thrdd_pool *pool = addr_ctx->pool;
+
+  DEBUGASSERT(addr_ctx->ref_count > 0);
+  if(--addr_ctx->ref_count)
+    return FALSE;
+  addr_ctx_destroy(addr_ctx);
+  /* each lookup holds a reference to the pool */
+  return !--pool->ref_count;
+}
+
+/* Initialize context for threaded resolver, pool mutex held */
 static struct async_thrdd_addr_ctx *
-addr_ctx_create(const char *hostname, int port,
+addr_ctx_create(struct async_thrdd_pool *pool, char *key,
+                const char *hostname, int port,
                 const struct addrinfo *hints)
 {
   struct async_thrdd_addr_ctx *addr_ctx = calloc(1, sizeof(*addr_ctx));
   if(!addr_ctx)
     return NULL;
 
-  addr_ctx->thread_hnd = curl_thread_t_null;
+  addr_ctx->pool = pool;
   addr_ctx->port = port;
 #ifndef CURL_DISABLE_SOCKETPAIR
   addr_ctx->sock_pair[0] = CURL_SOCKET_BAD;
@@ -162,8 +241,6 @@ addr_ctx_create(const char *hostname, int port,
   (void) hints;
 #endif
 
-  Curl_mutex_init(&addr_ctx->mutx);
-
 #ifndef CURL_DISABLE_SOCKETPAIR
   /* create socket pair or pipe */
   if(wakeup_create(addr_ctx->sock_pair, FALSE) < 0) {
@@ -181,7 +258,11 @@ addr_ctx_create(const char *hostname, int port,
   if(!addr_ctx->hostname)
     goto err_exit;
 
-  addr_ctx->ref_count = 1;
+  addr_ctx->key = key;
+  /* one reference for the transfer and one for the pool's queue */
+  addr_ctx->ref_count = 2;
+  addr_ctx->xfers = 1;
+  ++pool->ref_count;
   return addr_ctx;
 
 err_exit:
@@ -198,23 +279,13 @@ err_exit:
 #ifdef HAVE_GETADDRINFO
 
 /*
- * getaddrinfo_thread() resolves a name and then exits.
- *
- * For builds without ARES, but with USE_IPV6, create a resolver thread
- * and wait on it.
+ * addr_ctx_resolve() resolves a name using getaddrinfo(), without
+ * holding the pool mutex.
  */
-static
-#if defined(CURL_WINDOWS_UWP) || defined(UNDER_CE)
-DWORD
-#else
-unsigned int
-#endif
-CURL_STDCALL getaddrinfo_thread(void *arg)
+static void addr_ctx_resolve(struct async_thrdd_addr_ctx *addr_ctx)
 {
-  struct async_thrdd_addr_ctx *addr_ctx = arg;
   char service[12];
   int rc;
-  bool all_gone;
 
   msnprintf(service, sizeof(service), "%d", addr_ctx->port);
 
@@ -229,39 +300,57 @@ CURL_STDCALL getaddrinfo_thread(void *arg)
   else {
     Curl_addrinfo_set_port(addr_ctx->res, addr_ctx->port);
   }
+}
 
-  Curl_mutex_acquire(&addr_ctx->mutx);
-  if(addr_ctx->ref_count > 1) {
-    /* Someone still waiting on our results. */
+#else /* HAVE_GETADDRINFO */
+
+/*
+ * addr_ctx_resolve() resolves a name using gethostbyname(), without
+ * holding the pool mutex.
+ */
+static void addr_ctx_resolve(struct async_thrdd_addr_ctx *addr_ctx)
+{
+  addr_ctx->res = Curl_ipv4_resolve_r(addr_ctx->hostname, addr_ctx->port);
+
+  if(!addr_ctx->res) {
+    addr_ctx->sock_error = SOCKERRNO;
+    if(addr_ctx->sock_error == 0)
+      addr_ctx->sock_error = RESOLVER_ENOMEM;
+  }
+}
+
+#endif /* HAVE_GETADDRINFO */
+
+/* A thread has resolved the lookup, pool mutex held. */
+static bool addr_ctx_done(struct async_thrdd_addr_ctx *addr_ctx)
+{
+  struct async_thrdd_pool *pool = addr_ctx->pool;
+
+  addr_ctx->done = TRUE;
+  /* later lookups of the name start anew */
+  Curl_hash_delete(&pool->lookups, addr_ctx->key, strlen(addr_ctx->key) + 1);
 #ifndef CURL_DISABLE_SOCKETPAIR
-    if(addr_ctx->sock_pair[1] != CURL_SOCKET_BAD) {
+  if(addr_ctx->xfers && (addr_ctx->sock_pair[1] != CURL_SOCKET_BAD)) {
+    /* Someone still waiting on our results. */
 #ifdef USE_EVENTFD
-      const uint64_t buf[1] = { 1 };
+    const uint64_t buf[1] = { 1 };
 #else
-      const char buf[1] = { 1 };
+    const char buf[1] = { 1 };
 #endif
-      /* DNS has been resolved, signal client task */
-      if(wakeup_write(addr_ctx->sock_pair[1], buf, sizeof(buf)) < 0) {
-        /* update sock_erro to errno */
-        addr_ctx->sock_error = SOCKERRNO;
-      }
+    /* DNS has been resolved, signal client task */
+    if(wakeup_write(addr_ctx->sock_pair[1], buf, sizeof(buf)) < 0) {
+      /* update sock_erro to errno */
+      addr_ctx->sock_error = SOCKERRNO;
     }
-#endif
   }
-  /* thread gives up its reference to the shared data now. */
-  --addr_ctx->ref_count;
-  all_gone = !addr_ctx->ref_count;
-  Curl_mutex_release(&addr_ctx->mutx);
-  if(all_gone)
-    addr_ctx_destroy(addr_ctx);
-
-  return 0;
+#endif
+  /* the pool gives up its reference to the lookup now. */
+  return addr_ctx_unref(addr_ctx);
 }
 
-#else /* HAVE_GETADDRINFO */
-
 /*
- * gethostbyname_thread() resolves a name and then exits.
+ * async_thrdd_worker() resolves the queued lookups and exits when the
+ * queue is empty.
  */
 static
 #if defined(CURL_WINDOWS_UWP) || defined(UNDER_CE)
@@ -269,34 +358,199 @@ DWORD
 #else
 unsigned int
 #endif
-CURL_STDCALL gethostbyname_thread(void *arg)
+CURL_STDCALL async_thrdd_worker(void *arg)
 {
-  struct async_thrdd_addr_ctx *addr_ctx = arg;
+  struct async_thrdd_worker *w = arg;
+  struct async_thrdd_pool *pool = w->pool;
+  struct Curl_llist_node *e;
   bool all_gone;
 
-  addr_ctx->res = Curl_ipv4_resolve_r(addr_ctx->hostname, addr_ctx->port);
+  Curl_mutex_acquire(&pool->mutx);
+  for(e = Curl_llist_head(&pool->queue); e && !pool->closed;
+      e = Curl_llist_head(&pool->queue)) {
+    struct async_thrdd_addr_ctx *addr_ctx = Curl_node_elem(e);
+
+    Curl_node_remove(e);
+    addr_ctx->queued = FALSE;
+    w->busy = TRUE;
+#ifdef UNITTESTS
+    while(pool->hold && !pool->closed) {
+      Curl_mutex_release(&pool->mutx);
+      Curl_wait_ms(1);
+      Curl_mutex_acquire(&pool->mutx);
+    }
+#endif
+    Curl_mutex_release(&pool->mutx);
 
-  if(!addr_ctx->res) {
-    addr_ctx->sock_error = SOCKERRNO;
-    if(addr_ctx->sock_error == 0)
-      addr_ctx->sock_error = RESOLVER_ENOMEM;
-  }
+    addr_ctx_resolve(addr_ctx);
 
-  Curl_mutex_acquire(&addr_ctx->mutx);
-  /* thread gives up its reference to the shared data now. */
-  --addr_ctx->ref_count;
-  all_gone = !addr_ctx->ref_count;;
-  Curl_mutex_release(&addr_ctx->mutx);
+    Curl_mutex_acquire(&pool->mutx);
+    w->busy = FALSE;
+    /* the thread holds a reference, the pool cannot be gone */
+    (void)addr_ctx_done(addr_ctx);
+  }
+  /* thread gives up its reference to the pool now. */
+  w->done = TRUE;
+  --pool->nworkers;
+  all_gone = !--pool->ref_count;
+  Curl_mutex_release(&pool->mutx);
   if(all_gone)
-    addr_ctx_destroy(addr_ctx);
+    pool_free(pool);
 
   return 0;
 }
 
-#endif /* HAVE_GETADDRINFO */
+/* Make sure a thread runs for the queued lookups, pool mutex held.
+ * Returns FALSE if no thread runs. */
+static bool pool_start_worker(struct async_thrdd_pool *pool,
+                              unsigned int max_workers)
+{
+  struct Curl_llist_node *e, *n;
+  struct async_thrdd_worker *w;
+
+  /* join the threads that have finished */
+  for(e = Curl_llist_head(&pool->workers); e; e = n) {
+    n = Curl_node_next(e);
+    w = Curl_node_elem(e);
+    if(w->done) {
+      Curl_node_remove(e);
+      Curl_thread_join(&w->thread_hnd);
+      free(w);
+    }
+  }
+
+  if(pool->nworkers >= max_workers)
+    return TRUE;
+
+  w = calloc(1, sizeof(*w));
+  if(!w)
+    return pool->nworkers > 0;
+  w->pool = pool;
+  /* passing the pool to the thread adds a reference */
+  ++pool->ref_count;
+  ++pool->nworkers;
+  w->thread_hnd = Curl_thread_create(async_thrdd_worker, w);
+  if(w->thread_hnd == curl_thread_t_null) {
+    /* The thread never started, remove its reference that never happened. */
+    --pool->ref_count;
+    --pool->nworkers;
+    free(w);
+    return pool->nworkers > 0;
+  }
+  Curl_llist_append(&pool->workers, w, &w->node);
+  return TRUE;
+}
+
+void Curl_async_thrdd_pool_close(struct async_thrdd_pool **ppool)
+{
+  struct async_thrdd_pool *pool = *ppool;
+  struct Curl_llist joins;
+  struct Curl_llist_node *e, *n;
+  bool all_gone;
+
+  if(!pool)
+    return;
+  *ppool = NULL;
+
+  Curl_llist_init(&joins, NULL);
+  Curl_mutex_acquire(&pool->mutx);
+  pool->closed = TRUE;
+  for(e = Curl_llist_head(&pool->workers); e; e = n) {
+    struct async_thrdd_worker *w = Curl_node_elem(e);
+    n = Curl_node_next(e);
+    if(w->busy) {
+      /* Detach the thread while mutexed, it releases the pool when done. */
+      Curl_thread_destroy(&w->thread_hnd);
+    }
+    else {
+      Curl_node_remove(e);
+      Curl_llist_append(&joins, w, &w->node);
+    }
+  }
+  Curl_mutex_release(&pool->mutx);
+
+  /* threads not resolving anything see the pool closed and end */
+  for(e = Curl_llist_head(&joins); e; e = Curl_llist_head(&joins)) {
+    struct async_thrdd_worker *w = Curl_node_take_elem(e);
+    if(w->thread_hnd != curl_thread_t_null)
+      Curl_thread_join(&w->thread_hnd);
+    free(w);
+  }
+
+  Curl_mutex_acquire(&pool->mutx);
+  all_gone = !--pool->ref_count;
+  Curl_mutex_release(&pool->mutx);
+  if(all_gone)
+    pool_free(pool);
+}
+
+#ifdef UNITTESTS
+void Curl_async_thrdd_pool_hold(struct Curl_multi *multi, bool hold)
+{
+  if(!multi->resolver_pool) {
+    multi->resolver_pool = pool_create();
+    if(!multi->resolver_pool)
+      return;
+  }
+  Curl_mutex_acquire(&multi->resolver_pool->mutx);
+  multi->resolver_pool->hold = hold;
+  Curl_mutex_release(&multi->resolver_pool->mutx);
+}
+#endif
 
 /*
- * async_thrdd_destroy() cleans up async resolver data and thread handle.
+ * addr_ctx_release() gives up the reference of a transfer, or of a refresh
+ * when 'data' is NULL, to the lookup.
+ */
+static void addr_ctx_release(struct Curl_easy *data,
+                             struct async_thrdd_addr_ctx *addr)
+{
+  struct async_thrdd_pool *pool = addr->pool;
+#ifndef CURL_DISABLE_SOCKETPAIR
+  curl_socket_t sock_rd = CURL_SOCKET_BAD;
+#endif
+  bool all_gone;
+
+  /* Release our reference to the data shared with the pool. */
+  Curl_mutex_acquire(&pool->mutx);
+  --addr->xfers;
+  if(!addr->xfers) {
+#ifndef CURL_DISABLE_SOCKETPAIR
+    /* the last transfer closes the reading end */
+    sock_rd = addr->sock_pair[0];
+    addr->sock_pair[0] = CURL_SOCKET_BAD;
+#endif
+    if(addr->queued) {
+      /* no one wants it anymore, drop it before a thread picks it up */
+      Curl_node_remove(&addr->node);
+      Curl_hash_delete(&pool->lookups, addr->key, strlen(addr->key) + 1);
+      addr->queued = FALSE;
+      --addr->ref_count;
+    }
+  }
+  all_gone = addr_ctx_unref(addr);
+  Curl_mutex_release(&pool->mutx);
+  if(all_gone)
+    pool_free(pool);
+
+#ifndef CURL_DISABLE_SOCKETPAIR
+  if(sock_rd != CURL_SOCKET_BAD) {
+    /*
+     * ensure CURLMOPT_SOCKETFUNCTION fires CURL_POLL_REMOVE
+     * before the FD is invalidated to avoid EBADF on EPOLL_CTL_DEL
+     */
+    if(data)
+      Curl_multi_will_close(data, sock_rd);
+    wakeup_close(sock_rd);
+  }
+#else
+  (void)data;
+#endif
+}
+
+/*
+ * async_thrdd_destroy() releases the transfer's lookup and cleans up the
+ * async resolver data.
  */
 static void async_thrdd_destroy(struct Curl_easy *data)
 {
@@ -311,44 +565,13 @@ static void async_thrdd_destroy(struct Curl_easy *data)
 #endif
 
   if(addr) {
-#ifndef CURL_DISABLE_SOCKETPAIR
-    curl_socket_t sock_rd = addr->sock_pair[0];
-#endif
-    bool done;
-
-    /* Release our reference to the data shared with the thread. */
-    Curl_mutex_acquire(&addr->mutx);
-    --addr->ref_count;
-    CURL_TRC_DNS(data, "resolve, destroy async data, shared ref=%d",
-                 addr->ref_count);
-    done = !addr->ref_count;
+    CURL_TRC_DNS(data, "resolve, destroy async data");
     /* we give up our reference to `addr`, so NULL our pointer.
      * coverity analyses this as being a potential unsynched write,
      * assuming two calls to this function could be invoked concurrently.
      * Which they never are, as the transfer's side runs single-threaded. */
     thrdd->addr = NULL;
-    if(!done) {
-      /* thread is still running. Detach the thread while mutexed, it will
-       * trigger the cleanup when it releases its reference. */
-      Curl_thread_destroy(&addr->thread_hnd);
-    }
-    Curl_mutex_release(&addr->mutx);
-
-    if(done) {
-      /* thread has released its reference, join it and
-       * release the memory we shared with it. */
-      if(addr->thread_hnd != curl_thread_t_null)
-        Curl_thread_join(&addr->thread_hnd);
-      addr_ctx_destroy(addr);
-    }
-#ifndef CURL_DISABLE_SOCKETPAIR
-    /*
-     * ensure CURLMOPT_SOCKETFUNCTION fires CURL_POLL_REMOVE
-     * before the FD is invalidated to avoid EBADF on EPOLL_CTL_DEL
-     */
-    Curl_multi_will_close(data, sock_rd);
-    wakeup_close(sock_rd);
-#endif
+    addr_ctx_release(data, addr);
   }
 }
 
@@ -391,8 +614,85 @@ static CURLcode async_rr_start(struct Curl_easy *data)
 #endif
 
 /*
- * async_thrdd_init() starts a new thread that performs the actual
- * resolve. This function returns before the resolve is done.
+ * pool_lookup() queues a lookup at the resolver pool of the transfer's multi
+ * handle, or joins an identical one that is not done yet. The caller holds
+ * a reference to the returned lookup.
+ */
+static struct async_thrdd_addr_ctx *pool_lookup(struct Curl_easy *data,
+                                                const char *hostname,
+                                                int port,
+                                                const struct addrinfo *hints,
+                                                int *perr)
+{
+  struct async_thrdd_addr_ctx *addr_ctx;
+  struct async_thrdd_pool *pool;
+  char *key;
+  bool started;
+
+  DEBUGASSERT(data->multi);
+  if(!data->multi)
+    return NULL;
+  if(!data->multi->resolver_pool) {
+    data->multi->resolver_pool = pool_create();
+    if(!data->multi->resolver_pool)
+      return NULL;
+  }
+  pool = data->multi->resolver_pool;
+
+#ifdef HAVE_GETADDRINFO
+  key = aprintf("%s:%d:%d:%d", hostname, port,
+                hints->ai_family, hints->ai_socktype);
+#else
+  key = aprintf("%s:%d", hostname, port);
+#endif
+  if(!key)
+    return NULL;
+
+  Curl_mutex_acquire(&pool->mutx);
+  addr_ctx = Curl_hash_pick(&pool->lookups, key, strlen(key) + 1);
+  if(addr_ctx) {
+    /* someone resolves this already, wait for the same result */
+    ++addr_ctx->ref_count;
+    ++addr_ctx->xfers;
+    Curl_mutex_release(&pool->mutx);
+    free(key);
+    CURL_TRC_DNS(data, "resolve of %s:%d joins lookup in progress, "
+                 "shared ref=%d", hostname, port, addr_ctx->ref_count);
+    return addr_ctx;
+  }
+
+  addr_ctx = addr_ctx_create(pool, key, hostname, port, hints);
+  if(!addr_ctx) {
+    Curl_mutex_release(&pool->mutx);
+    free(key);
+    return NULL;
+  }
+  if(!Curl_hash_add(&pool->lookups, key, strlen(key) + 1, addr_ctx)) {
+    /* the lookup owns `key` now */
+    addr_ctx->ref_count = 0;
+    --pool->ref_count;
+    addr_ctx_destroy(addr_ctx);
+    Curl_mutex_release(&pool->mutx);
+    return NULL;
+  }
+  Curl_llist_append(&pool->queue, addr_ctx, &addr_ctx->node);
+  addr_ctx->queued = TRUE;
+  started = pool_start_worker(pool, data->multi->max_resolver_threads);
+  if(!started)
+    *perr = errno;
+  Curl_mutex_release(&pool->mutx);
+  if(!started) {
+    addr_ctx_release(data, addr_ctx);
+    return NULL;
+  }
+  CURL_TRC_DNS(data, "resolve of %s:%d queued for a thread",
+               hostname, port);
+  return addr_ctx;
+}
+
+/*
+ * async_thrdd_init() starts the transfer's lookup at the resolver pool.
+ * This function returns before the resolve is done.
  *
  * Returns FALSE in case of failure, otherwise TRUE.
  */
@@ -401,7 +701,6 @@ static bool async_thrdd_init(struct Curl_easy *data,
                              const struct addrinfo *hints)
 {
   struct async_thrdd_ctx *thrdd = &data->state.async.thrdd;
-  struct async_thrdd_addr_ctx *addr_ctx;
 
   /* !checksrc! disable ERRNOVAR 1 */
   int err = ENOMEM;
@@ -427,35 +726,18 @@ static bool async_thrdd_init(struct Curl_easy *data,
   if(!data->state.async.hostname)
     goto err_exit;
 
-  addr_ctx = addr_ctx_create(hostname, port, hints);
-  if(!addr_ctx)
-    goto err_exit;
-  thrdd->addr = addr_ctx;
+  thrdd->start = curlx_now();
+  thrdd->poll_interval = 0;
+  thrdd->interval_end = 0;
 
-  Curl_mutex_acquire(&addr_ctx->mutx);
-  DEBUGASSERT(addr_ctx->ref_count == 1);
-  /* passing addr_ctx to the thread adds a reference */
-  addr_ctx->start = curlx_now();
-  ++addr_ctx->ref_count;
-#ifdef HAVE_GETADDRINFO
-  addr_ctx->thread_hnd = Curl_thread_create(getaddrinfo_thread, addr_ctx);
-#else
-  addr_ctx->thread_hnd = Curl_thread_create(gethostbyname_thread, addr_ctx);
-#endif
-  if(addr_ctx->thread_hnd == curl_thread_t_null) {
-    /* The thread never started, remove its reference that never happened. */
-    --addr_ctx->ref_count;
-    err = errno;
-    Curl_mutex_release(&addr_ctx->mutx);
+  thrdd->addr = pool_lookup(data, hostname, port, hints, &err);
+  if(!thrdd->addr)
     goto err_exit;
-  }
-  Curl_mutex_release(&addr_ctx->mutx);
 
 #ifdef USE_HTTPSRR_ARES
   if(async_rr_start(data))
     infof(data, "Failed HTTPS RR operation");
 #endif
-  CURL_TRC_DNS(data, "resolve thread started for of %s:%d", hostname, port);
   return TRUE;
 
 err_exit:
@@ -472,18 +754,28 @@ static CURLcode asyn_thrdd_await(struct Curl_easy *data,
                                  struct async_thrdd_addr_ctx *addr_ctx,
                                  struct Curl_dns_entry **entry)
 {
+  struct async_thrdd_pool *pool = addr_ctx->pool;
   CURLcode result = CURLE_OK;
-
-  DEBUGASSERT(addr_ctx->thread_hnd != curl_thread_t_null);
-
-  CURL_TRC_DNS(data, "resolve, wait for thread to finish");
-  /* wait for the thread to resolve the name */
-  if(Curl_thread_join(&addr_ctx->thread_hnd)) {
-    if(entry)
-      result = Curl_async_is_resolved(data, entry);
+  bool done;
+
+  CURL_TRC_DNS(data, "resolve, wait for lookup to finish");
+  /* wait for a thread to resolve the name */
+  for(;;) {
+    Curl_mutex_acquire(&pool->mutx);
+    done = addr_ctx->done;
+    Curl_mutex_release(&pool->mutx);
+    if(done)
+      break;
+#ifndef CURL_DISABLE_SOCKETPAIR
+    /* the pair stays readable once signaled */
+    (void)SOCKET_READABLE(addr_ctx->sock_pair[0], 1000);
+#else
+    (void)Curl_wait_ms(10);
+#endif
   }
-  else
-    DEBUGASSERT(0);
+
+  if(entry)
+    result = Curl_async_is_resolved(data, entry);
 
   data->state.async.done = TRUE;
   if(entry)
@@ -495,21 +787,13 @@ static CURLcode asyn_thrdd_await(struct Curl_easy *data,
 
 
 /*
- * Until we gain a way to signal the resolver threads to stop early, we must
- * simply wait for them and ignore their results.
+ * A lookup nobody waits for anymore is dropped from the queue or keeps
+ * running in the pool until it is done. The multi handle waits for the
+ * running ones when it is cleaned up.
  */
 void Curl_async_thrdd_shutdown(struct Curl_easy *data)
 {
-  struct async_thrdd_ctx *thrdd = &data->state.async.thrdd;
-
-  /* If we are still resolving, we must wait for the threads to fully clean up,
-     unfortunately. Otherwise, we can simply cancel to clean up any resolver
-     data. */
-  if(thrdd->addr && (thrdd->addr->thread_hnd != curl_thread_t_null) &&
-     !data->set.quick_exit)
-    (void)asyn_thrdd_await(data, thrdd->addr, NULL);
-  else
-    async_thrdd_destroy(data);
+  async_thrdd_destroy(data);
 }
 
 void Curl_async_thrdd_destroy(struct Curl_easy *data)
@@ -570,9 +854,9 @@ CURLcode Curl_async_is_resolved(struct Curl_easy *data,
   if(!thrdd->addr)
     return CURLE_FAILED_INIT;
 
-  Curl_mutex_acquire(&thrdd->addr->mutx);
-  done = (thrdd->addr->ref_count == 1);
-  Curl_mutex_release(&thrdd->addr->mutx);
+  Curl_mutex_acquire(&thrdd->addr->pool->mutx);
+  done = thrdd->addr->done;
+  Curl_mutex_release(&thrdd->addr->pool->mutx);
 
   if(done) {
     CURLcode result = CURLE_OK;
@@ -580,12 +864,13 @@ CURLcode Curl_async_is_resolved(struct Curl_easy *data,
     data->state.async.done = TRUE;
     Curl_resolv_unlink(data, &data->state.async.dns);
 
+    /* the result no longer changes, but other transfers may use it */
     if(thrdd->addr->res) {
-      data->state.async.dns =
-        Curl_dnscache_mk_entry(data, thrdd->addr->res,
-                               data->state.async.hostname, 0,
-                               data->state.async.port, FALSE);
-      thrdd->addr->res = NULL;
+      struct Curl_addrinfo *ai = Curl_addrinfo_dup(thrdd->addr->res);
+      if(ai)
+        data->state.async.dns =
+          Curl_dnscache_mk_entry(data, ai, data->state.async.hostname, 0,
+                                 data->state.async.port, FALSE);
       if(!data->state.async.dns)
         result = CURLE_OUT_OF_MEMORY;
 
@@ -624,18 +909,18 @@ CURLcode Curl_async_is_resolved(struct Curl_easy *data,
     if(elapsed < 0)
       elapsed = 0;
 
-    if(thrdd->addr->poll_interval == 0)
+    if(thrdd->poll_interval == 0)
       /* Start at 1ms poll interval */
-      thrdd->addr->poll_interval = 1;
-    else if(elapsed >= thrdd->addr->interval_end)
+      thrdd->poll_interval = 1;
+    else if(elapsed >= thrdd->interval_end)
       /* Back-off exponentially if last interval expired  */
-      thrdd->addr->poll_interval *= 2;
+      thrdd->poll_interval *= 2;
 
-    if(thrdd->addr->poll_interval > 250)
-      thrdd->addr->poll_interval = 250;
+    if(thrdd->poll_interval > 250)
+      thrdd->poll_interval = 250;
 
-    thrdd->addr->interval_end = elapsed + thrdd->addr->poll_interval;
-    Curl_expire(data, thrdd->addr->poll_interval, EXPIRE_ASYNC_NAME);
+    thrdd->interval_end = elapsed + thrdd->poll_interval;
+    Curl_expire(data, thrdd->poll_interval, EXPIRE_ASYNC_NAME);
     return CURLE_OK;
   }
 }
@@ -672,7 +957,7 @@ int Curl_async_getsock(struct Curl_easy *data, curl_socket_t *socks)
 #endif
   {
     timediff_t milli;
-    timediff_t ms = curlx_timediff(curlx_now(), thrdd->addr->start);
+    timediff_t ms = curlx_timediff(curlx_now(), thrdd->start);
     if(ms < 3)
       milli = 0;
     else if(ms <= 50)
@@ -687,6 +972,57 @@ int Curl_async_getsock(struct Curl_easy *data, curl_socket_t *socks)
   return ret_val;
 }
 
+struct async_thrdd_addr_ctx *Curl_async_thrdd_refresh(struct Curl_easy *data,
+                                                      const char *hostname,
+                                                      int port)
+{
+  /* !checksrc! disable ERRNOVAR 1 */
+  int err = ENOMEM;
+#ifdef HAVE_GETADDRINFO
+  struct addrinfo hints;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = PF_INET;
+#ifdef CURLRES_IPV6
+  if(Curl_ipv6works(data))
+    hints.ai_family = PF_UNSPEC;
+#endif
+  hints.ai_socktype = (data->conn && (data->conn->transport != TRNSPRT_TCP)) ?
+    SOCK_DGRAM : SOCK_STREAM;
+  return pool_lookup(data, hostname, port, &hints, &err);
+#else
+  return pool_lookup(data, hostname, port, NULL, &err);
+#endif
+}
+
+bool Curl_async_thrdd_refresh_take(struct async_thrdd_addr_ctx **paddr,
+                                   struct Curl_addrinfo **pres)
+{
+  struct async_thrdd_addr_ctx *addr = *paddr;
+  bool done;
+
+  *pres = NULL;
+  Curl_mutex_acquire(&addr->pool->mutx);
+  /* a closed pool may never get to it */
+  done = addr->done || addr->pool->closed;
+  if(addr->done && addr->res)
+    *pres = Curl_addrinfo_dup(addr->res);
+  Curl_mutex_release(&addr->pool->mutx);
+  if(done) {
+    *paddr = NULL;
+    addr_ctx_release(NULL, addr);
+  }
+  return done;
+}
+
+void Curl_async_thrdd_refresh_release(struct async_thrdd_addr_ctx **paddr)
+{
+  if(*paddr) {
+    addr_ctx_release(NULL, *paddr);
+    *paddr = NULL;
+  }
+}
+
 #ifndef HAVE_GETADDRINFO
 /*
  * Curl_async_getaddrinfo() - for platforms without getaddrinfo
@@ -171,13 +171,19 @@ CURLcode Curl_async_ares_set_dns_local_ip6(struct Curl_easy *data);
 #ifdef CURLRES_THREADED
 /* async resolving implementation using POSIX threads */
 #include "curl_threads.h"
+#include "llist.h"
 
-/* Context for threaded address resolver */
+struct Curl_multi;
+struct async_thrdd_pool;
+
+/* A name lookup run by a thread of the resolver pool of a multi handle.
+ * Transfers resolving the same name and port with the same hints at the
+ * same time share one. All members are protected by the pool's mutex. */
 struct async_thrdd_addr_ctx {
-  curl_thread_t thread_hnd;
-  char *hostname;        /* hostname to resolve, Curl_async.hostname
-                            duplicate */
-  curl_mutex_t mutx;
+  struct Curl_llist_node node;  /* in the pool's queue while waiting */
+  struct async_thrdd_pool *pool;
+  char *key;             /* in the pool's hash of unfinished lookups */
+  char *hostname;        /* hostname to resolve */
 #ifndef CURL_DISABLE_SOCKETPAIR
   curl_socket_t sock_pair[2]; /* eventfd/pipes/socket pair */
 #endif
@@ -185,21 +191,24 @@ struct async_thrdd_addr_ctx {
 #ifdef HAVE_GETADDRINFO
   struct addrinfo hints;
 #endif
-  struct curltime start;
-  timediff_t interval_end;
-  unsigned int poll_interval;
   int port;
   int sock_error;
-  int ref_count;
+  int ref_count;         /* the transfers and the pool holding it */
+  unsigned int xfers;    /* the transfers waiting for it */
+  BIT(queued);           /* waiting for a thread */
+  BIT(done);             /* resolved or failed */
 };
 
 /* Context for threaded resolver */
 struct async_thrdd_ctx {
-  /* `addr` is a pointer since this memory is shared with a started
-   * thread. Since threads cannot be killed, we use reference counting
-   * so that we can "release" our pointer to this memory while the
-   * thread is still running. */
+  /* `addr` is a pointer since this memory is shared with the pool's
+   * threads and other transfers. Since threads cannot be killed, we use
+   * reference counting so that we can "release" our pointer to this
+   * memory while the lookup is still running. */
   struct async_thrdd_addr_ctx *addr;
+  struct curltime start;
+  timediff_t interval_end;
+  unsigned int poll_interval;
 #if defined(USE_HTTPSRR) && defined(USE_ARES)
   struct {
     ares_channel channel;
@@ -213,6 +222,45 @@ struct async_thrdd_ctx {
 void Curl_async_thrdd_shutdown(struct Curl_easy *data);
 void Curl_async_thrdd_destroy(struct Curl_easy *data);
 
+/*
+ * Curl_async_thrdd_pool_close()
+ *
+ * Called when the multi handle owning the resolver pool is cleaned up.
+ * Threads running a lookup are detached. They keep the pool alive until
+ * they are done.
+ */
+void Curl_async_thrdd_pool_close(struct async_thrdd_pool **ppool);
+
+#ifdef UNITTESTS
+/* used by unit3217.c, makes the pool's threads wait before resolving
+ * a name taken from the queue while `hold` is set */
+void Curl_async_thrdd_pool_hold(struct Curl_multi *multi, bool hold);
+#endif
+
+/*
+ * Curl_async_thrdd_refresh()
+ *
+ * Starts resolving the name in the resolver pool of the transfer's multi
+ * handle without the transfer waiting for it. The DNS cache refreshes its
+ * entries this way. Returns NULL on failure.
+ */
+struct async_thrdd_addr_ctx *Curl_async_thrdd_refresh(struct Curl_easy *data,
+                                                      const char *hostname,
+                                                      int port);
+
+/*
+ * Curl_async_thrdd_refresh_take()
+ *
+ * Returns TRUE when the refresh is done or can no longer finish. It then
+ * gives up the lookup and passes out a copy of the addresses, NULL when the
+ * lookup failed.
+ */
+bool Curl_async_thrdd_refresh_take(struct async_thrdd_addr_ctx **paddr,
+                                   struct Curl_addrinfo **pres);
+
+/* Gives up a refresh that may still be running */
+void Curl_async_thrdd_refresh_release(struct async_thrdd_addr_ctx **paddr);
+
 #endif /* CURLRES_THREADED */
 
 #ifndef CURL_DISABLE_DOH
@@ -248,7 +296,11 @@ struct Curl_async {
   char *hostname; /* copy of the params resolv started with */
   int port;
   int ip_version;
+  unsigned int wait_ms; /* poll interval while waiting for another lookup */
   BIT(done);
+  BIT(pending);   /* runs the lookup other transfers may wait for */
+  BIT(coalesced); /* waits for the lookup of another transfer */
+  BIT(allow_doh); /* may use DoH when it has to do its own lookup */
 };
 
 /*
@@ -0,0 +1,202 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+
+#include "curl_setup.h"
+
+#include <curl/curl.h>
+
+#include "urldata.h"
+#include "borrow.h"
+#include "multiif.h"
+
+#if defined(HAVE_ATOMIC) && defined(HAVE_STDATOMIC_H)
+#include <stdatomic.h>
+#define BORROW_ATOMIC
+#elif defined(USE_THREADS_POSIX) || defined(USE_THREADS_WIN32)
+#include "curl_threads.h"
+#define BORROW_MUTEX
+#endif
+
+/* The last 3 #include files should be in this order */
+#include "curl_printf.h"
+#include "curl_memory.h"
+#include "memdebug.h"
+
+/* The application may release references from another thread than the
+ * one running the transfer. */
+struct curl_borrow {
+#ifdef BORROW_ATOMIC
+  atomic_size_t refs;
+#else
+  size_t refs;
+#ifdef BORROW_MUTEX
+  curl_mutex_t lock;
+#endif
+#endif
+  size_t size;
+  char *mem; /* `size` bytes, allocated together with the struct */
+};
+
+struct curl_borrow *Curl_borrow_create(size_t size)
+{
+  struct curl_borrow *b = malloc(sizeof(*b) + size);
+  if(b) {
+#ifdef BORROW_ATOMIC
+    atomic_init(&b->refs, 1);
+#else
+    b->refs = 1;
+#ifdef BORROW_MUTEX
+    Curl_mutex_init(&b->lock);
+#endif
+#endif
+    b->size = size;
+    b->mem = (char *)b + sizeof(*b);
+  }
+  return b;
+}
+
+void Curl_borrow_hold(struct curl_borrow *b)
+{
+#ifdef BORROW_ATOMIC
+  atomic_fetch_add_explicit(&b->refs, 1, memory_order_relaxed);
+#else
+#ifdef BORROW_MUTEX
+  Curl_mutex_acquire(&b->lock);
+#endif
+  ++b->refs;
+#ifdef BORROW_MUTEX
+  Curl_mutex_release(&b->lock);
+#endif
+#endif
+}
+
+void Curl_borrow_drop(struct curl_borrow *b)
+{
+  size_t refs;
+
+  if(!b)
+    return;
+#ifdef BORROW_ATOMIC
+  refs = atomic_fetch_sub_explicit(&b->refs, 1, memory_order_acq_rel) - 1;
+#else
+#ifdef BORROW_MUTEX
+  Curl_mutex_acquire(&b->lock);
+#endif
+  DEBUGASSERT(b->refs);
+  refs = --b->refs;
+#ifdef BORROW_MUTEX
+  Curl_mutex_release(&b->lock);
+#endif
+#endif
+  if(!refs) {
+#ifdef BORROW_MUTEX
+    Curl_mutex_destroy(&b->lock);
+#endif
+    free(b);
+  }
+}
+
+/* TRUE iff others than the caller hold a reference */
+static bool borrow_is_shared(struct curl_borrow *b)
+{
+  size_t refs;
+#ifdef BORROW_ATOMIC
+  refs = atomic_load_explicit(&b->refs, memory_order_acquire);
+#else
+#ifdef BORROW_MUTEX
+  Curl_mutex_acquire(&b->lock);
+#endif
+  refs = b->refs;
+#ifdef BORROW_MUTEX
+  Curl_mutex_release(&b->lock);
+#endif
+#endif
+  return refs > 1;
+}
+
+char *Curl_borrow_mem(struct curl_borrow *b, size_t *psize)
+{
+  *psize = b->size;
+  return b->mem;
+}
+
+CURLcode Curl_borrow_renew(struct curl_borrow **pb, size_t size)
+{
+  if(*pb && ((*pb)->size != size || borrow_is_shared(*pb))) {
+    Curl_borrow_drop(*pb);
+    *pb = NULL;
+  }
+  if(!*pb) {
+    *pb = Curl_borrow_create(size);
+    if(!*pb)
+      return CURLE_OUT_OF_MEMORY;
+  }
+  return CURLE_OK;
+}
+
+struct curl_borrow *Curl_borrow_set_src(struct Curl_easy *data,
+                                        struct curl_borrow *b)
+{
+  struct curl_borrow *prev = NULL;
+  if(data->multi) {
+    prev = data->multi->xfer_borrow;
+    data->multi->xfer_borrow = b;
+  }
+  return prev;
+}
+
+CURLcode Curl_borrow_write(struct Curl_easy *data,
+                           const char *buf, size_t blen,
+                           size_t *pnwritten)
+{
+  struct curl_borrow *b = data->multi ? data->multi->xfer_borrow : NULL;
+  char *ptr;
+
+  DEBUGASSERT(data->set.fborrow);
+  if(b && (buf >= b->mem) && (blen <= b->size) &&
+     ((size_t)(buf - b->mem) <= (b->size - blen))) {
+    Curl_borrow_hold(b);
+    ptr = (char *)CURL_UNCONST(buf);
+  }
+  else {
+    /* not received into a borrow buffer, e.g. decoded or paused data */
+    b = Curl_borrow_create(blen);
+    if(!b)
+      return CURLE_OUT_OF_MEMORY;
+    memcpy(b->mem, buf, blen);
+    ptr = b->mem;
+  }
+
+  *pnwritten = data->set.fborrow(ptr, blen, b, data->set.borrow_data);
+  if(*pnwritten != blen) {
+    /* not accepted, the application does not hold it */
+    Curl_borrow_drop(b);
+  }
+  return CURLE_OK;
+}
+
+void curl_borrow_release(struct curl_borrow *b)
+{
+  Curl_borrow_drop(b);
+}
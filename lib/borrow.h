@@ -0,0 +1,68 @@
+#ifndef HEADER_CURL_BORROW_H
+#define HEADER_CURL_BORROW_H
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+
+#include "curl_setup.h"
+
+struct Curl_easy;
+
+/*
+ * A `struct curl_borrow` is a reference counted receive buffer. Data is
+ * received into it and passed to the CURLOPT_BORROWFUNCTION callback
+ * without being copied. Each piece the callback accepts holds a reference,
+ * which the application gives back with curl_borrow_release(). The
+ * buffer is only reused once all references are back.
+ */
+
+/* Create a borrow buffer of `size` bytes, holding one reference. */
+struct curl_borrow *Curl_borrow_create(size_t size);
+
+/* Add a reference to the buffer. */
+void Curl_borrow_hold(struct curl_borrow *b);
+
+/* Drop a reference, free the buffer with the last one. NULL is ok. */
+void Curl_borrow_drop(struct curl_borrow *b);
+
+/* Get the memory of the buffer and its size. */
+char *Curl_borrow_mem(struct curl_borrow *b, size_t *psize);
+
+/* Make `*pb` a buffer of `size` bytes that no one else holds a
+ * reference to, reusing the current one if possible. */
+CURLcode Curl_borrow_renew(struct curl_borrow **pb, size_t size);
+
+/* Set the buffer the transfer loop of the transfer's multi handle passes
+ * received data from, return the previous one. */
+struct curl_borrow *Curl_borrow_set_src(struct Curl_easy *data,
+                                        struct curl_borrow *b);
+
+/* Pass `blen` bytes at `buf` to the CURLOPT_BORROWFUNCTION callback.
+ * When `buf` lies in the current source buffer, the callback gets
+ * a reference to it, otherwise the bytes are copied into a new buffer.
+ * Returns what the callback returned in `*pnwritten`. */
+CURLcode Curl_borrow_write(struct Curl_easy *data,
+                           const char *buf, size_t blen,
+                           size_t *pnwritten);
+
+#endif /* HEADER_CURL_BORROW_H */
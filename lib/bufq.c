@@ -166,6 +166,11 @@ static void chunk_list_free(struct buf_chunk **anchor)
   }
 }
 
+static size_t chunk_mem(size_t chunk_size)
+{
+  return sizeof(struct buf_chunk) + chunk_size;
+}
+
 
 
 void Curl_bufcp_init(struct bufc_pool *pool,
@@ -178,26 +183,54 @@ void Curl_bufcp_init(struct bufc_pool *pool,
   pool->spare_max = spare_max;
 }
 
-static CURLcode bufcp_take(struct bufc_pool *pool,
+static void bufcp_drop_spare(struct bufc_pool *pool)
+{
+  struct buf_chunk *chunk = pool->spare;
+
+  pool->spare = chunk->next;
+  --pool->spare_count;
+  pool->mem -= chunk_mem(chunk->dlen);
+  free(chunk);
+}
+
+void Curl_bufcp_set_max_mem(struct bufc_pool *pool, size_t max_mem)
+{
+  pool->max_mem = max_mem;
+  while(pool->max_mem && pool->spare && (pool->mem > pool->max_mem))
+    bufcp_drop_spare(pool);
+}
+
+/* Take a chunk from the pool. Unless `force` is set, this fails with
+ * CURLE_AGAIN when a new chunk would exceed the pool's `max_mem`. */
+static CURLcode bufcp_take(struct bufc_pool *pool, bool force,
                            struct buf_chunk **pchunk)
 {
   struct buf_chunk *chunk = NULL;
+  size_t mem = chunk_mem(pool->chunk_size);
 
   if(pool->spare) {
     chunk = pool->spare;
     pool->spare = chunk->next;
     --pool->spare_count;
+    ++pool->stats.reused;
     chunk_reset(chunk);
     *pchunk = chunk;
     return CURLE_OK;
   }
 
-  chunk = calloc(1, sizeof(*chunk) + pool->chunk_size);
-  if(!chunk) {
-    *pchunk = NULL;
-    return CURLE_OUT_OF_MEMORY;
+  *pchunk = NULL;
+  if(!force && pool->max_mem && (pool->mem + mem > pool->max_mem)) {
+    ++pool->stats.denied;
+    return CURLE_AGAIN;
   }
+  chunk = calloc(1, mem);
+  if(!chunk)
+    return CURLE_OUT_OF_MEMORY;
   chunk->dlen = pool->chunk_size;
+  pool->mem += mem;
+  if(pool->mem > pool->stats.peak_mem)
+    pool->stats.peak_mem = pool->mem;
+  ++pool->stats.allocated;
   *pchunk = chunk;
   return CURLE_OK;
 }
@@ -205,7 +238,9 @@ static CURLcode bufcp_take(struct bufc_pool *pool,
 static void bufcp_put(struct bufc_pool *pool,
                       struct buf_chunk *chunk)
 {
-  if(pool->spare_count >= pool->spare_max) {
+  if((pool->spare_count >= pool->spare_max) ||
+     (pool->max_mem && (pool->mem > pool->max_mem))) {
+    pool->mem -= chunk_mem(chunk->dlen);
     free(chunk);
   }
   else {
@@ -216,10 +251,23 @@ static void bufcp_put(struct bufc_pool *pool,
   }
 }
 
+CURLcode Curl_bufcp_take(struct bufc_pool *pool, bool force,
+                         struct buf_chunk **pchunk)
+{
+  return bufcp_take(pool, force, pchunk);
+}
+
+void Curl_bufcp_put(struct bufc_pool *pool, struct buf_chunk *chunk)
+{
+  bufcp_put(pool, chunk);
+}
+
 void Curl_bufcp_free(struct bufc_pool *pool)
 {
-  chunk_list_free(&pool->spare);
-  pool->spare_count = 0;
+  while(pool->spare)
+    bufcp_drop_spare(pool);
+  /* all bufqs using the pool need to be freed before */
+  DEBUGASSERT(!pool->mem);
 }
 
 static void bufq_init(struct bufq *q, struct bufc_pool *pool,
@@ -253,6 +301,19 @@ void Curl_bufq_initp(struct bufq *q, struct bufc_pool *pool,
 
 void Curl_bufq_free(struct bufq *q)
 {
+  if(q->pool) {
+    struct buf_chunk *chunk;
+    while(q->head) {
+      chunk = q->head;
+      q->head = chunk->next;
+      bufcp_put(q->pool, chunk);
+    }
+    while(q->spare) {
+      chunk = q->spare;
+      q->spare = chunk->next;
+      bufcp_put(q->pool, chunk);
+    }
+  }
   chunk_list_free(&q->head);
   chunk_list_free(&q->spare);
   q->tail = NULL;
@@ -299,10 +360,24 @@ bool Curl_bufq_is_full(const struct bufq *q)
   return chunk_is_full(q->tail);
 }
 
-static struct buf_chunk *get_spare(struct bufq *q)
+bool Curl_bufq_is_gated(const struct bufq *q)
+{
+  const struct bufc_pool *pool = q->pool;
+
+  /* a bufq without chunks always gets one */
+  if(!pool || !pool->max_mem || !q->chunk_count || q->spare)
+    return FALSE;
+  if(q->tail && !chunk_is_full(q->tail))
+    return FALSE;
+  return !pool->spare &&
+         (pool->mem + chunk_mem(pool->chunk_size) > pool->max_mem);
+}
+
+static struct buf_chunk *get_spare(struct bufq *q, CURLcode *err)
 {
   struct buf_chunk *chunk = NULL;
 
+  *err = CURLE_OK;
   if(q->spare) {
     chunk = q->spare;
     q->spare = chunk->next;
@@ -310,19 +385,25 @@ static struct buf_chunk *get_spare(struct bufq *q)
     return chunk;
   }
 
-  if(q->chunk_count >= q->max_chunks && (!(q->opts & BUFQ_OPT_SOFT_LIMIT)))
+  if(q->chunk_count >= q->max_chunks && (!(q->opts & BUFQ_OPT_SOFT_LIMIT))) {
+    *err = CURLE_AGAIN;
     return NULL;
+  }
 
   if(q->pool) {
-    if(bufcp_take(q->pool, &chunk))
+    /* a bufq without chunks always gets one from its pool */
+    *err = bufcp_take(q->pool, !q->chunk_count, &chunk);
+    if(*err)
       return NULL;
     ++q->chunk_count;
     return chunk;
   }
   else {
     chunk = calloc(1, sizeof(*chunk) + q->chunk_size);
-    if(!chunk)
+    if(!chunk) {
+      *err = CURLE_OUT_OF_MEMORY;
       return NULL;
+    }
     chunk->dlen = q->chunk_size;
     ++q->chunk_count;
     return chunk;
@@ -400,13 +481,14 @@ static void prune_tail(struct bufq *q)
   }
 }
 
-static struct buf_chunk *get_non_full_tail(struct bufq *q)
+static struct buf_chunk *get_non_full_tail(struct bufq *q, CURLcode *err)
 {
   struct buf_chunk *chunk;
 
+  *err = CURLE_OK;
   if(q->tail && !chunk_is_full(q->tail))
     return q->tail;
-  chunk = get_spare(q);
+  chunk = get_spare(q, err);
   if(chunk) {
     /* new tail, and possibly new head */
     if(q->tail) {
@@ -431,12 +513,10 @@ ssize_t Curl_bufq_write(struct bufq *q,
 
   DEBUGASSERT(q->max_chunks > 0);
   while(len) {
-    tail = get_non_full_tail(q);
+    tail = get_non_full_tail(q, err);
     if(!tail) {
-      if((q->chunk_count < q->max_chunks) || (q->opts & BUFQ_OPT_SOFT_LIMIT)) {
-        *err = CURLE_OUT_OF_MEMORY;
+      if(*err == CURLE_OUT_OF_MEMORY)
         return -1;
-      }
       break;
     }
     n = chunk_append(tail, buf, len);
@@ -646,17 +726,12 @@ ssize_t Curl_bufq_sipn(struct bufq *q, size_t max_len,
   struct buf_chunk *tail = NULL;
   ssize_t nread;
 
-  *err = CURLE_AGAIN;
-  tail = get_non_full_tail(q);
+  tail = get_non_full_tail(q, err);
   if(!tail) {
-    if(q->chunk_count < q->max_chunks) {
-      *err = CURLE_OUT_OF_MEMORY;
-      return -1;
-    }
-    /* full, blocked */
-    *err = CURLE_AGAIN;
+    /* out of memory or full, blocked */
     return -1;
   }
+  *err = CURLE_AGAIN;
 
   nread = chunk_slurpn(tail, max_len, reader, reader_ctx, err);
   if(nread < 0) {
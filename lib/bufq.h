@@ -43,25 +43,60 @@ struct buf_chunk {
   } x;
 };
 
+/**
+ * Statistics of a `bufc_pool`.
+ */
+struct bufc_stats {
+  size_t allocated;         /* chunks allocated */
+  size_t reused;            /* chunks handed out again from spares */
+  size_t denied;            /* chunks refused because of `max_mem` */
+  size_t peak_mem;          /* the highest `mem` seen */
+};
+
 /**
  * A pool for providing/keeping a number of chunks of the same size
  *
  * The same pool can be shared by many `bufq` instances. However, a pool
  * is not thread safe. All bufqs using it are supposed to operate in the
  * same thread.
+ *
+ * Spares are kept in LIFO order, the chunk put back last is handed out
+ * first. `mem` is the memory of all chunks of the pool, in use by
+ * bufqs or spare. When `max_mem` is set, a bufq that already holds a
+ * chunk does not get another one that would exceed it. A bufq without
+ * chunks always gets one, so that all can make progress.
  */
 struct bufc_pool {
   struct buf_chunk *spare;  /* list of available spare chunks */
   size_t chunk_size;        /* the size of chunks in this pool */
   size_t spare_count;       /* current number of spare chunks in list */
   size_t spare_max;         /* max number of spares to keep */
+  size_t mem;               /* memory of all chunks, in use and spare */
+  size_t max_mem;           /* limit for `mem`, 0 for none */
+  struct bufc_stats stats;
 };
 
 void Curl_bufcp_init(struct bufc_pool *pool,
                      size_t chunk_size, size_t spare_max);
 
+/**
+ * Limit the memory of all chunks in the pool to `max_mem` bytes,
+ * 0 for no limit. Spares beyond the limit are freed.
+ */
+void Curl_bufcp_set_max_mem(struct bufc_pool *pool, size_t max_mem);
+
 void Curl_bufcp_free(struct bufc_pool *pool);
 
+/**
+ * Take a chunk from the pool for use outside of a `bufq`. Unless
+ * `force` is set, this fails with CURLE_AGAIN when a new chunk would
+ * exceed the pool's `max_mem`. Give it back with `Curl_bufcp_put()`.
+ */
+CURLcode Curl_bufcp_take(struct bufc_pool *pool, bool force,
+                         struct buf_chunk **pchunk);
+
+void Curl_bufcp_put(struct bufc_pool *pool, struct buf_chunk *chunk);
+
 /**
  * A queue of byte chunks for reading and writing.
  * Reading is done from `head`, writing is done to `tail`.
@@ -89,7 +124,8 @@ void Curl_bufcp_free(struct bufc_pool *pool);
  * disable that and free chunks once they become empty.
  *
  * When providing a pool to a bufq, all chunk creation and spare handling
- * will be delegated to that pool.
+ * will be delegated to that pool. When the pool refuses a chunk because
+ * of its memory limit, writing returns CURLE_AGAIN as on a full bufq.
  */
 struct bufq {
   struct buf_chunk *head;       /* chunk with bytes to read from */
@@ -160,6 +196,12 @@ bool Curl_bufq_is_empty(const struct bufq *q);
  */
 bool Curl_bufq_is_full(const struct bufq *q);
 
+/**
+ * Returns TRUE iff writing to the buffer queue needs a new chunk that
+ * its pool refuses because of the pool's `max_mem`.
+ */
+bool Curl_bufq_is_gated(const struct bufq *q);
+
 /**
  * Write buf to the end of the buffer queue. The buf is copied
  * and the amount of copied bytes is returned.
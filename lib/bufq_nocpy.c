@@ -22,213 +22,392 @@
  *
  ***************************************************************************/
 
+#include "curl_setup.h"
 #include "bufq_nocpy.h"
-#include <assert.h>
-#include <stdlib.h>
-#include <string.h>
-#include <stdio.h>
+#include "borrow.h"
 
-#define MIN(a, b) ((a) < (b) ? (a) : (b))
+/* The last 3 #include files should be in this order */
+#include "curl_printf.h"
+#include "curl_memory.h"
+#include "memdebug.h"
 
-struct bufq_nocpy_chunk
+/* entries in a segment when the queue has no pool */
+#define BUFQ_NOCPY_SEG_ENTRIES  16
+
+static void entry_release(struct bufq_nocpy *q,
+                          struct bufq_nocpy_entry *e)
 {
-  enum BUFQ_ALLOC_METHOD alloc_method;
-  size_t size;
-  size_t read_offset;
-  unsigned char *data;
-};
+  switch(e->alloc) {
+  case BUFQ_ALLOC_MALLOC:
+    free(e->mem);
+    break;
+  case BUFQ_ALLOC_EXTERNAL:
+    if(q->free_func)
+      q->free_func(e->mem);
+    break;
+  case BUFQ_ALLOC_BORROW:
+    Curl_borrow_drop(e->mem);
+    break;
+  case BUFQ_ALLOC_CHUNK:
+    if(q->pool && q->pool->bufcp)
+      Curl_bufcp_put(q->pool->bufcp, e->mem);
+    else
+      free(e->mem);
+    break;
+  default:
+    break;
+  }
+  q->len -= e->len;
+  q->mem -= e->memlen;
+  if(q->pool)
+    q->pool->mem -= e->memlen;
+  memset(e, 0, sizeof(*e));
+}
 
-struct bufq_nocpy
+static size_t seg_size(size_t nentries)
 {
-  size_t nb_buffers;
-  ssize_t input_index;
-  ssize_t output_index;
-  struct bufq_nocpy *next;
-  struct bufq_nocpy_chunk chunks[];
-};
+  return sizeof(struct bufq_nocpy_seg) +
+    ((nentries - 1) * sizeof(struct bufq_nocpy_entry));
+}
 
-BufqNoCpy *Curl_bufq_nocpy_init(size_t nb_buffers_base)
+void Curl_bufq_nocpy_pool_init(struct bufq_nocpy_pool *pool,
+                               size_t seg_entries, size_t spare_max,
+                               struct bufc_pool *bufcp)
 {
-  BufqNoCpy *queue;
+  DEBUGASSERT(seg_entries > 0);
+  memset(pool, 0, sizeof(*pool));
+  pool->seg_entries = seg_entries;
+  pool->spare_max = spare_max;
+  pool->bufcp = bufcp;
+}
 
-  if(nb_buffers_base < 1) {
-    return NULL;
-  }
-  queue = (BufqNoCpy *)calloc(1, sizeof(BufqNoCpy)
-                                 + nb_buffers_base
-                                 * sizeof(struct bufq_nocpy_chunk));
-  if(!queue) {
-    return NULL;
+void Curl_bufq_nocpy_pool_free(struct bufq_nocpy_pool *pool)
+{
+  while(pool->spare) {
+    struct bufq_nocpy_seg *seg = pool->spare;
+    pool->spare = seg->next;
+    free(seg);
+    --pool->seg_count;
   }
-  queue->nb_buffers = nb_buffers_base;
-  queue->output_index = -1;
-
-  return queue;
+  pool->spare_count = 0;
+  /* all queues using the pool need to be freed before */
+  DEBUGASSERT(!pool->seg_count);
+  DEBUGASSERT(!pool->mem);
 }
 
-bool Curl_bufq_nocpy_write(BufqNoCpy *queue, unsigned char *data,
-                           size_t size, enum BUFQ_ALLOC_METHOD alloc_method)
+static struct bufq_nocpy_seg *seg_take(struct bufq_nocpy *q)
 {
-  if(size == 0) {
-    /* If we add an empty buffer, the queue can appear to be empty when reading
-       it It's also work done for nothing */
-    return true;
+  struct bufq_nocpy_pool *pool = q->pool;
+  struct bufq_nocpy_seg *seg;
+  size_t nentries = pool ? pool->seg_entries : BUFQ_NOCPY_SEG_ENTRIES;
+
+  if(pool && pool->spare) {
+    seg = pool->spare;
+    pool->spare = seg->next;
+    --pool->spare_count;
   }
-  while(queue->next) {
-    queue = queue->next;
+  else {
+    seg = malloc(seg_size(nentries));
+    if(!seg)
+      return NULL;
+    if(pool)
+      ++pool->seg_count;
   }
+  memset(seg, 0, seg_size(nentries));
+  seg->nentries = nentries;
+  return seg;
+}
 
-  if(queue->input_index == queue->output_index) {
-    queue->next = Curl_bufq_nocpy_init(queue->nb_buffers);
-    if(!queue->next) {
-      return false; /* out of memory */
-    }
-    queue = queue->next;
+static void seg_put(struct bufq_nocpy *q, struct bufq_nocpy_seg *seg)
+{
+  struct bufq_nocpy_pool *pool = q->pool;
+
+  if(pool && (pool->spare_count < pool->spare_max)) {
+    seg->next = pool->spare;
+    pool->spare = seg;
+    ++pool->spare_count;
   }
-  queue->chunks[queue->input_index].size = size;
-  queue->chunks[queue->input_index].data = data;
-  queue->chunks[queue->input_index].read_offset = 0;
-  queue->chunks[queue->input_index].alloc_method = alloc_method;
-  if(queue->output_index == -1) {
-    queue->output_index = queue->input_index;
+  else {
+    free(seg);
+    if(pool)
+      --pool->seg_count;
   }
-  queue->input_index = (queue->input_index + 1) % (ssize_t)queue->nb_buffers;
-  return true;
 }
 
-size_t Curl_bufq_nocpy_read(BufqNoCpy *queue, unsigned char **data)
+void Curl_bufq_nocpy_init(struct bufq_nocpy *q,
+                          struct bufq_nocpy_pool *pool,
+                          size_t max_len, void (*free_func)(void *))
 {
-  size_t size;
-  BufqNoCpy *parent = NULL;
+  memset(q, 0, sizeof(*q));
+  q->pool = pool;
+  q->max_len = max_len;
+  q->free_func = free_func;
+}
 
-  while(queue->output_index == -1) {
-    if(!queue->next) {
-      /* queue is empty */
-      *data = NULL;
-      return 0;
-    }
-    parent = queue;
-    queue = queue->next;
-  }
-
-  *data = queue->chunks[queue->output_index].data;
-  size = queue->chunks[queue->output_index].size;
-
-  /* to be able to free dangling pointers */
-  queue->chunks[queue->output_index].data = NULL;
-  queue->chunks[queue->output_index].size = 0;
-
-  queue->output_index = (queue->output_index + 1) % (ssize_t)queue->nb_buffers;
-  if(queue->output_index == queue->input_index) {
-    /* this queue is now empty */
-    queue->output_index = -1;
-    if(!queue->next && parent) {
-      /* it's a tail queue, we can destroy it
-         it will take less memory but it will also
-         be faster */
-      free(queue);
-      parent->next = NULL;
-    }
+void Curl_bufq_nocpy_reset(struct bufq_nocpy *q)
+{
+  while(q->head) {
+    struct bufq_nocpy_seg *seg = q->head;
+    size_t i;
+
+    for(i = seg->r_idx; i < seg->w_idx; ++i)
+      entry_release(q, &seg->entries[i]);
+    q->head = seg->next;
+    seg_put(q, seg);
   }
+  q->tail = NULL;
+  DEBUGASSERT(!q->len);
+  DEBUGASSERT(!q->mem);
+}
 
-  return size;
+void Curl_bufq_nocpy_free(struct bufq_nocpy *q)
+{
+  Curl_bufq_nocpy_reset(q);
 }
 
-size_t Curl_bufq_nocpy_read_cpy(BufqNoCpy *queue, unsigned char *buf,
-                           size_t bufsize, unsigned char **ptr_to_free,
-                           size_t *ptr_to_free_size,
-                           enum BUFQ_ALLOC_METHOD *alloc_method)
+size_t Curl_bufq_nocpy_len(const struct bufq_nocpy *q)
 {
-  size_t size;
-  size_t left;
-  BufqNoCpy *parent = NULL;
+  return q->len;
+}
 
-  *ptr_to_free = NULL;
-  *ptr_to_free_size = 0;
+size_t Curl_bufq_nocpy_mem(const struct bufq_nocpy *q)
+{
+  return q->mem;
+}
 
-  while(queue->output_index == -1) {
-    if(!queue->next) {
-      /* queue is empty */
-      return 0;
-    }
-    parent = queue;
-    queue = queue->next;
+bool Curl_bufq_nocpy_is_empty(const struct bufq_nocpy *q)
+{
+  return !q->len;
+}
+
+bool Curl_bufq_nocpy_is_full(const struct bufq_nocpy *q)
+{
+  return q->max_len && (q->len >= q->max_len);
+}
+
+static struct bufq_nocpy_entry *entry_new(struct bufq_nocpy *q)
+{
+  if(!q->tail || (q->tail->w_idx >= q->tail->nentries)) {
+    struct bufq_nocpy_seg *seg = seg_take(q);
+    if(!seg)
+      return NULL;
+    if(q->tail)
+      q->tail->next = seg;
+    else
+      q->head = seg;
+    q->tail = seg;
+  }
+  return &q->tail->entries[q->tail->w_idx++];
+}
+
+static CURLcode entry_add(struct bufq_nocpy *q, const void *ptr, size_t len,
+                          void *mem, size_t memlen,
+                          enum BUFQ_ALLOC_METHOD alloc)
+{
+  struct bufq_nocpy_entry *e = entry_new(q);
+
+  if(!e)
+    return CURLE_OUT_OF_MEMORY;
+  e->ptr = ptr;
+  e->len = len;
+  e->mem = mem;
+  e->memlen = memlen;
+  e->alloc = alloc;
+  q->len += len;
+  q->mem += memlen;
+  if(q->pool)
+    q->pool->mem += memlen;
+  return CURLE_OK;
+}
+
+CURLcode Curl_bufq_nocpy_add(struct bufq_nocpy *q, void *mem, size_t len,
+                             enum BUFQ_ALLOC_METHOD alloc)
+{
+  if(!len) {
+    /* an empty entry would make the queue look empty while holding it */
+    struct bufq_nocpy_entry e;
+
+    memset(&e, 0, sizeof(e));
+    e.mem = mem;
+    e.alloc = alloc;
+    entry_release(q, &e);
+    return CURLE_OK;
   }
+  DEBUGASSERT(alloc != BUFQ_ALLOC_BORROW);
+  return entry_add(q, mem, len, mem,
+                   (alloc == BUFQ_ALLOC_STATIC) ? 0 : len, alloc);
+}
+
+CURLcode Curl_bufq_nocpy_add_borrow(struct bufq_nocpy *q,
+                                    struct curl_borrow *b,
+                                    const char *ptr, size_t len)
+{
+  CURLcode result;
+
+  if(!len)
+    return CURLE_OK;
+  result = entry_add(q, ptr, len, b, len, BUFQ_ALLOC_BORROW);
+  if(!result)
+    Curl_borrow_hold(b);
+  return result;
+}
 
-  *alloc_method = queue->chunks[queue->output_index].alloc_method;
+static CURLcode chunk_take(struct bufq_nocpy *q, struct buf_chunk **pchunk)
+{
+  struct buf_chunk *chunk;
 
-  left = queue->chunks[queue->output_index].size
-         - queue->chunks[queue->output_index].read_offset;
+  if(q->pool && q->pool->bufcp)
+    /* like a `bufq`, an empty queue always gets a chunk */
+    return Curl_bufcp_take(q->pool->bufcp, !q->len, pchunk);
+  chunk = calloc(1, sizeof(*chunk) + BUFQ_NOCPY_CHUNK_SIZE);
+  if(!chunk)
+    return CURLE_OUT_OF_MEMORY;
+  chunk->dlen = BUFQ_NOCPY_CHUNK_SIZE;
+  *pchunk = chunk;
+  return CURLE_OK;
+}
 
-  size = MIN(bufsize, left);
-  memcpy(buf,
-         queue->chunks[queue->output_index].data
-         + queue->chunks[queue->output_index].read_offset, size);
+/* Get the entry at the end of the queue to copy bytes into. That is the
+ * last entry when it has room left in its chunk, else a new one. */
+static CURLcode chunk_entry(struct bufq_nocpy *q,
+                            struct bufq_nocpy_entry **pe)
+{
+  struct bufq_nocpy_entry *e = NULL;
+  struct buf_chunk *chunk;
+  CURLcode result;
 
-  if(size < left) {
-    /* The buffer hasn't been entirely consumed */
-    queue->chunks[queue->output_index].read_offset += size;
-    return size;
+  /* the last entry of the tail is never read completely */
+  if(q->tail)
+    e = &q->tail->entries[q->tail->w_idx - 1];
+  if(e && (e->alloc == BUFQ_ALLOC_CHUNK)) {
+    chunk = e->mem;
+    if(chunk->w_offset < chunk->dlen) {
+      *pe = e;
+      return CURLE_OK;
+    }
   }
 
-  /* The buffer hasn't been entirely consumed, it's time to free it */
-  if(queue->chunks[queue->output_index].alloc_method != BUFQ_ALLOC_STATIC) {
-    *ptr_to_free = queue->chunks[queue->output_index].data;
-    *ptr_to_free_size = queue->chunks[queue->output_index].size;
+  result = chunk_take(q, &chunk);
+  if(result)
+    return result;
+  result = entry_add(q, chunk->x.data, 0, chunk, chunk->dlen,
+                     BUFQ_ALLOC_CHUNK);
+  if(result) {
+    if(q->pool && q->pool->bufcp)
+      Curl_bufcp_put(q->pool->bufcp, chunk);
+    else
+      free(chunk);
+    return result;
   }
+  *pe = &q->tail->entries[q->tail->w_idx - 1];
+  return CURLE_OK;
+}
 
-  queue->chunks[queue->output_index].data = NULL;
-  queue->chunks[queue->output_index].size = 0;
-  queue->chunks[queue->output_index].read_offset = 0;
+CURLcode Curl_bufq_nocpy_cwrite(struct bufq_nocpy *q,
+                                const char *buf, size_t len,
+                                size_t *pnwritten)
+{
+  CURLcode result = CURLE_OK;
 
-  queue->output_index = (queue->output_index + 1) % (ssize_t)queue->nb_buffers;
-  if(queue->output_index == queue->input_index) {
-    /* This queue is now empty */
-    queue->output_index = -1;
-    if(!queue->next && parent) {
-      /* it's a tail queue, we can destroy it
-         it will take less memory but it will also
-         be faster */
-      free(queue);
-      parent->next = NULL;
-    }
+  *pnwritten = 0;
+  if(q->max_len) {
+    if(q->len >= q->max_len)
+      return len ? CURLE_AGAIN : CURLE_OK;
+    if(len > (q->max_len - q->len))
+      len = q->max_len - q->len;
   }
+  while(len) {
+    struct bufq_nocpy_entry *e;
+    struct buf_chunk *chunk;
+    size_t n;
 
-  return size;
+    result = chunk_entry(q, &e);
+    if(result)
+      break;
+    /* unread bytes of a chunk entry always end at the chunk's `w_offset` */
+    chunk = e->mem;
+    n = CURLMIN(len, chunk->dlen - chunk->w_offset);
+    memcpy(&chunk->x.data[chunk->w_offset], buf, n);
+    chunk->w_offset += n;
+    e->len += n;
+    q->len += n;
+    buf += n;
+    len -= n;
+    *pnwritten += n;
+  }
+  return *pnwritten ? CURLE_OK : result;
+}
+
+bool Curl_bufq_nocpy_peek(const struct bufq_nocpy *q,
+                          const unsigned char **pbuf, size_t *plen)
+{
+  return Curl_bufq_nocpy_peek_at(q, 0, pbuf, plen);
 }
 
-bool Curl_bufq_nocpy_is_empty(BufqNoCpy *queue)
+bool Curl_bufq_nocpy_peek_at(const struct bufq_nocpy *q, size_t offset,
+                             const unsigned char **pbuf, size_t *plen)
 {
-  while(queue->output_index == -1) {
-    if(!queue->next) {
-      /* queue is empty */
-      return true;
+  const struct bufq_nocpy_seg *seg;
+  size_t i;
+
+  for(seg = q->head; seg; seg = seg->next) {
+    for(i = seg->r_idx; i < seg->w_idx; ++i) {
+      const struct bufq_nocpy_entry *e = &seg->entries[i];
+      if(offset < e->len) {
+        *pbuf = e->ptr + offset;
+        *plen = e->len - offset;
+        return TRUE;
+      }
+      offset -= e->len;
     }
-    queue = queue->next;
   }
-  return false;
+  *pbuf = NULL;
+  *plen = 0;
+  return FALSE;
 }
 
-static void rec_free(BufqNoCpy *queue, void (*free_func)(void *))
+void Curl_bufq_nocpy_skip(struct bufq_nocpy *q, size_t amount)
 {
-  if(queue->next) {
-    rec_free(queue->next, free_func);
-  }
-  if(free_func) {
-    for(size_t i = 0; i < queue->nb_buffers; i++) {
-      if(queue->chunks[i].alloc_method == BUFQ_ALLOC_MALLOC) {
-        free_func(queue->chunks[i].data);
-      }
+  while(amount && q->head) {
+    struct bufq_nocpy_seg *seg = q->head;
+    struct bufq_nocpy_entry *e = &seg->entries[seg->r_idx];
+
+    DEBUGASSERT(seg->r_idx < seg->w_idx);
+    if(amount < e->len) {
+      e->ptr += amount;
+      e->len -= amount;
+      q->len -= amount;
+      return;
+    }
+    amount -= e->len;
+    entry_release(q, e);
+    if(++seg->r_idx >= seg->w_idx) {
+      /* segment read completely, an idle queue holds none */
+      q->head = seg->next;
+      if(!q->head)
+        q->tail = NULL;
+      seg_put(q, seg);
     }
   }
-  free(queue);
 }
 
-void Curl_bufq_nocpy_free(BufqNoCpy **pqueue, void (*free_func)(void *))
+CURLcode Curl_bufq_nocpy_cread(struct bufq_nocpy *q, char *buf, size_t len,
+                               size_t *pnread)
 {
-  if(!*pqueue) {
-    return;
+  const unsigned char *ptr;
+  size_t n;
+
+  *pnread = 0;
+  if(Curl_bufq_nocpy_is_empty(q))
+    return CURLE_AGAIN;
+  while(len && Curl_bufq_nocpy_peek(q, &ptr, &n)) {
+    if(n > len)
+      n = len;
+    memcpy(buf, ptr, n);
+    Curl_bufq_nocpy_skip(q, n);
+    buf += n;
+    len -= n;
+    *pnread += n;
   }
-  rec_free(*pqueue, free_func);
-  *pqueue = NULL;
-}
\ No newline at end of file
+  return CURLE_OK;
+}
@@ -1,3 +1,5 @@
+#ifndef HEADER_CURL_BUFQ_NOCPY_H
+#define HEADER_CURL_BUFQ_NOCPY_H
 /***************************************************************************
  *                                  _   _ ____  _
  *  Project                     ___| | | |  _ \| |
@@ -21,36 +23,185 @@
  * SPDX-License-Identifier: curl
  *
  ***************************************************************************/
+#include "curl_setup.h"
 
-#ifndef BUFQ_NOCPY_H
-#define BUFQ_NOCPY_H
+#include <curl/curl.h>
 
-#include <stdbool.h>
-#include <stddef.h>
-#include <stdint.h>
+#include "bufq.h"
 
+/* size of the chunks copying writes use when the pool has no `bufcp` */
+#define BUFQ_NOCPY_CHUNK_SIZE  4096
+
+/**
+ * How the memory of an entry in a `bufq_nocpy` is released once
+ * its bytes have been read.
+ */
 enum BUFQ_ALLOC_METHOD {
-    BUFQ_ALLOC_STATIC,
-    BUFQ_ALLOC_MALLOC,
-    BUFQ_ALLOC_EXTERNAL
+  BUFQ_ALLOC_STATIC,   /* nothing to release, e.g. string constants */
+  BUFQ_ALLOC_MALLOC,   /* released with free() */
+  BUFQ_ALLOC_EXTERNAL, /* released with the queue's `free_func` */
+  BUFQ_ALLOC_BORROW,   /* a reference on a `struct curl_borrow` */
+  BUFQ_ALLOC_CHUNK     /* a `struct buf_chunk` copying writes fill */
+};
+
+/**
+ * An entry in a `bufq_nocpy`, referring to memory the queue does not
+ * copy. `ptr` and `len` are the bytes not read yet.
+ */
+struct bufq_nocpy_entry {
+  const unsigned char *ptr; /* first unread byte */
+  size_t len;               /* amount of unread bytes */
+  void *mem;                /* what to release, see `alloc` */
+  size_t memlen;            /* amount of memory accounted for the entry */
+  enum BUFQ_ALLOC_METHOD alloc;
+};
+
+/**
+ * A segment of entries. A queue is a list of segments, read at
+ * `r_idx` from `head` and written at `w_idx` of `tail`.
+ */
+struct bufq_nocpy_seg {
+  struct bufq_nocpy_seg *next; /* to keep it in a list */
+  size_t nentries;             /* the amount of allocated entries */
+  size_t r_idx;                /* first unread entry */
+  size_t w_idx;                /* one after last written entry */
+  struct bufq_nocpy_entry entries[1];
+};
+
+/**
+ * A pool of segments, shared by many `bufq_nocpy` instances. It also
+ * accounts the memory held by all queues using it.
+ *
+ * Copying writes go into chunks taken from `bufcp`, when set, and
+ * are given back there once read. Without it, chunks of
+ * BUFQ_NOCPY_CHUNK_SIZE are allocated.
+ *
+ * Like `bufc_pool`, a pool is not thread safe. All queues using it
+ * are supposed to operate in the same thread.
+ */
+struct bufq_nocpy_pool {
+  struct bufq_nocpy_seg *spare; /* list of available spare segments */
+  size_t seg_entries;           /* the number of entries in segments */
+  size_t spare_count;           /* current number of spare segments */
+  size_t spare_max;             /* max number of spares to keep */
+  size_t seg_count;             /* segments allocated, in use or spare */
+  size_t mem;                   /* memory held by entries of all queues */
+  struct bufc_pool *bufcp;      /* optional pool for copied bytes */
+};
+
+void Curl_bufq_nocpy_pool_init(struct bufq_nocpy_pool *pool,
+                               size_t seg_entries, size_t spare_max,
+                               struct bufc_pool *bufcp);
+
+void Curl_bufq_nocpy_pool_free(struct bufq_nocpy_pool *pool);
+
+/**
+ * A queue of references to memory. Where a `bufq` copies the bytes
+ * written into its chunks, a `bufq_nocpy` keeps pointers to the memory
+ * passed in and releases it, according to its `BUFQ_ALLOC_METHOD`,
+ * once all its bytes have been read or skipped.
+ *
+ * `len` is the number of bytes that can be read, `mem` the amount of
+ * memory held by the entries. When `max_len` is not 0, writing copies
+ * with `Curl_bufq_nocpy_cwrite()` stops at `max_len` bytes. Adding
+ * references is never limited.
+ *
+ * Reading is compatible with `bufq`: bytes can be peeked at and
+ * skipped, or copied out.
+ */
+struct bufq_nocpy {
+  struct bufq_nocpy_seg *head;   /* segment with entries to read from */
+  struct bufq_nocpy_seg *tail;   /* segment to add entries to */
+  struct bufq_nocpy_pool *pool;  /* optional pool for segments */
+  void (*free_func)(void *);     /* releases BUFQ_ALLOC_EXTERNAL memory */
+  size_t len;                    /* amount of bytes to read */
+  size_t mem;                    /* amount of memory held */
+  size_t max_len;                /* limit for copying writes, 0 for none */
 };
 
-typedef struct bufq_nocpy BufqNoCpy;
+/**
+ * Initialize a queue, taking segments from `pool` when it is not NULL.
+ */
+void Curl_bufq_nocpy_init(struct bufq_nocpy *q,
+                          struct bufq_nocpy_pool *pool,
+                          size_t max_len, void (*free_func)(void *));
+
+/**
+ * Release all entries in the queue, keeping it usable.
+ */
+void Curl_bufq_nocpy_reset(struct bufq_nocpy *q);
+
+/**
+ * Free all resources held by the queue.
+ */
+void Curl_bufq_nocpy_free(struct bufq_nocpy *q);
+
+size_t Curl_bufq_nocpy_len(const struct bufq_nocpy *q);
+
+/**
+ * Return the amount of memory held by the entries of the queue.
+ */
+size_t Curl_bufq_nocpy_mem(const struct bufq_nocpy *q);
+
+bool Curl_bufq_nocpy_is_empty(const struct bufq_nocpy *q);
+
+/**
+ * Returns TRUE iff `max_len` is set and reached.
+ */
+bool Curl_bufq_nocpy_is_full(const struct bufq_nocpy *q);
+
+/**
+ * Add `len` bytes at `mem` to the end of the queue without copying
+ * them. On success, the queue owns the memory and releases it as given
+ * by `alloc`. On failure, ownership stays with the caller.
+ * Adding 0 bytes releases `mem` right away.
+ */
+CURLcode Curl_bufq_nocpy_add(struct bufq_nocpy *q, void *mem, size_t len,
+                             enum BUFQ_ALLOC_METHOD alloc);
 
-BufqNoCpy *Curl_bufq_nocpy_init(size_t nb_buffers_base);
+/**
+ * Add `len` bytes at `ptr` inside the borrowed block `b` to the end of
+ * the queue. The queue holds its own reference on `b` until the
+ * bytes have been read.
+ */
+CURLcode Curl_bufq_nocpy_add_borrow(struct bufq_nocpy *q,
+                                    struct curl_borrow *b,
+                                    const char *ptr, size_t len);
 
-bool Curl_bufq_nocpy_write(BufqNoCpy *queue, unsigned char *data,
-                           size_t size, enum BUFQ_ALLOC_METHOD alloc_method);
+/**
+ * Copy `buf` to the end of the queue. Bytes go into the chunk of the
+ * last entry while it has room, then into new chunks. Copies at most
+ * up to `max_len`, returns CURLE_AGAIN when the queue is full or the
+ * pool's `bufcp` refuses a chunk before anything was copied.
+ */
+CURLcode Curl_bufq_nocpy_cwrite(struct bufq_nocpy *q,
+                                const char *buf, size_t len,
+                                size_t *pnwritten);
 
-size_t Curl_bufq_nocpy_read(BufqNoCpy *queue, unsigned char **data);
+/**
+ * Copy bytes from the start of the queue to `buf`, releasing the
+ * entries read completely. Returns CURLE_AGAIN when the queue is empty.
+ */
+CURLcode Curl_bufq_nocpy_cread(struct bufq_nocpy *q, char *buf, size_t len,
+                               size_t *pnread);
 
-size_t Curl_bufq_nocpy_read_cpy(BufqNoCpy *queue, unsigned char *buf,
-                                size_t bufsize, unsigned char **ptr_to_free,
-                                size_t *ptr_to_free_size,
-                                enum BUFQ_ALLOC_METHOD *alloc_method);
+/**
+ * Peek at the head entry of the queue, as `Curl_bufq_peek()` does.
+ */
+bool Curl_bufq_nocpy_peek(const struct bufq_nocpy *q,
+                          const unsigned char **pbuf, size_t *plen);
 
-void Curl_bufq_nocpy_free(BufqNoCpy **pqueue, void (*free_func)(void *));
+/**
+ * Peek at the entry holding the byte at `offset` from the start of the
+ * queue, as `Curl_bufq_peek_at()` does.
+ */
+bool Curl_bufq_nocpy_peek_at(const struct bufq_nocpy *q, size_t offset,
+                             const unsigned char **pbuf, size_t *plen);
 
-bool Curl_bufq_nocpy_is_empty(BufqNoCpy *queue);
+/**
+ * Discard `amount` bytes at the head of the queue, releasing
+ * all entries read completely.
+ */
+void Curl_bufq_nocpy_skip(struct bufq_nocpy *q, size_t amount);
 
-#endif
\ No newline at end of file
+#endif /* HEADER_CURL_BUFQ_NOCPY_H */
@@ -1457,6 +1457,35 @@ static void win_update_sndbuf_size(struct cf_socket_ctx *ctx)
 
 #endif /* USE_WINSOCK */
 
+static CURLcode socket_send_err(struct Curl_easy *data)
+{
+  int sockerr = SOCKERRNO;
+
+  if(
+#ifdef USE_WINSOCK
+    /* This is how Windows does it */
+    (SOCKEWOULDBLOCK == sockerr)
+#else
+    /* errno may be EWOULDBLOCK or on some systems EAGAIN when it returned
+       due to its inability to send off data without blocking. We therefore
+       treat both error codes the same here */
+    (SOCKEWOULDBLOCK == sockerr) ||
+    (EAGAIN == sockerr) || (SOCKEINTR == sockerr) ||
+    (SOCKEINPROGRESS == sockerr)
+#endif
+    ) {
+    /* this is just a case of EWOULDBLOCK */
+    return CURLE_AGAIN;
+  }
+  else {
+    char buffer[STRERROR_LEN];
+    failf(data, "Send failure: %s",
+          Curl_strerror(sockerr, buffer, sizeof(buffer)));
+    data->state.os_errno = sockerr;
+    return CURLE_SEND_ERROR;
+  }
+}
+
 static ssize_t cf_socket_send(struct Curl_cfilter *cf, struct Curl_easy *data,
                               const void *buf, size_t len, bool eos,
                               CURLcode *err)
@@ -1504,33 +1533,8 @@ static ssize_t cf_socket_send(struct Curl_cfilter *cf, struct Curl_easy *data,
 #endif
     nwritten = swrite(ctx->sock, buf, len);
 
-  if(-1 == nwritten) {
-    int sockerr = SOCKERRNO;
-
-    if(
-#ifdef USE_WINSOCK
-      /* This is how Windows does it */
-      (SOCKEWOULDBLOCK == sockerr)
-#else
-      /* errno may be EWOULDBLOCK or on some systems EAGAIN when it returned
-         due to its inability to send off data without blocking. We therefore
-         treat both error codes the same here */
-      (SOCKEWOULDBLOCK == sockerr) ||
-      (EAGAIN == sockerr) || (SOCKEINTR == sockerr) ||
-      (SOCKEINPROGRESS == sockerr)
-#endif
-      ) {
-      /* this is just a case of EWOULDBLOCK */
-      *err = CURLE_AGAIN;
-    }
-    else {
-      char buffer[STRERROR_LEN];
-      failf(data, "Send failure: %s",
-            Curl_strerror(sockerr, buffer, sizeof(buffer)));
-      data->state.os_errno = sockerr;
-      *err = CURLE_SEND_ERROR;
-    }
-  }
+  if(-1 == nwritten)
+    *err = socket_send_err(data);
 
 #if defined(USE_WINSOCK)
   if(!*err)
@@ -1543,6 +1547,96 @@ static ssize_t cf_socket_send(struct Curl_cfilter *cf, struct Curl_easy *data,
   return nwritten;
 }
 
+struct Curl_cfilter *Curl_cf_socket_sendv_cf(struct Curl_cfilter *cf)
+{
+  /* skip filters that pass sends on unchanged */
+  while(cf && (cf->cft->do_send == Curl_cf_def_send))
+    cf = cf->next;
+  if(cf && cf->connected && cf->ctx &&
+     (cf->cft == &Curl_cft_tcp || cf->cft == &Curl_cft_unix))
+    return cf;
+  return NULL;
+}
+
+/* the most spans written by one sendmsg() call */
+#define CF_SOCKET_IOV_MAX  16
+
+ssize_t Curl_cf_socket_sendv(struct Curl_cfilter *cf,
+                             struct Curl_easy *data,
+                             const struct Curl_iov *iov, size_t iovcnt,
+                             CURLcode *err)
+{
+  size_t i, total = 0;
+  ssize_t nwritten;
+
+  DEBUGASSERT(Curl_cf_socket_sendv_cf(cf) == cf);
+  *err = CURLE_OK;
+#ifdef HAVE_SENDMSG
+  if(iovcnt > 1 && !cf->conn->bits.tcp_fastopen) {
+    struct cf_socket_ctx *ctx = cf->ctx;
+    struct iovec vec[CF_SOCKET_IOV_MAX];
+    struct msghdr msg;
+    size_t n = CURLMIN(iovcnt, CF_SOCKET_IOV_MAX);
+
+    for(i = 0; i < n; ++i) {
+      vec[i].iov_base = CURL_UNCONST(iov[i].base);
+      vec[i].iov_len = iov[i].len;
+      total += iov[i].len;
+    }
+#ifdef DEBUGBUILD
+    /* simulate network blocking/partial writes */
+    if(ctx->wblock_percent > 0) {
+      unsigned char c = 0;
+      Curl_rand_bytes(data, FALSE, &c, 1);
+      if(c >= ((100-ctx->wblock_percent)*256/100)) {
+        CURL_TRC_CF(data, cf, "sendv(len=%zu) SIMULATE EWOULDBLOCK", total);
+        *err = CURLE_AGAIN;
+        return -1;
+      }
+    }
+    if(ctx->wpartial_percent > 0 && total > 8) {
+      size_t len = total * ctx->wpartial_percent / 100;
+      if(!len)
+        len = 1;
+      CURL_TRC_CF(data, cf, "sendv(len=%zu) SIMULATE partial write of %zu "
+                  "bytes", total, len);
+      for(i = 0; i < n && len; ++i) {
+        if(vec[i].iov_len > len)
+          vec[i].iov_len = len;
+        len -= vec[i].iov_len;
+      }
+      n = i;
+    }
+#endif
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = vec;
+    msg.msg_iovlen = (int)n;
+    nwritten = sendmsg(ctx->sock, &msg, SEND_4TH_ARG);
+    if(-1 == nwritten)
+      *err = socket_send_err(data);
+    CURL_TRC_CF(data, cf, "sendv(len=%zu, spans=%zu) -> %d, err=%d",
+                total, n, (int)nwritten, *err);
+    return nwritten;
+  }
+#endif /* HAVE_SENDMSG */
+
+  /* write the spans one by one, stop at the first short write */
+  for(i = 0; i < iovcnt; ++i) {
+    nwritten = cf_socket_send(cf, data, iov[i].base, iov[i].len, FALSE, err);
+    if(nwritten < 0) {
+      if(total && (*err == CURLE_AGAIN)) {
+        *err = CURLE_OK;
+        break;
+      }
+      return -1;
+    }
+    total += (size_t)nwritten;
+    if((size_t)nwritten < iov[i].len)
+      break;
+  }
+  return (ssize_t)total;
+}
+
 static ssize_t cf_socket_recv(struct Curl_cfilter *cf, struct Curl_easy *data,
                               char *buf, size_t len, CURLcode *err)
 {
@@ -31,6 +31,7 @@
 struct Curl_addrinfo;
 struct Curl_cfilter;
 struct Curl_easy;
+struct Curl_iov;
 struct connectdata;
 struct Curl_sockaddr_ex;
 struct ip_quadruple;
@@ -167,6 +168,26 @@ CURLcode Curl_cf_socket_peek(struct Curl_cfilter *cf,
                              const struct Curl_sockaddr_ex **paddr,
                              struct ip_quadruple *pip);
 
+/**
+ * Return the connected TCP or UNIX socket filter that sends by `cf`
+ * end up in, when only filters passing sends on unchanged are in
+ * between. Curl_cf_socket_sendv() can write to it. NULL otherwise.
+ */
+struct Curl_cfilter *Curl_cf_socket_sendv_cf(struct Curl_cfilter *cf);
+
+/**
+ * Send the `iovcnt` spans in `iov` with one vectored write on the
+ * socket of filter `cf`, in order and as if they were one buffer.
+ * Returns the number of bytes written, which may be less than the
+ * sum of all spans, or -1 with `err` set. CURLE_AGAIN is returned
+ * when the socket would block. Builds without sendmsg() write the
+ * spans one by one.
+ */
+ssize_t Curl_cf_socket_sendv(struct Curl_cfilter *cf,
+                             struct Curl_easy *data,
+                             const struct Curl_iov *iov, size_t iovcnt,
+                             CURLcode *err);
+
 extern struct Curl_cftype Curl_cft_tcp;
 extern struct Curl_cftype Curl_cft_udp;
 extern struct Curl_cftype Curl_cft_unix;
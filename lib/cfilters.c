@@ -27,6 +27,7 @@
 #include "urldata.h"
 #include "strerror.h"
 #include "cfilters.h"
+#include "cf-socket.h"
 #include "connect.h"
 #include "url.h"
 #include "sendf.h"
@@ -391,6 +392,47 @@ ssize_t Curl_conn_cf_send(struct Curl_cfilter *cf, struct Curl_easy *data,
   return -1;
 }
 
+ssize_t Curl_conn_cf_send_iov(struct Curl_cfilter *cf, struct Curl_easy *data,
+                              const struct Curl_iov *iov, size_t iovcnt,
+                              bool eos, CURLcode *err)
+{
+  struct Curl_cfilter *sock_cf;
+  char *buf;
+  size_t i, blen = 0, total = 0;
+  ssize_t nwritten;
+
+  if(!cf) {
+    *err = CURLE_SEND_ERROR;
+    return -1;
+  }
+  sock_cf = Curl_cf_socket_sendv_cf(cf);
+  if(sock_cf)
+    return Curl_cf_socket_sendv(sock_cf, data, iov, iovcnt, err);
+
+  if(!iovcnt)
+    return cf->cft->do_send(cf, data, NULL, 0, eos, err);
+  for(i = 0; i < iovcnt; ++i)
+    total += iov[i].len;
+  if((iovcnt == 1) || (iov[0].len >= CF_SEND_IOV_COALESCE_MAX) ||
+     Curl_multi_xfer_sockbuf_borrow(data, CURLMIN(total,
+                                                  CF_SEND_IOV_COALESCE_MAX),
+                                    &buf))
+    /* send what we can without copying */
+    return cf->cft->do_send(cf, data, iov[0].base, iov[0].len,
+                            eos && (iov[0].len == total), err);
+
+  for(i = 0; (i < iovcnt) && (blen < CF_SEND_IOV_COALESCE_MAX); ++i) {
+    size_t n = CURLMIN(iov[i].len, CF_SEND_IOV_COALESCE_MAX - blen);
+    if(n)
+      memcpy(buf + blen, iov[i].base, n);
+    blen += n;
+  }
+  nwritten = cf->cft->do_send(cf, data, buf, blen, eos && (blen == total),
+                              err);
+  Curl_multi_xfer_sockbuf_release(data, buf);
+  return nwritten;
+}
+
 ssize_t Curl_conn_cf_recv(struct Curl_cfilter *cf, struct Curl_easy *data,
                           char *buf, size_t len, CURLcode *err)
 {
@@ -109,6 +109,16 @@ typedef ssize_t  Curl_cft_send(struct Curl_cfilter *cf,
                                bool eos,               /* last chunk */
                                CURLcode *err);         /* error to return */
 
+/* A span of bytes to send, see Curl_conn_cf_send_iov() */
+struct Curl_iov {
+  const void *base;
+  size_t len;
+};
+
+/* Curl_conn_cf_send_iov() hands at most this many bytes of the spans to a
+ * filter that is not a socket, the payload of a full TLS record. */
+#define CF_SEND_IOV_COALESCE_MAX  (16 * 1024)
+
 typedef ssize_t  Curl_cft_recv(struct Curl_cfilter *cf,
                                struct Curl_easy *data, /* transfer */
                                char *buf,              /* store data here */
@@ -329,6 +339,16 @@ void Curl_conn_cf_close(struct Curl_cfilter *cf, struct Curl_easy *data);
 ssize_t Curl_conn_cf_send(struct Curl_cfilter *cf, struct Curl_easy *data,
                           const void *buf, size_t len, bool eos,
                           CURLcode *err);
+/* Send the `iovcnt` spans in `iov` via filter `cf`, in order and as if
+ * they were one buffer. Returns the number of bytes written, which may be
+ * less than the sum of all spans. When only filters passing sends on
+ * unchanged lead to a socket, the spans are written with one vectored
+ * write. Otherwise, they are copied into one buffer of at most
+ * CF_SEND_IOV_COALESCE_MAX bytes for `cf`. A first span at least that
+ * large is sent as it is. */
+ssize_t Curl_conn_cf_send_iov(struct Curl_cfilter *cf, struct Curl_easy *data,
+                              const struct Curl_iov *iov, size_t iovcnt,
+                              bool eos, CURLcode *err);
 ssize_t Curl_conn_cf_recv(struct Curl_cfilter *cf, struct Curl_easy *data,
                           char *buf, size_t len, CURLcode *err);
 CURLcode Curl_conn_cf_cntrl(struct Curl_cfilter *cf,
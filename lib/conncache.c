@@ -52,11 +52,22 @@
 #include "memdebug.h"
 
 
-#define CPOOL_IS_LOCKED(c)    ((c) && (c)->locked)
+#ifdef USE_CPOOL_SHARDS
+/* A pool split into shards is locked per shard. The share's lock
+ * callbacks are not called for CURL_LOCK_DATA_CONNECT then. */
+#define CPOOL_IS_SHARDED(c)   ((c)->sharded)
+#else
+#define CPOOL_IS_SHARDED(c)   FALSE
+#endif
+
+/* A sharded pool is locked per shard, tracked at the transfer. */
+#define CPOOL_IS_LOCKED(c,d)                                            \
+  ((c) && (CPOOL_IS_SHARDED(c) ? (d)->state.cpool_locked : (c)->locked))
 
+/* Lock the complete pool, when it is not sharded */
 #define CPOOL_LOCK(c,d)                                                 \
   do {                                                                  \
-    if((c)) {                                                           \
+    if((c) && !CPOOL_IS_SHARDED(c)) {                                   \
       if(CURL_SHARE_KEEP_CONNECT((c)->share))                           \
         Curl_share_lock((d), CURL_LOCK_DATA_CONNECT,                    \
                         CURL_LOCK_ACCESS_SINGLE);                       \
@@ -67,7 +78,7 @@
 
 #define CPOOL_UNLOCK(c,d)                                                 \
   do {                                                                  \
-    if((c)) {                                                           \
+    if((c) && !CPOOL_IS_SHARDED(c)) {                                   \
       DEBUGASSERT((c)->locked);                                         \
       (c)->locked = FALSE;                                              \
       if(CURL_SHARE_KEEP_CONNECT((c)->share))                           \
@@ -75,6 +86,25 @@
     }                                                                   \
   } while(0)
 
+/* Lock the pool's counters, when sharded. Never held while
+ * acquiring a shard lock. */
+#ifdef USE_CPOOL_SHARDS
+#define CPOOL_COUNT_LOCK(c)                                             \
+  do {                                                                  \
+    if((c)->sharded)                                                    \
+      Curl_mutex_acquire(&(c)->mutex);                                  \
+  } while(0)
+
+#define CPOOL_COUNT_UNLOCK(c)                                           \
+  do {                                                                  \
+    if((c)->sharded)                                                    \
+      Curl_mutex_release(&(c)->mutex);                                  \
+  } while(0)
+#else
+#define CPOOL_COUNT_LOCK(c)     Curl_nop_stmt
+#define CPOOL_COUNT_UNLOCK(c)   Curl_nop_stmt
+#endif
+
 
 /* A list of connections to the same destination. */
 struct cpool_bundle {
@@ -138,25 +168,107 @@ void Curl_cpool_init(struct cpool *cpool,
                      struct Curl_share *share,
                      size_t size)
 {
-  Curl_hash_init(&cpool->dest2bundle, size, Curl_hash_str,
-                 curlx_str_key_compare, cpool_bundle_free_entry);
-
   DEBUGASSERT(idata);
 
+  cpool->shards = &cpool->shard0;
+  cpool->nshards = 1;
+#ifdef USE_CPOOL_SHARDS
+  if(share) {
+    struct cpool_shard *shards = calloc(CPOOL_SHARDS_NUM, sizeof(*shards));
+    if(shards) {
+      size_t i, shard_size = (size + CPOOL_SHARDS_NUM - 1) / CPOOL_SHARDS_NUM;
+      for(i = 0; i < CPOOL_SHARDS_NUM; ++i) {
+        Curl_hash_init(&shards[i].dest2bundle, shard_size, Curl_hash_str,
+                       curlx_str_key_compare, cpool_bundle_free_entry);
+        Curl_mutex_init(&shards[i].mutex);
+      }
+      Curl_mutex_init(&cpool->mutex);
+      cpool->shards = shards;
+      cpool->nshards = CPOOL_SHARDS_NUM;
+      cpool->sharded = TRUE;
+    }
+  }
+#endif
+  if(cpool->nshards == 1)
+    Curl_hash_init(&cpool->shard0.dest2bundle, size, Curl_hash_str,
+                   curlx_str_key_compare, cpool_bundle_free_entry);
+
   cpool->idata = idata;
   cpool->share = share;
   cpool->initialised = TRUE;
 }
 
-/* Return the "first" connection in the pool or NULL. */
-static struct connectdata *cpool_get_first(struct cpool *cpool)
+/* Get the shard connections to `destination` are kept in. */
+static struct cpool_shard *cpool_get_shard(struct cpool *cpool,
+                                           const char *destination)
+{
+  if(cpool->nshards > 1 && destination) {
+    size_t i = Curl_hash_str(CURL_UNCONST(destination),
+                             strlen(destination) + 1, cpool->nshards);
+    return &cpool->shards[i];
+  }
+  return cpool->shards;
+}
+
+/* Lock the shard, when the pool is sharded. The lock is recorded at
+ * the calling transfer `data`, which may be NULL when the pool locks
+ * for its own maintenance and passes the state on explicitly. */
+static void cpool_shard_lock(struct cpool *cpool,
+                             struct cpool_shard *shard,
+                             struct Curl_easy *data)
+{
+#ifdef USE_CPOOL_SHARDS
+  if(CPOOL_IS_SHARDED(cpool)) {
+    Curl_mutex_acquire(&shard->mutex);
+    if(data) {
+      DEBUGASSERT(!data->state.cpool_locked);
+      data->state.cpool_locked = TRUE;
+    }
+  }
+#else
+  (void)cpool;
+  (void)shard;
+  (void)data;
+#endif
+}
+
+static void cpool_shard_unlock(struct cpool *cpool,
+                               struct cpool_shard *shard,
+                               struct Curl_easy *data)
+{
+#ifdef USE_CPOOL_SHARDS
+  if(CPOOL_IS_SHARDED(cpool)) {
+    if(data) {
+      DEBUGASSERT(data->state.cpool_locked);
+      data->state.cpool_locked = FALSE;
+    }
+    Curl_mutex_release(&shard->mutex);
+  }
+#else
+  (void)cpool;
+  (void)shard;
+  (void)data;
+#endif
+}
+
+static size_t cpool_num_conn(struct cpool *cpool)
+{
+  size_t n;
+  CPOOL_COUNT_LOCK(cpool);
+  n = cpool->num_conn;
+  CPOOL_COUNT_UNLOCK(cpool);
+  return n;
+}
+
+/* Return the "first" connection in the shard or NULL. */
+static struct connectdata *cpool_get_first(struct cpool_shard *shard)
 {
   struct Curl_hash_iterator iter;
   struct Curl_hash_element *he;
   struct cpool_bundle *bundle;
   struct Curl_llist_node *conn_node;
 
-  Curl_hash_start_iterate(&cpool->dest2bundle, &iter);
+  Curl_hash_start_iterate(&shard->dest2bundle, &iter);
   for(he = Curl_hash_next_element(&iter); he;
       he = Curl_hash_next_element(&iter)) {
     bundle = he->ptr;
@@ -168,37 +280,40 @@ static struct connectdata *cpool_get_first(struct cpool *cpool)
 }
 
 
-static struct cpool_bundle *cpool_find_bundle(struct cpool *cpool,
+static struct cpool_bundle *cpool_find_bundle(struct cpool_shard *shard,
                                               struct connectdata *conn)
 {
-  return Curl_hash_pick(&cpool->dest2bundle,
+  return Curl_hash_pick(&shard->dest2bundle,
                         conn->destination, strlen(conn->destination) + 1);
 }
 
 
-static void cpool_remove_bundle(struct cpool *cpool,
+static void cpool_remove_bundle(struct cpool_shard *shard,
                                 struct cpool_bundle *bundle)
 {
-  if(!cpool)
+  if(!shard)
     return;
-  Curl_hash_delete(&cpool->dest2bundle, bundle->dest, bundle->dest_len);
+  Curl_hash_delete(&shard->dest2bundle, bundle->dest, bundle->dest_len);
 }
 
 
 static void cpool_remove_conn(struct cpool *cpool,
+                              struct cpool_shard *shard,
                               struct connectdata *conn)
 {
   struct Curl_llist *list = Curl_node_llist(&conn->cpool_node);
   DEBUGASSERT(cpool);
   if(list) {
     /* The connection is certainly in the pool, but where? */
-    struct cpool_bundle *bundle = cpool_find_bundle(cpool, conn);
+    struct cpool_bundle *bundle = cpool_find_bundle(shard, conn);
     if(bundle && (list == &bundle->conns)) {
       cpool_bundle_remove(bundle, conn);
       if(!Curl_llist_count(&bundle->conns))
-        cpool_remove_bundle(cpool, bundle);
+        cpool_remove_bundle(shard, bundle);
       conn->bits.in_cpool = FALSE;
+      CPOOL_COUNT_LOCK(cpool);
       cpool->num_conn--;
+      CPOOL_COUNT_UNLOCK(cpool);
     }
     else {
       /* Should have been in the bundle list */
@@ -213,22 +328,44 @@ void Curl_cpool_destroy(struct cpool *cpool)
     struct connectdata *conn;
     SIGPIPE_VARIABLE(pipe_st);
 
+    size_t i;
+
     CURL_TRC_M(cpool->idata, "%s[CPOOL] destroy, %zu connections",
-               cpool->share ? "[SHARE] " : "", cpool->num_conn);
+               cpool->share ? "[SHARE] " : "", cpool_num_conn(cpool));
     /* Move all connections to the shutdown list */
     sigpipe_init(&pipe_st);
     CPOOL_LOCK(cpool, cpool->idata);
-    conn = cpool_get_first(cpool);
-    while(conn) {
-      cpool_remove_conn(cpool, conn);
-      sigpipe_apply(cpool->idata, &pipe_st);
-      connclose(conn, "kill all");
-      cpool_discard_conn(cpool, cpool->idata, conn, FALSE);
-      conn = cpool_get_first(cpool);
+    for(i = 0; i < cpool->nshards; ++i) {
+      struct cpool_shard *shard = &cpool->shards[i];
+      cpool_shard_lock(cpool, shard, NULL);
+      conn = cpool_get_first(shard);
+      while(conn) {
+        cpool_remove_conn(cpool, shard, conn);
+        sigpipe_apply(cpool->idata, &pipe_st);
+        connclose(conn, "kill all");
+        cpool_discard_conn(cpool, cpool->idata, conn, FALSE);
+        conn = cpool_get_first(shard);
+      }
+      cpool_shard_unlock(cpool, shard, NULL);
     }
     CPOOL_UNLOCK(cpool, cpool->idata);
     sigpipe_restore(&pipe_st);
-    Curl_hash_destroy(&cpool->dest2bundle);
+    for(i = 0; i < cpool->nshards; ++i) {
+      Curl_hash_destroy(&cpool->shards[i].dest2bundle);
+#ifdef USE_CPOOL_SHARDS
+      if(cpool->sharded)
+        Curl_mutex_destroy(&cpool->shards[i].mutex);
+#endif
+    }
+#ifdef USE_CPOOL_SHARDS
+    if(cpool->sharded) {
+      Curl_mutex_destroy(&cpool->mutex);
+      free(cpool->shards);
+      cpool->shards = &cpool->shard0;
+      cpool->nshards = 1;
+      cpool->sharded = FALSE;
+    }
+#endif
   }
 }
 
@@ -252,10 +389,12 @@ void Curl_cpool_xfer_init(struct Curl_easy *data)
   DEBUGASSERT(cpool);
   if(cpool) {
     CPOOL_LOCK(cpool, data);
+    CPOOL_COUNT_LOCK(cpool);
     /* the identifier inside the connection cache */
     data->id = cpool->next_easy_id++;
     if(cpool->next_easy_id <= 0)
       cpool->next_easy_id = 0;
+    CPOOL_COUNT_UNLOCK(cpool);
     data->state.lastconnect_id = -1;
 
     CPOOL_UNLOCK(cpool, data);
@@ -268,7 +407,7 @@ void Curl_cpool_xfer_init(struct Curl_easy *data)
 }
 
 static struct cpool_bundle *
-cpool_add_bundle(struct cpool *cpool, struct connectdata *conn)
+cpool_add_bundle(struct cpool_shard *shard, struct connectdata *conn)
 {
   struct cpool_bundle *bundle;
 
@@ -276,7 +415,7 @@ cpool_add_bundle(struct cpool *cpool, struct connectdata *conn)
   if(!bundle)
     return NULL;
 
-  if(!Curl_hash_add(&cpool->dest2bundle,
+  if(!Curl_hash_add(&shard->dest2bundle,
                     bundle->dest, bundle->dest_len, bundle)) {
     cpool_bundle_destroy(bundle);
     return NULL;
@@ -313,6 +452,7 @@ cpool_bundle_get_oldest_idle(struct cpool_bundle *bundle)
   return oldest_idle;
 }
 
+/* Find the oldest idle connection in all shards, all must be locked. */
 static struct connectdata *cpool_get_oldest_idle(struct cpool *cpool)
 {
   struct Curl_hash_iterator iter;
@@ -323,36 +463,72 @@ static struct connectdata *cpool_get_oldest_idle(struct cpool *cpool)
   struct curltime now;
   timediff_t highscore =- 1;
   timediff_t score;
+  size_t i;
 
   now = curlx_now();
-  Curl_hash_start_iterate(&cpool->dest2bundle, &iter);
-
-  for(he = Curl_hash_next_element(&iter); he;
-      he = Curl_hash_next_element(&iter)) {
-    struct connectdata *conn;
-    bundle = he->ptr;
-
-    for(curr = Curl_llist_head(&bundle->conns); curr;
-        curr = Curl_node_next(curr)) {
-      conn = Curl_node_elem(curr);
-      if(CONN_INUSE(conn) || conn->bits.close || conn->connect_only)
-        continue;
-      /* Set higher score for the age passed since the connection was used */
-      score = curlx_timediff(now, conn->lastused);
-      if(score > highscore) {
-        highscore = score;
-        oldest_idle = conn;
+  for(i = 0; i < cpool->nshards; ++i) {
+    Curl_hash_start_iterate(&cpool->shards[i].dest2bundle, &iter);
+
+    for(he = Curl_hash_next_element(&iter); he;
+        he = Curl_hash_next_element(&iter)) {
+      struct connectdata *conn;
+      bundle = he->ptr;
+
+      for(curr = Curl_llist_head(&bundle->conns); curr;
+          curr = Curl_node_next(curr)) {
+        conn = Curl_node_elem(curr);
+        if(CONN_INUSE(conn) || conn->bits.close || conn->connect_only)
+          continue;
+        /* Set higher score for the age passed since the connection was
+           used */
+        score = curlx_timediff(now, conn->lastused);
+        if(score > highscore) {
+          highscore = score;
+          oldest_idle = conn;
+        }
       }
     }
   }
   return oldest_idle;
 }
 
+/* Remove the oldest idle connection from the pool and return it.
+ * Locks all shards of a sharded pool in order, the caller may not
+ * hold any of them. */
+static struct connectdata *cpool_take_oldest_idle(struct cpool *cpool)
+{
+  struct connectdata *conn;
+#ifdef USE_CPOOL_SHARDS
+  size_t i;
+
+  if(CPOOL_IS_SHARDED(cpool)) {
+    for(i = 0; i < cpool->nshards; ++i)
+      Curl_mutex_acquire(&cpool->shards[i].mutex);
+  }
+#endif
+  conn = cpool_get_oldest_idle(cpool);
+  if(conn)
+    cpool_remove_conn(cpool, cpool_get_shard(cpool, conn->destination), conn);
+#ifdef USE_CPOOL_SHARDS
+  if(CPOOL_IS_SHARDED(cpool)) {
+    for(i = cpool->nshards; i > 0; --i)
+      Curl_mutex_release(&cpool->shards[i - 1].mutex);
+  }
+#endif
+  return conn;
+}
+
+
+static void cpool_conn_terminate(struct cpool *cpool,
+                                 struct Curl_easy *data,
+                                 struct connectdata *conn,
+                                 bool aborted, bool locked);
 
 int Curl_cpool_check_limits(struct Curl_easy *data,
                             struct connectdata *conn)
 {
   struct cpool *cpool = cpool_get_instance(data);
+  struct cpool_shard *shard;
   struct cpool_bundle *bundle;
   size_t dest_limit = 0;
   size_t total_limit = 0;
@@ -374,7 +550,9 @@ int Curl_cpool_check_limits(struct Curl_easy *data,
   if(dest_limit) {
     size_t live;
 
-    bundle = cpool_find_bundle(cpool, conn);
+    shard = cpool_get_shard(cpool, conn->destination);
+    cpool_shard_lock(cpool, shard, NULL);
+    bundle = cpool_find_bundle(shard, conn);
     live = bundle ? Curl_llist_count(&bundle->conns) : 0;
     shutdowns = Curl_cshutdn_dest_count(data, conn->destination);
     while((live  + shutdowns) >= dest_limit) {
@@ -397,14 +575,15 @@ int Curl_cpool_check_limits(struct Curl_easy *data,
                      FMT_OFF_T " from %zu to reach destination "
                      "limit of %zu", oldest_idle->connection_id,
                      Curl_llist_count(&bundle->conns), dest_limit);
-        Curl_conn_terminate(cpool->idata, oldest_idle, FALSE);
+        cpool_conn_terminate(cpool, cpool->idata, oldest_idle, FALSE, TRUE);
 
         /* in case the bundle was destroyed in disconnect, look it up again */
-        bundle = cpool_find_bundle(cpool, conn);
+        bundle = cpool_find_bundle(shard, conn);
         live = bundle ? Curl_llist_count(&bundle->conns) : 0;
       }
       shutdowns = Curl_cshutdn_dest_count(cpool->idata, conn->destination);
     }
+    cpool_shard_unlock(cpool, shard, NULL);
     if((live + shutdowns) >= dest_limit) {
       result = CPOOL_LIMIT_DEST;
       goto out;
@@ -413,26 +592,27 @@ int Curl_cpool_check_limits(struct Curl_easy *data,
 
   if(total_limit) {
     shutdowns = Curl_cshutdn_count(cpool->idata);
-    while((cpool->num_conn + shutdowns) >= total_limit) {
+    while((cpool_num_conn(cpool) + shutdowns) >= total_limit) {
       if(shutdowns) {
         /* close one connection in shutdown right away, if we can */
         if(!Curl_cshutdn_close_oldest(data, NULL))
           break;
       }
       else {
-        struct connectdata *oldest_idle = cpool_get_oldest_idle(cpool);
+        struct connectdata *oldest_idle = cpool_take_oldest_idle(cpool);
         if(!oldest_idle)
           break;
         /* disconnect the old conn and continue */
         CURL_TRC_M(data, "Discarding connection #%"
                    FMT_OFF_T " from %zu to reach total "
-                   "limit of %zu",
-                   oldest_idle->connection_id, cpool->num_conn, total_limit);
-        Curl_conn_terminate(cpool->idata, oldest_idle, FALSE);
+                   "limit of %zu", oldest_idle->connection_id,
+                   cpool_num_conn(cpool) + 1, total_limit);
+        /* no longer in the pool, a sharded pool needs no lock */
+        cpool_conn_terminate(cpool, cpool->idata, oldest_idle, FALSE, TRUE);
       }
       shutdowns = Curl_cshutdn_count(cpool->idata);
     }
-    if((cpool->num_conn + shutdowns) >= total_limit) {
+    if((cpool_num_conn(cpool) + shutdowns) >= total_limit) {
       result = CPOOL_LIMIT_TOTAL;
       goto out;
     }
@@ -449,6 +629,8 @@ CURLcode Curl_cpool_add(struct Curl_easy *data,
   CURLcode result = CURLE_OK;
   struct cpool_bundle *bundle = NULL;
   struct cpool *cpool = cpool_get_instance(data);
+  struct cpool_shard *shard;
+  size_t num_conn;
   DEBUGASSERT(conn);
 
   DEBUGASSERT(cpool);
@@ -456,9 +638,11 @@ CURLcode Curl_cpool_add(struct Curl_easy *data,
     return CURLE_FAILED_INIT;
 
   CPOOL_LOCK(cpool, data);
-  bundle = cpool_find_bundle(cpool, conn);
+  shard = cpool_get_shard(cpool, conn->destination);
+  cpool_shard_lock(cpool, shard, data);
+  bundle = cpool_find_bundle(shard, conn);
   if(!bundle) {
-    bundle = cpool_add_bundle(cpool, conn);
+    bundle = cpool_add_bundle(shard, conn);
     if(!bundle) {
       result = CURLE_OUT_OF_MEMORY;
       goto out;
@@ -466,12 +650,15 @@ CURLcode Curl_cpool_add(struct Curl_easy *data,
   }
 
   cpool_bundle_add(bundle, conn);
+  CPOOL_COUNT_LOCK(cpool);
   conn->connection_id = cpool->next_connection_id++;
-  cpool->num_conn++;
+  num_conn = ++cpool->num_conn;
+  CPOOL_COUNT_UNLOCK(cpool);
   CURL_TRC_M(data, "[CPOOL] added connection %" FMT_OFF_T ". "
              "The cache now contains %zu members",
-             conn->connection_id, cpool->num_conn);
+             conn->connection_id, num_conn);
 out:
+  cpool_shard_unlock(cpool, shard, data);
   CPOOL_UNLOCK(cpool, data);
 
   return result;
@@ -483,7 +670,7 @@ out:
 
    The cpool lock is still held when the callback is called. It needs it,
    so that it can safely continue traversing the lists once the callback
-   returns.
+   returns. A sharded pool is locked one shard at a time.
 
    Returns TRUE if the loop was aborted due to the callback's return code.
 
@@ -497,33 +684,70 @@ static bool cpool_foreach(struct Curl_easy *data,
 {
   struct Curl_hash_iterator iter;
   struct Curl_hash_element *he;
+  size_t i;
 
   if(!cpool)
     return FALSE;
 
-  Curl_hash_start_iterate(&cpool->dest2bundle, &iter);
+  for(i = 0; i < cpool->nshards; ++i) {
+    struct cpool_shard *shard = &cpool->shards[i];
 
-  he = Curl_hash_next_element(&iter);
-  while(he) {
-    struct Curl_llist_node *curr;
-    struct cpool_bundle *bundle = he->ptr;
-    he = Curl_hash_next_element(&iter);
+    cpool_shard_lock(cpool, shard, data);
+    Curl_hash_start_iterate(&shard->dest2bundle, &iter);
 
-    curr = Curl_llist_head(&bundle->conns);
-    while(curr) {
-      /* Yes, we need to update curr before calling func(), because func()
-         might decide to remove the connection */
-      struct connectdata *conn = Curl_node_elem(curr);
-      curr = Curl_node_next(curr);
-
-      if(1 == func(data, conn, param)) {
-        return TRUE;
+    he = Curl_hash_next_element(&iter);
+    while(he) {
+      struct Curl_llist_node *curr;
+      struct cpool_bundle *bundle = he->ptr;
+      he = Curl_hash_next_element(&iter);
+
+      curr = Curl_llist_head(&bundle->conns);
+      while(curr) {
+        /* Yes, we need to update curr before calling func(), because func()
+           might decide to remove the connection */
+        struct connectdata *conn = Curl_node_elem(curr);
+        curr = Curl_node_next(curr);
+
+        if(1 == func(data, conn, param)) {
+          cpool_shard_unlock(cpool, shard, data);
+          return TRUE;
+        }
       }
     }
+    cpool_shard_unlock(cpool, shard, data);
   }
   return FALSE;
 }
 
+static unsigned int cpool_max_connects(struct Curl_easy *data)
+{
+  return !data->multi->maxconnects ?
+    (Curl_multi_xfers_running(data->multi) * 4) : data->multi->maxconnects;
+}
+
+#ifdef USE_CPOOL_SHARDS
+/* Close the oldest idle connection of a sharded pool when it exceeds
+ * its limit. Must be called without holding a shard lock. */
+static void cpool_shrink(struct cpool *cpool, struct Curl_easy *data)
+{
+  unsigned int maxconnects;
+  size_t num_conn;
+
+  DEBUGASSERT(!data->state.cpool_locked);
+  if(!data->multi)
+    return;
+  maxconnects = cpool_max_connects(data);
+  num_conn = cpool_num_conn(cpool);
+  if(maxconnects && (num_conn > maxconnects)) {
+    struct connectdata *oldest_idle = cpool_take_oldest_idle(cpool);
+    infof(data, "Connection pool is full, closing the oldest of %zu/%u",
+          num_conn, maxconnects);
+    if(oldest_idle)
+      Curl_conn_terminate(data, oldest_idle, FALSE);
+  }
+}
+#endif
+
 /*
  * A connection (already in the pool) has become idle. Do any
  * cleanups in regard to the pool's limits.
@@ -533,16 +757,24 @@ static bool cpool_foreach(struct Curl_easy *data,
 bool Curl_cpool_conn_now_idle(struct Curl_easy *data,
                               struct connectdata *conn)
 {
-  unsigned int maxconnects = !data->multi->maxconnects ?
-    (Curl_multi_xfers_running(data->multi) * 4) : data->multi->maxconnects;
+  unsigned int maxconnects = cpool_max_connects(data);
   struct connectdata *oldest_idle = NULL;
   struct cpool *cpool = cpool_get_instance(data);
   bool kept = TRUE;
 
   conn->lastused = curlx_now(); /* it was used up until now */
+#ifdef USE_CPOOL_SHARDS
+  if(cpool && CPOOL_IS_SHARDED(cpool)) {
+    /* Finding the oldest connection needs all shards. When called under
+     * a shard lock, Curl_cpool_do_locked() shrinks the pool afterwards. */
+    if(!data->state.cpool_locked)
+      cpool_shrink(cpool, data);
+    return kept;
+  }
+#endif
   if(cpool && maxconnects) {
     /* may be called form a callback already under lock */
-    bool do_lock = !CPOOL_IS_LOCKED(cpool);
+    bool do_lock = !CPOOL_IS_LOCKED(cpool, data);
     if(do_lock)
       CPOOL_LOCK(cpool, data);
     if(cpool->num_conn > maxconnects) {
@@ -569,6 +801,7 @@ bool Curl_cpool_find(struct Curl_easy *data,
                      void *userdata)
 {
   struct cpool *cpool = cpool_get_instance(data);
+  struct cpool_shard *shard;
   struct cpool_bundle *bundle;
   bool result = FALSE;
 
@@ -578,7 +811,9 @@ bool Curl_cpool_find(struct Curl_easy *data,
     return FALSE;
 
   CPOOL_LOCK(cpool, data);
-  bundle = Curl_hash_pick(&cpool->dest2bundle,
+  shard = cpool_get_shard(cpool, destination);
+  cpool_shard_lock(cpool, shard, data);
+  bundle = Curl_hash_pick(&shard->dest2bundle,
                           CURL_UNCONST(destination),
                           strlen(destination) + 1);
   if(bundle) {
@@ -598,6 +833,7 @@ bool Curl_cpool_find(struct Curl_easy *data,
   if(done_cb) {
     result = done_cb(result, userdata);
   }
+  cpool_shard_unlock(cpool, shard, data);
   CPOOL_UNLOCK(cpool, data);
   return result;
 }
@@ -646,20 +882,18 @@ static void cpool_discard_conn(struct cpool *cpool,
   if(done || !data->multi)
     Curl_cshutdn_terminate(cpool->idata, conn, FALSE);
   else
-    Curl_cshutdn_add(&data->multi->cshutdn, conn, cpool->num_conn);
+    Curl_cshutdn_add(&data->multi->cshutdn, conn, cpool_num_conn(cpool));
 }
 
-void Curl_conn_terminate(struct Curl_easy *data,
-                         struct connectdata *conn,
-                         bool aborted)
+/* Terminate `conn`, `locked` is TRUE when the caller already holds
+ * the pool's lock, or the lock of the connection's shard. */
+static void cpool_conn_terminate(struct cpool *cpool,
+                                 struct Curl_easy *data,
+                                 struct connectdata *conn,
+                                 bool aborted, bool locked)
 {
-  struct cpool *cpool = cpool_get_instance(data);
-  bool do_lock;
-
-  DEBUGASSERT(cpool);
-  DEBUGASSERT(data && !data->conn);
-  if(!cpool)
-    return;
+  struct cpool_shard *shard;
+  bool do_lock = !locked;
 
   /* If this connection is not marked to force-close, leave it open if there
    * are other users of it */
@@ -669,14 +903,14 @@ void Curl_conn_terminate(struct Curl_easy *data,
     return;
   }
 
-  /* This method may be called while we are under lock, e.g. from a
-   * user callback in find. */
-  do_lock = !CPOOL_IS_LOCKED(cpool);
-  if(do_lock)
+  shard = cpool_get_shard(cpool, conn->destination);
+  if(do_lock) {
     CPOOL_LOCK(cpool, data);
+    cpool_shard_lock(cpool, shard, data);
+  }
 
   if(conn->bits.in_cpool) {
-    cpool_remove_conn(cpool, conn);
+    cpool_remove_conn(cpool, shard, conn);
     DEBUGASSERT(!conn->bits.in_cpool);
   }
 
@@ -697,8 +931,26 @@ void Curl_conn_terminate(struct Curl_easy *data,
     Curl_cshutdn_terminate(cpool->idata, conn, !aborted);
   }
 
-  if(do_lock)
+  if(do_lock) {
+    cpool_shard_unlock(cpool, shard, data);
     CPOOL_UNLOCK(cpool, data);
+  }
+}
+
+void Curl_conn_terminate(struct Curl_easy *data,
+                         struct connectdata *conn,
+                         bool aborted)
+{
+  struct cpool *cpool = cpool_get_instance(data);
+
+  DEBUGASSERT(cpool);
+  DEBUGASSERT(data && !data->conn);
+  if(!cpool)
+    return;
+  /* This method may be called while we are under lock, e.g. from a
+   * user callback in find. */
+  cpool_conn_terminate(cpool, data, conn, aborted,
+                       CPOOL_IS_LOCKED(cpool, data));
 }
 
 
@@ -736,12 +988,15 @@ void Curl_cpool_prune_dead(struct Curl_easy *data)
 
   rctx.now = curlx_now();
   CPOOL_LOCK(cpool, data);
+  CPOOL_COUNT_LOCK(cpool);
   elapsed = curlx_timediff(rctx.now, cpool->last_cleanup);
+  if(elapsed >= 1000L)
+    cpool->last_cleanup = rctx.now;
+  CPOOL_COUNT_UNLOCK(cpool);
 
   if(elapsed >= 1000L) {
     while(cpool_foreach(data, cpool, &rctx, cpool_reap_dead_cb))
       ;
-    cpool->last_cleanup = rctx.now;
   }
   CPOOL_UNLOCK(cpool, data);
 }
@@ -842,9 +1097,17 @@ void Curl_cpool_do_locked(struct Curl_easy *data,
 {
   struct cpool *cpool = cpool_get_instance(data);
   if(cpool) {
+    struct cpool_shard *shard =
+      cpool_get_shard(cpool, conn ? conn->destination : NULL);
     CPOOL_LOCK(cpool, data);
+    cpool_shard_lock(cpool, shard, data);
     cb(conn, data, cbdata);
+    cpool_shard_unlock(cpool, shard, data);
     CPOOL_UNLOCK(cpool, data);
+#ifdef USE_CPOOL_SHARDS
+    if(CPOOL_IS_SHARDED(cpool))
+      cpool_shrink(cpool, data);
+#endif
   }
   else
     cb(conn, data, cbdata);
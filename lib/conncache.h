@@ -27,6 +27,7 @@
 
 #include <curl/curl.h>
 #include "curlx/timeval.h"
+#include "curl_threads.h"
 
 struct connectdata;
 struct Curl_easy;
@@ -48,21 +49,44 @@ void Curl_conn_terminate(struct Curl_easy *data,
                          struct connectdata *conn,
                          bool aborted);
 
-struct cpool {
+#if defined(USE_THREADS_POSIX) || defined(USE_THREADS_WIN32)
+/* A pool in a share is split into shards, selected by the hash of
+ * a connection's destination. Each shard is locked by its own mutex, so
+ * threads using different destinations do not contend. The share's
+ * lock callbacks are not called for CURL_LOCK_DATA_CONNECT. */
+#define USE_CPOOL_SHARDS
+#define CPOOL_SHARDS_NUM   16
+#endif
+
+struct cpool_shard {
    /* the pooled connections, bundled per destination */
   struct Curl_hash dest2bundle;
+#ifdef USE_CPOOL_SHARDS
+  curl_mutex_t mutex;
+#endif
+};
+
+struct cpool {
+  struct cpool_shard *shards; /* `nshards` shards, `&shard0` if not sharded */
+  struct cpool_shard shard0;
+  size_t nshards;
   size_t num_conn;
   curl_off_t next_connection_id;
   curl_off_t next_easy_id;
   struct curltime last_cleanup;
   struct Curl_easy *idata; /* internal handle for maintenance */
   struct Curl_share *share; /* != NULL if pool belongs to share */
+#ifdef USE_CPOOL_SHARDS
+  curl_mutex_t mutex; /* guards the counters above when sharded */
+#endif
   BIT(locked);
   BIT(initialised);
+  BIT(sharded);
 };
 
 /* Init the pool, pass multi only if pool is owned by it.
- * Cannot fail.
+ * A pool belonging to a share is sharded when threads are available.
+ * Cannot fail, falls back to a single shard when out of memory.
  */
 void Curl_cpool_init(struct cpool *cpool,
                      struct Curl_easy *idata,
@@ -158,6 +182,8 @@ void Curl_cpool_do_by_id(struct Curl_easy *data,
  * connection pool's lock.
  * The callback is always invoked, even if the transfer has no connection
  * pool associated.
+ * For a sharded pool, only the lock of the connection's shard is held
+ * and the pool's size limit is enforced after the callback returned.
  */
 void Curl_cpool_do_locked(struct Curl_easy *data,
                           struct connectdata *conn,
@@ -70,6 +70,14 @@
 #define DECOMPRESS_BUFFER_SIZE 16384 /* buffer size for decompressed data */
 #endif
 
+/* max number of spare decoder states of each kind a multi handle keeps */
+#define CDEC_POOL_SPARES 4
+
+static struct cdec_pool *cdec_pool(struct Curl_easy *data)
+{
+  return data->multi ? &data->multi->cdecp : NULL;
+}
+
 #ifdef HAVE_LIBZ
 
 #if !defined(ZLIB_VERNUM) || (ZLIB_VERNUM < 0x1252)
@@ -84,13 +92,19 @@ typedef enum {
   ZLIB_INIT_GZIP             /* initialized in transparent gzip mode */
 } zlibInitState;
 
+/* zlib state with its output buffer, kept in a `cdec_pool` when idle */
+struct cw_zlib_dec {
+  struct cw_zlib_dec *next;  /* next spare in the pool */
+  z_stream z;                /* State structure for zlib. */
+  char buffer[DECOMPRESS_BUFFER_SIZE]; /* Put the decompressed data here. */
+};
+
 /* Deflate and gzip writer. */
 struct zlib_writer {
   struct Curl_cwriter super;
   zlibInitState zlib_init;   /* zlib init state */
-  char buffer[DECOMPRESS_BUFFER_SIZE]; /* Put the decompressed data here. */
   uInt trailerlen;           /* Remaining trailer byte count. */
-  z_stream z;                /* State structure for zlib. */
+  struct cw_zlib_dec *dec;   /* zlib state and output buffer */
 };
 
 
@@ -122,23 +136,73 @@ process_zlib_error(struct Curl_easy *data, z_stream *z)
   return CURLE_BAD_CONTENT_ENCODING;
 }
 
-static CURLcode
-exit_zlib(struct Curl_easy *data,
-          z_stream *z, zlibInitState *zlib_init, CURLcode result)
+/* Get a zlib state set up for `wbits`, a spare one from the pool if
+   possible. */
+static CURLcode zlib_dec_get(struct Curl_easy *data, int wbits,
+                             struct cw_zlib_dec **pdec)
 {
-  if(*zlib_init != ZLIB_UNINIT) {
-    if(inflateEnd(z) != Z_OK && result == CURLE_OK)
-      result = process_zlib_error(data, z);
-    *zlib_init = ZLIB_UNINIT;
+  struct cdec_pool *pool = cdec_pool(data);
+  struct cw_zlib_dec *dec;
+  CURLcode result;
+
+  while(pool && pool->zlib) {
+    dec = pool->zlib;
+    pool->zlib = dec->next;
+    pool->zlib_count--;
+    dec->next = NULL;
+    /* keeps the window allocated for same sized windows */
+    if(inflateReset2(&dec->z, wbits) == Z_OK) {
+      *pdec = dec;
+      return CURLE_OK;
+    }
+    inflateEnd(&dec->z);
+    free(dec);
   }
 
+  *pdec = NULL;
+  dec = malloc(sizeof(*dec));
+  if(!dec)
+    return CURLE_OUT_OF_MEMORY;
+  memset(&dec->z, 0, sizeof(dec->z));
+  dec->next = NULL;
+  dec->z.zalloc = (alloc_func) zalloc_cb;
+  dec->z.zfree = (free_func) zfree_cb;
+  if(inflateInit2(&dec->z, wbits) != Z_OK) {
+    result = process_zlib_error(data, &dec->z);
+    free(dec);
+    return result;
+  }
+  *pdec = dec;
+  return CURLE_OK;
+}
+
+/* Give a zlib state back, to the pool if there is room. */
+static void zlib_dec_put(struct Curl_easy *data, struct cw_zlib_dec *dec)
+{
+  struct cdec_pool *pool = cdec_pool(data);
+
+  if(pool && (pool->zlib_count < CDEC_POOL_SPARES)) {
+    dec->next = pool->zlib;
+    pool->zlib = dec;
+    pool->zlib_count++;
+  }
+  else {
+    inflateEnd(&dec->z);
+    free(dec);
+  }
+}
+
+/* The stream is over, accept no more data. The state itself is kept until
+   the writer closes. */
+static CURLcode exit_zlib(struct zlib_writer *zp, CURLcode result)
+{
+  zp->zlib_init = ZLIB_UNINIT;
   return result;
 }
 
-static CURLcode process_trailer(struct Curl_easy *data,
-                                struct zlib_writer *zp)
+static CURLcode process_trailer(struct zlib_writer *zp)
 {
-  z_stream *z = &zp->z;
+  z_stream *z = &zp->dec->z;
   CURLcode result = CURLE_OK;
   uInt len = z->avail_in < zp->trailerlen ? z->avail_in : zp->trailerlen;
 
@@ -151,7 +215,7 @@ static CURLcode process_trailer(struct Curl_easy *data,
   if(z->avail_in)
     result = CURLE_WRITE_ERROR;
   if(result || !zp->trailerlen)
-    result = exit_zlib(data, z, &zp->zlib_init, result);
+    result = exit_zlib(zp, result);
   else {
     /* Only occurs for gzip with zlib < 1.2.0.4 or raw deflate. */
     zp->zlib_init = ZLIB_EXTERNAL_TRAILER;
@@ -164,7 +228,7 @@ static CURLcode inflate_stream(struct Curl_easy *data,
                                zlibInitState started)
 {
   struct zlib_writer *zp = (struct zlib_writer *) writer;
-  z_stream *z = &zp->z;         /* zlib state structure */
+  z_stream *z = &zp->dec->z;    /* zlib state structure */
   uInt nread = z->avail_in;
   z_const Bytef *orig_in = z->next_in;
   bool done = FALSE;
@@ -174,7 +238,7 @@ static CURLcode inflate_stream(struct Curl_easy *data,
   if(zp->zlib_init != ZLIB_INIT &&
      zp->zlib_init != ZLIB_INFLATING &&
      zp->zlib_init != ZLIB_INIT_GZIP)
-    return exit_zlib(data, z, &zp->zlib_init, CURLE_WRITE_ERROR);
+    return exit_zlib(zp, CURLE_WRITE_ERROR);
 
   /* because the buffer size is fixed, iteratively decompress and transfer to
      the client via next_write function. */
@@ -183,7 +247,7 @@ static CURLcode inflate_stream(struct Curl_easy *data,
     done = TRUE;
 
     /* (re)set buffer for decompressed output for every iteration */
-    z->next_out = (Bytef *) zp->buffer;
+    z->next_out = (Bytef *) zp->dec->buffer;
     z->avail_out = DECOMPRESS_BUFFER_SIZE;
 
     status = inflate(z, Z_BLOCK);
@@ -192,10 +256,11 @@ static CURLcode inflate_stream(struct Curl_easy *data,
     if(z->avail_out != DECOMPRESS_BUFFER_SIZE) {
       if(status == Z_OK || status == Z_STREAM_END) {
         zp->zlib_init = started;      /* Data started. */
-        result = Curl_cwriter_write(data, writer->next, type, zp->buffer,
+        result = Curl_cwriter_write(data, writer->next, type,
+                                    zp->dec->buffer,
                                     DECOMPRESS_BUFFER_SIZE - z->avail_out);
         if(result) {
-          exit_zlib(data, z, &zp->zlib_init, result);
+          exit_zlib(zp, result);
           break;
         }
       }
@@ -211,7 +276,7 @@ static CURLcode inflate_stream(struct Curl_easy *data,
       /* No more data to flush: just exit loop. */
       break;
     case Z_STREAM_END:
-      result = process_trailer(data, zp);
+      result = process_trailer(zp);
       break;
     case Z_DATA_ERROR:
       /* some servers seem to not generate zlib headers, so this is an attempt
@@ -225,12 +290,12 @@ static CURLcode inflate_stream(struct Curl_easy *data,
           done = FALSE;
           break;
         }
-        zp->zlib_init = ZLIB_UNINIT;    /* inflateEnd() already called. */
+        zp->zlib_init = ZLIB_UNINIT;    /* no way to go on */
       }
-      result = exit_zlib(data, z, &zp->zlib_init, process_zlib_error(data, z));
+      result = exit_zlib(zp, process_zlib_error(data, z));
       break;
     default:
-      result = exit_zlib(data, z, &zp->zlib_init, process_zlib_error(data, z));
+      result = exit_zlib(zp, process_zlib_error(data, z));
       break;
     }
   }
@@ -250,14 +315,10 @@ static CURLcode deflate_do_init(struct Curl_easy *data,
                                 struct Curl_cwriter *writer)
 {
   struct zlib_writer *zp = (struct zlib_writer *) writer;
-  z_stream *z = &zp->z;     /* zlib state structure */
-
-  /* Initialize zlib */
-  z->zalloc = (alloc_func) zalloc_cb;
-  z->zfree = (free_func) zfree_cb;
+  CURLcode result = zlib_dec_get(data, MAX_WBITS, &zp->dec);
 
-  if(inflateInit(z) != Z_OK)
-    return process_zlib_error(data, z);
+  if(result)
+    return result;
   zp->zlib_init = ZLIB_INIT;
   return CURLE_OK;
 }
@@ -267,7 +328,7 @@ static CURLcode deflate_do_write(struct Curl_easy *data,
                                  const char *buf, size_t nbytes)
 {
   struct zlib_writer *zp = (struct zlib_writer *) writer;
-  z_stream *z = &zp->z;     /* zlib state structure */
+  z_stream *z = &zp->dec->z;     /* zlib state structure */
 
   if(!(type & CLIENTWRITE_BODY) || !nbytes)
     return Curl_cwriter_write(data, writer->next, type, buf, nbytes);
@@ -277,19 +338,22 @@ static CURLcode deflate_do_write(struct Curl_easy *data,
   z->avail_in = (uInt)nbytes;
 
   if(zp->zlib_init == ZLIB_EXTERNAL_TRAILER)
-    return process_trailer(data, zp);
+    return process_trailer(zp);
 
   /* Now uncompress the data */
   return inflate_stream(data, writer, type, ZLIB_INFLATING);
 }
 
-static void deflate_do_close(struct Curl_easy *data,
-                             struct Curl_cwriter *writer)
+static void zlib_do_close(struct Curl_easy *data,
+                          struct Curl_cwriter *writer)
 {
   struct zlib_writer *zp = (struct zlib_writer *) writer;
-  z_stream *z = &zp->z;     /* zlib state structure */
 
-  exit_zlib(data, z, &zp->zlib_init, CURLE_OK);
+  zp->zlib_init = ZLIB_UNINIT;
+  if(zp->dec) {
+    zlib_dec_put(data, zp->dec);
+    zp->dec = NULL;
+  }
 }
 
 static const struct Curl_cwtype deflate_encoding = {
@@ -297,7 +361,7 @@ static const struct Curl_cwtype deflate_encoding = {
   NULL,
   deflate_do_init,
   deflate_do_write,
-  deflate_do_close,
+  zlib_do_close,
   sizeof(struct zlib_writer)
 };
 
@@ -307,15 +371,11 @@ static CURLcode gzip_do_init(struct Curl_easy *data,
                              struct Curl_cwriter *writer)
 {
   struct zlib_writer *zp = (struct zlib_writer *) writer;
-  z_stream *z = &zp->z;     /* zlib state structure */
-
-  /* Initialize zlib */
-  z->zalloc = (alloc_func) zalloc_cb;
-  z->zfree = (free_func) zfree_cb;
-
-  if(inflateInit2(z, MAX_WBITS + 32) != Z_OK)
-    return process_zlib_error(data, z);
+  /* detect a gzip or zlib header */
+  CURLcode result = zlib_dec_get(data, MAX_WBITS + 32, &zp->dec);
 
+  if(result)
+    return result;
   zp->zlib_init = ZLIB_INIT_GZIP; /* Transparent gzip decompress state */
   return CURLE_OK;
 }
@@ -325,7 +385,7 @@ static CURLcode gzip_do_write(struct Curl_easy *data,
                               const char *buf, size_t nbytes)
 {
   struct zlib_writer *zp = (struct zlib_writer *) writer;
-  z_stream *z = &zp->z;     /* zlib state structure */
+  z_stream *z = &zp->dec->z;     /* zlib state structure */
 
   if(!(type & CLIENTWRITE_BODY) || !nbytes)
     return Curl_cwriter_write(data, writer->next, type, buf, nbytes);
@@ -339,16 +399,7 @@ static CURLcode gzip_do_write(struct Curl_easy *data,
   }
 
   /* We are running with an old version: return error. */
-  return exit_zlib(data, z, &zp->zlib_init, CURLE_WRITE_ERROR);
-}
-
-static void gzip_do_close(struct Curl_easy *data,
-                              struct Curl_cwriter *writer)
-{
-  struct zlib_writer *zp = (struct zlib_writer *) writer;
-  z_stream *z = &zp->z;     /* zlib state structure */
-
-  exit_zlib(data, z, &zp->zlib_init, CURLE_OK);
+  return exit_zlib(zp, CURLE_WRITE_ERROR);
 }
 
 static const struct Curl_cwtype gzip_encoding = {
@@ -356,7 +407,7 @@ static const struct Curl_cwtype gzip_encoding = {
   "x-gzip",
   gzip_do_init,
   gzip_do_write,
-  gzip_do_close,
+  zlib_do_close,
   sizeof(struct zlib_writer)
 };
 
@@ -486,11 +537,17 @@ static const struct Curl_cwtype brotli_encoding = {
 #endif
 
 #ifdef HAVE_ZSTD
+/* zstd state with its output buffer, kept in a `cdec_pool` when idle */
+struct cw_zstd_dec {
+  struct cw_zstd_dec *next;  /* next spare in the pool */
+  ZSTD_DStream *zds;         /* State structure for zstd. */
+  char buffer[DECOMPRESS_BUFFER_SIZE];
+};
+
 /* Zstd writer. */
 struct zstd_writer {
   struct Curl_cwriter super;
-  ZSTD_DStream *zds;    /* State structure for zstd. */
-  char buffer[DECOMPRESS_BUFFER_SIZE];
+  struct cw_zstd_dec *dec;   /* zstd state and output buffer */
 };
 
 #ifdef ZSTD_STATIC_LINKING_ONLY
@@ -507,24 +564,75 @@ static void Curl_zstd_free(void *opaque, void *address)
 }
 #endif
 
-static CURLcode zstd_do_init(struct Curl_easy *data,
-                             struct Curl_cwriter *writer)
+static void zstd_dec_free(struct cw_zstd_dec *dec)
 {
-  struct zstd_writer *zp = (struct zstd_writer *) writer;
+  if(dec->zds)
+    ZSTD_freeDStream(dec->zds);
+  free(dec);
+}
 
-  (void)data;
+/* Get a zstd state ready for a new frame, a spare one from the pool if
+   possible. */
+static CURLcode zstd_dec_get(struct Curl_easy *data,
+                             struct cw_zstd_dec **pdec)
+{
+  struct cdec_pool *pool = cdec_pool(data);
+  struct cw_zstd_dec *dec;
+
+  while(pool && pool->zstd) {
+    dec = pool->zstd;
+    pool->zstd = dec->next;
+    pool->zstd_count--;
+    dec->next = NULL;
+    if(!ZSTD_isError(ZSTD_initDStream(dec->zds))) {
+      *pdec = dec;
+      return CURLE_OK;
+    }
+    zstd_dec_free(dec);
+  }
 
+  *pdec = NULL;
+  dec = malloc(sizeof(*dec));
+  if(!dec)
+    return CURLE_OUT_OF_MEMORY;
+  dec->next = NULL;
 #ifdef ZSTD_STATIC_LINKING_ONLY
-  zp->zds = ZSTD_createDStream_advanced((ZSTD_customMem) {
+  dec->zds = ZSTD_createDStream_advanced((ZSTD_customMem) {
     .customAlloc = Curl_zstd_alloc,
     .customFree  = Curl_zstd_free,
     .opaque      = NULL
   });
 #else
-  zp->zds = ZSTD_createDStream();
+  dec->zds = ZSTD_createDStream();
 #endif
+  if(!dec->zds) {
+    free(dec);
+    return CURLE_OUT_OF_MEMORY;
+  }
+  *pdec = dec;
+  return CURLE_OK;
+}
+
+/* Give a zstd state back, to the pool if there is room. */
+static void zstd_dec_put(struct Curl_easy *data, struct cw_zstd_dec *dec)
+{
+  struct cdec_pool *pool = cdec_pool(data);
+
+  if(pool && (pool->zstd_count < CDEC_POOL_SPARES)) {
+    dec->next = pool->zstd;
+    pool->zstd = dec;
+    pool->zstd_count++;
+  }
+  else
+    zstd_dec_free(dec);
+}
+
+static CURLcode zstd_do_init(struct Curl_easy *data,
+                             struct Curl_cwriter *writer)
+{
+  struct zstd_writer *zp = (struct zstd_writer *) writer;
 
-  return zp->zds ? CURLE_OK : CURLE_OUT_OF_MEMORY;
+  return zstd_dec_get(data, &zp->dec);
 }
 
 static CURLcode zstd_do_write(struct Curl_easy *data,
@@ -546,16 +654,16 @@ static CURLcode zstd_do_write(struct Curl_easy *data,
 
   for(;;) {
     out.pos = 0;
-    out.dst = zp->buffer;
+    out.dst = zp->dec->buffer;
     out.size = DECOMPRESS_BUFFER_SIZE;
 
-    errorCode = ZSTD_decompressStream(zp->zds, &out, &in);
+    errorCode = ZSTD_decompressStream(zp->dec->zds, &out, &in);
     if(ZSTD_isError(errorCode)) {
       return CURLE_BAD_CONTENT_ENCODING;
     }
     if(out.pos > 0) {
       result = Curl_cwriter_write(data, writer->next, type,
-                                  zp->buffer, out.pos);
+                                  zp->dec->buffer, out.pos);
       if(result)
         break;
     }
@@ -570,11 +678,10 @@ static void zstd_do_close(struct Curl_easy *data,
                               struct Curl_cwriter *writer)
 {
   struct zstd_writer *zp = (struct zstd_writer *) writer;
-  (void)data;
 
-  if(zp->zds) {
-    ZSTD_freeDStream(zp->zds);
-    zp->zds = NULL;
+  if(zp->dec) {
+    zstd_dec_put(data, zp->dec);
+    zp->dec = NULL;
   }
 }
 
@@ -839,6 +946,32 @@ CURLcode Curl_build_unencoding_stack(struct Curl_easy *data,
   return CURLE_OK;
 }
 
+void Curl_cdec_pool_init(struct cdec_pool *pool)
+{
+  memset(pool, 0, sizeof(*pool));
+}
+
+void Curl_cdec_pool_free(struct cdec_pool *pool)
+{
+#ifdef HAVE_LIBZ
+  while(pool->zlib) {
+    struct cw_zlib_dec *dec = pool->zlib;
+    pool->zlib = dec->next;
+    inflateEnd(&dec->z);
+    free(dec);
+  }
+#endif
+#ifdef HAVE_ZSTD
+  while(pool->zstd) {
+    struct cw_zstd_dec *dec = pool->zstd;
+    pool->zstd = dec->next;
+    zstd_dec_free(dec);
+  }
+#endif
+  pool->zlib_count = 0;
+  pool->zstd_count = 0;
+}
+
 #else
 /* Stubs for builds without HTTP. */
 CURLcode Curl_build_unencoding_stack(struct Curl_easy *data,
@@ -850,6 +983,16 @@ CURLcode Curl_build_unencoding_stack(struct Curl_easy *data,
   return CURLE_NOT_BUILT_IN;
 }
 
+void Curl_cdec_pool_init(struct cdec_pool *pool)
+{
+  memset(pool, 0, sizeof(*pool));
+}
+
+void Curl_cdec_pool_free(struct cdec_pool *pool)
+{
+  (void)pool;
+}
+
 void Curl_all_content_encodings(char *buf, size_t blen)
 {
   DEBUGASSERT(buf);
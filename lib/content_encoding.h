@@ -25,7 +25,23 @@
  ***************************************************************************/
 #include "curl_setup.h"
 
+struct Curl_easy;
 struct Curl_cwriter;
+struct cw_zlib_dec;
+struct cw_zstd_dec;
+
+/* Decoder states that finished transfers leave for the next ones in the
+ * same multi handle. They are reset for reuse instead of being created
+ * anew, which saves their setup and window allocations. */
+struct cdec_pool {
+  struct cw_zlib_dec *zlib;  /* spare zlib states */
+  struct cw_zstd_dec *zstd;  /* spare zstd states */
+  size_t zlib_count;
+  size_t zstd_count;
+};
+
+void Curl_cdec_pool_init(struct cdec_pool *pool);
+void Curl_cdec_pool_free(struct cdec_pool *pool);
 
 void Curl_all_content_encodings(char *buf, size_t blen);
 
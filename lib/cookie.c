@@ -81,7 +81,6 @@ Example set of cookies:
 #include "share.h"
 #include "strcase.h"
 #include "curl_get_line.h"
-#include "curl_memrchr.h"
 #include "parsedate.h"
 #include "rename.h"
 #include "fopen.h"
@@ -95,6 +94,14 @@ Example set of cookies:
 #include "memdebug.h"
 
 static void strstore(char **str, const char *newstr, size_t len);
+static char *get_netscape_format(const struct Cookie *co);
+
+/* the line in the header of the cookie files libcurl writes */
+#define COOKIE_GENERATED \
+  "# This file was generated by libcurl! Edit at your own risk."
+
+/* a journal is compacted when it has grown this much over the jar size */
+#define COOKIE_JOURNAL_SLACK 65536
 
 /* number of seconds in 400 days */
 #define COOKIES_MAXAGE (400*24*3600)
@@ -211,69 +218,221 @@ pathmatched:
   return ret;
 }
 
+/* initial number of slots in the domain index, it grows with the domains */
+#define COOKIE_DOMAIN_SLOTS 63
+
+/* number of getlist results kept, the cache is emptied when it is full */
+#define COOKIE_CACHE_MAX 64
+
 /*
- * Return the top-level domain, for optimal hashing.
+ * The jar indexes its cookies on the lowercase domain. Each domain keeps its
+ * cookies in groups sharing the same path, longest path first, so a request
+ * path is matched once per group and only the domains of the requested host
+ * are looked at.
  */
-static const char *get_top_domain(const char * const domain, size_t *outlen)
+struct cookie_domain {
+  struct Curl_llist paths; /* struct cookie_path */
+  size_t klen;
+  char key[1]; /* the lowercase domain, empty for cookies without one */
+};
+
+struct cookie_path {
+  struct Curl_llist_node node; /* in the paths list of the domain */
+  struct Curl_llist cookies; /* struct Cookie, oldest first */
+  struct cookie_domain *dom;
+  char *spath; /* the sanitized path of all cookies in the group, or NULL */
+};
+
+/* a sorted getlist result */
+struct cookie_hits {
+  size_t n;
+  struct Cookie *list[1];
+};
+
+static void cookie_domain_dtor(void *p)
 {
-  size_t len = 0;
-  const char *first = NULL, *last;
-
-  if(domain) {
-    len = strlen(domain);
-    last = memrchr(domain, '.', len);
-    if(last) {
-      first = memrchr(domain, '.', (last - domain));
-      if(first)
-        len -= (++first - domain);
-    }
+  struct cookie_domain *dom = p;
+  /* a domain is removed when its last cookie is */
+  DEBUGASSERT(!Curl_llist_count(&dom->paths));
+  free(dom);
+}
+
+static void cookie_hits_dtor(void *p)
+{
+  free(p);
+}
+
+/*
+ * Return an allocated lowercase copy of the domain to use as index key.
+ */
+static char *cookie_key(const char *domain, size_t *plen)
+{
+  size_t len = domain ? strlen(domain) : 0;
+  char *key = malloc(len + 1);
+  if(key) {
+    Curl_strntolower(key, domain ? domain : "", len);
+    key[len] = 0;
+    *plen = len;
   }
+  return key;
+}
 
-  if(outlen)
-    *outlen = len;
+static bool samepath(const char *p1, const char *p2)
+{
+  if(p1 && p2)
+    return !strcmp(p1, p2);
+  return !p1 && !p2;
+}
 
-  return first ? first : domain;
+static struct cookie_domain *cookie_domain_get(struct CookieInfo *ci,
+                                               const char *key, size_t klen)
+{
+  struct cookie_domain *dom = Curl_hash_pick(&ci->domains,
+                                             CURL_UNCONST(key), klen);
+  if(!dom) {
+    dom = malloc(sizeof(*dom) + klen);
+    if(!dom)
+      return NULL;
+    Curl_llist_init(&dom->paths, NULL);
+    dom->klen = klen;
+    memcpy(dom->key, key, klen + 1);
+    if(!Curl_hash_add(&ci->domains, CURL_UNCONST(key), klen, dom)) {
+      free(dom);
+      return NULL;
+    }
+    /* keep the chains short, a failure to grow only makes lookups slower */
+    if(Curl_hash_count(&ci->domains) > (ci->domains.slots * 2))
+      (void)Curl_hash_resize(&ci->domains, (ci->domains.slots * 4) + 1);
+  }
+  return dom;
 }
 
-/* Avoid C1001, an "internal error" with MSVC14 */
-#if defined(_MSC_VER) && (_MSC_VER == 1900)
-#pragma optimize("", off)
-#endif
+/*
+ * The size of the line for the cookie in a jar file.
+ */
+static curl_off_t cookie_linelen(const struct Cookie *co)
+{
+  if(!co->domain)
+    /* not saved */
+    return 0;
+  /* the fixed fields are at most 40 bytes, counting the separators */
+  return (curl_off_t)(strlen(co->domain) + strlen(co->name) + 40 +
+                      (co->path ? strlen(co->path) : 1) +
+                      (co->value ? strlen(co->value) : 0));
+}
 
 /*
- * A case-insensitive hash for the cookie domains.
+ * Add the cookie to the jar: last in the main list and in the path group of
+ * its domain. Returns FALSE on out of memory.
  */
-static size_t cookie_hash_domain(const char *domain, const size_t len)
+static bool cookie_link(struct CookieInfo *ci, struct Cookie *co)
 {
-  const char *end = domain + len;
-  size_t h = 5381;
+  struct cookie_domain *dom;
+  struct cookie_path *group = NULL;
+  struct Curl_llist_node *n;
+  size_t plen = co->spath ? strlen(co->spath) : 0;
+  size_t klen;
+  char *key = cookie_key(co->domain, &klen);
 
-  while(domain < end) {
-    size_t j = (size_t)Curl_raw_toupper(*domain++);
-    h += h << 5;
-    h ^= j;
-  }
+  if(!key)
+    return FALSE;
+  dom = cookie_domain_get(ci, key, klen);
+  free(key);
+  if(!dom)
+    return FALSE;
 
-  return (h % COOKIE_HASH_SIZE);
+  /* the groups are sorted on the path length, longest first */
+  for(n = Curl_llist_head(&dom->paths); n; n = Curl_node_next(n)) {
+    struct cookie_path *g = Curl_node_elem(n);
+    size_t glen = g->spath ? strlen(g->spath) : 0;
+    if(glen < plen)
+      break;
+    if((glen == plen) && samepath(g->spath, co->spath)) {
+      group = g;
+      break;
+    }
+  }
+  if(!group) {
+    group = malloc(sizeof(*group) + (co->spath ? plen + 1 : 0));
+    if(!group) {
+      if(!Curl_llist_count(&dom->paths))
+        Curl_hash_delete(&ci->domains, dom->key, dom->klen);
+      return FALSE;
+    }
+    Curl_llist_init(&group->cookies, NULL);
+    group->dom = dom;
+    group->spath = NULL;
+    if(co->spath) {
+      group->spath = (char *)&group[1];
+      memcpy(group->spath, co->spath, plen + 1);
+    }
+    if(n)
+      Curl_llist_insert_next(&dom->paths, Curl_node_prev(n), group,
+                             &group->node);
+    else
+      Curl_llist_append(&dom->paths, group, &group->node);
+  }
+  Curl_llist_append(&group->cookies, co, &co->pnode);
+  co->group = group;
+  Curl_llist_append(&ci->cookielist, co, &co->node);
+  ci->jarsize += cookie_linelen(co);
+  ci->generation++;
+  return TRUE;
 }
 
-#if defined(_MSC_VER) && (_MSC_VER == 1900)
-#pragma optimize("", on)
-#endif
-
 /*
- * Hash this domain.
+ * Take the cookie out of the jar, without freeing it.
  */
-static size_t cookiehash(const char * const domain)
+static void cookie_unlink(struct CookieInfo *ci, struct Cookie *co)
 {
-  const char *top;
-  size_t len;
+  struct cookie_path *group = co->group;
+
+  Curl_node_remove(&co->node);
+  Curl_node_remove(&co->pnode);
+  co->group = NULL;
+  if(!Curl_llist_count(&group->cookies)) {
+    struct cookie_domain *dom = group->dom;
+    Curl_node_remove(&group->node);
+    free(group);
+    if(!Curl_llist_count(&dom->paths))
+      Curl_hash_delete(&ci->domains, dom->key, dom->klen);
+  }
+  ci->jarsize -= cookie_linelen(co);
+  ci->generation++;
+}
 
-  if(!domain || Curl_host_is_ipnum(domain))
-    return 0;
+/*
+ * Return the cookie in the jar with the same name, domain and path as the
+ * given one, if any.
+ */
+static struct Cookie *cookie_find(struct CookieInfo *ci,
+                                  const struct Cookie *co)
+{
+  struct cookie_domain *dom;
+  struct Curl_llist_node *n;
+  size_t klen;
+  char *key = cookie_key(co->domain, &klen);
 
-  top = get_top_domain(domain, &len);
-  return cookie_hash_domain(top, len);
+  if(!key)
+    return NULL;
+  dom = Curl_hash_pick(&ci->domains, key, klen);
+  free(key);
+  if(!dom)
+    return NULL;
+  for(n = Curl_llist_head(&dom->paths); n; n = Curl_node_next(n)) {
+    struct cookie_path *group = Curl_node_elem(n);
+    if(samepath(group->spath, co->spath)) {
+      for(n = Curl_llist_head(&group->cookies); n; n = Curl_node_next(n)) {
+        struct Cookie *c = Curl_node_elem(n);
+        /* the domains are in the same index entry */
+        if(!strcmp(c->name, co->name) && (c->tailmatch == co->tailmatch) &&
+           (!c->domain == !co->domain))
+          return c;
+      }
+      break;
+    }
+  }
+  return NULL;
 }
 
 /*
@@ -313,7 +472,11 @@ void Curl_cookie_loadfiles(struct Curl_easy *data)
 {
   struct curl_slist *list = data->state.cookielist;
   if(list) {
+    const char *jar = data->set.str[STRING_COOKIEJAR];
     Curl_share_lock(data, CURL_LOCK_DATA_COOKIE, CURL_LOCK_ACCESS_SINGLE);
+    if(data->cookies && data->cookies->journal)
+      /* the journal may be read */
+      fflush(data->cookies->journal);
     while(list) {
       struct CookieInfo *ci =
         Curl_cookie_init(data, list->data, data->cookies,
@@ -324,8 +487,14 @@ void Curl_cookie_loadfiles(struct Curl_easy *data)
          * but only the first should be
          */
         infof(data, "ignoring failed cookie_init for %s", list->data);
-      else
+      else {
         data->cookies = ci;
+        if(!jar || strcmp(jar, list->data))
+          /* a journal would lack the cookies from this file */
+          ci->compact = TRUE;
+        else
+          ci->jar_loaded = TRUE;
+      }
       list = list->next;
     }
     Curl_share_unlock(data, CURL_LOCK_DATA_COOKIE);
@@ -363,9 +532,9 @@ static void strstore(char **str, const char *newstr, size_t len)
  */
 static void remove_expired(struct CookieInfo *ci)
 {
-  struct Cookie *co;
   curl_off_t now = (curl_off_t)time(NULL);
-  unsigned int i;
+  struct Curl_llist_node *n;
+  struct Curl_llist_node *e = NULL;
 
   /*
    * If the earliest expiration timestamp in the jar is in the future we can
@@ -381,26 +550,21 @@ static void remove_expired(struct CookieInfo *ci)
   else
     ci->next_expiration = CURL_OFF_T_MAX;
 
-  for(i = 0; i < COOKIE_HASH_SIZE; i++) {
-    struct Curl_llist_node *n;
-    struct Curl_llist_node *e = NULL;
-
-    for(n = Curl_llist_head(&ci->cookielist[i]); n; n = e) {
-      co = Curl_node_elem(n);
-      e = Curl_node_next(n);
-      if(co->expires && co->expires < now) {
-        Curl_node_remove(n);
-        freecookie(co);
-        ci->numcookies--;
-      }
-      else {
-        /*
-         * If this cookie has an expiration timestamp earlier than what we
-         * have seen so far then record it for the next round of expirations.
-         */
-        if(co->expires && co->expires < ci->next_expiration)
-          ci->next_expiration = co->expires;
-      }
+  for(n = Curl_llist_head(&ci->cookielist); n; n = e) {
+    struct Cookie *co = Curl_node_elem(n);
+    e = Curl_node_next(n);
+    if(co->expires && co->expires < now) {
+      cookie_unlink(ci, co);
+      freecookie(co);
+      ci->numcookies--;
+    }
+    else {
+      /*
+       * If this cookie has an expiration timestamp earlier than what we have
+       * seen so far then record it for the next round of expirations.
+       */
+      if(co->expires && co->expires < ci->next_expiration)
+        ci->next_expiration = co->expires;
     }
   }
 }
@@ -944,94 +1108,105 @@ replace_existing(struct Curl_easy *data,
                  bool *replacep)
 {
   bool replace_old = FALSE;
-  struct Curl_llist_node *replace_n = NULL;
+  struct Cookie *repl = NULL;
+  struct cookie_domain *dom;
+  struct Curl_llist_node *g;
   struct Curl_llist_node *n;
-  size_t myhash = cookiehash(co->domain);
-  for(n = Curl_llist_head(&ci->cookielist[myhash]); n; n = Curl_node_next(n)) {
-    struct Cookie *clist = Curl_node_elem(n);
-    if(!strcmp(clist->name, co->name)) {
-      /* the names are identical */
-      bool matching_domains = FALSE;
-
-      if(clist->domain && co->domain) {
-        if(strcasecompare(clist->domain, co->domain))
-          /* The domains are identical */
+  size_t klen;
+  char *key = cookie_key(co->domain, &klen);
+
+  if(!key)
+    return CERR_OUT_OF_MEMORY;
+  /* only cookies of the same domain can be replaced or overlaid */
+  dom = Curl_hash_pick(&ci->domains, key, klen);
+  free(key);
+  for(g = dom ? Curl_llist_head(&dom->paths) : NULL; g;
+      g = Curl_node_next(g)) {
+    struct cookie_path *group = Curl_node_elem(g);
+    for(n = Curl_llist_head(&group->cookies); n; n = Curl_node_next(n)) {
+      struct Cookie *clist = Curl_node_elem(n);
+      if(!strcmp(clist->name, co->name)) {
+        /* the names are identical */
+        bool matching_domains = FALSE;
+
+        if(clist->domain && co->domain) {
+          if(strcasecompare(clist->domain, co->domain))
+            /* The domains are identical */
+            matching_domains = TRUE;
+        }
+        else if(!clist->domain && !co->domain)
           matching_domains = TRUE;
-      }
-      else if(!clist->domain && !co->domain)
-        matching_domains = TRUE;
 
-      if(matching_domains && /* the domains were identical */
-         clist->spath && co->spath && /* both have paths */
-         clist->secure && !co->secure && !secure) {
-        size_t cllen;
-        const char *sep;
+        if(matching_domains && /* the domains were identical */
+           clist->spath && co->spath && /* both have paths */
+           clist->secure && !co->secure && !secure) {
+          size_t cllen;
+          const char *sep;
 
-        /*
-         * A non-secure cookie may not overlay an existing secure cookie.
-         * For an existing cookie "a" with path "/login", refuse a new
-         * cookie "a" with for example path "/login/en", while the path
-         * "/loginhelper" is ok.
-         */
+          /*
+           * A non-secure cookie may not overlay an existing secure cookie.
+           * For an existing cookie "a" with path "/login", refuse a new
+           * cookie "a" with for example path "/login/en", while the path
+           * "/loginhelper" is ok.
+           */
 
-        sep = strchr(clist->spath + 1, '/');
+          sep = strchr(clist->spath + 1, '/');
 
-        if(sep)
-          cllen = sep - clist->spath;
-        else
-          cllen = strlen(clist->spath);
+          if(sep)
+            cllen = sep - clist->spath;
+          else
+            cllen = strlen(clist->spath);
 
-        if(strncasecompare(clist->spath, co->spath, cllen)) {
-          infof(data, "cookie '%s' for domain '%s' dropped, would "
-                "overlay an existing cookie", co->name, co->domain);
-          return CERR_BAD_SECURE;
+          if(strncasecompare(clist->spath, co->spath, cllen)) {
+            infof(data, "cookie '%s' for domain '%s' dropped, would "
+                  "overlay an existing cookie", co->name, co->domain);
+            return CERR_BAD_SECURE;
+          }
         }
       }
-    }
 
-    if(!replace_n && !strcmp(clist->name, co->name)) {
-      /* the names are identical */
+      if(!repl && !strcmp(clist->name, co->name)) {
+        /* the names are identical */
 
-      if(clist->domain && co->domain) {
-        if(strcasecompare(clist->domain, co->domain) &&
-          (clist->tailmatch == co->tailmatch))
-          /* The domains are identical */
+        if(clist->domain && co->domain) {
+          if(strcasecompare(clist->domain, co->domain) &&
+            (clist->tailmatch == co->tailmatch))
+            /* The domains are identical */
+            replace_old = TRUE;
+        }
+        else if(!clist->domain && !co->domain)
           replace_old = TRUE;
-      }
-      else if(!clist->domain && !co->domain)
-        replace_old = TRUE;
 
-      if(replace_old) {
-        /* the domains were identical */
+        if(replace_old) {
+          /* the domains were identical */
 
-        if(clist->spath && co->spath &&
-           !strcasecompare(clist->spath, co->spath))
-          replace_old = FALSE;
-        else if(!clist->spath != !co->spath)
-          replace_old = FALSE;
-      }
+          if(clist->spath && co->spath &&
+             !strcasecompare(clist->spath, co->spath))
+            replace_old = FALSE;
+          else if(!clist->spath != !co->spath)
+            replace_old = FALSE;
+        }
 
-      if(replace_old && !co->livecookie && clist->livecookie) {
-        /*
-         * Both cookies matched fine, except that the already present cookie
-         * is "live", which means it was set from a header, while the new one
-         * was read from a file and thus is not "live". "live" cookies are
-         * preferred so the new cookie is freed.
-         */
-        return CERR_LIVE_WINS;
+        if(replace_old && !co->livecookie && clist->livecookie) {
+          /*
+           * Both cookies matched fine, except that the already present
+           * cookie is "live", which means it was set from a header, while
+           * the new one was read from a file and thus is not "live". "live"
+           * cookies are preferred so the new cookie is freed.
+           */
+          return CERR_LIVE_WINS;
+        }
+        if(replace_old)
+          repl = clist;
       }
-      if(replace_old)
-        replace_n = n;
     }
   }
-  if(replace_n) {
-    struct Cookie *repl = Curl_node_elem(replace_n);
-
+  if(repl) {
     /* when replacing, creationtime is kept from old */
     co->creationtime = repl->creationtime;
 
     /* unlink the old */
-    Curl_node_remove(replace_n);
+    cookie_unlink(ci, repl);
 
     /* free the old cookie */
     freecookie(repl);
@@ -1040,6 +1215,154 @@ replace_existing(struct Curl_easy *data,
   return CERR_OK;
 }
 
+/*
+ * cookie_journal()
+ *
+ * Append the cookie to the jar file when it is kept as a journal. The file
+ * is in the Netscape format: a later line for the same cookie replaces an
+ * earlier one when the file is loaded, and an expired line removes it.
+ */
+static void cookie_journal(struct Curl_easy *data, struct CookieInfo *ci,
+                           const struct Cookie *co)
+{
+  const char *jar = data->set.str[STRING_COOKIEJAR];
+  char *line;
+
+  if(!data->set.cookie_journal || !jar || !strcmp(jar, "-") ||
+     ci->compact || !co->domain)
+    /* no journal, or the jar is written in full anyway */
+    return;
+  if(!ci->jar_loaded) {
+    /* appending to a jar we never read would keep its stale cookies */
+    ci->compact = TRUE;
+    return;
+  }
+  if(ci->journal_name && strcmp(ci->journal_name, jar))
+    /* the journal of another jar */
+    return;
+
+  if(!ci->journal) {
+    struct_stat st;
+    FILE *fp = fopen(jar, FOPEN_APPENDTEXT);
+    if(!fp) {
+      infof(data, "WARNING: failed to open cookie journal \"%s\"", jar);
+      ci->compact = TRUE;
+      return;
+    }
+    if(!ci->journal_name) {
+      ci->journal_name = strdup(jar);
+      if(!ci->journal_name) {
+        fclose(fp);
+        ci->compact = TRUE;
+        return;
+      }
+    }
+    ci->journal = fp;
+    ci->journal_size = fstat(fileno(fp), &st) ? 0 : (curl_off_t)st.st_size;
+    if(!ci->journal_size) {
+      static const char head[] = "# Netscape HTTP Cookie File\n"
+        "# https://curl.se/docs/http-cookies.html\n"
+        COOKIE_GENERATED "\n\n";
+      fputs(head, fp);
+      ci->journal_size = sizeof(head) - 1;
+    }
+  }
+
+  /* buffered, the journal is flushed before the jar is read and when the
+     cookies are flushed */
+  line = get_netscape_format(co);
+  if(!line || (fprintf(ci->journal, "%s\n", line) < 0)) {
+    /* the journal misses this change */
+    ci->compact = TRUE;
+    free(line);
+    return;
+  }
+  ci->journal_size += (curl_off_t)strlen(line) + 1;
+  free(line);
+}
+
+static void cookie_journal_close(struct CookieInfo *ci)
+{
+  if(ci->journal) {
+    fclose(ci->journal);
+    ci->journal = NULL;
+  }
+}
+
+/*
+ * Returns TRUE when the journal has the changes of the jar and it does not
+ * need to be written in full.
+ */
+static bool cookie_journal_sync(struct Curl_easy *data,
+                                struct CookieInfo *ci, const char *jar)
+{
+  if(!ci || !data->set.cookie_journal || !strcmp(jar, "-") || ci->compact)
+    return FALSE;
+  if(ci->journal_name && strcmp(ci->journal_name, jar))
+    return FALSE;
+  if(ci->journal) {
+    if(fflush(ci->journal))
+      return FALSE;
+    /* compact it when the replaced and removed cookies make most of it */
+    if(ci->journal_size > (ci->jarsize * 2) + COOKIE_JOURNAL_SLACK)
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/*
+ * cookie_load()
+ *
+ * Add a cookie line read from a jar file libcurl has written. Anyone can
+ * write such a file, so the cookie name prefixes and the public suffix are
+ * checked like Curl_cookie_add() does, but the older cookies are not scanned.
+ * It replaces the cookie with the same name, domain and path, unless that was
+ * set by a server, and an expired line only removes it.
+ */
+static void cookie_load(struct Curl_easy *data, struct CookieInfo *ci,
+                        const char *lineptr, curl_off_t now)
+{
+  struct Cookie *old;
+  struct Cookie *co = calloc(1, sizeof(struct Cookie));
+  if(!co)
+    return;
+
+  if(parse_netscape(co, ci, lineptr, TRUE) ||
+     (ci->newsession && !co->expires))
+    goto fail;
+
+  if(co->prefix_secure && !co->secure)
+    goto fail;
+  if(co->prefix_host &&
+     !(co->secure && co->path && !strcmp(co->path, "/") && !co->tailmatch))
+    goto fail;
+  if(is_public_suffix(data, co, NULL))
+    goto fail;
+
+  co->creationtime = ++ci->lastct;
+  old = cookie_find(ci, co);
+  if(old) {
+    if(old->livecookie)
+      goto fail;
+    /* when replacing, creationtime is kept from old */
+    co->creationtime = old->creationtime;
+    cookie_unlink(ci, old);
+    freecookie(old);
+    ci->numcookies--;
+  }
+  if(co->expires && (co->expires < now))
+    /* a removed cookie */
+    goto fail;
+  if(!cookie_link(ci, co))
+    goto fail;
+  ci->numcookies++;
+  if(co->expires && (co->expires < ci->next_expiration))
+    ci->next_expiration = co->expires;
+  return;
+fail:
+  freecookie(co);
+}
+
 /*
  * Curl_cookie_add
  *
@@ -1063,7 +1386,6 @@ Curl_cookie_add(struct Curl_easy *data,
                 bool secure)  /* TRUE if connection is over secure origin */
 {
   struct Cookie *co;
-  size_t myhash;
   int rc;
   bool replaces = FALSE;
 
@@ -1124,9 +1446,13 @@ Curl_cookie_add(struct Curl_easy *data,
   if(replace_existing(data, co, ci, secure, &replaces))
     goto fail;
 
-  /* add this cookie to the list */
-  myhash = cookiehash(co->domain);
-  Curl_llist_append(&ci->cookielist[myhash], co, &co->node);
+  /* add this cookie to the jar */
+  if(!cookie_link(ci, co)) {
+    if(replaces)
+      /* the replaced cookie is already gone */
+      ci->numcookies--;
+    goto fail;
+  }
 
   if(ci->running)
     /* Only show this when NOT reading the cookies from a file */
@@ -1138,6 +1464,9 @@ Curl_cookie_add(struct Curl_easy *data,
   if(!replaces)
     ci->numcookies++; /* one more cookie in the jar */
 
+  if(ci->running)
+    cookie_journal(data, ci, co);
+
   /*
    * Now that we have added a new cookie to the jar, update the expiration
    * tracker in case it is the next one to expire.
@@ -1174,8 +1503,6 @@ struct CookieInfo *Curl_cookie_init(struct Curl_easy *data,
   FILE *handle = NULL;
 
   if(!ci) {
-    int i;
-
     /* we did not get a struct, create one */
     ci = calloc(1, sizeof(struct CookieInfo));
     if(!ci)
@@ -1183,8 +1510,11 @@ struct CookieInfo *Curl_cookie_init(struct Curl_easy *data,
 
     /* This does not use the destructor callback since we want to add
        and remove to lists while keeping the cookie struct intact */
-    for(i = 0; i < COOKIE_HASH_SIZE; i++)
-      Curl_llist_init(&ci->cookielist[i], NULL);
+    Curl_llist_init(&ci->cookielist, NULL);
+    Curl_hash_init(&ci->domains, COOKIE_DOMAIN_SLOTS, Curl_hash_str,
+                   curlx_str_key_compare, cookie_domain_dtor);
+    Curl_hash_init(&ci->getcache, COOKIE_CACHE_MAX, Curl_hash_str,
+                   curlx_str_key_compare, cookie_hits_dtor);
     /*
      * Initialize the next_expiration time to signal that we do not have enough
      * information yet.
@@ -1210,10 +1540,24 @@ struct CookieInfo *Curl_cookie_init(struct Curl_easy *data,
     ci->running = FALSE; /* this is not running, this is init */
     if(fp) {
       struct dynbuf buf;
+      curl_off_t now = (curl_off_t)time(NULL);
+      bool cookies = FALSE;
+      bool trusted = FALSE;
       curlx_dyn_init(&buf, MAX_COOKIE_LINE);
       while(Curl_get_line(&buf, fp)) {
         const char *lineptr = curlx_dyn_ptr(&buf);
         bool headerline = FALSE;
+        if(!cookies) {
+          /* files libcurl has written are not scanned for older cookies */
+          if(!strncmp(lineptr, COOKIE_GENERATED, strlen(COOKIE_GENERATED)))
+            trusted = TRUE;
+          cookies = ((lineptr[0] != '#') || checkprefix("#HttpOnly_", lineptr))
+            && (lineptr[0] != '\n');
+        }
+        if(trusted && cookies) {
+          cookie_load(data, ci, lineptr, now);
+          continue;
+        }
         if(checkprefix("Set-Cookie:", lineptr)) {
           /* This is a cookie line, get it! */
           lineptr += 11;
@@ -1293,6 +1637,114 @@ static int cookie_sort_ct(const void *p1, const void *p2)
   return (c2->creationtime > c1->creationtime) ? 1 : -1;
 }
 
+/*
+ * Append the cookies of the domain that match the request to the list.
+ */
+static void cookie_domain_matches(struct cookie_domain *dom,
+                                  const char *host, bool is_ip,
+                                  const char *path, bool secure,
+                                  struct Curl_llist *list)
+{
+  struct Curl_llist_node *g;
+  struct Curl_llist_node *n;
+
+  for(g = Curl_llist_head(&dom->paths); g; g = Curl_node_next(g)) {
+    struct cookie_path *group = Curl_node_elem(g);
+
+    /* check the left part of the path with the cookies path requirement */
+    if(group->spath && !pathmatch(group->spath, path))
+      continue;
+
+    for(n = Curl_llist_head(&group->cookies); n; n = Curl_node_next(n)) {
+      struct Cookie *co = Curl_node_elem(n);
+
+      /* if the cookie requires we are secure we must only continue if we
+         are! */
+      if(co->secure && !secure)
+        continue;
+
+      /* now check if the domain is correct */
+      if(!co->domain ||
+         (co->tailmatch && !is_ip &&
+          cookie_tailmatch(co->domain, strlen(co->domain), host)) ||
+         ((!co->tailmatch || is_ip) && strcasecompare(host, co->domain)))
+        Curl_llist_append(list, co, &co->getnode);
+    }
+  }
+}
+
+/*
+ * Collect the cookies to send for the request, sorted. 'lhost' is the
+ * lowercase host of 'hlen' bytes. Returns NULL on out of memory.
+ */
+static struct cookie_hits *cookie_matches(struct Curl_easy *data,
+                                          struct CookieInfo *ci,
+                                          const char *host,
+                                          const char *lhost, size_t hlen,
+                                          const char *path, bool secure)
+{
+  struct cookie_hits *hits;
+  struct cookie_domain *dom;
+  struct Curl_llist list;
+  struct Curl_llist_node *n;
+  bool is_ip = Curl_host_is_ipnum(host);
+  size_t matches;
+  size_t i;
+
+  Curl_llist_init(&list, NULL);
+
+  /* the host itself, then its parent domains and last cookies without a
+     domain, only the domains of the host are looked at */
+  dom = Curl_hash_pick(&ci->domains, CURL_UNCONST(lhost), hlen);
+  if(dom)
+    cookie_domain_matches(dom, host, is_ip, path, secure, &list);
+  if(!is_ip) {
+    for(i = 0; i + 1 < hlen; i++) {
+      if(lhost[i] == '.') {
+        dom = Curl_hash_pick(&ci->domains, CURL_UNCONST(&lhost[i + 1]),
+                             hlen - i - 1);
+        if(dom)
+          cookie_domain_matches(dom, host, is_ip, path, secure, &list);
+      }
+    }
+  }
+  if(hlen) {
+    dom = Curl_hash_pick(&ci->domains, CURL_UNCONST(""), 0);
+    if(dom)
+      cookie_domain_matches(dom, host, is_ip, path, secure, &list);
+  }
+
+  matches = Curl_llist_count(&list);
+  hits = malloc(sizeof(*hits) + (matches * sizeof(struct Cookie *)));
+  if(!hits) {
+    Curl_llist_destroy(&list, NULL);
+    return NULL;
+  }
+  for(i = 0, n = Curl_llist_head(&list); n; n = Curl_node_next(n))
+    hits->list[i++] = Curl_node_elem(n);
+  Curl_llist_destroy(&list, NULL);
+
+  if(matches > MAX_COOKIE_SEND_AMOUNT) {
+    /* the oldest cookies are the ones sent, newest are first after this */
+    qsort(hits->list, matches, sizeof(struct Cookie *), cookie_sort_ct);
+    memmove(hits->list, &hits->list[matches - MAX_COOKIE_SEND_AMOUNT],
+            MAX_COOKIE_SEND_AMOUNT * sizeof(struct Cookie *));
+    matches = MAX_COOKIE_SEND_AMOUNT;
+    infof(data, "Included max number of cookies (%zu) in request!",
+          matches);
+  }
+
+  /*
+   * Now we need to make sure that if there is a name appearing more than
+   * once, the longest specified path version comes first. To make this the
+   * swiftest way, we just sort them all based on path length.
+   */
+  if(matches > 1)
+    qsort(hits->list, matches, sizeof(struct Cookie *), cookie_sort);
+  hits->n = matches;
+  return hits;
+}
+
 /*
  * Curl_cookie_getlist
  *
@@ -1302,6 +1754,9 @@ static int cookie_sort_ct(const void *p1, const void *p2)
  *
  * It shall only return cookies that have not expired.
  *
+ * The sorted result is kept per host, path and secure until the jar changes,
+ * so repeated requests only cost a lookup.
+ *
  * Returns 0 when there is a list returned. Otherwise non-zero.
  */
 int Curl_cookie_getlist(struct Curl_easy *data,
@@ -1310,97 +1765,58 @@ int Curl_cookie_getlist(struct Curl_easy *data,
                         bool secure,
                         struct Curl_llist *list)
 {
-  size_t matches = 0;
-  bool is_ip;
-  const size_t myhash = cookiehash(host);
-  struct Curl_llist_node *n;
+  struct cookie_hits *hits;
+  struct dynbuf key;
+  size_t hlen = strlen(host);
+  size_t i;
 
   Curl_llist_init(list, NULL);
 
-  if(!ci || !Curl_llist_count(&ci->cookielist[myhash]))
+  if(!ci || !ci->numcookies)
     return 1; /* no cookie struct or no cookies in the struct */
 
   /* at first, remove expired cookies */
   remove_expired(ci);
 
-  /* check if host is an IP(v4|v6) address */
-  is_ip = Curl_host_is_ipnum(host);
-
-  for(n = Curl_llist_head(&ci->cookielist[myhash]);
-      n; n = Curl_node_next(n)) {
-    struct Cookie *co = Curl_node_elem(n);
-
-    /* if the cookie requires we are secure we must only continue if we are! */
-    if(co->secure ? secure : TRUE) {
-
-      /* now check if the domain is correct */
-      if(!co->domain ||
-         (co->tailmatch && !is_ip &&
-          cookie_tailmatch(co->domain, strlen(co->domain), host)) ||
-         ((!co->tailmatch || is_ip) && strcasecompare(host, co->domain)) ) {
-        /*
-         * the right part of the host matches the domain stuff in the
-         * cookie data
-         */
-
-        /*
-         * now check the left part of the path with the cookies path
-         * requirement
-         */
-        if(!co->spath || pathmatch(co->spath, path) ) {
+  if(ci->cache_generation != ci->generation) {
+    /* the jar changed since the results were stored */
+    Curl_hash_clean(&ci->getcache);
+    ci->cache_generation = ci->generation;
+  }
 
-          /*
-           * This is a match and we add it to the return-linked-list
-           */
-          Curl_llist_append(list, co, &co->getnode);
-          matches++;
-          if(matches >= MAX_COOKIE_SEND_AMOUNT) {
-            infof(data, "Included max number of cookies (%zu) in request!",
-                  matches);
-            break;
-          }
-        }
-      }
+  curlx_dyn_init(&key, CURL_MAX_INPUT_LENGTH);
+  /* secure flag, host, a zero byte and the path */
+  if(curlx_dyn_addn(&key, secure ? "S" : "-", 1) ||
+     curlx_dyn_addn(&key, host, hlen + 1) ||
+     curlx_dyn_add(&key, path))
+    return 2; /* error */
+  /* the host part of the key is lowercase */
+  Curl_strntolower(curlx_dyn_ptr(&key) + 1, host, hlen);
+
+  hits = Curl_hash_pick(&ci->getcache, curlx_dyn_ptr(&key),
+                        curlx_dyn_len(&key));
+  if(!hits) {
+    hits = cookie_matches(data, ci, host, curlx_dyn_ptr(&key) + 1, hlen,
+                          path, secure);
+    if(!hits) {
+      curlx_dyn_free(&key);
+      return 2; /* error */
+    }
+    if(Curl_hash_count(&ci->getcache) >= COOKIE_CACHE_MAX)
+      Curl_hash_clean(&ci->getcache);
+    if(!Curl_hash_add(&ci->getcache, curlx_dyn_ptr(&key),
+                      curlx_dyn_len(&key), hits)) {
+      curlx_dyn_free(&key);
+      free(hits);
+      return 2; /* error */
     }
   }
+  curlx_dyn_free(&key);
 
-  if(matches) {
-    /*
-     * Now we need to make sure that if there is a name appearing more than
-     * once, the longest specified path version comes first. To make this
-     * the swiftest way, we just sort them all based on path length.
-     */
-    struct Cookie **array;
-    size_t i;
-
-    /* alloc an array and store all cookie pointers */
-    array = malloc(sizeof(struct Cookie *) * matches);
-    if(!array)
-      goto fail;
-
-    n = Curl_llist_head(list);
-
-    for(i = 0; n; n = Curl_node_next(n))
-      array[i++] = Curl_node_elem(n);
-
-    /* now sort the cookie pointers in path length order */
-    qsort(array, matches, sizeof(struct Cookie *), cookie_sort);
-
-    /* remake the linked list order according to the new order */
-    Curl_llist_destroy(list, NULL);
-
-    for(i = 0; i < matches; i++)
-      Curl_llist_append(list, array[i], &array[i]->getnode);
-
-    free(array); /* remove the temporary data again */
-  }
+  for(i = 0; i < hits->n; i++)
+    Curl_llist_append(list, hits->list[i], &hits->list[i]->getnode);
 
   return 0; /* success */
-
-fail:
-  /* failure, clear up the allocated chain and return NULL */
-  Curl_llist_destroy(list, NULL);
-  return 2; /* error */
 }
 
 /*
@@ -1411,18 +1827,15 @@ fail:
 void Curl_cookie_clearall(struct CookieInfo *ci)
 {
   if(ci) {
-    unsigned int i;
-    for(i = 0; i < COOKIE_HASH_SIZE; i++) {
-      struct Curl_llist_node *n;
-      for(n = Curl_llist_head(&ci->cookielist[i]); n;) {
-        struct Cookie *c = Curl_node_elem(n);
-        struct Curl_llist_node *e = Curl_node_next(n);
-        Curl_node_remove(n);
-        freecookie(c);
-        n = e;
-      }
+    struct Curl_llist_node *n;
+    while((n = Curl_llist_head(&ci->cookielist))) {
+      struct Cookie *c = Curl_node_elem(n);
+      cookie_unlink(ci, c);
+      freecookie(c);
     }
     ci->numcookies = 0;
+    /* the journal does not record this */
+    ci->compact = TRUE;
   }
 }
 
@@ -1433,25 +1846,23 @@ void Curl_cookie_clearall(struct CookieInfo *ci)
  */
 void Curl_cookie_clearsess(struct CookieInfo *ci)
 {
-  unsigned int i;
+  struct Curl_llist_node *n;
+  struct Curl_llist_node *e = NULL;
 
   if(!ci)
     return;
 
-  for(i = 0; i < COOKIE_HASH_SIZE; i++) {
-    struct Curl_llist_node *n = Curl_llist_head(&ci->cookielist[i]);
-    struct Curl_llist_node *e = NULL;
-
-    for(; n; n = e) {
-      struct Cookie *curr = Curl_node_elem(n);
-      e = Curl_node_next(n); /* in case the node is removed, get it early */
-      if(!curr->expires) {
-        Curl_node_remove(n);
-        freecookie(curr);
-        ci->numcookies--;
-      }
+  for(n = Curl_llist_head(&ci->cookielist); n; n = e) {
+    struct Cookie *curr = Curl_node_elem(n);
+    e = Curl_node_next(n); /* in case the node is removed, get it early */
+    if(!curr->expires) {
+      cookie_unlink(ci, curr);
+      freecookie(curr);
+      ci->numcookies--;
     }
   }
+  /* the journal does not record this */
+  ci->compact = TRUE;
 }
 
 /*
@@ -1463,6 +1874,10 @@ void Curl_cookie_cleanup(struct CookieInfo *ci)
 {
   if(ci) {
     Curl_cookie_clearall(ci);
+    cookie_journal_close(ci);
+    free(ci->journal_name);
+    Curl_hash_destroy(&ci->getcache);
+    Curl_hash_destroy(&ci->domains);
     free(ci); /* free the base struct as well */
   }
 }
@@ -1524,6 +1939,9 @@ static CURLcode cookie_output(struct Curl_easy *data,
   /* at first, remove expired cookies */
   remove_expired(ci);
 
+  /* the file is replaced, a new journal is started in it */
+  cookie_journal_close(ci);
+
   if(!strcmp("-", filename)) {
     /* use stdout */
     out = stdout;
@@ -1537,11 +1955,11 @@ static CURLcode cookie_output(struct Curl_easy *data,
 
   fputs("# Netscape HTTP Cookie File\n"
         "# https://curl.se/docs/http-cookies.html\n"
-        "# This file was generated by libcurl! Edit at your own risk.\n\n",
+        COOKIE_GENERATED "\n\n",
         out);
 
   if(ci->numcookies) {
-    unsigned int i;
+    size_t i;
     size_t nvalid = 0;
     struct Cookie **array;
     struct Curl_llist_node *n;
@@ -1553,14 +1971,11 @@ static CURLcode cookie_output(struct Curl_easy *data,
     }
 
     /* only sort the cookies with a domain property */
-    for(i = 0; i < COOKIE_HASH_SIZE; i++) {
-      for(n = Curl_llist_head(&ci->cookielist[i]); n;
-          n = Curl_node_next(n)) {
-        struct Cookie *co = Curl_node_elem(n);
-        if(!co->domain)
-          continue;
-        array[nvalid++] = co;
-      }
+    for(n = Curl_llist_head(&ci->cookielist); n; n = Curl_node_next(n)) {
+      struct Cookie *co = Curl_node_elem(n);
+      if(!co->domain)
+        continue;
+      array[nvalid++] = co;
     }
 
     qsort(array, nvalid, sizeof(struct Cookie *), cookie_sort_ct);
@@ -1594,6 +2009,10 @@ static CURLcode cookie_output(struct Curl_easy *data,
    * no need to inspect the error, any error case should have jumped into the
    * error block below.
    */
+  if(!use_stdout) {
+    ci->compact = FALSE;
+    ci->jar_loaded = TRUE;
+  }
   free(tempstore);
   return CURLE_OK;
 
@@ -1608,32 +2027,29 @@ static struct curl_slist *cookie_list(struct Curl_easy *data)
 {
   struct curl_slist *list = NULL;
   struct curl_slist *beg;
-  unsigned int i;
   struct Curl_llist_node *n;
 
   if(!data->cookies || (data->cookies->numcookies == 0))
     return NULL;
 
-  for(i = 0; i < COOKIE_HASH_SIZE; i++) {
-    for(n = Curl_llist_head(&data->cookies->cookielist[i]); n;
-        n = Curl_node_next(n)) {
-      struct Cookie *c = Curl_node_elem(n);
-      char *line;
-      if(!c->domain)
-        continue;
-      line = get_netscape_format(c);
-      if(!line) {
-        curl_slist_free_all(list);
-        return NULL;
-      }
-      beg = Curl_slist_append_nodup(list, line);
-      if(!beg) {
-        free(line);
-        curl_slist_free_all(list);
-        return NULL;
-      }
-      list = beg;
+  for(n = Curl_llist_head(&data->cookies->cookielist); n;
+      n = Curl_node_next(n)) {
+    struct Cookie *c = Curl_node_elem(n);
+    char *line;
+    if(!c->domain)
+      continue;
+    line = get_netscape_format(c);
+    if(!line) {
+      curl_slist_free_all(list);
+      return NULL;
+    }
+    beg = Curl_slist_append_nodup(list, line);
+    if(!beg) {
+      free(line);
+      curl_slist_free_all(list);
+      return NULL;
     }
+    list = beg;
   }
 
   return list;
@@ -1655,11 +2071,16 @@ void Curl_flush_cookies(struct Curl_easy *data, bool cleanup)
   if(data->set.str[STRING_COOKIEJAR]) {
     Curl_share_lock(data, CURL_LOCK_DATA_COOKIE, CURL_LOCK_ACCESS_SINGLE);
 
-    /* if we have a destination file for all the cookies to get dumped to */
-    res = cookie_output(data, data->cookies, data->set.str[STRING_COOKIEJAR]);
-    if(res)
-      infof(data, "WARNING: failed to save cookies in %s: %s",
-            data->set.str[STRING_COOKIEJAR], curl_easy_strerror(res));
+    /* if we have a destination file for all the cookies to get dumped to,
+       unless the changes have been appended to it */
+    if(!cookie_journal_sync(data, data->cookies,
+                            data->set.str[STRING_COOKIEJAR])) {
+      res = cookie_output(data, data->cookies,
+                          data->set.str[STRING_COOKIEJAR]);
+      if(res)
+        infof(data, "WARNING: failed to save cookies in %s: %s",
+              data->set.str[STRING_COOKIEJAR], curl_easy_strerror(res));
+    }
   }
   else {
     Curl_share_lock(data, CURL_LOCK_DATA_COOKIE, CURL_LOCK_ACCESS_SINGLE);
@@ -28,10 +28,15 @@
 #include <curl/curl.h>
 
 #include "llist.h"
+#include "hash.h"
+
+struct cookie_path;
 
 struct Cookie {
   struct Curl_llist_node node; /* for the main cookie list */
+  struct Curl_llist_node pnode; /* for the list of its path group */
   struct Curl_llist_node getnode; /* for getlist */
+  struct cookie_path *group; /* the domain and path group it is in */
   char *name;         /* <this> = value */
   char *value;        /* name = <this> */
   char *path;         /* path = <this> which is in Set-Cookie: */
@@ -54,16 +59,23 @@ struct Cookie {
 #define COOKIE_PREFIX__SECURE (1<<0)
 #define COOKIE_PREFIX__HOST (1<<1)
 
-#define COOKIE_HASH_SIZE 63
-
 struct CookieInfo {
-  /* linked lists of cookies we know of */
-  struct Curl_llist cookielist[COOKIE_HASH_SIZE];
+  struct Curl_llist cookielist; /* all cookies we know of, oldest first */
+  struct Curl_hash domains; /* struct cookie_domain per lowercase domain */
+  struct Curl_hash getcache; /* sorted getlist results per request */
+  unsigned int generation;  /* changes whenever a cookie is added or gone */
+  unsigned int cache_generation; /* the generation 'getcache' is valid for */
+  FILE *journal;            /* jar file cookie changes are appended to */
+  char *journal_name;       /* name of the journal file */
+  curl_off_t journal_size;  /* size of the journal file */
+  curl_off_t jarsize;       /* size of the jar file when written in full */
   curl_off_t next_expiration; /* the next time at which expiration happens */
   unsigned int numcookies;  /* number of cookies in the "jar" */
   unsigned int lastct;      /* last creation-time used in the jar */
   BIT(running);    /* state info, for cookie adding information */
   BIT(newsession); /* new session, discard session cookies on load */
+  BIT(compact);    /* the journal lacks changes, write the jar in full */
+  BIT(jar_loaded); /* the cookies of the jar file were read */
 };
 
 /* The maximum sizes we accept for cookies. RFC 6265 section 6.1 says
@@ -212,6 +212,49 @@ Curl_getaddrinfo_ex(const char *nodename,
 }
 #endif /* HAVE_GETADDRINFO */
 
+/*
+ * Curl_addrinfo_dup()
+ *
+ * Returns a copy of a Curl_addrinfo list, allocated the same way as by
+ * Curl_getaddrinfo_ex(), or NULL on out of memory. The copy *MUST* be
+ * free'd with Curl_freeaddrinfo().
+ */
+struct Curl_addrinfo *
+Curl_addrinfo_dup(const struct Curl_addrinfo *orig)
+{
+  struct Curl_addrinfo *cafirst = NULL;
+  struct Curl_addrinfo *calast = NULL;
+  struct Curl_addrinfo *ca;
+
+  for(; orig; orig = orig->ai_next) {
+    size_t namelen = orig->ai_canonname ? strlen(orig->ai_canonname) + 1 : 0;
+
+    ca = malloc(sizeof(struct Curl_addrinfo) + orig->ai_addrlen + namelen);
+    if(!ca) {
+      Curl_freeaddrinfo(cafirst);
+      return NULL;
+    }
+    *ca = *orig;
+    ca->ai_canonname = NULL;
+    ca->ai_next = NULL;
+
+    ca->ai_addr = (void *)((char *)ca + sizeof(struct Curl_addrinfo));
+    memcpy(ca->ai_addr, orig->ai_addr, orig->ai_addrlen);
+
+    if(namelen) {
+      ca->ai_canonname = (void *)((char *)ca->ai_addr + orig->ai_addrlen);
+      memcpy(ca->ai_canonname, orig->ai_canonname, namelen);
+    }
+
+    if(!cafirst)
+      cafirst = ca;
+    if(calast)
+      calast->ai_next = ca;
+    calast = ca;
+  }
+  return cafirst;
+}
+
 
 /*
  * Curl_he2ai()
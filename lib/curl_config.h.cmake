@@ -433,6 +433,9 @@
 /* Define to 1 if you have the `pipe2' function. */
 #cmakedefine HAVE_PIPE2 1
 
+/* Define to 1 if you have the `epoll_create1' function. */
+#cmakedefine HAVE_EPOLL_CREATE1 1
+
 /* Define to 1 if you have the `eventfd' function. */
 #cmakedefine HAVE_EVENTFD 1
 
@@ -565,6 +568,9 @@
 /* Define to 1 if you have the timeval struct. */
 #cmakedefine HAVE_STRUCT_TIMEVAL 1
 
+/* Define to 1 if you have the <sys/epoll.h> header file. */
+#cmakedefine HAVE_SYS_EPOLL_H 1
+
 /* Define to 1 if you have the <sys/eventfd.h> header file. */
 #cmakedefine HAVE_SYS_EVENTFD_H 1
 
@@ -574,6 +580,9 @@
 /* Define to 1 if you have the <sys/ioctl.h> header file. */
 #cmakedefine HAVE_SYS_IOCTL_H 1
 
+/* Define to 1 if you have the <sys/mman.h> header file. */
+#cmakedefine HAVE_SYS_MMAN_H 1
+
 /* Define to 1 if you have the <sys/param.h> header file. */
 #cmakedefine HAVE_SYS_PARAM_H 1
 
@@ -691,6 +700,9 @@ ${SIZEOF_TIME_T_CODE}
 /* if SSL session export support is available */
 #cmakedefine USE_SSLS_EXPORT 1
 
+/* to use a timer wheel for the timers of multi handles */
+#cmakedefine USE_TIMER_WHEEL 1
+
 /* if mbedTLS is enabled */
 #cmakedefine USE_MBEDTLS 1
 
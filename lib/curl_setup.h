@@ -457,6 +457,11 @@
 #define USE_EVENTFD
 #endif
 
+/* Whether to use epoll() in curl_multi_wait() */
+#if defined(HAVE_EPOLL_CREATE1) && defined(HAVE_SYS_EPOLL_H)
+#define USE_EPOLL
+#endif
+
 #include <stdio.h>
 #include <assert.h>
 
@@ -744,6 +749,12 @@
 #define USE_SSL    /* SSL support has been enabled */
 #endif
 
+/* SSL sessions stored in a file, see CURLOPT_SSL_SESSION_FILE */
+#if defined(USE_SSL) && defined(USE_SSLS_EXPORT) && \
+  defined(HAVE_SYS_MMAN_H) && defined(HAVE_FCNTL_H) && !defined(_WIN32)
+#define USE_SSLS_FILE
+#endif
+
 #if defined(USE_OPENSSL) && defined(USE_WOLFSSL)
 #  include <wolfssl/version.h>
 #  if LIBWOLFSSL_VERSION_HEX >= 0x05007006
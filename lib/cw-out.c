@@ -27,6 +27,7 @@
 #include <curl/curl.h>
 
 #include "urldata.h"
+#include "borrow.h"
 #include "cfilters.h"
 #include "headers.h"
 #include "multiif.h"
@@ -203,6 +204,7 @@ static CURLcode cw_out_ptr_flush(struct cw_out_ctx *ctx,
   void *wcb_data;
   size_t max_write, min_write;
   size_t wlen, nwritten;
+  bool borrow;
 
   /* If we errored once, we do not invoke the client callback  again */
   if(ctx->errored)
@@ -210,7 +212,9 @@ static CURLcode cw_out_ptr_flush(struct cw_out_ctx *ctx,
 
   /* write callbacks may get NULLed by the client between calls. */
   cw_get_writefunc(data, otype, &wcb, &wcb_data, &max_write, &min_write);
-  if(!wcb) {
+  /* body data goes to the borrow callback instead, if there is one */
+  borrow = (otype == CW_OUT_BODY) && data->set.fborrow;
+  if(!wcb && !borrow) {
     *pconsumed = blen;
     return CURLE_OK;
   }
@@ -221,7 +225,15 @@ static CURLcode cw_out_ptr_flush(struct cw_out_ctx *ctx,
       break;
     wlen = max_write ? CURLMIN(blen, max_write) : blen;
     Curl_set_in_callback(data, TRUE);
-    nwritten = wcb((char *)CURL_UNCONST(buf), 1, wlen, wcb_data);
+    if(borrow) {
+      CURLcode result = Curl_borrow_write(data, buf, wlen, &nwritten);
+      if(result) {
+        Curl_set_in_callback(data, FALSE);
+        return result;
+      }
+    }
+    else
+      nwritten = wcb((char *)CURL_UNCONST(buf), 1, wlen, wcb_data);
     Curl_set_in_callback(data, FALSE);
     CURL_TRC_WRITE(data, "[OUT] wrote %zu %s bytes -> %zu",
                    wlen, (otype == CW_OUT_BODY) ? "body" : "header",
@@ -878,7 +878,14 @@ CURLcode curl_easy_getinfo(CURL *data, CURLINFO info, ...)
   va_start(arg, info);
   paramp = va_arg(arg, void *);
 
-  result = Curl_getinfo(data, info, paramp);
+  if(!data)
+    result = CURLE_BAD_FUNCTION_ARGUMENT;
+  else {
+    /* a worker thread may be running the transfer */
+    Curl_mwrk_easy_lock(data);
+    result = Curl_getinfo(data, info, paramp);
+    Curl_mwrk_easy_unlock(data);
+  }
 
   va_end(arg);
   return result;
@@ -1113,20 +1120,7 @@ void curl_easy_reset(CURL *d)
   data->master_mid = UINT_MAX;
 }
 
-/*
- * curl_easy_pause() allows an application to pause or unpause a specific
- * transfer and direction. This function sets the full new state for the
- * current connection this easy handle operates on.
- *
- * NOTE: if you have the receiving paused and you call this function to remove
- * the pausing, you may get your write callback called at this point.
- *
- * Action is a bitmask consisting of CURLPAUSE_* bits in curl/curl.h
- *
- * NOTE: This is one of few API functions that are allowed to be called from
- * within a callback.
- */
-CURLcode curl_easy_pause(CURL *d, int action)
+static CURLcode easy_pause(struct Curl_easy *data, int action)
 {
   struct SingleRequest *k;
   CURLcode result = CURLE_OK;
@@ -1134,9 +1128,8 @@ CURLcode curl_easy_pause(CURL *d, int action)
   int newstate;
   bool recursive = FALSE;
   bool keep_changed, unpause_read, not_all_paused;
-  struct Curl_easy *data = d;
 
-  if(!GOOD_EASY_HANDLE(data) || !data->conn)
+  if(!data->conn)
     /* crazy input, do not continue */
     return CURLE_BAD_FUNCTION_ARGUMENT;
 
@@ -1208,6 +1201,34 @@ out:
   return result;
 }
 
+/*
+ * curl_easy_pause() allows an application to pause or unpause a specific
+ * transfer and direction. This function sets the full new state for the
+ * current connection this easy handle operates on.
+ *
+ * NOTE: if you have the receiving paused and you call this function to remove
+ * the pausing, you may get your write callback called at this point.
+ *
+ * Action is a bitmask consisting of CURLPAUSE_* bits in curl/curl.h
+ *
+ * NOTE: This is one of few API functions that are allowed to be called from
+ * within a callback.
+ */
+CURLcode curl_easy_pause(CURL *d, int action)
+{
+  struct Curl_easy *data = d;
+  CURLcode result;
+
+  if(!GOOD_EASY_HANDLE(data))
+    return CURLE_BAD_FUNCTION_ARGUMENT;
+
+  /* a worker thread may be running the transfer */
+  Curl_mwrk_easy_lock(data);
+  result = easy_pause(data, action);
+  Curl_mwrk_easy_unlock(data);
+  return result;
+}
+
 
 static CURLcode easy_connection(struct Curl_easy *data,
                                 struct connectdata **connp)
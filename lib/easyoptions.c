@@ -38,6 +38,8 @@ const struct curl_easyoption Curl_easyopts[] = {
   {"APPEND", CURLOPT_APPEND, CURLOT_LONG, 0},
   {"AUTOREFERER", CURLOPT_AUTOREFERER, CURLOT_LONG, 0},
   {"AWS_SIGV4", CURLOPT_AWS_SIGV4, CURLOT_STRING, 0},
+  {"BORROWDATA", CURLOPT_BORROWDATA, CURLOT_CBPTR, 0},
+  {"BORROWFUNCTION", CURLOPT_BORROWFUNCTION, CURLOT_FUNCTION, 0},
   {"BUFFERSIZE", CURLOPT_BUFFERSIZE, CURLOT_LONG, 0},
   {"CAINFO", CURLOPT_CAINFO, CURLOT_STRING, 0},
   {"CAINFO_BLOB", CURLOPT_CAINFO_BLOB, CURLOT_BLOB, 0},
@@ -62,6 +64,7 @@ const struct curl_easyoption Curl_easyopts[] = {
   {"COOKIE", CURLOPT_COOKIE, CURLOT_STRING, 0},
   {"COOKIEFILE", CURLOPT_COOKIEFILE, CURLOT_STRING, 0},
   {"COOKIEJAR", CURLOPT_COOKIEJAR, CURLOT_STRING, 0},
+  {"COOKIEJOURNAL", CURLOPT_COOKIEJOURNAL, CURLOT_LONG, 0},
   {"COOKIELIST", CURLOPT_COOKIELIST, CURLOT_STRING, 0},
   {"COOKIESESSION", CURLOPT_COOKIESESSION, CURLOT_LONG, 0},
   {"COPYPOSTFIELDS", CURLOPT_COPYPOSTFIELDS, CURLOT_OBJECT, 0},
@@ -75,10 +78,13 @@ const struct curl_easyoption Curl_easyopts[] = {
   {"DIRLISTONLY", CURLOPT_DIRLISTONLY, CURLOT_LONG, 0},
   {"DISALLOW_USERNAME_IN_URL", CURLOPT_DISALLOW_USERNAME_IN_URL,
    CURLOT_LONG, 0},
+  {"DNS_CACHE_FILE", CURLOPT_DNS_CACHE_FILE, CURLOT_STRING, 0},
   {"DNS_CACHE_TIMEOUT", CURLOPT_DNS_CACHE_TIMEOUT, CURLOT_LONG, 0},
   {"DNS_INTERFACE", CURLOPT_DNS_INTERFACE, CURLOT_STRING, 0},
   {"DNS_LOCAL_IP4", CURLOPT_DNS_LOCAL_IP4, CURLOT_STRING, 0},
   {"DNS_LOCAL_IP6", CURLOPT_DNS_LOCAL_IP6, CURLOT_STRING, 0},
+  {"DNS_NEGATIVE_TIMEOUT", CURLOPT_DNS_NEGATIVE_TIMEOUT, CURLOT_LONG, 0},
+  {"DNS_REFRESH_AHEAD", CURLOPT_DNS_REFRESH_AHEAD, CURLOT_LONG, 0},
   {"DNS_SERVERS", CURLOPT_DNS_SERVERS, CURLOT_STRING, 0},
   {"DNS_SHUFFLE_ADDRESSES", CURLOPT_DNS_SHUFFLE_ADDRESSES, CURLOT_LONG, 0},
   {"DNS_USE_GLOBAL_CACHE", CURLOPT_DNS_USE_GLOBAL_CACHE, CURLOT_LONG, 0},
@@ -317,6 +323,7 @@ const struct curl_easyoption Curl_easyopts[] = {
   {"SSL_FALSESTART", CURLOPT_SSL_FALSESTART, CURLOT_LONG, 0},
   {"SSL_OPTIONS", CURLOPT_SSL_OPTIONS, CURLOT_VALUES, 0},
   {"SSL_SESSIONID_CACHE", CURLOPT_SSL_SESSIONID_CACHE, CURLOT_LONG, 0},
+  {"SSL_SESSION_FILE", CURLOPT_SSL_SESSION_FILE, CURLOT_STRING, 0},
   {"SSL_SIGNATURE_ALGORITHMS", CURLOPT_SSL_SIGNATURE_ALGORITHMS,
    CURLOT_STRING, 0},
   {"SSL_VERIFYHOST", CURLOPT_SSL_VERIFYHOST, CURLOT_LONG, 0},
@@ -325,6 +332,7 @@ const struct curl_easyoption Curl_easyopts[] = {
   {"STDERR", CURLOPT_STDERR, CURLOT_OBJECT, 0},
   {"STREAM_DEPENDS", CURLOPT_STREAM_DEPENDS, CURLOT_OBJECT, 0},
   {"STREAM_DEPENDS_E", CURLOPT_STREAM_DEPENDS_E, CURLOT_OBJECT, 0},
+  {"STREAM_URGENCY", CURLOPT_STREAM_URGENCY, CURLOT_LONG, 0},
   {"STREAM_WEIGHT", CURLOPT_STREAM_WEIGHT, CURLOT_LONG, 0},
   {"SUPPRESS_CONNECT_HEADERS", CURLOPT_SUPPRESS_CONNECT_HEADERS,
    CURLOT_LONG, 0},
@@ -380,6 +388,6 @@ const struct curl_easyoption Curl_easyopts[] = {
  */
 int Curl_easyopts_check(void)
 {
-  return (CURLOPT_LASTENTRY % 10000) != (328 + 1);
+  return (CURLOPT_LASTENTRY % 10000) != (336 + 1);
 }
 #endif
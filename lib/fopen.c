@@ -24,9 +24,6 @@
 
 #include "curl_setup.h"
 
-#if !defined(CURL_DISABLE_COOKIES) || !defined(CURL_DISABLE_ALTSVC) ||  \
-  !defined(CURL_DISABLE_HSTS)
-
 #ifdef HAVE_FCNTL_H
 #include <fcntl.h>
 #endif
@@ -160,5 +157,3 @@ fail:
   free(tempstore);
   return result;
 }
-
-#endif /* ! disabled */
@@ -72,6 +72,8 @@ CURLcode Curl_initinfo(struct Curl_easy *data)
   info->proxyauthpicked = 0;
   info->httpauthpicked = 0;
   info->numconnects = 0;
+  info->h2_window = 0;
+  info->h2_rtt = 0;
 
   free(info->contenttype);
   info->contenttype = NULL;
@@ -469,6 +471,12 @@ static CURLcode getinfo_offt(struct Curl_easy *data, CURLINFO info,
   case CURLINFO_EARLYDATA_SENT_T:
     *param_offt = data->progress.earlydata_sent;
     break;
+  case CURLINFO_HTTP2_WINDOW_T:
+    *param_offt = data->info.h2_window;
+    break;
+  case CURLINFO_HTTP2_RTT_T:
+    *param_offt = data->info.h2_rtt;
+    break;
   default:
     return CURLE_UNKNOWN_OPTION;
   }
@@ -311,6 +311,40 @@ size_t Curl_hash_count(struct Curl_hash *h)
   return h->size;
 }
 
+/* Moves all entries into a table with the given number of slots. Must not
+ * be called while iterating over the hash. Returns non-zero on failure, the
+ * hash remains unchanged then.
+ *
+ * @unittest: 1603
+ */
+int Curl_hash_resize(struct Curl_hash *h, size_t slots)
+{
+  DEBUGASSERT(h->init == HASHINIT);
+  DEBUGASSERT(slots);
+  if(h->table) {
+    struct Curl_hash_element **table;
+    size_t i;
+
+    table = calloc(slots, sizeof(struct Curl_hash_element *));
+    if(!table)
+      return 1; /* OOM */
+    for(i = 0; i < h->slots; ++i) {
+      while(h->table[i]) {
+        struct Curl_hash_element *he = h->table[i];
+        struct Curl_hash_element **slot =
+          &table[h->hash_func(he->key, he->key_len, slots)];
+        h->table[i] = he->next;
+        he->next = *slot;
+        *slot = he;
+      }
+    }
+    free(h->table);
+    h->table = table;
+  }
+  h->slots = slots;
+  return 0;
+}
+
 /* Cleans all entries that pass the comp function criteria. */
 void
 Curl_hash_clean_with_criterium(struct Curl_hash *h, void *user,
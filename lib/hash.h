@@ -94,6 +94,7 @@ void *Curl_hash_pick(struct Curl_hash *, void *key, size_t key_len);
 
 void Curl_hash_destroy(struct Curl_hash *h);
 size_t Curl_hash_count(struct Curl_hash *h);
+int Curl_hash_resize(struct Curl_hash *h, size_t slots);
 void Curl_hash_clean(struct Curl_hash *h);
 void Curl_hash_clean_with_criterium(struct Curl_hash *h, void *user,
                                     int (*comp)(void *, void *));
@@ -62,7 +62,12 @@
 #include "select.h"
 #include "strcase.h"
 #include "easy_lock.h"
+#include "uint-spbset.h"
 #include "curlx/strparse.h"
+#include "curl_get_line.h"
+#include "parsedate.h"
+#include "fopen.h"
+#include "rename.h"
 
 /* The last 3 #include files should be in this order */
 #include "curl_printf.h"
@@ -82,6 +87,19 @@
 
 #define MAX_DNS_CACHE_SIZE 29999
 
+/* most failed lookups to remember in a DNS cache */
+#define MAX_DNS_NEGATIVE_SIZE 100
+
+/* cache hits an entry needs before it is refreshed ahead of its expiry */
+#define DNS_REFRESH_MIN_HITS 2
+/* seconds to wait after a failed refresh, doubling with each further
+   failure up to the maximum */
+#define DNS_REFRESH_RETRY_SECS 2
+#define DNS_REFRESH_RETRY_MAX_SECS 64
+
+#define MAX_DNS_CACHE_LINE 4095
+#define MAX_DNS_CACHE_DATELEN 64
+
 /*
  * hostip.c explained
  * ==================
@@ -254,6 +272,56 @@ static void dnscache_unlock(struct Curl_easy *data,
     Curl_share_unlock(data, CURL_LOCK_DATA_DNS);
 }
 
+/* a lookup in progress that other transfers may wait for */
+struct dnscache_pending {
+  struct Curl_easy *owner;    /* the transfer running the lookup */
+  struct Curl_multi *multi;   /* the multi handle of 'owner' */
+  struct uint_spbset waiters; /* mids of the transfers waiting in 'multi' */
+  int ip_version;
+};
+
+/* a lookup that failed */
+struct dnscache_negative {
+  struct Curl_llist_node node; /* in the cache's list, oldest first */
+  time_t timestamp;
+  int ip_version;
+  size_t idlen;
+  char id[1];
+};
+
+static void dnscache_pending_dtor(void *entry)
+{
+  struct dnscache_pending *pending = entry;
+  Curl_uint_spbset_destroy(&pending->waiters);
+  free(pending);
+}
+
+static void dnscache_negative_dtor(void *entry)
+{
+  struct dnscache_negative *neg = entry;
+  Curl_node_remove(&neg->node);
+  free(neg);
+}
+
+/*
+ * Remove the outdated failed lookups and then the oldest ones until at most
+ * 'max' are left. This assumes that a lock has already been taken.
+ */
+static void dnscache_negative_prune(struct Curl_dnscache *dnscache,
+                                    int timeout, time_t now, size_t max)
+{
+  struct Curl_llist_node *e;
+
+  for(e = Curl_llist_head(&dnscache->negative_list); e;
+      e = Curl_llist_head(&dnscache->negative_list)) {
+    struct dnscache_negative *neg = Curl_node_elem(e);
+    if((Curl_hash_count(&dnscache->negative) <= max) &&
+       ((now - neg->timestamp) < (time_t)timeout))
+      break;
+    Curl_hash_delete(&dnscache->negative, neg->id, neg->idlen + 1);
+  }
+}
+
 /*
  * Library-wide function for pruning the DNS cache. This function takes and
  * returns the appropriate locks.
@@ -287,9 +355,204 @@ void Curl_dnscache_prune(struct Curl_easy *data)
   } while(timeout &&
           (Curl_hash_count(&dnscache->entries) > MAX_DNS_CACHE_SIZE));
 
+  dnscache_negative_prune(dnscache, data->set.dns_negative_timeout, now,
+                          MAX_DNS_NEGATIVE_SIZE);
+
+  dnscache_unlock(data, dnscache);
+}
+
+/*
+ * Return TRUE if a lookup of the name with this id failed recently. This
+ * assumes that a lock has already been taken.
+ */
+static bool dnscache_negative_get(struct Curl_easy *data,
+                                  struct Curl_dnscache *dnscache,
+                                  const char *id, size_t idlen,
+                                  int ip_version)
+{
+  struct dnscache_negative *neg;
+
+  if(!data->set.dns_negative_timeout)
+    return FALSE;
+  neg = Curl_hash_pick(&dnscache->negative, CURL_UNCONST(id), idlen + 1);
+  if(!neg)
+    return FALSE;
+  if((time(NULL) - neg->timestamp) >=
+     (time_t)data->set.dns_negative_timeout) {
+    Curl_hash_delete(&dnscache->negative, CURL_UNCONST(id), idlen + 1);
+    return FALSE;
+  }
+  return neg->ip_version == ip_version;
+}
+
+UNITTEST void Curl_dnscache_add_negative(struct Curl_easy *data,
+                                         const char *hostname, int port,
+                                         int ip_version);
+/*
+ * Curl_dnscache_add_negative() remembers that resolving the name failed, so
+ * that transfers to it fail right away for 'dns_negative_timeout' seconds.
+ *
+ * @unittest: 3218
+ */
+UNITTEST void Curl_dnscache_add_negative(struct Curl_easy *data,
+                                         const char *hostname, int port,
+                                         int ip_version)
+{
+  struct Curl_dnscache *dnscache = dnscache_get(data);
+  struct dnscache_negative *neg;
+  char id[MAX_HOSTCACHE_LEN];
+  size_t idlen;
+
+  if(!dnscache || !hostname || !data->set.dns_negative_timeout)
+    return;
+  idlen = create_dnscache_id(hostname, 0, port, id, sizeof(id));
+  neg = calloc(1, sizeof(*neg) + idlen);
+  if(!neg)
+    return;
+  neg->timestamp = time(NULL);
+  neg->ip_version = ip_version;
+  neg->idlen = idlen;
+  memcpy(neg->id, id, idlen);
+
+  dnscache_lock(data, dnscache);
+  /* an entry for the name is replaced, make room for one otherwise */
+  Curl_hash_delete(&dnscache->negative, id, idlen + 1);
+  dnscache_negative_prune(dnscache, data->set.dns_negative_timeout,
+                          neg->timestamp, MAX_DNS_NEGATIVE_SIZE - 1);
+  if(Curl_hash_add(&dnscache->negative, id, idlen + 1, neg))
+    Curl_llist_append(&dnscache->negative_list, neg, &neg->node);
+  else
+    free(neg);
+  dnscache_unlock(data, dnscache);
+}
+
+#ifdef USE_CURL_ASYNC
+UNITTEST void Curl_dnscache_add_pending(struct Curl_easy *data);
+/*
+ * Curl_dnscache_add_pending() registers the async lookup the transfer has
+ * started, so that other transfers resolving the same name wait for its
+ * result instead of starting their own. They find the result in the DNS
+ * cache, which is why nothing is registered when the cache is disabled.
+ *
+ * @unittest: 3218
+ */
+UNITTEST void Curl_dnscache_add_pending(struct Curl_easy *data)
+{
+  struct Curl_dnscache *dnscache = dnscache_get(data);
+  struct Curl_async *async = &data->state.async;
+  struct dnscache_pending *pending;
+  char id[MAX_HOSTCACHE_LEN];
+  size_t idlen;
+
+  if(!dnscache || !async->hostname || !data->set.dns_cache_timeout)
+    return;
+  pending = calloc(1, sizeof(*pending));
+  if(!pending)
+    return;
+  pending->owner = data;
+  pending->multi = data->multi;
+  pending->ip_version = async->ip_version;
+  Curl_uint_spbset_init(&pending->waiters);
+  idlen = create_dnscache_id(async->hostname, 0, async->port,
+                             id, sizeof(id));
+
+  dnscache_lock(data, dnscache);
+  if(!Curl_hash_pick(&dnscache->pending, id, idlen + 1) &&
+     Curl_hash_add(&dnscache->pending, id, idlen + 1, pending)) {
+    async->pending = TRUE;
+    pending = NULL;
+  }
+  dnscache_unlock(data, dnscache);
+  if(pending)
+    dnscache_pending_dtor(pending);
+}
+
+void Curl_resolv_pending_drop(struct Curl_easy *data)
+{
+  struct Curl_async *async = &data->state.async;
+  struct Curl_dnscache *dnscache;
+  struct dnscache_pending *pending;
+  char id[MAX_HOSTCACHE_LEN];
+  size_t idlen;
+  bool coalesced = async->coalesced;
+
+  async->coalesced = FALSE;
+  if(!async->pending && !coalesced)
+    return;
+  async->pending = FALSE;
+  dnscache = dnscache_get(data);
+  if(!dnscache || !async->hostname)
+    return;
+  idlen = create_dnscache_id(async->hostname, 0, async->port,
+                             id, sizeof(id));
+
+  dnscache_lock(data, dnscache);
+  pending = Curl_hash_pick(&dnscache->pending, id, idlen + 1);
+  if(pending && (pending->owner == data)) {
+    unsigned int mid;
+    /* Wake up the waiting transfers of our multi handle. Those of other
+       multi handles sharing the cache poll for the result. */
+    if(data->multi && (pending->multi == data->multi) &&
+       Curl_uint_spbset_first(&pending->waiters, &mid)) {
+      do {
+        struct Curl_easy *waiter = Curl_multi_get_easy(data->multi, mid);
+        if(waiter)
+          Curl_expire(waiter, 0, EXPIRE_RUN_NOW);
+      } while(Curl_uint_spbset_next(&pending->waiters, mid, &mid));
+    }
+    Curl_hash_delete(&dnscache->pending, id, idlen + 1);
+  }
+  else if(pending && coalesced && (pending->multi == data->multi))
+    /* we no longer wait, the mid may go to another transfer */
+    Curl_uint_spbset_remove(&pending->waiters, data->mid);
   dnscache_unlock(data, dnscache);
 }
 
+/*
+ * Wait for the lookup of the name another transfer is running, if there is
+ * one. Returns TRUE when the transfer waits for it.
+ */
+static bool resolv_coalesce(struct Curl_easy *data,
+                            struct Curl_dnscache *dnscache,
+                            const char *id, size_t idlen,
+                            const char *hostname, int port,
+                            int ip_version, bool allowDOH)
+{
+  struct Curl_async *async = &data->state.async;
+  struct dnscache_pending *pending;
+  bool wait = FALSE;
+
+  if(!data->set.dns_cache_timeout)
+    return FALSE;
+
+  dnscache_lock(data, dnscache);
+  pending = Curl_hash_pick(&dnscache->pending, CURL_UNCONST(id), idlen + 1);
+  if(pending && (pending->owner != data) &&
+     (pending->ip_version == ip_version)) {
+    if(data->multi && (pending->multi == data->multi))
+      Curl_uint_spbset_add(&pending->waiters, data->mid);
+    wait = TRUE;
+  }
+  dnscache_unlock(data, dnscache);
+  if(!wait)
+    return FALSE;
+
+  Curl_safefree(async->hostname);
+  async->hostname = strdup(hostname);
+  if(!async->hostname)
+    return FALSE;
+  async->port = port;
+  async->ip_version = ip_version;
+  async->dns = NULL;
+  async->done = FALSE;
+  async->wait_ms = 0;
+  async->coalesced = TRUE;
+  async->allow_doh = allowDOH;
+  infof(data, "Waiting for the ongoing resolve of %s", hostname);
+  return TRUE;
+}
+#endif /* USE_CURL_ASYNC */
+
 #ifdef USE_ALARM_TIMEOUT
 /* Beware this is a global and unique instance. This is used to store the
    return address that we can jump back to from inside a signal handler. This
@@ -298,6 +561,82 @@ static sigjmp_buf curl_jmpenv;
 static curl_simple_lock curl_jmpenv_lock;
 #endif
 
+#ifdef CURLRES_THREADED
+static void dnscache_refresh_failed(struct Curl_dns_entry *dns)
+{
+  time_t wait = DNS_REFRESH_RETRY_SECS;
+  unsigned int i;
+
+  for(i = 0; (i < dns->refresh_fails) && (wait < DNS_REFRESH_RETRY_MAX_SECS);
+      ++i)
+    wait *= 2;
+  ++dns->refresh_fails;
+  dns->refresh_retry = time(NULL) + CURLMIN(wait, DNS_REFRESH_RETRY_MAX_SECS);
+}
+
+/*
+ * Replace the entry with the result of its refresh, when that is done. This
+ * assumes that a lock has already been taken. Returns the entry to use.
+ */
+static struct Curl_dns_entry *
+dnscache_refreshed(struct Curl_easy *data, struct Curl_dnscache *dnscache,
+                   struct Curl_dns_entry *dns, const char *id, size_t idlen)
+{
+  struct Curl_addrinfo *addr;
+  struct Curl_dns_entry *fresh;
+
+  if(!Curl_async_thrdd_refresh_take(&dns->refresh, &addr))
+    /* still running, keep using the entry we have */
+    return dns;
+  if(!addr) {
+    /* failed, keep the entry and do not retry right away */
+    dnscache_refresh_failed(dns);
+    return dns;
+  }
+  fresh = Curl_dnscache_mk_entry(data, addr, dns->hostname, 0, dns->hostport,
+                                 FALSE);
+  if(!fresh)
+    return dns;
+  /* this drops the cache's reference to the old entry */
+  if(!Curl_hash_add(&dnscache->entries, CURL_UNCONST(id), idlen + 1, fresh)) {
+    dnscache_entry_free(fresh);
+    return dns;
+  }
+  dnscache->dirty = TRUE;
+  infof(data, "Hostname %s was refreshed in DNS cache", fresh->hostname);
+  return fresh;
+}
+
+/*
+ * Start refreshing an often used entry in the background when it is about
+ * to expire, so that transfers do not have to wait for the name to resolve
+ * again. This assumes that a lock has already been taken.
+ */
+static void dnscache_refresh_ahead(struct Curl_easy *data,
+                                   struct Curl_dns_entry *dns)
+{
+  time_t now;
+
+  if(!data->set.dns_refresh_ahead || (data->set.dns_cache_timeout <= 0) ||
+     !dns->timestamp || dns->refresh || !dns->hostname[0])
+    return;
+  if(++dns->hits < DNS_REFRESH_MIN_HITS)
+    return;
+  now = time(NULL);
+  if(((now - dns->timestamp) < ((time_t)data->set.dns_cache_timeout -
+                                (time_t)data->set.dns_refresh_ahead)) ||
+     (now < dns->refresh_retry))
+    return;
+  dns->refresh = Curl_async_thrdd_refresh(data, dns->hostname, dns->hostport);
+  if(dns->refresh)
+    infof(data, "Refreshing %s in DNS cache ahead of expiry", dns->hostname);
+  else
+    dnscache_refresh_failed(dns);
+}
+#else
+#define dnscache_refresh_ahead(x,y) Curl_nop_stmt
+#endif
+
 /* lookup address, returns entry if found and not stale */
 static struct Curl_dns_entry *fetch_addr(struct Curl_easy *data,
                                          struct Curl_dnscache *dnscache,
@@ -327,6 +666,11 @@ static struct Curl_dns_entry *fetch_addr(struct Curl_easy *data,
     dns = Curl_hash_pick(&dnscache->entries, entry_id, entry_len + 1);
   }
 
+#ifdef CURLRES_THREADED
+  if(dns && dns->refresh)
+    dns = dnscache_refreshed(data, dnscache, dns, entry_id, entry_len);
+#endif
+
   if(dns && (data->set.dns_cache_timeout != -1)) {
     /* See whether the returned entry is stale. Done before we release lock */
     struct dnscache_prune_data user;
@@ -587,6 +931,9 @@ CURLcode Curl_dnscache_add(struct Curl_easy *data,
     return CURLE_OUT_OF_MEMORY;
   }
   entry->refcount++;
+  dnscache->dirty = TRUE;
+  /* the name resolves again */
+  Curl_hash_delete(&dnscache->negative, id, idlen + 1);
   dnscache_unlock(data, dnscache);
   return CURLE_OK;
 }
@@ -782,6 +1129,44 @@ static bool can_resolve_ip_version(struct Curl_easy *data, int ip_version)
   return TRUE;
 }
 
+/*
+ * Start resolving the name with DoH or the resolver backend. Returns the
+ * addresses when they are known right away. Sets 'respwait' for an async
+ * lookup, and returns NULL for everything else.
+ */
+static struct Curl_addrinfo *resolv_start(struct Curl_easy *data,
+                                          const char *hostname,
+                                          int port,
+                                          int ip_version,
+                                          bool allowDOH,
+                                          int *respwait)
+{
+#ifndef CURLRES_ASYNCH
+  struct Curl_addrinfo *addr;
+#endif
+
+#ifndef CURL_DISABLE_DOH
+  if(allowDOH && data->set.doh)
+    return Curl_doh(data, hostname, port, ip_version, respwait);
+#else
+  (void)allowDOH;
+#endif
+
+  /* Can we provide the requested IP specifics in resolving? */
+  if(!can_resolve_ip_version(data, ip_version))
+    return NULL;
+
+#ifdef CURLRES_ASYNCH
+  return Curl_async_getaddrinfo(data, hostname, port, ip_version, respwait);
+#else
+  *respwait = 0; /* no async waiting here */
+  addr = Curl_sync_getaddrinfo(data, hostname, port, ip_version);
+  if(!addr)
+    Curl_dnscache_add_negative(data, hostname, port, ip_version);
+  return addr;
+#endif
+}
+
 /*
  * Curl_resolv() is the main name resolve function within libcurl. It resolves
  * a name and returns a pointer to the entry in the 'entry' argument (if one
@@ -797,20 +1182,27 @@ static bool can_resolve_ip_version(struct Curl_easy *data, int ip_version)
  * CURLE_AGAIN = resolving in progress, *entry == NULL
  * CURLE_COULDNT_RESOLVE_HOST = error, *entry == NULL
  * CURLE_OPERATION_TIMEDOUT = timeout expired, *entry == NULL
+ *
+ * With 'coalesce' set, the transfer may wait for the lookup of the same name
+ * that another transfer runs instead of starting its own.
  */
-CURLcode Curl_resolv(struct Curl_easy *data,
-                     const char *hostname,
-                     int port,
-                     int ip_version,
-                     bool allowDOH,
-                     struct Curl_dns_entry **entry)
+static CURLcode hostip_resolv(struct Curl_easy *data,
+                              const char *hostname,
+                              int port,
+                              int ip_version,
+                              bool allowDOH,
+                              bool coalesce,
+                              struct Curl_dns_entry **entry)
 {
   struct Curl_dnscache *dnscache = dnscache_get(data);
   struct Curl_dns_entry *dns = NULL;
   struct Curl_addrinfo *addr = NULL;
   int respwait = 0;
   bool is_ipaddr;
+  bool failed;
   size_t hostname_len;
+  char id[MAX_HOSTCACHE_LEN];
+  size_t idlen;
 
 #ifndef CURL_DISABLE_DOH
   data->conn->bits.doh = FALSE; /* default is not */
@@ -832,8 +1224,10 @@ CURLcode Curl_resolv(struct Curl_easy *data,
   /* Let's check our DNS cache first */
   dnscache_lock(data, dnscache);
   dns = fetch_addr(data, dnscache, hostname, port, ip_version);
-  if(dns)
+  if(dns) {
     dns->refcount++; /* we pass out the reference. */
+    dnscache_refresh_ahead(data, dns);
+  }
   dnscache_unlock(data, dnscache);
   if(dns) {
     infof(data, "Hostname %s was found in DNS cache", hostname);
@@ -877,24 +1271,35 @@ CURLcode Curl_resolv(struct Curl_easy *data,
       tailmatch(hostname, hostname_len, STRCONST(".localhost")) ||
       tailmatch(hostname, hostname_len, STRCONST(".localhost.")))) {
     addr = get_localhost(port, hostname);
+    goto out;
   }
-#ifndef CURL_DISABLE_DOH
-  else if(!is_ipaddr && allowDOH && data->set.doh) {
-    addr = Curl_doh(data, hostname, port, ip_version, &respwait);
+
+  /* Did resolving the name fail a moment ago? */
+  idlen = create_dnscache_id(hostname, hostname_len, port, id, sizeof(id));
+  dnscache_lock(data, dnscache);
+  failed = dnscache_negative_get(data, dnscache, id, idlen, ip_version);
+  dnscache_unlock(data, dnscache);
+  if(failed) {
+    infof(data, "Hostname %s was found in negative DNS cache", hostname);
+    goto error;
   }
-#endif
-  else {
-    /* Can we provide the requested IP specifics in resolving? */
-    if(!can_resolve_ip_version(data, ip_version))
-      goto error;
 
-#ifdef CURLRES_ASYNCH
-    addr = Curl_async_getaddrinfo(data, hostname, port, ip_version, &respwait);
+  allowDOH = allowDOH && !is_ipaddr;
+#ifdef USE_CURL_ASYNC
+  if(coalesce && resolv_coalesce(data, dnscache, id, idlen, hostname, port,
+                                 ip_version, allowDOH)) {
+    respwait = 1;
+    goto out;
+  }
 #else
-    respwait = 0; /* no async waiting here */
-    addr = Curl_sync_getaddrinfo(data, hostname, port, ip_version);
+  (void)coalesce;
+#endif
+
+  addr = resolv_start(data, hostname, port, ip_version, allowDOH, &respwait);
+#ifdef USE_CURL_ASYNC
+  if(respwait && coalesce)
+    Curl_dnscache_add_pending(data);
 #endif
-  }
 
 out:
   /* We either have found a `dns` or looked up the `addr`
@@ -929,6 +1334,17 @@ error:
   return CURLE_COULDNT_RESOLVE_HOST;
 }
 
+CURLcode Curl_resolv(struct Curl_easy *data,
+                     const char *hostname,
+                     int port,
+                     int ip_version,
+                     bool allowDOH,
+                     struct Curl_dns_entry **entry)
+{
+  return hostip_resolv(data, hostname, port, ip_version, allowDOH, TRUE,
+                       entry);
+}
+
 CURLcode Curl_resolv_blocking(struct Curl_easy *data,
                               const char *hostname,
                               int port,
@@ -938,7 +1354,9 @@ CURLcode Curl_resolv_blocking(struct Curl_easy *data,
   CURLcode result;
 
   *dnsentry = NULL;
-  result = Curl_resolv(data, hostname, port, ip_version, FALSE, dnsentry);
+  /* waiting on a lookup driven by another transfer would block forever */
+  result = hostip_resolv(data, hostname, port, ip_version, FALSE, FALSE,
+                         dnsentry);
   switch(result) {
   case CURLE_OK:
     DEBUGASSERT(*dnsentry);
@@ -946,6 +1364,9 @@ CURLcode Curl_resolv_blocking(struct Curl_easy *data,
   case CURLE_AGAIN:
     DEBUGASSERT(!*dnsentry);
     result = Curl_async_await(data, dnsentry);
+    if((result == CURLE_COULDNT_RESOLVE_HOST) ||
+       (result == CURLE_COULDNT_RESOLVE_PROXY))
+      Curl_dnscache_add_negative(data, hostname, port, ip_version);
     if(result || !*dnsentry) {
       /* close the connection, since we cannot return failure here without
          cleaning up this connection properly. */
@@ -1152,6 +1573,9 @@ clean_up:
 
 static void dnscache_entry_free(struct Curl_dns_entry *dns)
 {
+#ifdef CURLRES_THREADED
+  Curl_async_thrdd_refresh_release(&dns->refresh);
+#endif
   Curl_freeaddrinfo(dns->addr);
 #ifdef USE_HTTPSRR
   if(dns->hinfo) {
@@ -1199,11 +1623,195 @@ void Curl_dnscache_init(struct Curl_dnscache *dns, size_t size)
 {
   Curl_hash_init(&dns->entries, size, Curl_hash_str, curlx_str_key_compare,
                  dnscache_entry_dtor);
+  Curl_hash_init(&dns->pending, size, Curl_hash_str, curlx_str_key_compare,
+                 dnscache_pending_dtor);
+  Curl_hash_init(&dns->negative, size, Curl_hash_str, curlx_str_key_compare,
+                 dnscache_negative_dtor);
+  Curl_llist_init(&dns->negative_list, NULL);
 }
 
 void Curl_dnscache_destroy(struct Curl_dnscache *dns)
 {
   Curl_hash_destroy(&dns->entries);
+  Curl_hash_destroy(&dns->pending);
+  Curl_hash_destroy(&dns->negative);
+  Curl_safefree(dns->filename);
+}
+
+/*
+ * Add a cache entry from a line of the DNS cache file, without its newline,
+ * unless it is stale or the name is in the cache already. This assumes that
+ * a lock has already been taken.
+ */
+static void dnscache_load_line(struct Curl_easy *data,
+                               struct Curl_dnscache *dnscache,
+                               const char *line, time_t now)
+{
+  /* Example line:
+     example.com 443 "20250101 10:00:00" 192.0.2.1 2001:db8::1
+   */
+  struct Curl_str host;
+  struct Curl_str date;
+  struct Curl_str ip;
+  curl_off_t port;
+  struct Curl_addrinfo *head = NULL;
+  struct Curl_addrinfo *tail = NULL;
+  struct Curl_dns_entry *dns;
+  char dbuf[MAX_DNS_CACHE_DATELEN + 1];
+  char ipbuf[MAX_IPADR_LEN];
+  char id[MAX_HOSTCACHE_LEN];
+  size_t idlen;
+  time_t stamp;
+
+  if(curlx_str_word(&line, &host, MAX_HOSTCACHE_LEN - 7) ||
+     curlx_str_singlespace(&line) ||
+     curlx_str_number(&line, &port, 0xffff) ||
+     curlx_str_singlespace(&line) ||
+     curlx_str_quotedword(&line, &date, MAX_DNS_CACHE_DATELEN))
+    return;
+
+  /* The date parser works on a null-terminated string. The maximum length
+     is upheld by curlx_str_quotedword(). */
+  memcpy(dbuf, curlx_str(&date), curlx_strlen(&date));
+  dbuf[curlx_strlen(&date)] = 0;
+  stamp = Curl_getdate_capped(dbuf);
+  if((stamp <= 0) || (stamp > now) ||
+     ((data->set.dns_cache_timeout != -1) &&
+      ((now - stamp) >= (time_t)data->set.dns_cache_timeout)))
+    return;
+
+  while(*line) {
+    struct Curl_addrinfo *ai;
+    if(curlx_str_singlespace(&line) ||
+       curlx_str_word(&line, &ip, sizeof(ipbuf) - 1))
+      goto fail;
+    memcpy(ipbuf, curlx_str(&ip), curlx_strlen(&ip));
+    ipbuf[curlx_strlen(&ip)] = 0;
+    ai = Curl_str2addr(ipbuf, (int)port);
+    if(!ai)
+      goto fail;
+    if(tail)
+      tail->ai_next = ai;
+    else
+      head = ai;
+    tail = ai;
+  }
+  if(!head)
+    return;
+
+  idlen = create_dnscache_id(curlx_str(&host), curlx_strlen(&host),
+                             (int)port, id, sizeof(id));
+  if(Curl_hash_pick(&dnscache->entries, id, idlen + 1))
+    goto fail;
+  dns = Curl_dnscache_mk_entry(data, head, curlx_str(&host),
+                               curlx_strlen(&host), (int)port, FALSE);
+  if(!dns)
+    return;
+  dns->timestamp = stamp;
+  if(!Curl_hash_add(&dnscache->entries, id, idlen + 1, dns))
+    dnscache_entry_free(dns);
+  return;
+fail:
+  Curl_freeaddrinfo(head);
+}
+
+void Curl_dnscache_loadfile(struct Curl_easy *data)
+{
+  struct Curl_dnscache *dnscache = dnscache_get(data);
+  const char *file = data->set.str[STRING_DNS_CACHE_FILE];
+
+  if(!dnscache || !file || !file[0] || !data->set.dns_cache_timeout)
+    return;
+
+  dnscache_lock(data, dnscache);
+  /* a cache is loaded from the first file set for it only */
+  if(!dnscache->filename) {
+    dnscache->filename = strdup(file);
+    if(dnscache->filename) {
+      FILE *fp = fopen(file, FOPEN_READTEXT);
+      if(fp) {
+        struct dynbuf buf;
+        time_t now = time(NULL);
+        curlx_dyn_init(&buf, MAX_DNS_CACHE_LINE);
+        while(Curl_get_line(&buf, fp)) {
+          const char *lineptr;
+          /* the addresses at the end of the line are words up to a space */
+          if(curlx_dyn_setlen(&buf, curlx_dyn_len(&buf) - 1))
+            break;
+          lineptr = curlx_dyn_ptr(&buf);
+          curlx_str_passblanks(&lineptr);
+          if((*lineptr == '#') || !*lineptr)
+            continue;
+          dnscache_load_line(data, dnscache, lineptr, now);
+        }
+        curlx_dyn_free(&buf);
+        fclose(fp);
+        infof(data, "DNS cache loaded from %s", file);
+      }
+    }
+  }
+  dnscache_unlock(data, dnscache);
+}
+
+static CURLcode dnscache_out(struct Curl_dns_entry *dns, FILE *fp)
+{
+  struct Curl_addrinfo *ai;
+  struct tm stamp;
+  CURLcode result;
+
+  /* names from CURLOPT_RESOLVE and unix domain sockets are not saved */
+  if(!dns->timestamp || !dns->hostname[0])
+    return CURLE_OK;
+  result = Curl_gmtime(dns->timestamp, &stamp);
+  if(result)
+    return result;
+  fprintf(fp, "%s %d \"%d%02d%02d %02d:%02d:%02d\"",
+          dns->hostname, dns->hostport,
+          stamp.tm_year + 1900, stamp.tm_mon + 1, stamp.tm_mday,
+          stamp.tm_hour, stamp.tm_min, stamp.tm_sec);
+  for(ai = dns->addr; ai; ai = ai->ai_next) {
+    char buf[MAX_IPADR_LEN];
+    Curl_printable_address(ai, buf, sizeof(buf));
+    if(buf[0])
+      fprintf(fp, " %s", buf);
+  }
+  fputs("\n", fp);
+  return CURLE_OK;
+}
+
+CURLcode Curl_dnscache_save(struct Curl_easy *data,
+                            struct Curl_dnscache *dnscache)
+{
+  CURLcode result = CURLE_OK;
+
+  if(dnscache->filename && dnscache->dirty) {
+    char *tempstore = NULL;
+    FILE *out;
+
+    result = Curl_fopen(data, dnscache->filename, &out, &tempstore);
+    if(!result) {
+      struct Curl_hash_iterator iter;
+      struct Curl_hash_element *he;
+
+      fputs("# Your DNS cache.\n"
+            "# This file was generated by libcurl! Edit at your own risk.\n",
+            out);
+      Curl_hash_start_iterate(&dnscache->entries, &iter);
+      for(he = Curl_hash_next_element(&iter); he && !result;
+          he = Curl_hash_next_element(&iter))
+        result = dnscache_out(he->ptr, out);
+      fclose(out);
+      if(!result && tempstore && Curl_rename(tempstore, dnscache->filename))
+        result = CURLE_WRITE_ERROR;
+
+      if(result && tempstore)
+        unlink(tempstore);
+    }
+    free(tempstore);
+    if(!result)
+      dnscache->dirty = FALSE;
+  }
+  return result;
 }
 
 CURLcode Curl_loadhostpairs(struct Curl_easy *data)
@@ -1475,6 +2083,76 @@ fail:
 #endif
 
 #ifdef USE_CURL_ASYNC
+/*
+ * Check on the lookup of another transfer this one waits for. When that
+ * ends without leaving an outcome in the cache, start an own lookup.
+ */
+static CURLcode resolv_check_coalesced(struct Curl_easy *data,
+                                       struct Curl_dns_entry **dns)
+{
+  struct Curl_dnscache *dnscache = dnscache_get(data);
+  struct Curl_async *async = &data->state.async;
+  struct dnscache_pending *pending;
+  struct Curl_addrinfo *addr;
+  char id[MAX_HOSTCACHE_LEN];
+  size_t idlen;
+  char *hostname;
+  int respwait = 0;
+  bool failed;
+  bool waiting = FALSE;
+
+  if(!dnscache)
+    return CURLE_FAILED_INIT;
+  idlen = create_dnscache_id(async->hostname, 0, async->port,
+                             id, sizeof(id));
+  dnscache_lock(data, dnscache);
+  failed = dnscache_negative_get(data, dnscache, id, idlen,
+                                 async->ip_version);
+  if(!failed) {
+    pending = Curl_hash_pick(&dnscache->pending, id, idlen + 1);
+    waiting = pending && (pending->ip_version == async->ip_version);
+  }
+  dnscache_unlock(data, dnscache);
+
+  if(failed) {
+    Curl_resolv_pending_drop(data);
+    return Curl_resolver_error(data);
+  }
+  if(waiting) {
+    /* we are woken up when the lookup ends in our multi handle, poll with
+       exponential backoff up to 250ms in case it runs elsewhere */
+    async->wait_ms = async->wait_ms ? CURLMIN(async->wait_ms * 2, 250) : 1;
+    Curl_expire(data, async->wait_ms, EXPIRE_ASYNC_NAME);
+    return CURLE_OK;
+  }
+
+  infof(data, "Resolving %s on our own", async->hostname);
+  Curl_resolv_pending_drop(data);
+  /* the backends set the hostname anew */
+  hostname = async->hostname;
+  async->hostname = NULL;
+  addr = resolv_start(data, hostname, async->port, async->ip_version,
+                      async->allow_doh, &respwait);
+  if(addr) {
+    *dns = Curl_dnscache_mk_entry(data, addr, hostname, 0, async->port,
+                                  FALSE);
+    if(*dns && Curl_dnscache_add(data, *dns))
+      Curl_resolv_unlink(data, dns);
+    free(hostname);
+    if(!*dns)
+      return CURLE_OUT_OF_MEMORY;
+    show_resolve_info(data, *dns);
+    async->dns = *dns;
+    async->done = TRUE;
+    return CURLE_OK;
+  }
+  free(hostname);
+  if(!respwait)
+    return Curl_resolver_error(data);
+  Curl_dnscache_add_pending(data);
+  return Curl_resolv_check(data, dns);
+}
+
 CURLcode Curl_resolv_check(struct Curl_easy *data,
                            struct Curl_dns_entry **dns)
 {
@@ -1498,6 +2176,9 @@ CURLcode Curl_resolv_check(struct Curl_easy *data,
     return CURLE_OK;
   }
 
+  if(data->state.async.coalesced)
+    return resolv_check_coalesced(data, dns);
+
 #ifndef CURL_DISABLE_DOH
   if(data->conn->bits.doh) {
     result = Curl_doh_is_resolved(data, dns);
@@ -1507,6 +2188,14 @@ CURLcode Curl_resolv_check(struct Curl_easy *data,
   result = Curl_async_is_resolved(data, dns);
   if(*dns)
     show_resolve_info(data, *dns);
+  else if((result == CURLE_COULDNT_RESOLVE_HOST) ||
+          (result == CURLE_COULDNT_RESOLVE_PROXY))
+    Curl_dnscache_add_negative(data, data->state.async.hostname,
+                               data->state.async.port,
+                               data->state.async.ip_version);
+  if(*dns || result)
+    /* the transfers waiting for us find the outcome in the cache */
+    Curl_resolv_pending_drop(data);
   return result;
 }
 #endif
@@ -1515,6 +2204,9 @@ int Curl_resolv_getsock(struct Curl_easy *data,
                         curl_socket_t *socks)
 {
 #ifdef CURLRES_ASYNCH
+  if(data->state.async.coalesced)
+    /* waiting for another transfer, which wakes us up */
+    return GETSOCK_BLANK;
 #ifndef CURL_DISABLE_DOH
   if(data->conn->bits.doh)
     /* nothing to wait for during DoH resolve, those handles have their own
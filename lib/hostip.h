@@ -26,6 +26,7 @@
 
 #include "curl_setup.h"
 #include "hash.h"
+#include "llist.h"
 #include "curl_addrinfo.h"
 #include "curlx/timeval.h" /* for timediff_t */
 #include "asyn.h"
@@ -70,6 +71,13 @@ struct Curl_dns_entry {
   time_t timestamp;
   /* reference counter, entry is freed on reaching 0 */
   size_t refcount;
+#ifdef CURLRES_THREADED
+  /* background lookup replacing this entry before it expires */
+  struct async_thrdd_addr_ctx *refresh;
+  time_t refresh_retry; /* no new refresh before, after one failed */
+  unsigned int refresh_fails; /* refreshes failed in a row */
+  unsigned int hits; /* number of times the entry was found in the cache */
+#endif
   /* hostname port number that resolved to addr. */
   int hostport;
   /* hostname that resolved to addr. may be NULL (Unix domain sockets). */
@@ -78,6 +86,11 @@ struct Curl_dns_entry {
 
 struct Curl_dnscache {
   struct Curl_hash entries;
+  struct Curl_hash pending;  /* lookups in progress others may wait for */
+  struct Curl_hash negative; /* recently failed lookups */
+  struct Curl_llist negative_list; /* the failed lookups, oldest first */
+  char *filename; /* the file the cache was loaded from and is saved to */
+  BIT(dirty);     /* entries were added since the cache was last saved */
 };
 
 bool Curl_host_is_ipnum(const char *hostname);
@@ -130,6 +143,24 @@ void Curl_dnscache_destroy(struct Curl_dnscache *dns);
 /* prune old entries from the DNS cache */
 void Curl_dnscache_prune(struct Curl_easy *data);
 
+/* load the CURLOPT_DNS_CACHE_FILE into the DNS cache, once */
+void Curl_dnscache_loadfile(struct Curl_easy *data);
+
+/* save the DNS cache to its file, if it changed. Called when the owner of
+   the cache destroys it, no lock is taken. */
+CURLcode Curl_dnscache_save(struct Curl_easy *data,
+                            struct Curl_dnscache *dnscache);
+
+#ifdef USE_CURL_ASYNC
+/*
+ * Curl_resolv_pending_drop() is called when the async resolve of the
+ * transfer ends or is abandoned. When the transfer ran the lookup other
+ * transfers wait for, it is removed and the waiting ones are woken up.
+ * When the transfer waited for another one's lookup, it stops waiting.
+ */
+void Curl_resolv_pending_drop(struct Curl_easy *data);
+#endif
+
 /* IPv4 threadsafe resolve function used for synch and asynch builds */
 struct Curl_addrinfo *Curl_ipv4_resolve_r(const char *hostname, int port);
 
@@ -52,6 +52,9 @@
 #define MAX_HSTS_DATELEN 256
 #define UNLIMITED "unlimited"
 
+/* initial number of slots in the host index, it grows with the entries */
+#define HSTS_INDEX_SLOTS 63
+
 #if defined(DEBUGBUILD) || defined(UNITTESTS)
 /* to play well with debug builds, we can *set* a fixed time this will
    return */
@@ -72,38 +75,53 @@ static time_t hsts_debugtime(void *unused)
 #define time(x) hsts_debugtime(x)
 #endif
 
+static void hsts_free(struct stsentry *e)
+{
+  free(CURL_UNCONST(e->host));
+  free(e);
+}
+
+/* the index owns the entries */
+static void hsts_entry_dtor(void *entry)
+{
+  struct stsentry *sts = entry;
+  Curl_node_remove(&sts->node);
+  hsts_free(sts);
+}
+
 struct hsts *Curl_hsts_init(void)
 {
   struct hsts *h = calloc(1, sizeof(struct hsts));
   if(h) {
     Curl_llist_init(&h->list, NULL);
+    Curl_hash_init(&h->idx, HSTS_INDEX_SLOTS, Curl_hash_str,
+                   curlx_str_key_compare, hsts_entry_dtor);
   }
   return h;
 }
 
-static void hsts_free(struct stsentry *e)
-{
-  free(CURL_UNCONST(e->host));
-  free(e);
-}
-
 void Curl_hsts_cleanup(struct hsts **hp)
 {
   struct hsts *h = *hp;
   if(h) {
-    struct Curl_llist_node *e;
-    struct Curl_llist_node *n;
-    for(e = Curl_llist_head(&h->list); e; e = n) {
-      struct stsentry *sts = Curl_node_elem(e);
-      n = Curl_node_next(e);
-      hsts_free(sts);
-    }
+    Curl_hash_destroy(&h->idx);
     free(h->filename);
     free(h);
     *hp = NULL;
   }
 }
 
+/* remove the entry from the cache and free it */
+static void hsts_remove(struct hsts *h, struct stsentry *sts)
+{
+  char key[MAX_HSTS_HOSTLEN];
+  size_t klen = strlen(sts->host);
+
+  DEBUGASSERT(klen <= sizeof(key));
+  Curl_strntolower(key, sts->host, klen);
+  Curl_hash_delete(&h->idx, key, klen);
+}
+
 static CURLcode hsts_create(struct hsts *h,
                             const char *hostname,
                             size_t hlen,
@@ -116,9 +134,24 @@ static CURLcode hsts_create(struct hsts *h,
   if(hlen && (hostname[hlen - 1] == '.'))
     /* strip off any trailing dot */
     --hlen;
+  if(hlen > MAX_HSTS_HOSTLEN)
+    /* a name no lookup would match */
+    return CURLE_OK;
   if(hlen) {
+    char key[MAX_HSTS_HOSTLEN];
     char *duphost;
-    struct stsentry *sts = calloc(1, sizeof(struct stsentry));
+    struct stsentry *sts;
+
+    Curl_strntolower(key, hostname, hlen);
+    sts = Curl_hash_pick(&h->idx, key, hlen);
+    if(sts) {
+      /* a name is only kept once, update the present entry */
+      sts->expires = expires;
+      sts->includeSubDomains = subdomains;
+      return CURLE_OK;
+    }
+
+    sts = calloc(1, sizeof(struct stsentry));
     if(!sts)
       return CURLE_OUT_OF_MEMORY;
 
@@ -132,6 +165,13 @@ static CURLcode hsts_create(struct hsts *h,
     sts->expires = expires;
     sts->includeSubDomains = subdomains;
     Curl_llist_append(&h->list, sts, &sts->node);
+    if(!Curl_hash_add(&h->idx, key, hlen, sts)) {
+      hsts_entry_dtor(sts);
+      return CURLE_OUT_OF_MEMORY;
+    }
+    /* keep the chains short, a failure to grow only makes lookups slower */
+    if(Curl_hash_count(&h->idx) > (h->idx.slots * 2))
+      (void)Curl_hash_resize(&h->idx, (h->idx.slots * 4) + 1);
   }
   return CURLE_OK;
 }
@@ -210,10 +250,8 @@ CURLcode Curl_hsts_parse(struct hsts *h, const char *hostname,
   if(!expires) {
     /* remove the entry if present verbatim (without subdomain match) */
     sts = Curl_hsts(h, hostname, hlen, FALSE);
-    if(sts) {
-      Curl_node_remove(&sts->node);
-      hsts_free(sts);
-    }
+    if(sts)
+      hsts_remove(h, sts);
     return CURLE_OK;
   }
 
@@ -236,55 +274,58 @@ CURLcode Curl_hsts_parse(struct hsts *h, const char *hostname,
   return CURLE_OK;
 }
 
+/* Return the entry for the lowercase name, removing it when expired */
+static struct stsentry *hsts_pick(struct hsts *h, const char *key,
+                                  size_t klen, time_t now)
+{
+  struct stsentry *sts = Curl_hash_pick(&h->idx, CURL_UNCONST(key), klen);
+  if(sts && (sts->expires <= now)) {
+    /* remove expired entries */
+    hsts_remove(h, sts);
+    sts = NULL;
+  }
+  return sts;
+}
+
 /*
  * Return TRUE if the given hostname is currently an HSTS one.
  *
  * The 'subdomain' argument tells the function if subdomain matching should be
- * attempted.
+ * attempted. The name itself and then its parent domains, longest first, are
+ * looked up in the index, so the cost does not depend on the number of
+ * entries.
  */
 struct stsentry *Curl_hsts(struct hsts *h, const char *hostname,
                            size_t hlen, bool subdomain)
 {
-  struct stsentry *bestsub = NULL;
   if(h) {
     time_t now = time(NULL);
-    struct Curl_llist_node *e;
-    struct Curl_llist_node *n;
-    size_t blen = 0;
+    char key[MAX_HSTS_HOSTLEN];
+    struct stsentry *sts;
+    size_t offs;
 
     if((hlen > MAX_HSTS_HOSTLEN) || !hlen)
       return NULL;
     if(hostname[hlen-1] == '.')
       /* remove the trailing dot */
       --hlen;
+    if(!hlen)
+      return NULL;
 
-    for(e = Curl_llist_head(&h->list); e; e = n) {
-      struct stsentry *sts = Curl_node_elem(e);
-      size_t ntail;
-      n = Curl_node_next(e);
-      if(sts->expires <= now) {
-        /* remove expired entries */
-        Curl_node_remove(&sts->node);
-        hsts_free(sts);
-        continue;
-      }
-      ntail = strlen(sts->host);
-      if((subdomain && sts->includeSubDomains) && (ntail < hlen)) {
-        size_t offs = hlen - ntail;
-        if((hostname[offs-1] == '.') &&
-           strncasecompare(&hostname[offs], sts->host, ntail) &&
-           (ntail > blen)) {
-          /* save the tail match with the longest tail */
-          bestsub = sts;
-          blen = ntail;
-        }
+    Curl_strntolower(key, hostname, hlen);
+    sts = hsts_pick(h, key, hlen, now);
+    if(sts || !subdomain)
+      return sts;
+
+    for(offs = 0; offs + 1 < hlen; offs++) {
+      if(key[offs] == '.') {
+        sts = hsts_pick(h, &key[offs + 1], hlen - offs - 1, now);
+        if(sts && sts->includeSubDomains)
+          return sts;
       }
-      /* avoid strcasecompare because the host name is not null-terminated */
-      if((hlen == ntail) && strncasecompare(hostname, sts->host, hlen))
-        return sts;
     }
   }
-  return bestsub;
+  return NULL;
 }
 
 /*
@@ -360,6 +401,14 @@ CURLcode Curl_hsts_save(struct Curl_easy *data, struct hsts *h,
     /* no cache activated */
     return CURLE_OK;
 
+  /* lookups only remove the expired entries they run into */
+  for(e = Curl_llist_head(&h->list); e; e = n) {
+    struct stsentry *sts = Curl_node_elem(e);
+    n = Curl_node_next(e);
+    if(sts->expires <= time(NULL))
+      hsts_remove(h, sts);
+  }
+
   /* if no new name is given, use the one we stored from the load */
   if(!file && h->filename)
     file = h->filename;
@@ -28,6 +28,7 @@
 #if !defined(CURL_DISABLE_HTTP) && !defined(CURL_DISABLE_HSTS)
 #include <curl/curl.h>
 #include "llist.h"
+#include "hash.h"
 
 #if defined(DEBUGBUILD) || defined(UNITTESTS)
 extern time_t deltatime;
@@ -42,7 +43,8 @@ struct stsentry {
 
 /* The HSTS cache. Needs to be able to tailmatch hostnames. */
 struct hsts {
-  struct Curl_llist list;
+  struct Curl_llist list; /* the entries, in the order they were added */
+  struct Curl_hash idx;   /* the entries by lowercase hostname */
   char *filename;
   unsigned int flags;
 };
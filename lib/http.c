@@ -77,6 +77,7 @@
 #include "content_encoding.h"
 #include "http_proxy.h"
 #include "curlx/warnless.h"
+#include "http1.h"
 #include "http2.h"
 #include "cfilters.h"
 #include "connect.h"
@@ -104,7 +105,7 @@ static bool http_exp100_is_selected(struct Curl_easy *data);
 static void http_exp100_got100(struct Curl_easy *data);
 static CURLcode http_firstwrite(struct Curl_easy *data);
 static CURLcode http_header(struct Curl_easy *data,
-                            const char *hd, size_t hdlen);
+                            const char *hd, size_t hdlen, size_t namelen);
 static CURLcode http_host(struct Curl_easy *data, struct connectdata *conn);
 static CURLcode http_range(struct Curl_easy *data,
                            Curl_HttpReq httpreq);
@@ -123,6 +124,19 @@ static CURLcode http_useragent(struct Curl_easy *data);
 #ifdef HAVE_LIBZ
 static CURLcode http_transferencode(struct Curl_easy *data);
 #endif
+UNITTEST CURLcode Curl_http_req_h2_make(struct http_req_h2 **ph2);
+UNITTEST CURLcode Curl_http_req_h2_start(struct http_req_h2 *h2,
+                                         struct Curl_easy *data,
+                                         const char *method,
+                                         const char *target, size_t tlen);
+UNITTEST CURLcode Curl_http_req_h2_field(struct http_req_h2 *h2,
+                                         const char *name, size_t namelen,
+                                         const char *value, size_t valuelen);
+UNITTEST CURLcode Curl_http_req_h2_lines(struct http_req_h2 *h2,
+                                         const char *buf, size_t len);
+UNITTEST CURLcode Curl_http_req_h2_done(struct http_req_h2 *h2,
+                                        struct Curl_easy *data,
+                                        size_t head_len);
 
 
 /*
@@ -1615,9 +1629,12 @@ static const char *get_http_string(int httpversion)
   }
 }
 
-CURLcode Curl_add_custom_headers(struct Curl_easy *data,
-                                 bool is_connect, int httpversion,
-                                 struct dynbuf *req)
+/* Add the custom headers to `req` and, when set, to the HTTP/2 and HTTP/3
+ * request headers `h2` */
+static CURLcode http_add_custom_headers(struct Curl_easy *data,
+                                        bool is_connect, int httpversion,
+                                        struct dynbuf *req,
+                                        struct http_req_h2 *h2)
 {
   struct curl_slist *h[2];
   struct curl_slist *headers;
@@ -1662,6 +1679,7 @@ CURLcode Curl_add_custom_headers(struct Curl_easy *data,
       CURLcode result = CURLE_OK;
       bool blankheader = FALSE;
       struct Curl_str name;
+      struct Curl_str val;
       const char *p = headers->data;
       const char *origp = p;
 
@@ -1671,13 +1689,14 @@ CURLcode Curl_add_custom_headers(struct Curl_easy *data,
       if(!curlx_str_until(&p, &name, MAX_HTTP_RESP_HEADER_SIZE, ';') &&
          !curlx_str_single(&p, ';') &&
          !curlx_str_single(&p, '\0') &&
-         !memchr(curlx_str(&name), ':', curlx_strlen(&name)))
+         !memchr(curlx_str(&name), ':', curlx_strlen(&name))) {
         blankheader = TRUE;
+        curlx_str_init(&val);
+      }
       else {
         p = origp;
         if(!curlx_str_until(&p, &name, MAX_HTTP_RESP_HEADER_SIZE, ':') &&
            !curlx_str_single(&p, ':')) {
-          struct Curl_str val;
           curlx_str_untilnl(&p, &val, MAX_HTTP_RESP_HEADER_SIZE);
           curlx_str_trimblanks(&val);
           if(!curlx_strlen(&val))
@@ -1725,11 +1744,18 @@ CURLcode Curl_add_custom_headers(struct Curl_easy *data,
                  other hosts */
               !Curl_auth_allowed_to_host(data))
         ;
-      else if(blankheader)
-        result = curlx_dyn_addf(req, "%.*s:\r\n", (int)curlx_strlen(&name),
-                                curlx_str(&name));
-      else
-        result = curlx_dyn_addf(req, "%s\r\n", origp);
+      else {
+        if(blankheader)
+          result = curlx_dyn_addf(req, "%.*s:\r\n", (int)curlx_strlen(&name),
+                                  curlx_str(&name));
+        else
+          result = curlx_dyn_addf(req, "%s\r\n", origp);
+        if(!result && h2)
+          result = Curl_http_req_h2_field(h2, curlx_str(&name),
+                                          curlx_strlen(&name),
+                                          curlx_str(&val),
+                                          curlx_strlen(&val));
+      }
 
       if(result)
         return result;
@@ -1739,6 +1765,13 @@ CURLcode Curl_add_custom_headers(struct Curl_easy *data,
   return CURLE_OK;
 }
 
+CURLcode Curl_add_custom_headers(struct Curl_easy *data,
+                                 bool is_connect, int httpversion,
+                                 struct dynbuf *req)
+{
+  return http_add_custom_headers(data, is_connect, httpversion, req, NULL);
+}
+
 #ifndef CURL_DISABLE_PARSEDATE
 CURLcode Curl_add_timecondition(struct Curl_easy *data,
                                 struct dynbuf *req)
@@ -2654,6 +2687,17 @@ static CURLcode http_transferencode(struct Curl_easy *data)
 }
 #endif
 
+/* Add the header lines written to `req` from `offset` on to the HTTP/2
+ * and HTTP/3 request headers, if there are any */
+static CURLcode http_req_h2_lines(struct http_req_h2 *h2,
+                                  struct dynbuf *req, size_t offset)
+{
+  if(!h2)
+    return CURLE_OK;
+  return Curl_http_req_h2_lines(h2, curlx_dyn_ptr(req) + offset,
+                                curlx_dyn_len(req) - offset);
+}
+
 /*
  * Curl_http() gets called from the generic multi_do() function when an HTTP
  * request is to be performed. This creates and sends a properly constructed
@@ -2671,6 +2715,8 @@ CURLcode Curl_http(struct Curl_easy *data, bool *done)
   char *altused = NULL;
   const char *p_accept;      /* Accept: string */
   unsigned char httpversion;
+  struct http_req_h2 *h2 = NULL; /* headers for HTTP/2 and HTTP/3 */
+  size_t hds;
 
   /* Always consider the DO phase done after this function call, even if there
      may be parts of the request that are not yet sent, since we can deal with
@@ -2779,6 +2825,15 @@ CURLcode Curl_http(struct Curl_easy *data, bool *done)
   if(result)
     goto fail;
 
+  if(httpversion >= 20) {
+    /* the HTTP/2 and HTTP/3 filters send the headers collected here */
+    Curl_http_req_h2_free(data->req.h2req);
+    result = Curl_http_req_h2_make(&data->req.h2req);
+    if(result)
+      goto fail;
+    h2 = data->req.h2req;
+  }
+
   /* initialize a dynamic send-buffer */
   curlx_dyn_init(&req, DYN_HTTP_REQUEST);
 
@@ -2789,8 +2844,14 @@ CURLcode Curl_http(struct Curl_easy *data, bool *done)
   /* add the main request stuff */
   /* GET/HEAD/POST/PUT */
   result = curlx_dyn_addf(&req, "%s ", request);
-  if(!result)
+  if(!result) {
+    hds = curlx_dyn_len(&req);
     result = http_target(data, conn, &req);
+    if(!result && h2)
+      result = Curl_http_req_h2_start(h2, data, request,
+                                      curlx_dyn_ptr(&req) + hds,
+                                      curlx_dyn_len(&req) - hds);
+  }
   if(result) {
     curlx_dyn_free(&req);
     goto fail;
@@ -2806,58 +2867,61 @@ CURLcode Curl_http(struct Curl_easy *data, bool *done)
     }
   }
 #endif
-  result =
-    curlx_dyn_addf(&req,
-                   " HTTP/%s\r\n" /* HTTP version */
-                   "%s" /* host */
-                   "%s" /* proxyuserpwd */
-                   "%s" /* userpwd */
-                   "%s" /* range */
-                   "%s" /* user agent */
-                   "%s" /* accept */
-                   "%s" /* TE: */
-                   "%s" /* accept-encoding */
-                   "%s" /* referer */
-                   "%s" /* Proxy-Connection */
-                   "%s" /* transfer-encoding */
-                   "%s",/* Alt-Used */
-
-                   httpstring,
-                   (data->state.aptr.host ? data->state.aptr.host : ""),
+  result = curlx_dyn_addf(&req, " HTTP/%s\r\n", httpstring);
+  hds = curlx_dyn_len(&req);
+  if(!result)
+    result =
+      curlx_dyn_addf(&req,
+                     "%s" /* host */
+                     "%s" /* proxyuserpwd */
+                     "%s" /* userpwd */
+                     "%s" /* range */
+                     "%s" /* user agent */
+                     "%s" /* accept */
+                     "%s" /* TE: */
+                     "%s" /* accept-encoding */
+                     "%s" /* referer */
+                     "%s" /* Proxy-Connection */
+                     "%s" /* transfer-encoding */
+                     "%s",/* Alt-Used */
+
+                     (data->state.aptr.host ? data->state.aptr.host : ""),
 #ifndef CURL_DISABLE_PROXY
-                   data->state.aptr.proxyuserpwd ?
-                   data->state.aptr.proxyuserpwd : "",
+                     data->state.aptr.proxyuserpwd ?
+                     data->state.aptr.proxyuserpwd : "",
 #else
-                   "",
+                     "",
 #endif
-                   data->state.aptr.userpwd ? data->state.aptr.userpwd : "",
-                   (data->state.use_range && data->state.aptr.rangeline) ?
-                   data->state.aptr.rangeline : "",
-                   (data->set.str[STRING_USERAGENT] &&
-                    *data->set.str[STRING_USERAGENT] &&
-                    data->state.aptr.uagent) ?
-                   data->state.aptr.uagent : "",
-                   p_accept ? p_accept : "",
-                   data->state.aptr.te ? data->state.aptr.te : "",
-                   (data->set.str[STRING_ENCODING] &&
-                    *data->set.str[STRING_ENCODING] &&
-                    data->state.aptr.accept_encoding) ?
-                   data->state.aptr.accept_encoding : "",
-                   (data->state.referer && data->state.aptr.ref) ?
-                   data->state.aptr.ref : "" /* Referer: <data> */,
+                     data->state.aptr.userpwd ? data->state.aptr.userpwd : "",
+                     (data->state.use_range && data->state.aptr.rangeline) ?
+                     data->state.aptr.rangeline : "",
+                     (data->set.str[STRING_USERAGENT] &&
+                      *data->set.str[STRING_USERAGENT] &&
+                      data->state.aptr.uagent) ?
+                     data->state.aptr.uagent : "",
+                     p_accept ? p_accept : "",
+                     data->state.aptr.te ? data->state.aptr.te : "",
+                     (data->set.str[STRING_ENCODING] &&
+                      *data->set.str[STRING_ENCODING] &&
+                      data->state.aptr.accept_encoding) ?
+                     data->state.aptr.accept_encoding : "",
+                     (data->state.referer && data->state.aptr.ref) ?
+                     data->state.aptr.ref : "" /* Referer: <data> */,
 #ifndef CURL_DISABLE_PROXY
-                   (conn->bits.httpproxy &&
-                    !conn->bits.tunnel_proxy &&
-                    !Curl_checkheaders(data, STRCONST("Proxy-Connection")) &&
-                    !Curl_checkProxyheaders(data, conn,
-                                            STRCONST("Proxy-Connection"))) ?
-                   "Proxy-Connection: Keep-Alive\r\n":"",
+                     (conn->bits.httpproxy &&
+                      !conn->bits.tunnel_proxy &&
+                      !Curl_checkheaders(data, STRCONST("Proxy-Connection")) &&
+                      !Curl_checkProxyheaders(data, conn,
+                                              STRCONST("Proxy-Connection"))) ?
+                     "Proxy-Connection: Keep-Alive\r\n":"",
 #else
-                   "",
+                     "",
 #endif
-                   te,
-                   altused ? altused : ""
-      );
+                     te,
+                     altused ? altused : ""
+        );
+  if(!result)
+    result = http_req_h2_lines(h2, &req, hds);
 
   /* clear userpwd and proxyuserpwd to avoid reusing old credentials
    * from reused connections */
@@ -2884,6 +2948,7 @@ CURLcode Curl_http(struct Curl_easy *data, bool *done)
     }
   }
 
+  hds = curlx_dyn_len(&req);
   result = http_cookies(data, conn, &req);
 #ifndef CURL_DISABLE_WEBSOCKETS
   if(!result && conn->handler->protocol&(CURLPROTO_WS|CURLPROTO_WSS))
@@ -2892,11 +2957,19 @@ CURLcode Curl_http(struct Curl_easy *data, bool *done)
   if(!result)
     result = Curl_add_timecondition(data, &req);
   if(!result)
-    result = Curl_add_custom_headers(data, FALSE, httpversion, &req);
+    result = http_req_h2_lines(h2, &req, hds);
+  if(!result)
+    result = http_add_custom_headers(data, FALSE, httpversion, &req, h2);
 
   if(!result) {
     /* req_send takes ownership of the 'req' memory on success */
+    hds = curlx_dyn_len(&req);
     result = http_req_complete(data, &req, httpversion, httpreq);
+    if(!result && h2) {
+      result = http_req_h2_lines(h2, &req, hds);
+      if(!result)
+        result = Curl_http_req_h2_done(h2, data, curlx_dyn_len(&req));
+    }
     if(!result)
       result = Curl_req_send(data, &req, httpversion);
   }
@@ -2985,46 +3058,43 @@ checkprotoprefix(struct Curl_easy *data, struct connectdata *conn,
   return checkhttpprefix(data, s, len);
 }
 
-/* HTTP header has field name `n` (a string constant) */
-#define HD_IS(hd, hdlen, n) \
-  (((hdlen) >= (sizeof(n)-1)) && curl_strnequal((n), (hd), (sizeof(n)-1)))
-
-#define HD_VAL(hd, hdlen, n) \
-  ((((hdlen) >= (sizeof(n)-1)) && \
-    curl_strnequal((n), (hd), (sizeof(n)-1)))? (hd + (sizeof(n)-1)) : NULL)
-
-/* HTTP header has field name `n` (a string constant) and contains `v`
+/* HTTP header with field name `n` (a string constant) contains `v`
  * (a string constant) in its value(s) */
-#define HD_IS_AND_SAYS(hd, hdlen, n, v) \
-  (HD_IS(hd, hdlen, n) && \
-   ((hdlen) > ((sizeof(n)-1) + (sizeof(v)-1))) && \
+#define HD_SAYS(hd, hdlen, n, v) \
+  (((hdlen) > ((sizeof(n)-1) + (sizeof(v)-1))) && \
    Curl_compareheader(hd, STRCONST(n), STRCONST(v)))
 
 /*
- * http_header() parses a single response header.
+ * http_header() parses a single response header. `namelen` is the length of
+ * the field name, the offset of the first colon in the line.
  */
 static CURLcode http_header(struct Curl_easy *data,
-                            const char *hd, size_t hdlen)
+                            const char *hd, size_t hdlen, size_t namelen)
 {
   struct connectdata *conn = data->conn;
   CURLcode result;
   struct SingleRequest *k = &data->req;
-  const char *v;
+  const char *v = hd + hdlen;
+  enum h1_hd_id hdid = H1_HD_UNKNOWN;
 
-  switch(hd[0]) {
-  case 'a':
-  case 'A':
+  if(namelen < hdlen) {
+    hdid = Curl_h1_hd_id(hd, namelen);
+    /* the value starts right after the colon */
+    v = hd + namelen + 1;
+  }
+
+  switch(hdid) {
+  case H1_HD_ALT_SVC:
 #ifndef CURL_DISABLE_ALTSVC
-    v = (data->asi &&
-         (Curl_conn_is_ssl(data->conn, FIRSTSOCKET) ||
+    if(data->asi &&
+       (Curl_conn_is_ssl(data->conn, FIRSTSOCKET) ||
 #ifdef DEBUGBUILD
-          /* allow debug builds to circumvent the HTTPS restriction */
-          getenv("CURL_ALTSVC_HTTP")
+        /* allow debug builds to circumvent the HTTPS restriction */
+        getenv("CURL_ALTSVC_HTTP")
 #else
-          0
+        0
 #endif
-        )) ? HD_VAL(hd, hdlen, "Alt-Svc:") : NULL;
-    if(v) {
+         )) {
       /* the ALPN of the current request */
       enum alpnid id = (k->httpversion == 30) ? ALPN_h3 :
                          (k->httpversion == 20) ? ALPN_h2 : ALPN_h1;
@@ -3033,12 +3103,9 @@ static CURLcode http_header(struct Curl_easy *data,
     }
 #endif
     break;
-  case 'c':
-  case 'C':
+  case H1_HD_CONTENT_LENGTH:
     /* Check for Content-Length: header lines to get size */
-    v = (!k->http_bodyless && !data->set.ignorecl) ?
-      HD_VAL(hd, hdlen, "Content-Length:") : NULL;
-    if(v) {
+    if(!k->http_bodyless && !data->set.ignorecl) {
       curl_off_t contentlength;
       int offt = curlx_str_numblanks(&v, &contentlength);
 
@@ -3062,9 +3129,9 @@ static CURLcode http_header(struct Curl_easy *data,
       }
       return CURLE_OK;
     }
-    v = (!k->http_bodyless && data->set.str[STRING_ENCODING]) ?
-      HD_VAL(hd, hdlen, "Content-Encoding:") : NULL;
-    if(v) {
+    break;
+  case H1_HD_CONTENT_ENCODING:
+    if(!k->http_bodyless && data->set.str[STRING_ENCODING]) {
       /*
        * Process Content-Encoding. Look for the values: identity,
        * gzip, deflate, compress, x-gzip and x-compress. x-gzip and
@@ -3074,22 +3141,23 @@ static CURLcode http_header(struct Curl_easy *data,
        */
       return Curl_build_unencoding_stack(data, v, FALSE);
     }
+    break;
+  case H1_HD_CONTENT_TYPE: {
     /* check for Content-Type: header lines to get the MIME-type */
-    v = HD_VAL(hd, hdlen, "Content-Type:");
-    if(v) {
-      char *contenttype = Curl_copy_header_value(hd);
-      if(!contenttype)
-        return CURLE_OUT_OF_MEMORY;
-      if(!*contenttype)
-        /* ignore empty data */
-        free(contenttype);
-      else {
-        free(data->info.contenttype);
-        data->info.contenttype = contenttype;
-      }
-      return CURLE_OK;
+    char *contenttype = Curl_copy_header_value(hd);
+    if(!contenttype)
+      return CURLE_OUT_OF_MEMORY;
+    if(!*contenttype)
+      /* ignore empty data */
+      free(contenttype);
+    else {
+      free(data->info.contenttype);
+      data->info.contenttype = contenttype;
     }
-    if(HD_IS_AND_SAYS(hd, hdlen, "Connection:", "close")) {
+    return CURLE_OK;
+  }
+  case H1_HD_CONNECTION:
+    if(HD_SAYS(hd, hdlen, "Connection:", "close")) {
       /*
        * [RFC 2616, section 8.1.2.1]
        * "Connection: close" is HTTP/1.1 language and means that
@@ -3100,7 +3168,7 @@ static CURLcode http_header(struct Curl_easy *data,
       return CURLE_OK;
     }
     if((k->httpversion == 10) &&
-       HD_IS_AND_SAYS(hd, hdlen, "Connection:", "keep-alive")) {
+       HD_SAYS(hd, hdlen, "Connection:", "keep-alive")) {
       /*
        * An HTTP/1.0 reply with the 'Connection: keep-alive' line
        * tells us the connection will be kept alive for our
@@ -3111,8 +3179,9 @@ static CURLcode http_header(struct Curl_easy *data,
       infof(data, "HTTP/1.0 connection set to keep alive");
       return CURLE_OK;
     }
-    v = !k->http_bodyless ? HD_VAL(hd, hdlen, "Content-Range:") : NULL;
-    if(v) {
+    break;
+  case H1_HD_CONTENT_RANGE:
+    if(!k->http_bodyless) {
       /* Content-Range: bytes [num]-
          Content-Range: bytes: [num]-
          Content-Range: [num]-
@@ -3141,20 +3210,18 @@ static CURLcode http_header(struct Curl_easy *data,
         data->state.resume_from = 0; /* get everything */
     }
     break;
-  case 'l':
-  case 'L':
-    v = (!k->http_bodyless &&
-         (data->set.timecondition || data->set.get_filetime)) ?
-        HD_VAL(hd, hdlen, "Last-Modified:") : NULL;
-    if(v) {
+  case H1_HD_LAST_MODIFIED:
+    if(!k->http_bodyless &&
+       (data->set.timecondition || data->set.get_filetime)) {
       k->timeofdoc = Curl_getdate_capped(v);
       if(data->set.get_filetime)
         data->info.filetime = k->timeofdoc;
       return CURLE_OK;
     }
+    break;
+  case H1_HD_LOCATION:
     if((k->httpcode >= 300 && k->httpcode < 400) &&
-            HD_IS(hd, hdlen, "Location:") &&
-            !data->req.location) {
+       !data->req.location) {
       /* this is the URL that the server advises us to use instead */
       char *location = Curl_copy_header_value(hd);
       if(!location)
@@ -3183,35 +3250,34 @@ static CURLcode http_header(struct Curl_easy *data,
       }
     }
     break;
-  case 'p':
-  case 'P':
+  case H1_HD_PROXY_CONNECTION:
 #ifndef CURL_DISABLE_PROXY
-    v = HD_VAL(hd, hdlen, "Proxy-Connection:");
-    if(v) {
-      if((k->httpversion == 10) && conn->bits.httpproxy &&
-         HD_IS_AND_SAYS(hd, hdlen, "Proxy-Connection:", "keep-alive")) {
-        /*
-         * When an HTTP/1.0 reply comes when using a proxy, the
-         * 'Proxy-Connection: keep-alive' line tells us the
-         * connection will be kept alive for our pleasure.
-         * Default action for 1.0 is to close.
-         */
-        connkeep(conn, "Proxy-Connection keep-alive"); /* do not close */
-        infof(data, "HTTP/1.0 proxy connection set to keep alive");
-      }
-      else if((k->httpversion == 11) && conn->bits.httpproxy &&
-              HD_IS_AND_SAYS(hd, hdlen, "Proxy-Connection:", "close")) {
-        /*
-         * We get an HTTP/1.1 response from a proxy and it says it will
-         * close down after this transfer.
-         */
-        connclose(conn, "Proxy-Connection: asked to close after done");
-        infof(data, "HTTP/1.1 proxy connection set close");
-      }
-      return CURLE_OK;
+    if((k->httpversion == 10) && conn->bits.httpproxy &&
+       HD_SAYS(hd, hdlen, "Proxy-Connection:", "keep-alive")) {
+      /*
+       * When an HTTP/1.0 reply comes when using a proxy, the
+       * 'Proxy-Connection: keep-alive' line tells us the
+       * connection will be kept alive for our pleasure.
+       * Default action for 1.0 is to close.
+       */
+      connkeep(conn, "Proxy-Connection keep-alive"); /* do not close */
+      infof(data, "HTTP/1.0 proxy connection set to keep alive");
     }
+    else if((k->httpversion == 11) && conn->bits.httpproxy &&
+            HD_SAYS(hd, hdlen, "Proxy-Connection:", "close")) {
+      /*
+       * We get an HTTP/1.1 response from a proxy and it says it will
+       * close down after this transfer.
+       */
+      connclose(conn, "Proxy-Connection: asked to close after done");
+      infof(data, "HTTP/1.1 proxy connection set close");
+    }
+    return CURLE_OK;
+#else
+    break;
 #endif
-    if((407 == k->httpcode) && HD_IS(hd, hdlen, "Proxy-authenticate:")) {
+  case H1_HD_PROXY_AUTHENTICATE:
+    if(407 == k->httpcode) {
       char *auth = Curl_copy_header_value(hd);
       if(!auth)
         return CURLE_OUT_OF_MEMORY;
@@ -3219,8 +3285,10 @@ static CURLcode http_header(struct Curl_easy *data,
       free(auth);
       return result;
     }
+    break;
+  case H1_HD_PERSISTENT_AUTH:
 #ifdef USE_SPNEGO
-    if(HD_IS(hd, hdlen, "Persistent-Auth:")) {
+    {
       struct negotiatedata *negdata = &conn->negotiate;
       struct auth *authp = &data->state.authhost;
       if(authp->picked == CURLAUTH_NEGOTIATE) {
@@ -3236,42 +3304,35 @@ static CURLcode http_header(struct Curl_easy *data,
     }
 #endif
     break;
-  case 'r':
-  case 'R':
-    v = HD_VAL(hd, hdlen, "Retry-After:");
-    if(v) {
-      /* Retry-After = HTTP-date / delay-seconds */
-      curl_off_t retry_after = 0; /* zero for unknown or "now" */
-      time_t date;
-      curlx_str_passblanks(&v);
-
-      /* try it as a date first, because a date can otherwise start with and
-         get treated as a number */
-      date = Curl_getdate_capped(v);
-
-      if((time_t)-1 != date) {
-        time_t current = time(NULL);
-        if(date >= current)
-          /* convert date to number of seconds into the future */
-          retry_after = date - current;
-      }
-      else
-        /* Try it as a decimal number */
-        curlx_str_number(&v, &retry_after, CURL_OFF_T_MAX);
-      /* limit to 6 hours max. this is not documented so that it can be changed
-         in the future if necessary. */
-      if(retry_after > 21600)
-        retry_after = 21600;
-      data->info.retry_after = retry_after;
-      return CURLE_OK;
+  case H1_HD_RETRY_AFTER: {
+    /* Retry-After = HTTP-date / delay-seconds */
+    curl_off_t retry_after = 0; /* zero for unknown or "now" */
+    time_t date;
+    curlx_str_passblanks(&v);
+
+    /* try it as a date first, because a date can otherwise start with and
+       get treated as a number */
+    date = Curl_getdate_capped(v);
+
+    if((time_t)-1 != date) {
+      time_t current = time(NULL);
+      if(date >= current)
+        /* convert date to number of seconds into the future */
+        retry_after = date - current;
     }
-    break;
-  case 's':
-  case 'S':
+    else
+      /* Try it as a decimal number */
+      curlx_str_number(&v, &retry_after, CURL_OFF_T_MAX);
+    /* limit to 6 hours max. this is not documented so that it can be changed
+       in the future if necessary. */
+    if(retry_after > 21600)
+      retry_after = 21600;
+    data->info.retry_after = retry_after;
+    return CURLE_OK;
+  }
+  case H1_HD_SET_COOKIE:
 #if !defined(CURL_DISABLE_COOKIES)
-    v = (data->cookies && data->state.cookie_engine) ?
-        HD_VAL(hd, hdlen, "Set-Cookie:") : NULL;
-    if(v) {
+    if(data->cookies && data->state.cookie_engine) {
       /* If there is a custom-set Host: name, use it here, or else use
        * real peer hostname. */
       const char *host = data->state.aptr.cookiehost ?
@@ -3290,19 +3351,19 @@ static CURLcode http_header(struct Curl_easy *data,
       return CURLE_OK;
     }
 #endif
+    break;
+  case H1_HD_STRICT_TRANSPORT_SECURITY:
 #ifndef CURL_DISABLE_HSTS
     /* If enabled, the header is incoming and this is over HTTPS */
-    v = (data->hsts &&
-         (Curl_conn_is_ssl(conn, FIRSTSOCKET) ||
+    if(data->hsts &&
+       (Curl_conn_is_ssl(conn, FIRSTSOCKET) ||
 #ifdef DEBUGBUILD
-           /* allow debug builds to circumvent the HTTPS restriction */
-           getenv("CURL_HSTS_HTTP")
+        /* allow debug builds to circumvent the HTTPS restriction */
+        getenv("CURL_HSTS_HTTP")
 #else
-           0
+        0
 #endif
-            )
-        ) ? HD_VAL(hd, hdlen, "Strict-Transport-Security:") : NULL;
-    if(v) {
+         )) {
       CURLcode check =
         Curl_hsts_parse(data->hsts, conn->host.name, v);
       if(check)
@@ -3315,8 +3376,7 @@ static CURLcode http_header(struct Curl_easy *data,
     }
 #endif
     break;
-  case 't':
-  case 'T':
+  case H1_HD_TRANSFER_ENCODING:
     /* RFC 9112, ch. 6.1
      * "Transfer-Encoding MAY be sent in a response to a HEAD request or
      *  in a 304 (Not Modified) response (Section 15.4.5 of [HTTP]) to a
@@ -3327,11 +3387,9 @@ static CURLcode http_header(struct Curl_easy *data,
      * Read: in these cases the 'Transfer-Encoding' does not apply
      * to any data following the response headers. Do not add any decoders.
      */
-    v = (!k->http_bodyless &&
-         (data->state.httpreq != HTTPREQ_HEAD) &&
-         (k->httpcode != 304)) ?
-      HD_VAL(hd, hdlen, "Transfer-Encoding:") : NULL;
-    if(v) {
+    if(!k->http_bodyless &&
+       (data->state.httpreq != HTTPREQ_HEAD) &&
+       (k->httpcode != 304)) {
       /* One or more encodings. We check for chunked and/or a compression
          algorithm. */
       result = Curl_build_unencoding_stack(data, v, TRUE);
@@ -3346,15 +3404,12 @@ static CURLcode http_header(struct Curl_easy *data,
       }
       return CURLE_OK;
     }
-    v = HD_VAL(hd, hdlen, "Trailer:");
-    if(v) {
-      data->req.resp_trailer = TRUE;
-      return CURLE_OK;
-    }
     break;
-  case 'w':
-  case 'W':
-    if((401 == k->httpcode) && HD_IS(hd, hdlen, "WWW-Authenticate:")) {
+  case H1_HD_TRAILER:
+    data->req.resp_trailer = TRUE;
+    return CURLE_OK;
+  case H1_HD_WWW_AUTHENTICATE:
+    if(401 == k->httpcode) {
       char *auth = Curl_copy_header_value(hd);
       if(!auth)
         return CURLE_OUT_OF_MEMORY;
@@ -3363,6 +3418,8 @@ static CURLcode http_header(struct Curl_easy *data,
       return result;
     }
     break;
+  default:
+    break;
   }
 
   if(conn->handler->protocol & CURLPROTO_RTSP) {
@@ -3494,11 +3551,14 @@ static CURLcode http_size(struct Curl_easy *data)
 }
 
 static CURLcode verify_header(struct Curl_easy *data,
-                              const char *hd, size_t hdlen)
+                              const char *hd, size_t hdlen,
+                              size_t *pnamelen)
 {
   struct SingleRequest *k = &data->req;
-  char *ptr = memchr(hd, 0x00, hdlen);
-  if(ptr) {
+  bool nul;
+  /* one pass for the colon and any zero byte */
+  *pnamelen = Curl_h1_hd_scan(hd, hdlen, &nul);
+  if(nul) {
     /* this is bad, bail out */
     failf(data, "Nul byte in header");
     return CURLE_WEIRD_SERVER_REPLY;
@@ -3510,8 +3570,7 @@ static CURLcode verify_header(struct Curl_easy *data,
     /* line folding, cannot happen on line 2 */
     ;
   else {
-    ptr = memchr(hd, ':', hdlen);
-    if(!ptr) {
+    if(*pnamelen == hdlen) {
       /* this is bad, bail out */
       failf(data, "Header without colon");
       return CURLE_WEIRD_SERVER_REPLY;
@@ -3864,6 +3923,7 @@ static CURLcode http_rw_hd(struct Curl_easy *data,
 {
   CURLcode result = CURLE_OK;
   struct SingleRequest *k = &data->req;
+  size_t namelen;
   int writetype;
 
   *pconsumed = 0;
@@ -4000,11 +4060,11 @@ static CURLcode http_rw_hd(struct Curl_easy *data,
     }
   }
 
-  result = verify_header(data, hd, hdlen);
+  result = verify_header(data, hd, hdlen, &namelen);
   if(result)
     return result;
 
-  result = http_header(data, hd, hdlen);
+  result = http_header(data, hd, hdlen, namelen);
   if(result)
     return result;
 
@@ -4467,40 +4527,50 @@ static struct name_const H2_NON_FIELD[] = {
   { STRCONST("Transfer-Encoding") },
 };
 
-static bool h2_permissible_field(struct dynhds_entry *e)
+static bool h2_permissible_field(const char *name, size_t namelen)
 {
   size_t i;
   for(i = 0; i < CURL_ARRAYSIZE(H2_NON_FIELD); ++i) {
-    if(e->namelen < H2_NON_FIELD[i].namelen)
+    if(namelen < H2_NON_FIELD[i].namelen)
       return TRUE;
-    if(e->namelen == H2_NON_FIELD[i].namelen &&
-       strcasecompare(H2_NON_FIELD[i].name, e->name))
+    if(namelen == H2_NON_FIELD[i].namelen &&
+       strncasecompare(H2_NON_FIELD[i].name, name, namelen))
       return FALSE;
   }
   return TRUE;
 }
 
-static bool http_TE_has_token(const char *fvalue, const char *token)
+static bool http_TE_has_token(const char *fvalue, size_t flen,
+                              const char *token)
 {
-  while(*fvalue) {
-    struct Curl_str name;
+  const char *end = fvalue + flen;
+  size_t tlen = strlen(token);
+
+  while(fvalue < end) {
+    const char *name;
 
     /* skip to first token */
-    while(ISBLANK(*fvalue) || *fvalue == ',')
+    while(fvalue < end && (ISBLANK(*fvalue) || *fvalue == ','))
+      fvalue++;
+    name = fvalue;
+    while(fvalue < end && !ISBLANK(*fvalue) && (*fvalue != '\r') &&
+          (*fvalue != ';') && (*fvalue != ','))
       fvalue++;
-    if(curlx_str_cspn(&fvalue, &name, " \t\r;,"))
+    if(fvalue == name)
       return FALSE;
-    if(curlx_str_casecompare(&name, token))
+    if(((size_t)(fvalue - name) == tlen) &&
+       strncasecompare(name, token, tlen))
       return TRUE;
 
     /* skip any remainder after token, e.g. parameters with quoted strings */
-    while(*fvalue && *fvalue != ',') {
+    while(fvalue < end && *fvalue != ',') {
       if(*fvalue == '"') {
-        struct Curl_str qw;
         /* if we do not cleanly find a quoted word here, the header value
          * does not follow HTTP syntax and we reject */
-        if(curlx_str_quotedword(&fvalue, &qw, CURL_MAX_HTTP_HEADER))
+        const char *q = memchr(fvalue + 1, '"', end - fvalue - 1);
+        if(!q)
           return FALSE;
+        fvalue = q + 1;
       }
       else
         fvalue++;
@@ -4509,6 +4579,43 @@ static bool http_TE_has_token(const char *fvalue, const char *token)
   return FALSE;
 }
 
+/* Check if a request field is sent in HTTP/2 and HTTP/3 and with what
+ * value. "TE" is special in that it is only permissible when it has
+ * only value "trailers". RFC 9113 ch. 8.2.2 */
+static bool h2_field_value(const char *name, size_t namelen,
+                           const char **pvalue, size_t *pvaluelen)
+{
+  if(namelen == 2 && strncasecompare("TE", name, 2)) {
+    if(!http_TE_has_token(*pvalue, *pvaluelen, "trailers"))
+      return FALSE;
+    *pvalue = "trailers";
+    *pvaluelen = sizeof("trailers") - 1;
+    return TRUE;
+  }
+  return h2_permissible_field(name, namelen);
+}
+
+/* The :scheme for a request target that has none */
+static const char *h2_scheme_default(struct Curl_easy *data)
+{
+  const char *scheme = Curl_checkheaders(data,
+                                         STRCONST(HTTP_PSEUDO_SCHEME));
+  if(scheme) {
+    scheme += sizeof(HTTP_PSEUDO_SCHEME);
+    curlx_str_passblanks(&scheme);
+    infof(data, "set pseudo header %s to %s", HTTP_PSEUDO_SCHEME, scheme);
+    return scheme;
+  }
+  return Curl_conn_is_ssl(data->conn, FIRSTSOCKET) ? "https" : "http";
+}
+
+size_t Curl_http_prio_value(char *buf, size_t blen, int urgency)
+{
+  int len = msnprintf(buf, blen, "u=%d%s", urgency & 7,
+                      (urgency & CURLURGENCY_INCREMENTAL) ? ", i" : "");
+  return (len > 0) ? (size_t)len : 0;
+}
+
 CURLcode Curl_http_req_to_h2(struct dynhds *h2_headers,
                              struct httpreq *req, struct Curl_easy *data)
 {
@@ -4524,16 +4631,7 @@ CURLcode Curl_http_req_to_h2(struct dynhds *h2_headers,
     scheme = req->scheme;
   }
   else if(strcmp("CONNECT", req->method)) {
-    scheme = Curl_checkheaders(data, STRCONST(HTTP_PSEUDO_SCHEME));
-    if(scheme) {
-      scheme += sizeof(HTTP_PSEUDO_SCHEME);
-      curlx_str_passblanks(&scheme);
-      infof(data, "set pseudo header %s to %s", HTTP_PSEUDO_SCHEME, scheme);
-    }
-    else {
-      scheme = Curl_conn_is_ssl(data->conn, FIRSTSOCKET) ?
-        "https" : "http";
-    }
+    scheme = h2_scheme_default(data);
   }
 
   if(req->authority) {
@@ -4562,23 +4660,370 @@ CURLcode Curl_http_req_to_h2(struct dynhds *h2_headers,
                              req->path, strlen(req->path));
   }
   for(i = 0; !result && i < Curl_dynhds_count(&req->headers); ++i) {
+    const char *value;
+    size_t valuelen;
+
     e = Curl_dynhds_getn(&req->headers, i);
-    /* "TE" is special in that it is only permissible when it
-     * has only value "trailers". RFC 9113 ch. 8.2.2 */
-    if(e->namelen == 2 && strcasecompare("TE", e->name)) {
-      if(http_TE_has_token(e->value, "trailers"))
-        result = Curl_dynhds_add(h2_headers, e->name, e->namelen,
-                                 "trailers", sizeof("trailers") - 1);
-    }
-    else if(h2_permissible_field(e)) {
+    value = e->value;
+    valuelen = e->valuelen;
+    if(h2_field_value(e->name, e->namelen, &value, &valuelen))
       result = Curl_dynhds_add(h2_headers, e->name, e->namelen,
-                               e->value, e->valuelen);
+                               value, valuelen);
+  }
+#if defined(USE_HTTP2) || defined(USE_HTTP3)
+  /* RFC 9218 priority, unless the application sends its own */
+  if(!result && (data->set.priority.urgency >= 0) &&
+     strcmp("CONNECT", req->method) &&
+     !Curl_dynhds_get(&req->headers, STRCONST("Priority"))) {
+    char prio[16];
+    size_t plen = Curl_http_prio_value(prio, sizeof(prio),
+                                       data->set.priority.urgency);
+    result = Curl_dynhds_add(h2_headers, STRCONST("priority"), prio, plen);
+  }
+#endif
+
+  return result;
+}
+
+/* where a header name and value are in `http_req_h2.buf` */
+struct h2_span {
+  size_t name;
+  size_t namelen;
+  size_t value;
+  size_t valuelen;
+};
+
+/* indexes into `http_req_h2.pseudo`, in the order they are sent */
+#define H2_PSEUDO_METHOD     0
+#define H2_PSEUDO_SCHEME     1
+#define H2_PSEUDO_AUTHORITY  2
+#define H2_PSEUDO_PATH       3
+
+static const struct name_const H2_PSEUDO[] = {
+  { STRCONST(HTTP_PSEUDO_METHOD) },
+  { STRCONST(HTTP_PSEUDO_SCHEME) },
+  { STRCONST(HTTP_PSEUDO_AUTHORITY) },
+  { STRCONST(HTTP_PSEUDO_PATH) },
+};
+
+struct http_req_h2 {
+  struct dynbuf buf;        /* names and values of all headers */
+  struct h2_span pseudo[4]; /* pseudo header values, names are H2_PSEUDO */
+  struct h2_span *fields;   /* the request fields in send order */
+  size_t fields_len;
+  size_t fields_alloc;
+  size_t head_len;          /* HTTP/1 head bytes the filter has to skip */
+  unsigned char pseudo_set; /* bit per pseudo header that is present */
+  BIT(is_connect);          /* a CONNECT request */
+  BIT(has_prio);            /* request has a "Priority" field */
+  BIT(complete);            /* all headers are added */
+};
+
+#define H2_PSEUDO_IS_SET(h2, i)  ((h2)->pseudo_set & (1 << (i)))
+
+UNITTEST CURLcode Curl_http_req_h2_make(struct http_req_h2 **ph2)
+{
+  struct http_req_h2 *h2 = calloc(1, sizeof(*h2));
+
+  *ph2 = h2;
+  if(!h2)
+    return CURLE_OUT_OF_MEMORY;
+  curlx_dyn_init(&h2->buf, DYN_HTTP_REQUEST);
+  return CURLE_OK;
+}
+
+void Curl_http_req_h2_free(struct http_req_h2 *h2)
+{
+  if(h2) {
+    curlx_dyn_free(&h2->buf);
+    free(h2->fields);
+    free(h2);
+  }
+}
+
+static CURLcode h2_req_pseudo(struct http_req_h2 *h2, int i,
+                              const char *value, size_t valuelen)
+{
+  h2->pseudo[i].value = curlx_dyn_len(&h2->buf);
+  h2->pseudo[i].valuelen = valuelen;
+  h2->pseudo_set |= (unsigned char)(1 << i);
+  return curlx_dyn_addn(&h2->buf, value, valuelen);
+}
+
+static CURLcode h2_req_add(struct http_req_h2 *h2,
+                           const char *name, size_t namelen,
+                           const char *value, size_t valuelen)
+{
+  struct h2_span *span;
+  char *lname;
+  CURLcode result;
+
+  if(h2->fields_len >= h2->fields_alloc) {
+    size_t nalloc = h2->fields_alloc ? (h2->fields_alloc * 2) : 16;
+    struct h2_span *nfields = realloc(h2->fields,
+                                      nalloc * sizeof(struct h2_span));
+    if(!nfields)
+      return CURLE_OUT_OF_MEMORY;
+    h2->fields = nfields;
+    h2->fields_alloc = nalloc;
+  }
+  span = &h2->fields[h2->fields_len];
+  span->name = curlx_dyn_len(&h2->buf);
+  span->namelen = namelen;
+  result = curlx_dyn_addn(&h2->buf, name, namelen);
+  if(result)
+    return result;
+  lname = curlx_dyn_ptr(&h2->buf) + span->name;
+  Curl_strntolower(lname, lname, namelen);
+  span->value = curlx_dyn_len(&h2->buf);
+  span->valuelen = valuelen;
+  result = curlx_dyn_addn(&h2->buf, value, valuelen);
+  if(!result)
+    h2->fields_len++;
+  return result;
+}
+
+/* Add the pseudo headers from an absolute-form request target */
+static CURLcode h2_req_absolute(struct http_req_h2 *h2, const char *method,
+                                const char *target)
+{
+  struct httpreq *req = NULL;
+  CURLU *url = curl_url();
+  CURLcode result = CURLE_OUT_OF_MEMORY;
+
+  if(!url)
+    goto out;
+  if(curl_url_set(url, CURLUPART_URL, target,
+                  CURLU_NON_SUPPORT_SCHEME | CURLU_PATH_AS_IS |
+                  CURLU_NO_DEFAULT_PORT | CURLU_ALLOW_SPACE)) {
+    result = CURLE_URL_MALFORMAT;
+    goto out;
+  }
+  result = Curl_http_req_make2(&req, method, strlen(method), url, NULL);
+  if(!result && req->scheme)
+    result = h2_req_pseudo(h2, H2_PSEUDO_SCHEME, req->scheme,
+                           strlen(req->scheme));
+  if(!result && req->authority)
+    result = h2_req_pseudo(h2, H2_PSEUDO_AUTHORITY, req->authority,
+                           strlen(req->authority));
+  if(!result && req->path)
+    result = h2_req_pseudo(h2, H2_PSEUDO_PATH, req->path,
+                           strlen(req->path));
+out:
+  Curl_http_req_free(req);
+  curl_url_cleanup(url);
+  return result;
+}
+
+/*
+ * Curl_http_req_h2_start() adds the pseudo headers for the request
+ * `method` and `target`, the way the HTTP/1 request parser derives
+ * them from the request line.
+ *
+ * @unittest: 3231
+ */
+UNITTEST CURLcode Curl_http_req_h2_start(struct http_req_h2 *h2,
+                                         struct Curl_easy *data,
+                                         const char *method,
+                                         const char *target, size_t tlen)
+{
+  const char *scheme;
+  CURLcode result;
+
+  h2->is_connect = !strcmp("CONNECT", method);
+  result = h2_req_pseudo(h2, H2_PSEUDO_METHOD, method, strlen(method));
+  if(result)
+    return result;
+  if(!tlen)
+    return CURLE_URL_MALFORMAT;
+
+  /* The TARGET can be (rfc 9112, ch. 3.2):
+   * origin-form:     path + optional query
+   * absolute-form:   absolute URI
+   * authority-form:  host+port for CONNECT
+   * asterisk-form:   '*' for OPTIONS
+   */
+  if(tlen == 1 && target[0] == '*')
+    ; /* asterisk-form */
+  else if(h2->is_connect)
+    return h2_req_pseudo(h2, H2_PSEUDO_AUTHORITY, target, tlen);
+  else if(target[0] != '/') {
+    /* origin-form OR absolute-form */
+    char *tmp = Curl_memdup0(target, tlen);
+    if(!tmp)
+      return CURLE_OUT_OF_MEMORY;
+    if(Curl_is_absolute_url(tmp, NULL, 0, FALSE)) {
+      result = h2_req_absolute(h2, method, tmp);
+      free(tmp);
+      return result;
     }
+    free(tmp);
+  }
+
+  if(!h2->is_connect) {
+    scheme = h2_scheme_default(data);
+    result = h2_req_pseudo(h2, H2_PSEUDO_SCHEME, scheme, strlen(scheme));
+    if(result)
+      return result;
   }
+  return h2_req_pseudo(h2, H2_PSEUDO_PATH, target, tlen);
+}
 
+/*
+ * Curl_http_req_h2_field() adds a request header field. The first "Host"
+ * becomes the :authority, unless the target had one.
+ *
+ * @unittest: 3231
+ */
+UNITTEST CURLcode Curl_http_req_h2_field(struct http_req_h2 *h2,
+                                         const char *name, size_t namelen,
+                                         const char *value, size_t valuelen)
+{
+  if(!namelen)
+    return CURLE_OK;
+  if(namelen == 4 && strncasecompare("Host", name, 4)) {
+    if(!H2_PSEUDO_IS_SET(h2, H2_PSEUDO_AUTHORITY))
+      return h2_req_pseudo(h2, H2_PSEUDO_AUTHORITY, value, valuelen);
+    return CURLE_OK;
+  }
+  if(namelen == 8 && strncasecompare("Priority", name, 8))
+    h2->has_prio = TRUE;
+  if(!h2_field_value(name, namelen, &value, &valuelen))
+    return CURLE_OK;
+  return h2_req_add(h2, name, namelen, value, valuelen);
+}
+
+/*
+ * Curl_http_req_h2_lines() adds the "name: value" header lines in `buf`,
+ * up to an empty line or the end of `buf`.
+ *
+ * @unittest: 3231
+ */
+UNITTEST CURLcode Curl_http_req_h2_lines(struct http_req_h2 *h2,
+                                         const char *buf, size_t len)
+{
+  const char *end = buf + len;
+
+  while(buf < end) {
+    const char *eol = memchr(buf, '\n', end - buf);
+    const char *lend = eol ? eol : end;
+    const char *colon, *value, *vend;
+    CURLcode result;
+
+    vend = memchr(buf, '\r', lend - buf);
+    if(vend)
+      lend = vend;
+    if(lend == buf)
+      break; /* end of the head */
+    if(!ISBLANK(*buf)) {
+      colon = memchr(buf, ':', lend - buf);
+      if(!colon)
+        return CURLE_BAD_FUNCTION_ARGUMENT;
+      for(value = colon + 1; value < lend && ISBLANK(*value); ++value)
+        ;
+      result = Curl_http_req_h2_field(h2, buf, colon - buf,
+                                      value, lend - value);
+      if(result)
+        return result;
+    }
+    if(!eol)
+      break;
+    buf = eol + 1;
+  }
+  return CURLE_OK;
+}
+
+/*
+ * Curl_http_req_h2_done() completes the headers of a request whose
+ * HTTP/1 formatted head is `head_len` bytes long.
+ *
+ * @unittest: 3231
+ */
+UNITTEST CURLcode Curl_http_req_h2_done(struct http_req_h2 *h2,
+                                        struct Curl_easy *data,
+                                        size_t head_len)
+{
+  CURLcode result = CURLE_OK;
+
+#if defined(USE_HTTP2) || defined(USE_HTTP3)
+  /* RFC 9218 priority, unless the application sends its own */
+  if((data->set.priority.urgency >= 0) && !h2->is_connect &&
+     !h2->has_prio) {
+    char prio[16];
+    size_t plen = Curl_http_prio_value(prio, sizeof(prio),
+                                       data->set.priority.urgency);
+    result = h2_req_add(h2, STRCONST("priority"), prio, plen);
+  }
+#else
+  (void)data;
+#endif
+  h2->head_len = head_len;
+  h2->complete = !result;
   return result;
 }
 
+size_t Curl_http_req_h2_count(struct http_req_h2 *h2)
+{
+  size_t i, n = h2->fields_len;
+
+  for(i = 0; i < CURL_ARRAYSIZE(H2_PSEUDO); ++i) {
+    if(H2_PSEUDO_IS_SET(h2, i))
+      ++n;
+  }
+  return n;
+}
+
+bool Curl_http_req_h2_getn(struct http_req_h2 *h2, size_t n,
+                           struct http_req_h2_field *field)
+{
+  const char *buf = curlx_dyn_ptr(&h2->buf);
+  struct h2_span *span;
+  size_t i;
+
+  for(i = 0; i < CURL_ARRAYSIZE(H2_PSEUDO); ++i) {
+    if(H2_PSEUDO_IS_SET(h2, i)) {
+      if(!n) {
+        field->name = H2_PSEUDO[i].name;
+        field->namelen = H2_PSEUDO[i].namelen;
+        field->value = buf + h2->pseudo[i].value;
+        field->valuelen = h2->pseudo[i].valuelen;
+        return TRUE;
+      }
+      --n;
+    }
+  }
+  if(n >= h2->fields_len)
+    return FALSE;
+  span = &h2->fields[n];
+  field->name = buf + span->name;
+  field->namelen = span->namelen;
+  field->value = buf + span->value;
+  field->valuelen = span->valuelen;
+  return TRUE;
+}
+
+ssize_t Curl_http_req_h2_take(struct Curl_easy *data, size_t len,
+                              struct http_req_h2 **ph2, CURLcode *err)
+{
+  struct http_req_h2 *h2 = data->req.h2req;
+  size_t nskip;
+
+  *ph2 = NULL;
+  if(!h2 || !h2->complete) {
+    failf(data, "no HTTP/2 headers prepared for the request");
+    *err = CURLE_SEND_ERROR;
+    return -1;
+  }
+  nskip = CURLMIN(len, h2->head_len);
+  h2->head_len -= nskip;
+  if(!h2->head_len) {
+    data->req.h2req = NULL;
+    *ph2 = h2;
+  }
+  *err = CURLE_OK;
+  return (ssize_t)nskip;
+}
+
 CURLcode Curl_http_resp_make(struct http_resp **presp,
                              int status,
                              const char *description)
@@ -261,6 +261,8 @@ void Curl_http_req_free(struct httpreq *req);
  *   that as `authority` and remove "Host"
  * - removes and Connection header fields as defined in rfc9113 ch. 8.2.2
  * - lower-cases the header field names
+ * - adds a "priority" field when CURLOPT_STREAM_URGENCY is set and the
+ *   request has none
  *
  * @param h2_headers will contain the HTTP/2 headers on success
  * @param req        the request to transform
@@ -269,6 +271,47 @@ void Curl_http_req_free(struct httpreq *req);
 CURLcode Curl_http_req_to_h2(struct dynhds *h2_headers,
                              struct httpreq *req, struct Curl_easy *data);
 
+/**
+ * Write the RFC 9218 Priority field value for a CURLOPT_STREAM_URGENCY
+ * value into `buf`, like "u=1, i". Returns the length written.
+ */
+size_t Curl_http_prio_value(char *buf, size_t blen, int urgency);
+
+/**
+ * The HTTP/2 and HTTP/3 headers of a request, collected by Curl_http()
+ * while it writes the HTTP/1 formatted request. Pseudo headers come
+ * first, field names are lower-cased and the fields not permitted in
+ * HTTP/2 (rfc9113 ch. 8.2.2) are left out, as Curl_http_req_to_h2() does.
+ */
+struct http_req_h2;
+
+struct http_req_h2_field {
+  const char *name;
+  size_t namelen;
+  const char *value;
+  size_t valuelen;
+};
+
+void Curl_http_req_h2_free(struct http_req_h2 *h2);
+
+/* Number of headers, including the pseudo headers */
+size_t Curl_http_req_h2_count(struct http_req_h2 *h2);
+
+/* Get the header at index `n`. FALSE when `n` is out of range. */
+bool Curl_http_req_h2_getn(struct http_req_h2 *h2, size_t n,
+                           struct http_req_h2_field *field);
+
+/**
+ * Take the HTTP/2 or HTTP/3 headers of the request the transfer is
+ * sending. The HTTP/1 formatted request head is still passed to the
+ * connection filters, which skip it with this call.
+ * Returns the number of head bytes skipped from the `len` bytes to send,
+ * or -1 with `*err` set. `*ph2` is set once the complete head has been
+ * skipped and the caller then owns the headers.
+ */
+ssize_t Curl_http_req_h2_take(struct Curl_easy *data, size_t len,
+                              struct http_req_h2 **ph2, CURLcode *err);
+
 /**
  * All about a core HTTP response, excluding body and trailers
  */
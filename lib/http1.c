@@ -31,6 +31,16 @@
 #include "http.h"
 #include "http1.h"
 #include "urlapi-int.h"
+#include "uint-bset.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+  (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define H1_SCAN_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define H1_SCAN_NEON
+#endif
 
 /* The last 3 #include files should be in this order */
 #include "curl_printf.h"
@@ -40,6 +50,146 @@
 
 #define H1_MAX_URL_LEN   (8*1024)
 
+size_t Curl_h1_hd_scan(const char *hd, size_t hdlen, bool *pnul)
+{
+  size_t i = 0;
+#ifdef H1_SCAN_SSE2
+  const __m128i vcolon = _mm_set1_epi8(':');
+  const __m128i vzero = _mm_setzero_si128();
+  for(; i + 16 <= hdlen; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(const void *)&hd[i]);
+    unsigned int m = (unsigned int)_mm_movemask_epi8(
+      _mm_or_si128(_mm_cmpeq_epi8(v, vcolon), _mm_cmpeq_epi8(v, vzero)));
+    if(m) {
+      i += CURL_CTZ64(m);
+      break;
+    }
+  }
+#elif defined(H1_SCAN_NEON)
+  const uint8x16_t vcolon = vdupq_n_u8(':');
+  for(; i + 16 <= hdlen; i += 16) {
+    uint8x16_t v = vld1q_u8((const uint8_t *)&hd[i]);
+    uint8x16_t eq = vorrq_u8(vceqq_u8(v, vcolon), vceqzq_u8(v));
+    /* narrow the 0x00/0xff bytes to one nibble each */
+    curl_uint64_t m = vget_lane_u64(vreinterpret_u64_u8(
+      vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+    if(m) {
+      i += CURL_CTZ64(m) >> 2;
+      break;
+    }
+  }
+#endif
+  /* the tail, or all of it without vector support */
+  while((i < hdlen) && (hd[i] != ':') && hd[i])
+    i++;
+
+  if(i == hdlen) {
+    *pnul = FALSE;
+    return hdlen;
+  }
+  if(!hd[i]) {
+    *pnul = TRUE;
+    return hdlen;
+  }
+  /* found the colon, only zero bytes are of interest after it */
+  *pnul = !!memchr(&hd[i + 1], 0, hdlen - i - 1);
+  return i;
+}
+
+size_t Curl_h1_scan_crlf(const char *buf, size_t blen)
+{
+  size_t i = 0;
+#ifdef H1_SCAN_SSE2
+  const __m128i vcr = _mm_set1_epi8(0x0d);
+  const __m128i vlf = _mm_set1_epi8(0x0a);
+  for(; i + 16 <= blen; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(const void *)&buf[i]);
+    unsigned int m = (unsigned int)_mm_movemask_epi8(
+      _mm_or_si128(_mm_cmpeq_epi8(v, vcr), _mm_cmpeq_epi8(v, vlf)));
+    if(m)
+      return i + CURL_CTZ64(m);
+  }
+#elif defined(H1_SCAN_NEON)
+  const uint8x16_t vcr = vdupq_n_u8(0x0d);
+  const uint8x16_t vlf = vdupq_n_u8(0x0a);
+  for(; i + 16 <= blen; i += 16) {
+    uint8x16_t v = vld1q_u8((const uint8_t *)&buf[i]);
+    uint8x16_t eq = vorrq_u8(vceqq_u8(v, vcr), vceqq_u8(v, vlf));
+    curl_uint64_t m = vget_lane_u64(vreinterpret_u64_u8(
+      vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+    if(m)
+      return i + (CURL_CTZ64(m) >> 2);
+  }
+#endif
+  while((i < blen) && (buf[i] != 0x0d) && (buf[i] != 0x0a))
+    i++;
+  return i;
+}
+
+/* Known header names, placed at their H1_HD_HASH() slot. The hash is
+ * perfect for this set, a lookup is one hash and one compare. */
+#define H1_HD_HASH(n, nlen) \
+  ((2 * ((unsigned int)(nlen) + ((unsigned char)(n)[0] | 0x20)) + \
+    3 * ((unsigned char)(n)[(nlen) - 1] | 0x20)) & 31)
+
+#define H1_HD_MINLEN 7
+#define H1_HD_MAXLEN 25
+
+struct h1_hd_name {
+  const char *name;
+  size_t len;
+  enum h1_hd_id id;
+};
+
+#define H1_HD_NONE { NULL, 0, H1_HD_UNKNOWN }
+#define H1_HD(n, i) { n, sizeof(n) - 1, i }
+
+static const struct h1_hd_name h1_hd_names[32] = {
+  H1_HD_NONE,
+  H1_HD_NONE,
+  H1_HD_NONE,
+  H1_HD("Strict-Transport-Security", H1_HD_STRICT_TRANSPORT_SECURITY),
+  H1_HD("Connection", H1_HD_CONNECTION),
+  H1_HD_NONE,
+  H1_HD_NONE,
+  H1_HD_NONE,
+  H1_HD_NONE,
+  H1_HD("Set-Cookie", H1_HD_SET_COOKIE),
+  H1_HD("Proxy-Connection", H1_HD_PROXY_CONNECTION),
+  H1_HD_NONE,
+  H1_HD("Trailer", H1_HD_TRAILER),
+  H1_HD("Content-Type", H1_HD_CONTENT_TYPE),
+  H1_HD_NONE,
+  H1_HD("Content-Range", H1_HD_CONTENT_RANGE),
+  H1_HD("Retry-After", H1_HD_RETRY_AFTER),
+  H1_HD_NONE,
+  H1_HD("Location", H1_HD_LOCATION),
+  H1_HD("Proxy-Authenticate", H1_HD_PROXY_AUTHENTICATE),
+  H1_HD_NONE,
+  H1_HD_NONE,
+  H1_HD("Persistent-Auth", H1_HD_PERSISTENT_AUTH),
+  H1_HD_NONE,
+  H1_HD_NONE,
+  H1_HD("Alt-Svc", H1_HD_ALT_SVC),
+  H1_HD("Content-Length", H1_HD_CONTENT_LENGTH),
+  H1_HD("Content-Encoding", H1_HD_CONTENT_ENCODING),
+  H1_HD_NONE,
+  H1_HD("WWW-Authenticate", H1_HD_WWW_AUTHENTICATE),
+  H1_HD("Last-Modified", H1_HD_LAST_MODIFIED),
+  H1_HD("Transfer-Encoding", H1_HD_TRANSFER_ENCODING)
+};
+
+enum h1_hd_id Curl_h1_hd_id(const char *name, size_t namelen)
+{
+  const struct h1_hd_name *e;
+  if((namelen < H1_HD_MINLEN) || (namelen > H1_HD_MAXLEN))
+    return H1_HD_UNKNOWN;
+  e = &h1_hd_names[H1_HD_HASH(name, namelen)];
+  if((e->len == namelen) && curl_strnequal(e->name, name, namelen))
+    return e->id;
+  return H1_HD_UNKNOWN;
+}
+
 void Curl_h1_req_parse_init(struct h1_req_parser *parser, size_t max_line_len)
 {
   memset(parser, 0, sizeof(*parser));
@@ -59,5 +59,40 @@ CURLcode Curl_h1_req_dprint(const struct httpreq *req,
 CURLcode Curl_h1_req_write_head(struct httpreq *req, int http_minor,
                                 struct dynbuf *dbuf);
 
+/* Response header fields that libcurl acts on */
+enum h1_hd_id {
+  H1_HD_UNKNOWN,
+  H1_HD_ALT_SVC,
+  H1_HD_CONNECTION,
+  H1_HD_CONTENT_ENCODING,
+  H1_HD_CONTENT_LENGTH,
+  H1_HD_CONTENT_RANGE,
+  H1_HD_CONTENT_TYPE,
+  H1_HD_LAST_MODIFIED,
+  H1_HD_LOCATION,
+  H1_HD_PERSISTENT_AUTH,
+  H1_HD_PROXY_AUTHENTICATE,
+  H1_HD_PROXY_CONNECTION,
+  H1_HD_RETRY_AFTER,
+  H1_HD_SET_COOKIE,
+  H1_HD_STRICT_TRANSPORT_SECURITY,
+  H1_HD_TRAILER,
+  H1_HD_TRANSFER_ENCODING,
+  H1_HD_WWW_AUTHENTICATE
+};
+
+/* Scan the header line `hd` for its first colon and for zero bytes.
+ * Returns the offset of the first ':' or `hdlen` when there is none.
+ * Sets `*pnul` when the line contains a zero byte. */
+size_t Curl_h1_hd_scan(const char *hd, size_t hdlen, bool *pnul);
+
+/* Returns the offset of the first CR or LF in `buf` or `blen` when there
+ * is none. */
+size_t Curl_h1_scan_crlf(const char *buf, size_t blen);
+
+/* Identify the header field `name` of length `namelen`, the part of the
+ * line before its colon. Compares case insensitively. */
+enum h1_hd_id Curl_h1_hd_id(const char *name, size_t namelen);
+
 #endif /* !CURL_DISABLE_HTTP */
 #endif /* HEADER_CURL_HTTP1_H */
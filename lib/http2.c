@@ -28,7 +28,9 @@
 #include <stdint.h>
 #include <nghttp2/nghttp2.h>
 #include "urldata.h"
+#include "borrow.h"
 #include "bufq.h"
+#include "bufq_nocpy.h"
 #include "uint-hash.h"
 #include "http1.h"
 #include "http2.h"
@@ -65,16 +67,26 @@
 #define NGHTTP2_HAS_SET_LOCAL_WINDOW_SIZE 1
 #endif
 
+#if (NGHTTP2_VERSION_NUM >= 0x013100)
+#define NGHTTP2_HAS_PRIORITY_UPDATE 1
+#endif
+
 
 /* buffer dimensioning:
  * use 16K as chunk size, as that fits H2 DATA frames well */
 #define H2_CHUNK_SIZE           (16 * 1024)
+#if H2_CHUNK_SIZE < CF_SEND_IOV_COALESCE_MAX
+#error "a chunk of outbufq must hold a blocked vectored write"
+#endif
 /* connection window size */
 #define H2_CONN_WINDOW_SIZE     (10 * 1024 * 1024)
 /* on receiving from TLS, we prep for holding a full stream window */
 #define H2_NW_RECV_CHUNKS       (H2_CONN_WINDOW_SIZE / H2_CHUNK_SIZE)
-/* on send into TLS, we just want to accumulate small frames */
-#define H2_NW_SEND_CHUNKS       1
+/* on send into TLS, we just want to accumulate small frames, but an
+ * empty buffer always has room for a complete DATA frame */
+#define H2_NW_SEND_CHUNKS       2
+/* the most spans a DATA frame is written from, header included */
+#define H2_SEND_IOV_MAX         16
 /* this is how much we want "in flight" for a stream, unthrottled  */
 #define H2_STREAM_WINDOW_SIZE_MAX   (10 * 1024 * 1024)
 /* this is how much we want "in flight" for a stream, initially, IFF
@@ -84,16 +96,39 @@
 #else
 #define H2_STREAM_WINDOW_SIZE_INITIAL H2_STREAM_WINDOW_SIZE_MAX
 #endif
+/* The stream windows we grant follow the bandwidth-delay product (BDP) we
+ * measure for each stream, between these limits. Without a measurement,
+ * we start with H2_BDP_WINDOW_START. */
+#define H2_BDP_WINDOW_MIN       (128 * 1024)
+#define H2_BDP_WINDOW_START     (1024 * 1024)
+/* The connection window follows the BDP of the whole connection, starting
+ * at H2_BDP_CONN_WINDOW_START, between H2_BDP_WINDOW_START and
+ * HTTP2_HUGE_WINDOW_SIZE. */
+#define H2_BDP_CONN_WINDOW_START (4 * H2_BDP_WINDOW_START)
+/* time between two PINGs for measuring the BDP. It doubles with every
+ * measurement that changes no window, up to the maximum. */
+#define H2_BDP_PING_INTERVAL_MS     100
+#define H2_BDP_PING_INTERVAL_MAX_MS (10 * 1000)
+/* how long to wait before receiving again when the chunk pool refused
+ * the connection an input buffer */
+#define H2_IN_GATE_RETRY_MS     10
+/* opaque data of our measuring PINGs, only the first 8 bytes are used */
+#define H2_BDP_PING_DATA        "curl-bdp"
 /* keep smaller stream upload buffer (default h2 window size) to have
  * our progress bars and "upload done" reporting closer to reality */
-#define H2_STREAM_SEND_CHUNKS   ((64 * 1024) / H2_CHUNK_SIZE)
+#define H2_STREAM_SEND_MAX      (64 * 1024)
+/* stream upload buffers copy sends into chunks of `ctx->bufcp` and
+ * reference borrowed ones, with entries kept in segments of */
+#define H2_STREAM_NBUF_ENTRIES  16
 /* spare chunks we keep for a full window */
 #define H2_STREAM_POOL_SPARES   (H2_CONN_WINDOW_SIZE / H2_CHUNK_SIZE)
 
 /* We need to accommodate the max number of streams with their window sizes on
  * the overall connection. Streams might become PAUSED which will block their
  * received QUOTA in the connection window. If we run out of space, the server
- * is blocked from sending us any data. See #10988 for an issue with this. */
+ * is blocked from sending us any data. See #10988 for an issue with this.
+ * The connection window grows with what all streams receive in one round
+ * trip, up to this limit. */
 #define HTTP2_HUGE_WINDOW_SIZE (100 * H2_STREAM_WINDOW_SIZE_MAX)
 
 #define H2_SETTINGS_IV_LEN  3
@@ -126,14 +161,34 @@ static ssize_t populate_binsettings(uint8_t *binsettings,
                                        iv, ivlen);
 }
 
+/* Bandwidth-delay estimation of a connection. While DATA arrives, we send
+ * a PING and count the DATA bytes received, on the connection and on each
+ * stream, until its ACK comes back. That is what the server was able to
+ * send us in one round trip. When it filled most of a window, the window is
+ * what limits the transfer and we grow it. When only a small part of the
+ * window was used, we shrink it again. */
+struct h2_bdp {
+  struct curltime ping_sent;    /* when the running measurement started */
+  struct curltime last_sample;  /* when the last measurement ended */
+  curl_off_t nrcvd;             /* DATA bytes received since `ping_sent` */
+  timediff_t rtt_us;            /* smoothed round trip time */
+  timediff_t interval_ms;       /* time until the next measurement */
+  unsigned int seq;             /* number of the running measurement */
+  int32_t conn_win;             /* connection window we set */
+  BIT(ping_pending);            /* our PING awaits its ACK */
+};
+
 struct cf_h2_ctx {
   nghttp2_session *h2;
   /* The easy handle used in the current filter call, cleared at return */
   struct cf_call_data call_data;
 
   struct bufq inbufq;           /* network input */
+  struct curl_borrow *inborrow; /* network input for borrowing transfers */
   struct bufq outbufq;          /* network output */
-  struct bufc_pool stream_bufcp; /* spares for stream buffers */
+  struct bufc_pool stream_bufcp; /* spares, unless the multi's are used */
+  struct bufc_pool *bufcp;      /* pool for `inbufq` and `outbufq` */
+  struct bufq_nocpy_pool stream_nbufp; /* spares for stream upload queues */
   struct dynbuf scratch;        /* scratch buffer for temp use */
 
   struct uint_hash streams; /* hash of `data->mid` to `h2_stream_ctx` */
@@ -145,6 +200,7 @@ struct cf_h2_ctx {
 #ifdef DEBUGBUILD
   int32_t stream_win_max;       /* max h2 stream window size */
 #endif
+  struct h2_bdp bdp;            /* bandwidth-delay estimation */
   BIT(initialized);
   BIT(via_h1_upgrade);
   BIT(conn_closed);
@@ -152,6 +208,7 @@ struct cf_h2_ctx {
   BIT(sent_goaway);
   BIT(enable_push);
   BIT(nw_out_blocked);
+  BIT(in_gated);                /* pool refused a chunk for `inbufq` */
 };
 
 /* How to access `call_data` from a cf_h2 filter */
@@ -159,13 +216,30 @@ struct cf_h2_ctx {
 #define CF_CTX_CALL_DATA(cf)  \
   ((struct cf_h2_ctx *)(cf)->ctx)->call_data
 
+#ifdef DEBUGBUILD
+#define H2_STREAM_WIN_MAX(ctx)  ((ctx)->stream_win_max)
+#else
+#define H2_STREAM_WIN_MAX(ctx)  H2_STREAM_WINDOW_SIZE_MAX
+#endif
+
 static void h2_stream_hash_free(unsigned int id, void *stream);
 
-static void cf_h2_ctx_init(struct cf_h2_ctx *ctx, bool via_h1_upgrade)
-{
-  Curl_bufcp_init(&ctx->stream_bufcp, H2_CHUNK_SIZE, H2_STREAM_POOL_SPARES);
-  Curl_bufq_initp(&ctx->inbufq, &ctx->stream_bufcp, H2_NW_RECV_CHUNKS, 0);
-  Curl_bufq_initp(&ctx->outbufq, &ctx->stream_bufcp, H2_NW_SEND_CHUNKS, 0);
+static void cf_h2_ctx_init(struct cf_h2_ctx *ctx, struct Curl_easy *data,
+                           bool via_h1_upgrade)
+{
+  /* Use the chunks of the multi handle when we can. Memory is then
+   * shared with all other connections, instead of each connection
+   * keeping its own spares. */
+  ctx->bufcp = Curl_multi_bufcp(data);
+  if(!ctx->bufcp || (ctx->bufcp->chunk_size != H2_CHUNK_SIZE)) {
+    Curl_bufcp_init(&ctx->stream_bufcp, H2_CHUNK_SIZE,
+                    H2_STREAM_POOL_SPARES);
+    ctx->bufcp = &ctx->stream_bufcp;
+  }
+  Curl_bufq_initp(&ctx->inbufq, ctx->bufcp, H2_NW_RECV_CHUNKS, 0);
+  Curl_bufq_initp(&ctx->outbufq, ctx->bufcp, H2_NW_SEND_CHUNKS, 0);
+  Curl_bufq_nocpy_pool_init(&ctx->stream_nbufp, H2_STREAM_NBUF_ENTRIES,
+                            H2_STREAM_POOL_SPARES, ctx->bufcp);
   curlx_dyn_init(&ctx->scratch, CURL_MAX_HTTP_HEADER);
   Curl_uint_hash_init(&ctx->streams, 63, h2_stream_hash_free);
   ctx->remote_max_sid = 2147483647;
@@ -182,6 +256,7 @@ static void cf_h2_ctx_init(struct cf_h2_ctx *ctx, bool via_h1_upgrade)
     }
   }
 #endif
+  ctx->bdp.interval_ms = H2_BDP_PING_INTERVAL_MS;
   ctx->initialized = TRUE;
 }
 
@@ -189,10 +264,12 @@ static void cf_h2_ctx_free(struct cf_h2_ctx *ctx)
 {
   if(ctx && ctx->initialized) {
     Curl_bufq_free(&ctx->inbufq);
+    Curl_borrow_drop(ctx->inborrow);
     Curl_bufq_free(&ctx->outbufq);
-    Curl_bufcp_free(&ctx->stream_bufcp);
     curlx_dyn_free(&ctx->scratch);
     Curl_uint_hash_destroy(&ctx->streams);
+    Curl_bufq_nocpy_pool_free(&ctx->stream_nbufp);
+    Curl_bufcp_free(&ctx->stream_bufcp);
     memset(ctx, 0, sizeof(*ctx));
   }
   free(ctx);
@@ -212,11 +289,13 @@ static CURLcode h2_progress_egress(struct Curl_cfilter *cf,
  * All about the H2 internals of a stream
  */
 struct h2_stream_ctx {
-  struct bufq sendbuf; /* request buffer */
-  struct h1_req_parser h1; /* parsing the request */
+  struct bufq_nocpy sendbuf; /* request buffer */
   struct dynhds resp_trailers; /* response trailer fields */
   size_t resp_hds_len; /* amount of response header bytes in recvbuf */
   curl_off_t nrcvd_data;  /* number of DATA bytes received */
+  curl_off_t bdp_rcvd; /* DATA bytes received in measurement `bdp_seq` */
+  unsigned int bdp_seq; /* the BDP measurement `bdp_rcvd` belongs to */
+  int32_t bdp_win; /* the recv window we want to grant */
 
   char **push_headers;       /* allocated array */
   size_t push_headers_used;  /* number of entries filled in */
@@ -251,9 +330,9 @@ static struct h2_stream_ctx *h2_stream_ctx_create(struct cf_h2_ctx *ctx)
     return NULL;
 
   stream->id = -1;
-  Curl_bufq_initp(&stream->sendbuf, &ctx->stream_bufcp,
-                  H2_STREAM_SEND_CHUNKS, BUFQ_OPT_NONE);
-  Curl_h1_req_parse_init(&stream->h1, H1_PARSE_DEFAULT_MAX_LINE_LEN);
+  stream->bdp_win = CURLMIN(H2_BDP_WINDOW_START, H2_STREAM_WIN_MAX(ctx));
+  Curl_bufq_nocpy_init(&stream->sendbuf, &ctx->stream_nbufp,
+                       H2_STREAM_SEND_MAX, NULL);
   Curl_dynhds_init(&stream->resp_trailers, 0, DYN_HTTP_REQUEST);
   stream->bodystarted = FALSE;
   stream->status_code = -1;
@@ -276,8 +355,7 @@ static void free_push_headers(struct h2_stream_ctx *stream)
 
 static void h2_stream_ctx_free(struct h2_stream_ctx *stream)
 {
-  Curl_bufq_free(&stream->sendbuf);
-  Curl_h1_req_parse_free(&stream->h1);
+  Curl_bufq_nocpy_free(&stream->sendbuf);
   Curl_dynhds_free(&stream->resp_trailers);
   free_push_headers(stream);
   free(stream);
@@ -291,10 +369,9 @@ static void h2_stream_hash_free(unsigned int id, void *stream)
 }
 
 #ifdef NGHTTP2_HAS_SET_LOCAL_WINDOW_SIZE
-static int32_t cf_h2_get_desired_local_win(struct Curl_cfilter *cf,
-                                           struct Curl_easy *data)
+static int32_t cf_h2_get_desired_local_win(struct Curl_easy *data,
+                                           struct h2_stream_ctx *stream)
 {
-  (void)cf;
   if(data->set.max_recv_speed && data->set.max_recv_speed < INT32_MAX) {
     /* The transfer should only receive `max_recv_speed` bytes per second.
      * We restrict the stream's local window size, so that the server cannot
@@ -302,15 +379,8 @@ static int32_t cf_h2_get_desired_local_win(struct Curl_cfilter *cf,
      * This gets less precise the higher the latency. */
     return (int32_t)data->set.max_recv_speed;
   }
-#ifdef DEBUGBUILD
-  else {
-    struct cf_h2_ctx *ctx = cf->ctx;
-    CURL_TRC_CF(data, cf, "stream_win_max=%d", ctx->stream_win_max);
-    return ctx->stream_win_max;
-  }
-#else
-  return H2_STREAM_WINDOW_SIZE_MAX;
-#endif
+  else
+    return stream->bdp_win;
 }
 
 static CURLcode cf_h2_update_local_win(struct Curl_cfilter *cf,
@@ -322,7 +392,7 @@ static CURLcode cf_h2_update_local_win(struct Curl_cfilter *cf,
   int rv;
 
   dwsize = (stream->write_paused || stream->xfer_result) ?
-           0 : cf_h2_get_desired_local_win(cf, data);
+           0 : cf_h2_get_desired_local_win(data, stream);
   if(dwsize != stream->local_window_size) {
     int32_t wsize = nghttp2_session_get_stream_effective_local_window_size(
                       ctx->h2, stream->id);
@@ -374,6 +444,139 @@ static CURLcode cf_h2_update_local_win(struct Curl_cfilter *cf,
 }
 #endif /* !NGHTTP2_HAS_SET_LOCAL_WINDOW_SIZE */
 
+/* Set the connection window to `wsize`. */
+static CURLcode cf_h2_set_conn_win(struct Curl_cfilter *cf,
+                                   struct Curl_easy *data, int32_t wsize)
+{
+  struct cf_h2_ctx *ctx = cf->ctx;
+  int rv;
+
+  if(!ctx->h2 || (wsize == ctx->bdp.conn_win))
+    return CURLE_OK;
+
+  rv = nghttp2_session_set_local_window_size(ctx->h2, NGHTTP2_FLAG_NONE, 0,
+                                             wsize);
+  if(rv) {
+    failf(data, "nghttp2_session_set_local_window_size() failed: %s(%d)",
+          nghttp2_strerror(rv), rv);
+    return CURLE_HTTP2;
+  }
+  ctx->bdp.conn_win = wsize;
+  CURL_TRC_CF(data, cf, "[0] connection window now %d", ctx->bdp.conn_win);
+  return CURLE_OK;
+}
+
+/* The window for `nrcvd` bytes received in one round trip with `win`. */
+static int32_t h2_bdp_win(int32_t win, curl_off_t nrcvd,
+                          int32_t min, int32_t max)
+{
+  if((3 * nrcvd) >= (2 * (curl_off_t)win)) {
+    /* the server filled most of the window in one round trip */
+    if(nrcvd >= (max / 2))
+      win = max;
+    else
+      win = (int32_t)(2 * nrcvd);
+  }
+  else if((4 * nrcvd) < (curl_off_t)win) {
+    /* less than a quarter was used, give back half of it */
+    win = win / 2;
+  }
+  return CURLMIN(CURLMAX(win, min), max);
+}
+
+/* DATA of `len` bytes arrived for `stream`. Count it for the running
+ * measurement or start a new one, unless the last one is too recent. */
+static void h2_bdp_on_data(struct Curl_cfilter *cf,
+                           struct h2_stream_ctx *stream, size_t len)
+{
+  struct cf_h2_ctx *ctx = cf->ctx;
+  struct h2_bdp *bdp = &ctx->bdp;
+
+  if(!bdp->ping_pending) {
+    struct curltime now = curlx_now();
+    if(bdp->last_sample.tv_sec &&
+       curlx_timediff(now, bdp->last_sample) < bdp->interval_ms)
+      return;
+    /* failing to send the PING only means we do not measure this time */
+    if(nghttp2_submit_ping(ctx->h2, NGHTTP2_FLAG_NONE,
+                           (const uint8_t *)H2_BDP_PING_DATA))
+      return;
+    bdp->ping_pending = TRUE;
+    bdp->ping_sent = now;
+    bdp->nrcvd = 0;
+    bdp->seq++;
+  }
+  bdp->nrcvd += (curl_off_t)len;
+  if(stream->bdp_seq != bdp->seq) {
+    stream->bdp_seq = bdp->seq;
+    stream->bdp_rcvd = 0;
+  }
+  stream->bdp_rcvd += (curl_off_t)len;
+}
+
+struct h2_bdp_ack_ctx {
+  struct cf_h2_ctx *ctx;
+  unsigned int changed; /* number of streams with a new window */
+};
+
+static bool h2_bdp_stream_ack(unsigned int mid, void *val, void *user_data)
+{
+  struct h2_bdp_ack_ctx *actx = user_data;
+  struct cf_h2_ctx *ctx = actx->ctx;
+  struct h2_stream_ctx *stream = val;
+  curl_off_t nrcvd;
+  int32_t win;
+
+  (void)mid;
+  /* a stream without DATA in this round trip did not need its window */
+  nrcvd = (stream->bdp_seq == ctx->bdp.seq) ? stream->bdp_rcvd : 0;
+  win = h2_bdp_win(stream->bdp_win, nrcvd, H2_BDP_WINDOW_MIN,
+                   H2_STREAM_WIN_MAX(ctx));
+  if(win != stream->bdp_win) {
+    /* the stream picks up the new window when it receives DATA next */
+    stream->bdp_win = win;
+    actx->changed++;
+  }
+  return TRUE;
+}
+
+/* The ACK for our measuring PING arrived, adjust the windows. Once they
+ * no longer change, we measure less and less often. */
+static CURLcode h2_bdp_on_ack(struct Curl_cfilter *cf,
+                              struct Curl_easy *data)
+{
+  struct cf_h2_ctx *ctx = cf->ctx;
+  struct h2_bdp *bdp = &ctx->bdp;
+  struct h2_bdp_ack_ctx actx;
+  int32_t conn_win;
+  timediff_t rtt;
+
+  bdp->ping_pending = FALSE;
+  bdp->last_sample = curlx_now();
+  rtt = curlx_timediff_us(bdp->last_sample, bdp->ping_sent);
+  if(rtt <= 0)
+    rtt = 1;
+  bdp->rtt_us = bdp->rtt_us ? ((7 * bdp->rtt_us) + rtt) / 8 : rtt;
+
+  actx.ctx = ctx;
+  actx.changed = 0;
+  Curl_uint_hash_visit(&ctx->streams, h2_bdp_stream_ack, &actx);
+  conn_win = h2_bdp_win(bdp->conn_win, bdp->nrcvd, H2_BDP_WINDOW_START,
+                        HTTP2_HUGE_WINDOW_SIZE);
+
+  if(actx.changed || (conn_win != bdp->conn_win))
+    bdp->interval_ms = H2_BDP_PING_INTERVAL_MS;
+  else
+    bdp->interval_ms = CURLMIN(2 * bdp->interval_ms,
+                               H2_BDP_PING_INTERVAL_MAX_MS);
+  CURL_TRC_CF(data, cf, "[0] BDP: rtt=%" FMT_TIMEDIFF_T "us, rcvd=%"
+              FMT_OFF_T ", %u stream windows changed, next in %"
+              FMT_TIMEDIFF_T "ms", rtt, bdp->nrcvd, actx.changed,
+              bdp->interval_ms);
+  bdp->nrcvd = 0;
+  return cf_h2_set_conn_win(cf, data, conn_win);
+}
+
 /*
  * Mark this transfer to get "drained".
  */
@@ -386,7 +589,7 @@ static void drain_stream(struct Curl_cfilter *cf,
   (void)cf;
   bits = CURL_CSELECT_IN;
   if(!stream->closed &&
-     (!stream->body_eos || !Curl_bufq_is_empty(&stream->sendbuf)))
+     (!stream->body_eos || !Curl_bufq_nocpy_is_empty(&stream->sendbuf)))
     bits |= CURL_CSELECT_OUT;
   if(stream->closed || (data->state.select_bits != bits)) {
     CURL_TRC_CF(data, cf, "[%d] DRAIN select_bits=%x",
@@ -403,7 +606,6 @@ static CURLcode http2_data_setup(struct Curl_cfilter *cf,
   struct cf_h2_ctx *ctx = cf->ctx;
   struct h2_stream_ctx *stream;
 
-  (void)cf;
   DEBUGASSERT(data);
   stream = H2_STREAM_CTX(ctx, data);
   if(stream) {
@@ -510,6 +712,10 @@ static ssize_t nw_out_writer(void *writer_ctx,
 static ssize_t send_callback(nghttp2_session *h2,
                              const uint8_t *mem, size_t length, int flags,
                              void *userp);
+static int send_data_callback(nghttp2_session *session,
+                              nghttp2_frame *frame, const uint8_t *framehd,
+                              size_t length, nghttp2_data_source *source,
+                              void *userp);
 static int on_frame_recv(nghttp2_session *session, const nghttp2_frame *frame,
                          void *userp);
 static int cf_h2_on_invalid_frame_recv(nghttp2_session *session,
@@ -555,6 +761,7 @@ static CURLcode cf_h2_ctx_open(struct Curl_cfilter *cf,
   }
 
   nghttp2_session_callbacks_set_send_callback(cbs, send_callback);
+  nghttp2_session_callbacks_set_send_data_callback(cbs, send_data_callback);
   nghttp2_session_callbacks_set_on_frame_recv_callback(cbs, on_frame_recv);
   nghttp2_session_callbacks_set_on_invalid_frame_recv_callback(cbs,
     cf_h2_on_invalid_frame_recv);
@@ -633,14 +840,9 @@ static CURLcode cf_h2_ctx_open(struct Curl_cfilter *cf,
     }
   }
 
-  rc = nghttp2_session_set_local_window_size(ctx->h2, NGHTTP2_FLAG_NONE, 0,
-                                             HTTP2_HUGE_WINDOW_SIZE);
-  if(rc) {
-    failf(data, "nghttp2_session_set_local_window_size() failed: %s(%d)",
-          nghttp2_strerror(rc), rc);
-    result = CURLE_HTTP2;
+  result = cf_h2_set_conn_win(cf, data, H2_BDP_CONN_WINDOW_START);
+  if(result)
     goto out;
-  }
 
   /* all set, traffic will be send on connect */
   result = CURLE_OK;
@@ -705,6 +907,48 @@ static int h2_process_pending_input(struct Curl_cfilter *cf,
   return 0;
 }
 
+/*
+ * Receive network input into a borrow buffer and process it right away,
+ * so that DATA payloads reach CURLOPT_BORROWFUNCTION callbacks without
+ * being copied. Input nghttp2 does not process goes to `inbufq`.
+ */
+static ssize_t h2_recv_borrowed(struct Curl_cfilter *cf,
+                                struct Curl_easy *data,
+                                CURLcode *err)
+{
+  struct cf_h2_ctx *ctx = cf->ctx;
+  struct curl_borrow *prev_src;
+  char *buf;
+  size_t blen;
+  ssize_t nread, rv;
+
+  DEBUGASSERT(Curl_bufq_is_empty(&ctx->inbufq));
+  *err = Curl_borrow_renew(&ctx->inborrow, H2_CHUNK_SIZE);
+  if(*err)
+    return -1;
+  buf = Curl_borrow_mem(ctx->inborrow, &blen);
+  nread = Curl_conn_cf_recv(cf->next, data, buf, blen, err);
+  if(nread <= 0)
+    return nread;
+
+  prev_src = Curl_borrow_set_src(data, ctx->inborrow);
+  rv = nghttp2_session_mem_recv(ctx->h2, (const uint8_t *)buf,
+                                (size_t)nread);
+  Curl_borrow_set_src(data, prev_src);
+  if(rv < 0) {
+    failf(data, "nghttp2 recv error %zd: %s", rv, nghttp2_strerror((int)rv));
+    *err = CURLE_HTTP2;
+    return -1;
+  }
+  if(rv < nread) {
+    *err = Curl_bufq_cwrite(&ctx->inbufq, buf + rv, (size_t)(nread - rv),
+                            &blen);
+    if(*err)
+      return -1;
+  }
+  return nread;
+}
+
 /*
  * The server may send us data at any point (e.g. PING frames). Therefore,
  * we cannot assume that an HTTP/2 socket is dead just because it is readable.
@@ -844,6 +1088,124 @@ static ssize_t send_callback(nghttp2_session *h2,
   return nwritten;
 }
 
+/* Add the DATA frame with header `framehd` and the first `length` bytes
+ * of `sendbuf` to `outbufq`, leaving out the first `skip` bytes of it.
+ * Adds nothing and returns CURLE_AGAIN when it does not fit. */
+static CURLcode h2_out_add_data(struct cf_h2_ctx *ctx,
+                                const uint8_t *framehd,
+                                struct bufq_nocpy *sendbuf, size_t length,
+                                size_t skip)
+{
+  const unsigned char *p;
+  size_t plen, offset, added = 0;
+  ssize_t nwritten;
+  CURLcode result = CURLE_OK;
+
+  offset = (skip > 9) ? (skip - 9) : 0;
+  while((skip < 9) || (offset < length)) {
+    if(skip < 9) {
+      p = framehd + skip;
+      plen = 9 - skip;
+      skip = 9;
+    }
+    else if(Curl_bufq_nocpy_peek_at(sendbuf, offset, &p, &plen)) {
+      plen = CURLMIN(plen, length - offset);
+      offset += plen;
+    }
+    else
+      break;
+    nwritten = Curl_bufq_write(&ctx->outbufq, p, plen, &result);
+    if(nwritten > 0)
+      added += (size_t)nwritten;
+    if((nwritten < 0) || ((size_t)nwritten < plen)) {
+      (void)Curl_bufq_unwrite(&ctx->outbufq, added);
+      return CURLE_AGAIN;
+    }
+  }
+  return CURLE_OK;
+}
+
+/*
+ * The implementation of nghttp2_send_data_callback type. The body of the
+ * DATA frame is still in the stream's `sendbuf`, see
+ * req_body_read_callback(). When `outbufq` is empty, we send the frame
+ * header and the body spans with one vectored write and only copy what
+ * the connection did not take into `outbufq`.
+ *
+ * A TLS filter that got blocked needs the same bytes again on its next
+ * send, and they are in `outbufq` whenever that may be the case. We then
+ * add the frame to `outbufq` behind them and leave the sending to
+ * nw_out_flush(). A blocked vectored write sent at most
+ * CF_SEND_IOV_COALESCE_MAX bytes, which the first chunk of `outbufq`
+ * holds in full after the frame is added.
+ */
+static int send_data_callback(nghttp2_session *session,
+                              nghttp2_frame *frame, const uint8_t *framehd,
+                              size_t length, nghttp2_data_source *source,
+                              void *userp)
+{
+  struct Curl_cfilter *cf = userp;
+  struct cf_h2_ctx *ctx = cf->ctx;
+  struct Curl_easy *data = CF_DATA_CURRENT(cf);
+  struct Curl_easy *data_s;
+  struct h2_stream_ctx *stream = NULL;
+  size_t nwritten = 0;
+
+  (void)source;
+  DEBUGASSERT(data);
+  DEBUGASSERT(!frame->data.padlen);
+  data_s = nghttp2_session_get_stream_user_data(session, frame->hd.stream_id);
+  if(data_s)
+    stream = H2_STREAM_CTX(ctx, data_s);
+  if(!stream || (Curl_bufq_nocpy_len(&stream->sendbuf) < length))
+    /* the transfer is gone, reset the stream */
+    return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+
+  if(cf->connected && Curl_bufq_is_empty(&ctx->outbufq)) {
+    struct Curl_iov iov[H2_SEND_IOV_MAX];
+    size_t iovcnt = 0, offset = 0;
+    const unsigned char *p;
+    size_t plen;
+    ssize_t n;
+    CURLcode result;
+
+    iov[iovcnt].base = framehd;
+    iov[iovcnt++].len = 9;
+    while((offset < length) && (iovcnt < H2_SEND_IOV_MAX) &&
+          Curl_bufq_nocpy_peek_at(&stream->sendbuf, offset, &p, &plen)) {
+      plen = CURLMIN(plen, length - offset);
+      iov[iovcnt].base = p;
+      iov[iovcnt++].len = plen;
+      offset += plen;
+    }
+    n = Curl_conn_cf_send_iov(cf->next, data, iov, iovcnt, FALSE, &result);
+    if(n < 0) {
+      if(result != CURLE_AGAIN) {
+        failf(data, "Failed sending HTTP2 data");
+        return NGHTTP2_ERR_CALLBACK_FAILURE;
+      }
+      /* the frame goes into `outbufq` for the retry */
+      ctx->nw_out_blocked = 1;
+      n = 0;
+    }
+    CURL_TRC_CF(data, cf, "[%d] egress: wrote %zd bytes of DATA frame"
+                "(len=%zu) from %zu spans", frame->hd.stream_id,
+                n, length, iovcnt);
+    nwritten = (size_t)n;
+  }
+
+  if(nwritten < (length + 9)) {
+    /* an empty `outbufq` always takes the rest of a frame */
+    if(h2_out_add_data(ctx, framehd, &stream->sendbuf, length, nwritten)) {
+      DEBUGASSERT(!nwritten);
+      ctx->nw_out_blocked = 1;
+      return NGHTTP2_ERR_WOULDBLOCK;
+    }
+  }
+  Curl_bufq_nocpy_skip(&stream->sendbuf, length);
+  return 0;
+}
+
 
 /* We pass a pointer to this struct in the push callback, but the contents of
    the struct are hidden from the user. */
@@ -911,6 +1273,7 @@ static struct Curl_easy *h2_duphandle(struct Curl_cfilter *cf,
     struct h2_stream_ctx *second_stream;
     http2_data_setup(cf, second, &second_stream);
     second->state.priority.weight = data->state.priority.weight;
+    second->state.priority.urgency = data->state.priority.urgency;
   }
   return second;
 }
@@ -1217,11 +1580,11 @@ static CURLcode on_stream_frame(struct Curl_cfilter *cf,
     drain_stream(cf, data, stream);
     break;
   case NGHTTP2_WINDOW_UPDATE:
-    if(CURL_WANT_SEND(data) && Curl_bufq_is_empty(&stream->sendbuf)) {
+    if(CURL_WANT_SEND(data) && Curl_bufq_nocpy_is_empty(&stream->sendbuf)) {
       /* need more data, force processing of transfer */
       drain_stream(cf, data, stream);
     }
-    else if(!Curl_bufq_is_empty(&stream->sendbuf)) {
+    else if(!Curl_bufq_nocpy_is_empty(&stream->sendbuf)) {
       /* resume the potentially suspended stream */
       rv = nghttp2_session_resume_data(ctx->h2, stream->id);
       if(nghttp2_is_fatal(rv))
@@ -1402,6 +1765,12 @@ static int on_frame_recv(nghttp2_session *session, const nghttp2_frame *frame,
       }
       break;
     }
+    case NGHTTP2_PING:
+      if((frame->hd.flags & NGHTTP2_FLAG_ACK) && ctx->bdp.ping_pending &&
+         !memcmp(frame->ping.opaque_data, H2_BDP_PING_DATA, 8) &&
+         h2_bdp_on_ack(cf, data))
+        return NGHTTP2_ERR_CALLBACK_FAILURE;
+      break;
     case NGHTTP2_GOAWAY:
       ctx->rcvd_goaway = TRUE;
       ctx->goaway_error = frame->goaway.error_code;
@@ -1490,10 +1859,15 @@ static int on_data_chunk_recv(nghttp2_session *session, uint8_t flags,
   if(!stream)
     return NGHTTP2_ERR_CALLBACK_FAILURE;
 
+  h2_bdp_on_data(cf, stream, len);
   h2_xfer_write_resp(cf, data_s, stream, (const char *)mem, len, FALSE);
 
   nghttp2_session_consume(ctx->h2, stream_id, len);
   stream->nrcvd_data += (curl_off_t)len;
+  /* let the transfer tell what flow control did for it */
+  if(stream->local_window_size > data_s->info.h2_window)
+    data_s->info.h2_window = stream->local_window_size;
+  data_s->info.h2_rtt = ctx->bdp.rtt_us;
   return 0;
 }
 
@@ -1783,11 +2157,10 @@ static ssize_t req_body_read_callback(nghttp2_session *session,
   struct cf_h2_ctx *ctx = cf->ctx;
   struct Curl_easy *data_s;
   struct h2_stream_ctx *stream = NULL;
-  CURLcode result;
-  ssize_t nread;
+  size_t nread, blen;
   (void)source;
+  (void)buf;
 
-  (void)cf;
   if(!stream_id)
     return NGHTTP2_ERR_INVALID_ARGUMENT;
 
@@ -1803,21 +2176,22 @@ static ssize_t req_body_read_callback(nghttp2_session *session,
   if(!stream)
     return NGHTTP2_ERR_CALLBACK_FAILURE;
 
-  nread = Curl_bufq_read(&stream->sendbuf, buf, length, &result);
-  if(nread < 0) {
-    if(result != CURLE_AGAIN)
-      return NGHTTP2_ERR_CALLBACK_FAILURE;
-    nread = 0;
-  }
+  /* The body stays in `sendbuf` until send_data_callback() writes the
+   * frame, nghttp2 only learns how much of it goes into the frame. */
+  blen = Curl_bufq_nocpy_len(&stream->sendbuf);
+  nread = CURLMIN(blen, length);
 
-  CURL_TRC_CF(data_s, cf, "[%d] req_body_read(len=%zu) eos=%d -> %zd, %d",
-              stream_id, length, stream->body_eos, nread, result);
+  CURL_TRC_CF(data_s, cf, "[%d] req_body_read(len=%zu) eos=%d -> %zu",
+              stream_id, length, stream->body_eos, nread);
 
-  if(stream->body_eos && Curl_bufq_is_empty(&stream->sendbuf)) {
-    *data_flags = NGHTTP2_DATA_FLAG_EOF;
-    return nread;
+  if(stream->body_eos && (nread == blen)) {
+    *data_flags = NGHTTP2_DATA_FLAG_EOF | NGHTTP2_DATA_FLAG_NO_COPY;
+    return (ssize_t)nread;
   }
-  return (nread == 0) ? NGHTTP2_ERR_DEFERRED : nread;
+  if(!nread)
+    return NGHTTP2_ERR_DEFERRED;
+  *data_flags = NGHTTP2_DATA_FLAG_NO_COPY;
+  return (ssize_t)nread;
 }
 
 #if !defined(CURL_DISABLE_VERBOSE_STRINGS)
@@ -1957,18 +2331,31 @@ out:
   return rv;
 }
 
+static int sweight(const struct Curl_data_priority *prio)
+{
+  /* 0 weight is not set by user. Without an urgency either, we take the
+   * nghttp2 default one. Each urgency level doubles the weight of the one
+   * below it, with the default urgency 3 getting the default weight. That
+   * way nghttp2 interleaves our request bodies in the order the urgencies
+   * ask for, even when the server ignores them. */
+  if(prio->weight)
+    return prio->weight;
+  if(prio->urgency >= 0) {
+    int u = prio->urgency & 7;
+    return (u <= 3) ? (NGHTTP2_DEFAULT_WEIGHT << (3 - u)) :
+      (NGHTTP2_DEFAULT_WEIGHT >> (u - 3));
+  }
+  return NGHTTP2_DEFAULT_WEIGHT;
+}
+
 static int sweight_wanted(const struct Curl_easy *data)
 {
-  /* 0 weight is not set by user and we take the nghttp2 default one */
-  return data->set.priority.weight ?
-    data->set.priority.weight : NGHTTP2_DEFAULT_WEIGHT;
+  return sweight(&data->set.priority);
 }
 
 static int sweight_in_effect(const struct Curl_easy *data)
 {
-  /* 0 weight is not set by user and we take the nghttp2 default one */
-  return data->state.priority.weight ?
-    data->state.priority.weight : NGHTTP2_DEFAULT_WEIGHT;
+  return sweight(&data->state.priority);
 }
 
 /*
@@ -1993,7 +2380,7 @@ static void h2_pri_spec(struct cf_h2_ctx *ctx,
 /*
  * Check if there is been an update in the priority /
  * dependency settings and if so it submits a PRIORITY frame with the updated
- * info.
+ * info. A changed urgency is also sent in a PRIORITY_UPDATE frame.
  * Flush any out data pending in the network buffer.
  */
 static CURLcode h2_progress_egress(struct Curl_cfilter *cf,
@@ -2005,10 +2392,27 @@ static CURLcode h2_progress_egress(struct Curl_cfilter *cf,
 
   if(stream && stream->id > 0 &&
      ((sweight_wanted(data) != sweight_in_effect(data)) ||
+      (data->set.priority.urgency != data->state.priority.urgency) ||
       (data->set.priority.exclusive != data->state.priority.exclusive) ||
       (data->set.priority.parent != data->state.priority.parent)) ) {
     /* send new weight and/or dependency */
     nghttp2_priority_spec pri_spec;
+#ifdef NGHTTP2_HAS_PRIORITY_UPDATE
+    int urgency = data->set.priority.urgency;
+
+    if((urgency >= 0) && (urgency != data->state.priority.urgency)) {
+      char prio[16];
+      size_t plen = Curl_http_prio_value(prio, sizeof(prio), urgency);
+      CURL_TRC_CF(data, cf, "[%d] Queuing PRIORITY_UPDATE %s",
+                  stream->id, prio);
+      /* does nothing unless the server disabled RFC 7540 priorities */
+      rv = nghttp2_submit_priority_update(ctx->h2, NGHTTP2_FLAG_NONE,
+                                          stream->id, (const uint8_t *)prio,
+                                          plen);
+      if(rv)
+        goto out;
+    }
+#endif
 
     h2_pri_spec(ctx, data, &pri_spec);
     CURL_TRC_CF(data, cf, "[%d] Queuing PRIORITY", stream->id);
@@ -2106,7 +2510,10 @@ static CURLcode h2_progress_ingress(struct Curl_cfilter *cf,
       break;
     }
 
-    nread = Curl_bufq_sipn(&ctx->inbufq, 0, nw_in_reader, cf, &result);
+    if(data->set.fborrow)
+      nread = h2_recv_borrowed(cf, data, &result);
+    else
+      nread = Curl_bufq_sipn(&ctx->inbufq, 0, nw_in_reader, cf, &result);
     if(nread < 0) {
       if(result != CURLE_AGAIN) {
         failf(data, "Failed receiving HTTP2 data: %d(%s)", result,
@@ -2136,6 +2543,12 @@ static CURLcode h2_progress_ingress(struct Curl_cfilter *cf,
     connclose(cf->conn, "GOAWAY received");
   }
 
+  /* The socket may still be readable when the pool refuses `inbufq`
+   * a chunk. Input is then not polled for until the gate opens. */
+  ctx->in_gated = Curl_bufq_is_gated(&ctx->inbufq);
+  if(ctx->in_gated)
+    CURL_TRC_CF(data, cf, "[0] progress ingress: no buffer memory");
+
   CURL_TRC_CF(data, cf, "[0] progress ingress: done");
   return CURLE_OK;
 }
@@ -2206,7 +2619,7 @@ out:
               nghttp2_session_get_stream_effective_local_window_size(
                 ctx->h2, stream->id),
               nghttp2_session_get_local_window_size(ctx->h2),
-              HTTP2_HUGE_WINDOW_SIZE);
+              ctx->bdp.conn_win);
 
   CF_DATA_RESTORE(cf, save);
   return nread;
@@ -2219,7 +2632,7 @@ static ssize_t cf_h2_body_send(struct Curl_cfilter *cf,
                                CURLcode *err)
 {
   struct cf_h2_ctx *ctx = cf->ctx;
-  ssize_t nwritten;
+  size_t nwritten;
 
   if(stream->closed) {
     if(stream->resp_hds_complete) {
@@ -2241,14 +2654,14 @@ static ssize_t cf_h2_body_send(struct Curl_cfilter *cf,
     return -1;
   }
 
-  nwritten = Curl_bufq_write(&stream->sendbuf, buf, blen, err);
-  if(nwritten < 0)
+  *err = Curl_bufq_nocpy_cwrite(&stream->sendbuf, buf, blen, &nwritten);
+  if(*err)
     return -1;
 
-  if(eos && (blen == (size_t)nwritten))
+  if(eos && (blen == nwritten))
     stream->body_eos = TRUE;
 
-  if(eos || !Curl_bufq_is_empty(&stream->sendbuf)) {
+  if(eos || !Curl_bufq_nocpy_is_empty(&stream->sendbuf)) {
     /* resume the potentially suspended stream */
     int rv = nghttp2_session_resume_data(ctx->h2, stream->id);
     if(nghttp2_is_fatal(rv)) {
@@ -2256,7 +2669,30 @@ static ssize_t cf_h2_body_send(struct Curl_cfilter *cf,
       return -1;
     }
   }
-  return nwritten;
+  return (ssize_t)nwritten;
+}
+
+static nghttp2_nv *h2_req_to_nva(struct http_req_h2 *h2req, size_t *pcount)
+{
+  size_t i, n = Curl_http_req_h2_count(h2req);
+  nghttp2_nv *nva = calloc(1, sizeof(nghttp2_nv) * n);
+
+  *pcount = 0;
+  if(!nva)
+    return NULL;
+
+  for(i = 0; i < n; ++i) {
+    struct http_req_h2_field f;
+    if(!Curl_http_req_h2_getn(h2req, i, &f))
+      break;
+    nva[i].name = (unsigned char *)CURL_UNCONST(f.name);
+    nva[i].namelen = f.namelen;
+    nva[i].value = (unsigned char *)CURL_UNCONST(f.value);
+    nva[i].valuelen = f.valuelen;
+    nva[i].flags = NGHTTP2_NV_FLAG_NONE;
+  }
+  *pcount = i;
+  return nva;
 }
 
 static ssize_t h2_submit(struct h2_stream_ctx **pstream,
@@ -2266,7 +2702,7 @@ static ssize_t h2_submit(struct h2_stream_ctx **pstream,
 {
   struct cf_h2_ctx *ctx = cf->ctx;
   struct h2_stream_ctx *stream = NULL;
-  struct dynhds h2_headers;
+  struct http_req_h2 *h2req = NULL;
   nghttp2_nv *nva = NULL;
   const void *body = NULL;
   size_t nheader, bodylen, i;
@@ -2275,32 +2711,22 @@ static ssize_t h2_submit(struct h2_stream_ctx **pstream,
   nghttp2_priority_spec pri_spec;
   ssize_t nwritten;
 
-  Curl_dynhds_init(&h2_headers, 0, DYN_HTTP_REQUEST);
-
   *err = http2_data_setup(cf, data, &stream);
   if(*err) {
     nwritten = -1;
     goto out;
   }
 
-  nwritten = Curl_h1_req_parse_read(&stream->h1, buf, len, NULL, 0, err);
+  /* skip the HTTP/1 request head, we send the headers prepared for it */
+  nwritten = Curl_http_req_h2_take(data, len, &h2req, err);
   if(nwritten < 0)
     goto out;
-  if(!stream->h1.done) {
+  if(!h2req) {
     /* need more data */
     goto out;
   }
-  DEBUGASSERT(stream->h1.req);
-
-  *err = Curl_http_req_to_h2(&h2_headers, stream->h1.req, data);
-  if(*err) {
-    nwritten = -1;
-    goto out;
-  }
-  /* no longer needed */
-  Curl_h1_req_parse_free(&stream->h1);
 
-  nva = Curl_dynhds_to_nva(&h2_headers, &nheader);
+  nva = h2_req_to_nva(h2req, &nheader);
   if(!nva) {
     *err = CURLE_OUT_OF_MEMORY;
     nwritten = -1;
@@ -2378,7 +2804,7 @@ out:
               stream ? stream->id : -1, nwritten, *err);
   Curl_safefree(nva);
   *pstream = stream;
-  Curl_dynhds_free(&h2_headers);
+  Curl_http_req_h2_free(h2req);
   return nwritten;
 }
 
@@ -2462,7 +2888,7 @@ out:
                 nghttp2_session_get_stream_remote_window_size(
                   ctx->h2, stream->id),
                 nghttp2_session_get_remote_window_size(ctx->h2),
-                Curl_bufq_len(&stream->sendbuf),
+                Curl_bufq_nocpy_len(&stream->sendbuf),
                 Curl_bufq_len(&ctx->outbufq));
   }
   else {
@@ -2485,7 +2911,7 @@ static CURLcode cf_h2_flush(struct Curl_cfilter *cf,
   CURLcode result = CURLE_OK;
 
   CF_DATA_SAVE(save, cf, data);
-  if(stream && !Curl_bufq_is_empty(&stream->sendbuf)) {
+  if(stream && !Curl_bufq_nocpy_is_empty(&stream->sendbuf)) {
     /* resume the potentially suspended stream */
     int rv = nghttp2_session_resume_data(ctx->h2, stream->id);
     if(nghttp2_is_fatal(rv)) {
@@ -2505,7 +2931,7 @@ out:
                 nghttp2_session_get_stream_remote_window_size(
                   ctx->h2, stream->id),
                 nghttp2_session_get_remote_window_size(ctx->h2),
-                Curl_bufq_len(&stream->sendbuf),
+                Curl_bufq_nocpy_len(&stream->sendbuf),
                 Curl_bufq_len(&ctx->outbufq));
   }
   else {
@@ -2545,6 +2971,16 @@ static void cf_h2_adjust_pollset(struct Curl_cfilter *cf,
     want_send = (!s_exhaust && want_send) ||
                 (!c_exhaust && nghttp2_session_want_write(ctx->h2)) ||
                 !Curl_bufq_is_empty(&ctx->outbufq);
+    if(ctx->in_gated) {
+      if(Curl_bufq_is_gated(&ctx->inbufq)) {
+        /* level triggered polling would report the socket readable
+         * again and again. Check back when chunks may be free. */
+        want_recv = FALSE;
+        Curl_expire(data, H2_IN_GATE_RETRY_MS, EXPIRE_BUFFERS);
+      }
+      else
+        ctx->in_gated = FALSE;
+    }
 
     Curl_pollset_set(data, ps, sock, want_recv, want_send);
     CF_DATA_RESTORE(cf, save);
@@ -2823,7 +3259,7 @@ static CURLcode cf_h2_query(struct Curl_cfilter *cf,
   case CF_QUERY_NEED_FLUSH: {
     struct h2_stream_ctx *stream = H2_STREAM_CTX(ctx, data);
     if(!Curl_bufq_is_empty(&ctx->outbufq) ||
-       (stream && !Curl_bufq_is_empty(&stream->sendbuf))) {
+       (stream && !Curl_bufq_nocpy_is_empty(&stream->sendbuf))) {
       *pres1 = TRUE;
       return CURLE_OK;
     }
@@ -2873,7 +3309,7 @@ static CURLcode http2_cfilter_add(struct Curl_cfilter **pcf,
   ctx = calloc(1, sizeof(*ctx));
   if(!ctx)
     goto out;
-  cf_h2_ctx_init(ctx, via_h1_upgrade);
+  cf_h2_ctx_init(ctx, data, via_h1_upgrade);
 
   result = Curl_cf_create(&cf, &Curl_cft_nghttp2, ctx);
   if(result)
@@ -2897,11 +3333,10 @@ static CURLcode http2_cfilter_insert_after(struct Curl_cfilter *cf,
   struct cf_h2_ctx *ctx;
   CURLcode result = CURLE_OUT_OF_MEMORY;
 
-  (void)data;
   ctx = calloc(1, sizeof(*ctx));
   if(!ctx)
     goto out;
-  cf_h2_ctx_init(ctx, via_h1_upgrade);
+  cf_h2_ctx_init(ctx, data, via_h1_upgrade);
 
   result = Curl_cf_create(&cf_h2, &Curl_cft_nghttp2, ctx);
   if(result)
@@ -33,6 +33,7 @@
 #include "curlx/dynbuf.h"
 #include "content_encoding.h"
 #include "http.h"
+#include "http1.h"
 #include "multiif.h"
 #include "curlx/strparse.h"
 #include "curlx/warnless.h"
@@ -146,16 +147,21 @@ static CURLcode httpchunk_readwrite(struct Curl_easy *data,
     switch(ch->state) {
     case CHUNK_HEX:
       if(ISXDIGIT(*buf)) {
-        if(ch->hexindex >= CHUNK_MAXNUM_LEN) {
+        /* take all the digits we have in one go */
+        size_t ndigits = 1;
+        while((ndigits < blen) && ISXDIGIT(buf[ndigits]))
+          ndigits++;
+        if(ch->hexindex + ndigits > CHUNK_MAXNUM_LEN) {
           failf(data, "chunk hex-length longer than %d", CHUNK_MAXNUM_LEN);
           ch->state = CHUNK_FAILED;
           ch->last_code = CHUNKE_TOO_LONG_HEX; /* longer than we support */
           return CURLE_RECV_ERROR;
         }
-        ch->hexbuffer[ch->hexindex++] = *buf;
-        buf++;
-        blen--;
-        (*pconsumed)++;
+        memcpy(&ch->hexbuffer[ch->hexindex], buf, ndigits);
+        ch->hexindex = (unsigned char)(ch->hexindex + ndigits);
+        buf += ndigits;
+        blen -= ndigits;
+        *pconsumed += ndigits;
       }
       else {
         const char *p;
@@ -180,24 +186,29 @@ static CURLcode httpchunk_readwrite(struct Curl_easy *data,
       }
       break;
 
-    case CHUNK_LF:
-      /* waiting for the LF after a chunk size */
-      if(*buf == 0x0a) {
-        /* we are now expecting data to come, unless size was zero! */
-        if(0 == ch->datasize) {
-          ch->state = CHUNK_TRAILER; /* now check for trailers */
-        }
-        else {
-          ch->state = CHUNK_DATA;
-          CURL_TRC_WRITE(data, "http_chunked, chunk start of %"
-                         FMT_OFF_T " bytes", ch->datasize);
-        }
+    case CHUNK_LF: {
+      /* waiting for the LF after a chunk size, ignore all else */
+      const char *lf = memchr(buf, 0x0a, blen);
+      if(!lf) {
+        *pconsumed += blen;
+        blen = 0;
+        break;
       }
-
-      buf++;
-      blen--;
-      (*pconsumed)++;
+      /* we are now expecting data to come, unless size was zero! */
+      if(0 == ch->datasize) {
+        ch->state = CHUNK_TRAILER; /* now check for trailers */
+      }
+      else {
+        ch->state = CHUNK_DATA;
+        CURL_TRC_WRITE(data, "http_chunked, chunk start of %"
+                       FMT_OFF_T " bytes", ch->datasize);
+      }
+      piece = (size_t)(lf - buf) + 1;
+      buf += piece;
+      blen -= piece;
+      *pconsumed += piece;
       break;
+    }
 
     case CHUNK_DATA:
       /* We expect 'datasize' of data. We have 'blen' right now, it can be
@@ -294,12 +305,18 @@ static CURLcode httpchunk_readwrite(struct Curl_easy *data,
         }
       }
       else {
-        result = curlx_dyn_addn(&ch->trailer, buf, 1);
+        /* add the trailer line up to its end, or all we have */
+        piece = Curl_h1_scan_crlf(buf, blen);
+        result = curlx_dyn_addn(&ch->trailer, buf, piece);
         if(result) {
           ch->state = CHUNK_FAILED;
           ch->last_code = CHUNKE_OUT_OF_MEMORY;
           return result;
         }
+        buf += piece;
+        blen -= piece;
+        *pconsumed += piece;
+        break;
       }
       buf++;
       blen--;
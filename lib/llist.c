@@ -222,7 +222,6 @@ struct Curl_llist_node *Curl_llist_head(struct Curl_llist *list)
   return VERIFYNODE(list->_head);
 }
 
-#ifdef UNITTESTS
 /* Curl_llist_tail() returns the last 'struct Curl_llist_node *', which
    might be NULL */
 struct Curl_llist_node *Curl_llist_tail(struct Curl_llist *list)
@@ -231,7 +230,6 @@ struct Curl_llist_node *Curl_llist_tail(struct Curl_llist *list)
   DEBUGASSERT(list->_init == LLISTINIT);
   return VERIFYNODE(list->_tail);
 }
-#endif
 
 /* Curl_llist_count() returns a size_t the number of nodes in the list */
 size_t Curl_llist_count(struct Curl_llist *list)
@@ -258,8 +256,6 @@ struct Curl_llist_node *Curl_node_next(struct Curl_llist_node *n)
   return VERIFYNODE(n->_next);
 }
 
-#ifdef UNITTESTS
-
 /* Curl_node_prev() returns the previous element in a list from a given
    Curl_llist_node */
 struct Curl_llist_node *Curl_node_prev(struct Curl_llist_node *n)
@@ -269,8 +265,6 @@ struct Curl_llist_node *Curl_node_prev(struct Curl_llist_node *n)
   return VERIFYNODE(n->_prev);
 }
 
-#endif
-
 struct Curl_llist *Curl_node_llist(struct Curl_llist_node *n)
 {
   DEBUGASSERT(n);
@@ -82,6 +82,16 @@
 #define CURL_TLS_SESSION_SIZE 25
 #endif
 
+/* the number of spare chunks kept in the buffer pool */
+#ifndef CURL_MULTI_CHUNK_SPARES
+#define CURL_MULTI_CHUNK_SPARES 64
+#endif
+
+/* the default maximum of threads resolving names */
+#ifndef CURL_MULTI_RESOLVER_THREADS
+#define CURL_MULTI_RESOLVER_THREADS 16
+#endif
+
 #define CURL_MULTI_HANDLE 0x000bab1e
 
 #ifdef DEBUGBUILD
@@ -104,6 +114,8 @@ static CURLMcode add_next_timeout(struct curltime now,
 static CURLMcode multi_timeout(struct Curl_multi *multi,
                                struct curltime *expire_time,
                                long *timeout_ms);
+static struct Curl_easy *multi_timer_getbest(struct Curl_multi *multi,
+                                             const struct curltime *now);
 static void process_pending_handles(struct Curl_multi *multi);
 static void multi_xfer_bufs_free(struct Curl_multi *multi);
 #ifdef DEBUGBUILD
@@ -239,10 +251,20 @@ struct Curl_multi *Curl_multi_handle(unsigned int xfer_table_size,
   Curl_hash_init(&multi->proto_hash, 23,
                  Curl_hash_str, curlx_str_key_compare, ph_freeentry);
   Curl_llist_init(&multi->msglist, NULL);
+  Curl_bufcp_init(&multi->bufcp, CURL_MULTI_CHUNK_SIZE,
+                  CURL_MULTI_CHUNK_SPARES);
+  Curl_cdec_pool_init(&multi->cdecp);
 
   multi->multiplexing = TRUE;
   multi->max_concurrent_streams = 100;
+  multi->max_resolver_threads = CURL_MULTI_RESOLVER_THREADS;
   multi->last_timeout_ms = -1;
+#ifdef USE_TIMER_WHEEL
+  {
+    struct curltime now = curlx_now();
+    Curl_twheel_init(&multi->timewheel, &now);
+  }
+#endif
 
   if(Curl_uint_bset_resize(&multi->process, xfer_table_size) ||
      Curl_uint_bset_resize(&multi->pending, xfer_table_size) ||
@@ -293,6 +315,8 @@ error:
   Curl_dnscache_destroy(&multi->dnscache);
   Curl_cpool_destroy(&multi->cpool);
   Curl_cshutdn_destroy(&multi->cshutdn, multi->admin);
+  Curl_bufcp_free(&multi->bufcp);
+  Curl_cdec_pool_free(&multi->cdecp);
   Curl_ssl_scache_destroy(multi->ssl_scache);
   if(multi->admin) {
     multi->admin->multi = NULL;
@@ -382,6 +406,10 @@ CURLMcode curl_multi_add_handle(CURLM *m, CURL *d)
   if(!GOOD_EASY_HANDLE(data))
     return CURLM_BAD_EASY_HANDLE;
 
+  if(Curl_mwrk_active(multi))
+    /* a worker thread runs the transfer */
+    return Curl_mwrk_add(multi, data);
+
   /* Prevent users from adding same easy handle more than once and prevent
      adding to more than one multi stack */
   if(data->multi)
@@ -688,6 +716,9 @@ CURLMcode curl_multi_remove_handle(CURLM *m, CURL *d)
   if(!GOOD_EASY_HANDLE(data))
     return CURLM_BAD_EASY_HANDLE;
 
+  if(Curl_mwrk_active(multi))
+    return Curl_mwrk_remove(multi, data);
+
   /* Prevent users from trying to remove same easy handle more than once */
   if(!data->multi)
     return CURLM_OK; /* it is already removed so let's say it is fine! */
@@ -1220,6 +1251,9 @@ static CURLMcode multi_wait(struct Curl_multi *multi,
   unsigned int curl_nfds = 0; /* how many pfds are for curl transfers */
   CURLMcode result = CURLM_OK;
   unsigned int mid;
+#ifdef USE_EPOLL
+  int epfd;
+#endif
 
 #ifdef USE_WINSOCK
   WSANETWORKEVENTS wsa_events;
@@ -1240,6 +1274,21 @@ static CURLMcode multi_wait(struct Curl_multi *multi,
 
   Curl_pollfds_init(&cpfds, a_few_on_stack, NUM_POLLS_ON_STACK);
 
+#ifdef USE_EPOLL
+  /* With an epoll instance, the sockets of all transfers are registered
+   * there. The registrations change when transfers run, so a wait only
+   * polls the instance itself, as the first of `cpfds`. */
+  epfd = Curl_multi_ev_epoll_fd(multi);
+  if(epfd != -1) {
+    if(!Curl_multi_ev_epoll_count(multi))
+      epfd = -1;
+    else if(Curl_pollfds_add_sock(&cpfds, epfd, POLLIN)) {
+      result = CURLM_OUT_OF_MEMORY;
+      goto out;
+    }
+  }
+  else
+#endif
   /* Add the curl handles to our pollfds first */
   if(Curl_uint_bset_first(&multi->process, &mid)) {
     do {
@@ -1332,12 +1381,29 @@ static CURLMcode multi_wait(struct Curl_multi *multi,
     else
       pollrc = 0;
 #else
+#ifdef USE_EPOLL
+    if((epfd != -1) && (cpfds.n == 1)) {
+      /* nothing besides the transfers, wait on the epoll instance */
+      pollrc = Curl_multi_ev_epoll_wait(multi, timeout_ms);
+      cpfds.pfds[0].revents = pollrc ? POLLIN : 0;
+      epfd = -1; /* ready sockets are counted */
+    }
+    else
+#endif
     pollrc = Curl_poll(cpfds.pfds, cpfds.n, timeout_ms); /* wait... */
 #endif
     if(pollrc < 0) {
       result = CURLM_UNRECOVERABLE_POLL;
       goto out;
     }
+#ifdef USE_EPOLL
+    if((pollrc > 0) && (epfd != -1) && (cpfds.pfds[0].revents & POLLIN)) {
+      /* count the ready transfer sockets instead of the instance */
+      int nready = Curl_multi_ev_epoll_wait(multi, 0);
+      if(nready > 0)
+        pollrc += nready - 1;
+    }
+#endif
 
     if(pollrc > 0) {
       retcode = pollrc;
@@ -1456,8 +1522,10 @@ CURLMcode curl_multi_wait(CURLM *multi,
                           int timeout_ms,
                           int *ret)
 {
+  struct Curl_multi *m = multi;
+  /* with worker threads, completed transfers are signalled via wakeup */
   return multi_wait(multi, extra_fds, extra_nfds, timeout_ms, ret, FALSE,
-                    FALSE);
+                    GOOD_MULTI_HANDLE(m) && Curl_mwrk_active(m));
 }
 
 CURLMcode curl_multi_poll(CURLM *multi,
@@ -2657,7 +2725,7 @@ statemachine_end:
 CURLMcode curl_multi_perform(CURLM *m, int *running_handles)
 {
   CURLMcode returncode = CURLM_OK;
-  struct Curl_tree *t = NULL;
+  struct Curl_easy *data;
   struct curltime now = curlx_now();
   struct Curl_multi *multi = m;
   unsigned int mid;
@@ -2669,13 +2737,17 @@ CURLMcode curl_multi_perform(CURLM *m, int *running_handles)
   if(multi->in_callback)
     return CURLM_RECURSIVE_API_CALL;
 
+  if(Curl_mwrk_active(multi))
+    /* worker threads do all the work */
+    return Curl_mwrk_perform(multi, running_handles);
+
   sigpipe_init(&pipe_st);
   if(Curl_uint_bset_first(&multi->process, &mid)) {
     CURL_TRC_M(multi->admin, "multi_perform(running=%u)",
                Curl_multi_xfers_running(multi));
     do {
-      struct Curl_easy *data = Curl_multi_get_easy(multi, mid);
       CURLMcode result;
+      data = Curl_multi_get_easy(multi, mid);
       if(!data) {
         DEBUGASSERT(0);
         Curl_uint_bset_remove(&multi->process, mid);
@@ -2685,6 +2757,15 @@ CURLMcode curl_multi_perform(CURLM *m, int *running_handles)
         /* admin handle is processed below */
         sigpipe_apply(data, &pipe_st);
         result = multi_runsingle(multi, &now, data);
+#ifdef USE_EPOLL
+        if((CURLM_OK >= result) && !multi->socket_cb) {
+          /* update the epoll instance, if there is one, with the changes
+           * of this transfer, like the socket callback path does */
+          CURLMcode mresult = Curl_multi_ev_assess_xfer(multi, data);
+          if(mresult)
+            result = mresult;
+        }
+#endif
         if(result)
           returncode = result;
       }
@@ -2710,10 +2791,9 @@ CURLMcode curl_multi_perform(CURLM *m, int *running_handles)
    * been handled!
    */
   do {
-    multi->timetree = Curl_splaygetbest(now, multi->timetree, &t);
-    if(t) {
+    data = multi_timer_getbest(multi, &now);
+    if(data) {
       /* the removed may have another timeout in queue */
-      struct Curl_easy *data = Curl_splayget(t);
       if(data->mstate == MSTATE_PENDING) {
         bool stream_unused;
         CURLcode result_unused;
@@ -2722,9 +2802,9 @@ CURLMcode curl_multi_perform(CURLM *m, int *running_handles)
           move_pending_to_connect(multi, data);
         }
       }
-      (void)add_next_timeout(now, multi, Curl_splayget(t));
+      (void)add_next_timeout(now, multi, data);
     }
-  } while(t);
+  } while(data);
 
   if(running_handles) {
     unsigned int running = Curl_multi_xfers_running(multi);
@@ -2746,6 +2826,9 @@ CURLMcode curl_multi_cleanup(CURLM *m)
     if(multi->in_callback)
       return CURLM_RECURSIVE_API_CALL;
 
+    /* Stop worker threads, this detaches all transfers they run */
+    Curl_mwrk_cleanup(multi);
+
     /* First remove all remaining easy handles,
      * close internal ones. admin handle is special */
     if(Curl_uint_tbl_first(&multi->xfers, &mid, &entry)) {
@@ -2783,14 +2866,27 @@ CURLMcode curl_multi_cleanup(CURLM *m)
       while(Curl_uint_tbl_next(&multi->xfers, mid, &mid, &entry));
     }
 
+#ifdef CURLRES_THREADED
+    /* all transfers have given up their lookups */
+    Curl_async_thrdd_pool_close(&multi->resolver_pool);
+#endif
     Curl_cpool_destroy(&multi->cpool);
     Curl_cshutdn_destroy(&multi->cshutdn, multi->admin);
+    if(multi->admin && multi->bufcp.stats.allocated) {
+      CURL_TRC_M(multi->admin, "buffer pool: %zu chunks allocated, "
+                 "%zu reused, %zu denied, peak memory %zu",
+                 multi->bufcp.stats.allocated, multi->bufcp.stats.reused,
+                 multi->bufcp.stats.denied, multi->bufcp.stats.peak_mem);
+    }
+    Curl_bufcp_free(&multi->bufcp);
     if(multi->admin) {
+      (void)Curl_dnscache_save(multi->admin, &multi->dnscache);
       CURL_TRC_M(multi->admin, "multi_cleanup, closing admin handle, done");
       multi->admin->multi = NULL;
       Curl_uint_tbl_remove(&multi->xfers, multi->admin->mid);
       Curl_close(&multi->admin);
     }
+    Curl_cdec_pool_free(&multi->cdecp);
 
     multi->magic = 0; /* not good anymore */
 
@@ -2846,6 +2942,9 @@ CURLMsg *curl_multi_info_read(CURLM *m, int *msgs_in_queue)
 
   *msgs_in_queue = 0; /* default to none */
 
+  if(GOOD_MULTI_HANDLE(multi) && Curl_mwrk_active(multi))
+    return Curl_mwrk_info_read(multi, msgs_in_queue);
+
   if(GOOD_MULTI_HANDLE(multi) &&
      !multi->in_callback &&
      Curl_llist_count(&multi->msglist)) {
@@ -2879,6 +2978,70 @@ void Curl_multi_will_close(struct Curl_easy *data, curl_socket_t s)
   }
 }
 
+/* Add the transfer to the multi's timers, sorted by its `expiretime` */
+static void multi_timer_add(struct Curl_multi *multi, struct Curl_easy *data)
+{
+#ifdef USE_TIMER_WHEEL
+  Curl_twheel_set(&data->state.timenode, data);
+  Curl_twheel_add(&multi->timewheel, data->state.expiretime,
+                  &data->state.timenode);
+#else
+  Curl_splayset(&data->state.timenode, data);
+  multi->timetree = Curl_splayinsert(data->state.expiretime, multi->timetree,
+                                     &data->state.timenode);
+#endif
+}
+
+/* Remove the transfer from the multi's timers, returns non-zero
+ * if it was not there */
+static int multi_timer_remove(struct Curl_multi *multi,
+                              struct Curl_easy *data)
+{
+#ifdef USE_TIMER_WHEEL
+  Curl_twheel_remove(&multi->timewheel, &data->state.timenode);
+  return 0;
+#else
+  return Curl_splayremove(multi->timetree, &data->state.timenode,
+                          &multi->timetree);
+#endif
+}
+
+/* Remove and return a transfer whose timer expired at `now` or NULL */
+static struct Curl_easy *multi_timer_getbest(struct Curl_multi *multi,
+                                             const struct curltime *now)
+{
+#ifdef USE_TIMER_WHEEL
+  struct Curl_twnode *t = Curl_twheel_getbest(&multi->timewheel, now);
+  return t ? Curl_twheel_get(t) : NULL;
+#else
+  struct Curl_tree *t = NULL;
+  multi->timetree = Curl_splaygetbest(*now, multi->timetree, &t);
+  return t ? Curl_splayget(t) : NULL;
+#endif
+}
+
+/* Get the earliest expire time of all transfers, FALSE if there is none */
+static bool multi_timer_first(struct Curl_multi *multi,
+                              struct curltime *expire_time)
+{
+#ifdef USE_TIMER_WHEEL
+  return Curl_twheel_first(&multi->timewheel, expire_time);
+#else
+  static const struct curltime tv_zero = {0, 0};
+
+  if(!multi->timetree)
+    return FALSE;
+  /* splay the lowest to the bottom */
+  multi->timetree = Curl_splay(tv_zero, multi->timetree);
+  /* this will not return NULL from a non-empty tree, but some compilers
+   * are not convinced of that. Analyzers are hard. */
+  if(!multi->timetree)
+    return FALSE;
+  *expire_time = multi->timetree->key;
+  return TRUE;
+#endif
+}
+
 /*
  * add_next_timeout()
  *
@@ -2928,8 +3091,7 @@ static CURLMcode add_next_timeout(struct curltime now,
 
     /* Insert this node again into the splay. Keep the timer in the list in
        case we need to recompute future timers. */
-    multi->timetree = Curl_splayinsert(*tv, multi->timetree,
-                                       &d->state.timenode);
+    multi_timer_add(multi, d);
   }
   return CURLM_OK;
 }
@@ -2946,7 +3108,6 @@ static CURLMcode multi_run_expired(struct multi_run_ctx *mrc)
 {
   struct Curl_multi *multi = mrc->multi;
   struct Curl_easy *data = NULL;
-  struct Curl_tree *t = NULL;
   CURLMcode result = CURLM_OK;
 
   /*
@@ -2957,13 +3118,9 @@ static CURLMcode multi_run_expired(struct multi_run_ctx *mrc)
   while(1) {
     /* Check if there is one (more) expired timer to deal with! This function
        extracts a matching node if there is one */
-    multi->timetree = Curl_splaygetbest(mrc->now, multi->timetree, &t);
-    if(!t)
-      goto out;
-
-    data = Curl_splayget(t); /* assign this for next loop */
+    data = multi_timer_getbest(multi, &mrc->now);
     if(!data)
-      continue;
+      goto out;
 
     (void)add_next_timeout(mrc->now, multi, data);
     if(data == multi->admin) {
@@ -2996,6 +3153,10 @@ static CURLMcode multi_socket(struct Curl_multi *multi,
   struct multi_run_ctx mrc;
 
   (void)ev_bitmask;
+  if(Curl_mwrk_active(multi))
+    /* the socket interface is not available with worker threads */
+    return CURLM_BAD_FUNCTION_ARGUMENT;
+
   memset(&mrc, 0, sizeof(mrc));
   mrc.multi = multi;
   mrc.now = curlx_now();
@@ -3076,10 +3237,16 @@ CURLMcode curl_multi_setopt(CURLM *m,
     return CURLM_RECURSIVE_API_CALL;
 
   va_start(param, option);
+  /* running workers copy the options */
+  Curl_mwrk_setopt_lock(multi);
 
   switch(option) {
   case CURLMOPT_SOCKETFUNCTION:
     multi->socket_cb = va_arg(param, curl_socket_callback);
+#ifdef USE_EPOLL
+    if(multi->socket_cb)
+      Curl_multi_ev_epoll_stop(multi);
+#endif
     break;
   case CURLMOPT_SOCKETDATA:
     multi->socket_userp = va_arg(param, void *);
@@ -3129,10 +3296,60 @@ CURLMcode curl_multi_setopt(CURLM *m,
       multi->max_concurrent_streams = (unsigned int)streams;
     }
     break;
+  case CURLMOPT_MAX_RESOLVER_THREADS:
+    {
+      long threads = va_arg(param, long);
+      if((threads < 1) || (threads > INT_MAX))
+        threads = CURL_MULTI_RESOLVER_THREADS;
+      multi->max_resolver_threads = (unsigned int)threads;
+    }
+    break;
+  case CURLMOPT_WAIT_EPOLL:
+    {
+      long wanted = va_arg(param, long);
+#ifdef USE_EPOLL
+      multi->ev.ep_wanted = !!wanted;
+      multi->ev.ep_failed = FALSE;
+      if(!wanted)
+        Curl_multi_ev_epoll_stop(multi);
+#else
+      (void)wanted;
+#endif
+    }
+    break;
+  case CURLMOPT_MAX_BUFFER_MEMORY:
+    {
+      curl_off_t max_mem = va_arg(param, curl_off_t);
+      if(max_mem < 0)
+        res = CURLM_BAD_FUNCTION_ARGUMENT;
+      else {
+#if SIZEOF_CURL_OFF_T > SIZEOF_SIZE_T
+        if(max_mem > (curl_off_t)SIZE_T_MAX)
+          max_mem = (curl_off_t)SIZE_T_MAX;
+#endif
+        Curl_bufcp_set_max_mem(&multi->bufcp, (size_t)max_mem);
+      }
+    }
+    break;
+#ifdef USE_MULTI_WORKERS
+  case CURLMOPT_WORKER_THREADS:
+    {
+      long workers = va_arg(param, long);
+      if((workers < 0) || (workers > CURL_MWRK_MAX_WORKERS))
+        res = CURLM_BAD_FUNCTION_ARGUMENT;
+      else if(multi->wrk || (Curl_uint_tbl_count(&multi->xfers) > 1))
+        /* cannot change once transfers have been added */
+        res = CURLM_BAD_FUNCTION_ARGUMENT;
+      else
+        multi->num_workers = (unsigned int)workers;
+    }
+    break;
+#endif
   default:
     res = CURLM_UNKNOWN_OPTION;
     break;
   }
+  Curl_mwrk_setopt_unlock(multi);
   va_end(param);
   return res;
 }
@@ -3176,22 +3393,13 @@ static CURLMcode multi_timeout(struct Curl_multi *multi,
     return CURLM_OK;
   }
 
-  if(multi->timetree) {
-    /* we have a tree of expire times */
+  if(multi_timer_first(multi, expire_time)) {
+    /* we have expire times */
     struct curltime now = curlx_now();
 
-    /* splay the lowest to the bottom */
-    multi->timetree = Curl_splay(tv_zero, multi->timetree);
-    /* this will not return NULL from a non-empty tree, but some compilers
-     * are not convinced of that. Analyzers are hard. */
-    *expire_time = multi->timetree ? multi->timetree->key : tv_zero;
-
-    /* 'multi->timetree' will be non-NULL here but the compilers sometimes
-       yell at us if we assume so */
-    if(multi->timetree &&
-       curlx_timediff_us(multi->timetree->key, now) > 0) {
+    if(curlx_timediff_us(*expire_time, now) > 0) {
       /* some time left before expiration */
-      timediff_t diff = curlx_timediff_ceil(multi->timetree->key, now);
+      timediff_t diff = curlx_timediff_ceil(*expire_time, now);
       /* this should be safe even on 32-bit archs, as we do not use that
          overly long timeouts */
       *timeout_ms = (long)diff;
@@ -3408,8 +3616,7 @@ void Curl_expire_ex(struct Curl_easy *data,
 
     /* Since this is an updated time, we must remove the previous entry from
        the splay tree first and then re-add the new value */
-    rc = Curl_splayremove(multi->timetree, &data->state.timenode,
-                          &multi->timetree);
+    rc = multi_timer_remove(multi, data);
     if(rc)
       infof(data, "Internal error removing splay node = %d", rc);
   }
@@ -3417,9 +3624,7 @@ void Curl_expire_ex(struct Curl_easy *data,
   /* Indicate that we are in the splay tree and insert the new timer expiry
      value since it is our local minimum. */
   *curr_expire = set;
-  Curl_splayset(&data->state.timenode, data);
-  multi->timetree = Curl_splayinsert(*curr_expire, multi->timetree,
-                                     &data->state.timenode);
+  multi_timer_add(multi, data);
 }
 
 /*
@@ -3472,8 +3677,7 @@ bool Curl_expire_clear(struct Curl_easy *data)
     struct Curl_llist *list = &data->state.timeoutlist;
     int rc;
 
-    rc = Curl_splayremove(multi->timetree, &data->state.timenode,
-                          &multi->timetree);
+    rc = multi_timer_remove(multi, data);
     if(rc)
       infof(data, "Internal error clearing splay node = %d", rc);
 
@@ -3562,8 +3766,14 @@ CURL **curl_multi_get_handles(CURLM *m)
 {
   struct Curl_multi *multi = m;
   void *entry;
-  unsigned int count = Curl_uint_tbl_count(&multi->xfers);
-  CURL **a = malloc(sizeof(struct Curl_easy *) * (count + 1));
+  unsigned int count;
+  CURL **a;
+
+  if(Curl_mwrk_active(multi))
+    return Curl_mwrk_get_handles(multi);
+
+  count = Curl_uint_tbl_count(&multi->xfers);
+  a = malloc(sizeof(struct Curl_easy *) * (count + 1));
   if(a) {
     unsigned int i = 0, mid;
 
@@ -3732,6 +3942,18 @@ void Curl_multi_xfer_sockbuf_release(struct Curl_easy *data, char *buf)
   data->multi->xfer_sockbuf_borrowed = FALSE;
 }
 
+struct bufc_pool *Curl_multi_bufcp(struct Curl_easy *data)
+{
+  /* this needs to match the connection pool used by conncache.c */
+  if(!data || CURL_SHARE_KEEP_CONNECT(data->share))
+    return NULL;
+  else if(data->multi_easy)
+    return &data->multi_easy->bufcp;
+  else if(data->multi)
+    return &data->multi->bufcp;
+  return NULL;
+}
+
 static void multi_xfer_bufs_free(struct Curl_multi *multi)
 {
   DEBUGASSERT(multi);
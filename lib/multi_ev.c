@@ -26,6 +26,13 @@
 
 #include <curl/curl.h>
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#endif
+
 #include "urldata.h"
 #include "url.h"
 #include "cfilters.h"
@@ -53,6 +60,79 @@ static void mev_in_callback(struct Curl_multi *multi, bool value)
 
 #define CURL_MEV_CONN_HASH_SIZE 3
 
+/* TRUE when socket changes of transfers (or connections, when `conn`
+ * is set) need to be tracked. Connections are only tracked for the
+ * socket callback, as connection shutdowns are polled separately in
+ * curl_multi_wait(). */
+static bool mev_tracking(struct Curl_multi *multi, struct connectdata *conn)
+{
+  if(multi->socket_cb)
+    return TRUE;
+#ifdef USE_EPOLL
+  if(!conn && (multi->ev.epfd != -1))
+    return TRUE;
+#else
+  (void)conn;
+#endif
+  return FALSE;
+}
+
+#ifdef USE_EPOLL
+/* Change the registration of socket `s` at the epoll instance from
+ * `last_action` to `cur_action`. */
+static CURLMcode mev_epoll_update(struct Curl_multi *multi,
+                                  struct Curl_easy *data,
+                                  curl_socket_t s,
+                                  unsigned int last_action,
+                                  unsigned int cur_action)
+{
+  struct epoll_event ev;
+  int op;
+
+  memset(&ev, 0, sizeof(ev));
+  ev.data.fd = s;
+  if(cur_action & CURL_POLL_IN)
+    ev.events |= EPOLLIN;
+  if(cur_action & CURL_POLL_OUT)
+    ev.events |= EPOLLOUT;
+
+  if(!cur_action) {
+    if(!last_action)
+      return CURLM_OK;
+    /* the socket may already be closed, which removed it from the epoll
+     * instance, so there is no use in checking the outcome */
+    (void)epoll_ctl(multi->ev.epfd, EPOLL_CTL_DEL, s, &ev);
+    DEBUGASSERT(multi->ev.ep_nsocks);
+    multi->ev.ep_nsocks--;
+    return CURLM_OK;
+  }
+
+  op = last_action ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+  if(epoll_ctl(multi->ev.epfd, op, s, &ev)) {
+    /* A socket closed and reopened under the same number is unknown
+     * to epoll, while one that has been dup'ed may still be known. */
+    if((op == EPOLL_CTL_MOD) && (errno == ENOENT))
+      op = EPOLL_CTL_ADD;
+    else if((op == EPOLL_CTL_ADD) && (errno == EEXIST))
+      op = EPOLL_CTL_MOD;
+    else
+      op = -1;
+    if((op == -1) || epoll_ctl(multi->ev.epfd, op, s, &ev)) {
+      /* epoll refuses some descriptors poll() handles fine, e.g. regular
+       * files (EPERM). Give up on epoll, the next wait polls all
+       * transfers again. */
+      CURL_TRC_M(data, "ev epoll_ctl(fd=%" FMT_SOCKET_T ") failed, "
+                 "errno=%d, falling back to poll()", s, errno);
+      multi->ev.ep_failed = TRUE;
+      return CURLM_OK;
+    }
+  }
+  if(!last_action)
+    multi->ev.ep_nsocks++;
+  return CURLM_OK;
+}
+#endif /* USE_EPOLL */
+
 /* Information about a socket for which we inform the libcurl application
  * what to supervise (CURL_POLL_IN/CURL_POLL_OUT/CURL_POLL_REMOVE)
  */
@@ -213,6 +293,12 @@ static CURLMcode mev_forget_socket(struct Curl_multi *multi,
                           multi->socket_userp, entry->user_data);
     mev_in_callback(multi, FALSE);
   }
+#ifdef USE_EPOLL
+  else if(multi->ev.epfd != -1) {
+    CURL_TRC_M(data, "ev %s, epoll remove fd=%" FMT_SOCKET_T, cause, s);
+    (void)mev_epoll_update(multi, data, s, entry->action, 0);
+  }
+#endif
 
   mev_sh_entry_kill(multi, s);
   if(rc == -1) {
@@ -231,14 +317,15 @@ static CURLMcode mev_sh_entry_update(struct Curl_multi *multi,
 {
   int rc, comboaction;
 
-  /* we should only be called when the callback exists */
-  DEBUGASSERT(multi->socket_cb);
-  if(!multi->socket_cb)
+  /* we should only be called when the callback exists or epoll is used */
+  DEBUGASSERT(mev_tracking(multi, NULL));
+  if(!mev_tracking(multi, NULL))
     return CURLM_OK;
 
   /* Transfer `data` goes from `last_action` to `cur_action` on socket `s`
    * with `multi->ev.sh_entries` entry `entry`. Update `entry` and trigger
-   * `multi->socket_cb` on change, if the callback is set. */
+   * `multi->socket_cb` on change, if the callback is set. Without callback,
+   * update the epoll instance instead. */
   if(last_action == cur_action)  /* nothing from `data` changed */
     return CURLM_OK;
 
@@ -275,6 +362,17 @@ static CURLMcode mev_sh_entry_update(struct Curl_multi *multi,
   if(((int)entry->action == comboaction)) /* nothing for socket changed */
     return CURLM_OK;
 
+#ifdef USE_EPOLL
+  if(!multi->socket_cb) {
+    CURLMcode mresult = mev_epoll_update(multi, data, s, entry->action,
+                                         (unsigned int)comboaction);
+    if(mresult)
+      return mresult;
+    entry->action = (unsigned int)comboaction;
+    return CURLM_OK;
+  }
+#endif
+
   CURL_TRC_M(data, "ev update call(fd=%" FMT_SOCKET_T ", ev=%s%s)",
              s, (comboaction & CURL_POLL_IN) ? "IN" : "",
              (comboaction & CURL_POLL_OUT) ? "OUT" : "");
@@ -498,7 +596,7 @@ static CURLMcode mev_assess(struct Curl_multi *multi,
                             struct Curl_easy *data,
                             struct connectdata *conn)
 {
-  if(multi && multi->socket_cb) {
+  if(multi && mev_tracking(multi, conn)) {
     struct easy_pollset ps, *last_ps;
 
     mev_init_cur_pollset(&ps, data, conn);
@@ -540,7 +638,7 @@ CURLMcode Curl_multi_ev_assess_xfer_bset(struct Curl_multi *multi,
   unsigned int mid;
   CURLMcode result = CURLM_OK;
 
-  if(multi && multi->socket_cb && Curl_uint_bset_first(set, &mid)) {
+  if(multi && mev_tracking(multi, NULL) && Curl_uint_bset_first(set, &mid)) {
     do {
       struct Curl_easy *data = Curl_multi_get_easy(multi, mid);
       if(data)
@@ -629,9 +727,93 @@ void Curl_multi_ev_init(struct Curl_multi *multi, size_t hashsize)
 {
   Curl_hash_init(&multi->ev.sh_entries, hashsize, mev_sh_entry_hash,
                  mev_sh_entry_compare, mev_sh_entry_dtor);
+#ifdef USE_EPOLL
+  multi->ev.epfd = -1;
+  multi->ev.ep_nsocks = 0;
+  multi->ev.ep_failed = FALSE;
+  multi->ev.ep_wanted = FALSE;
+#endif
 }
 
 void Curl_multi_ev_cleanup(struct Curl_multi *multi)
 {
+#ifdef USE_EPOLL
+  if(multi->ev.epfd != -1) {
+    close(multi->ev.epfd);
+    multi->ev.epfd = -1;
+  }
+#endif
   Curl_hash_destroy(&multi->ev.sh_entries);
 }
+
+#ifdef USE_EPOLL
+
+int Curl_multi_ev_epoll_fd(struct Curl_multi *multi)
+{
+  if(multi->socket_cb || !multi->ev.ep_wanted)
+    return -1;
+  if(multi->ev.ep_failed) {
+    Curl_multi_ev_epoll_stop(multi);
+    return -1;
+  }
+
+  if(multi->ev.epfd == -1) {
+    multi->ev.epfd = epoll_create1(EPOLL_CLOEXEC);
+    if(multi->ev.epfd == -1) {
+      CURL_TRC_M(multi->admin, "ev epoll_create1() failed, errno=%d", errno);
+      multi->ev.ep_failed = TRUE;
+      return -1;
+    }
+    multi->ev.ep_nsocks = 0;
+    /* Forget whatever was known about sockets before, e.g. from a socket
+     * callback having been in place. Adding all transfers again then
+     * registers every socket in use at the new epoll instance. */
+    Curl_hash_clean(&multi->ev.sh_entries);
+    if(Curl_multi_ev_assess_xfer_bset(multi, &multi->process)) {
+      Curl_multi_ev_epoll_stop(multi);
+      multi->ev.ep_failed = TRUE;
+      return -1;
+    }
+    CURL_TRC_M(multi->admin, "ev epoll instance created, %u sockets",
+               multi->ev.ep_nsocks);
+  }
+  return multi->ev.epfd;
+}
+
+unsigned int Curl_multi_ev_epoll_count(struct Curl_multi *multi)
+{
+  return (multi->ev.epfd != -1) ? multi->ev.ep_nsocks : 0;
+}
+
+/* most events we take from the epoll instance in one wait */
+#define CURL_MEV_EPOLL_EVENTS 64
+
+int Curl_multi_ev_epoll_wait(struct Curl_multi *multi, int timeout_ms)
+{
+  struct epoll_event events[CURL_MEV_EPOLL_EVENTS];
+  int i, n, nready = 0;
+
+  DEBUGASSERT(multi->ev.epfd != -1);
+  n = epoll_wait(multi->ev.epfd, events, CURL_MEV_EPOLL_EVENTS, timeout_ms);
+  if(n < 0)
+    /* make EINTR not a "lethal" error */
+    return (SOCKERRNO == SOCKEINTR) ? 0 : -1;
+  for(i = 0; i < n; ++i) {
+    if(events[i].events & (EPOLLIN|EPOLLOUT|EPOLLERR|EPOLLHUP))
+      nready++;
+  }
+  return nready;
+}
+
+void Curl_multi_ev_epoll_stop(struct Curl_multi *multi)
+{
+  if(multi->ev.epfd != -1) {
+    close(multi->ev.epfd);
+    multi->ev.epfd = -1;
+    multi->ev.ep_nsocks = 0;
+    /* The socket callback needs to learn about all sockets anew */
+    Curl_hash_clean(&multi->ev.sh_entries);
+  }
+}
+
+#endif /* USE_EPOLL */
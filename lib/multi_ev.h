@@ -36,6 +36,13 @@ struct uint_bset;
 
 struct curl_multi_ev {
   struct Curl_hash sh_entries;
+#ifdef USE_EPOLL
+  int epfd; /* epoll instance for curl_multi_wait() or -1 */
+  unsigned int ep_nsocks; /* number of sockets registered at `epfd` */
+  BIT(ep_failed); /* epoll instance could not be created or refused a
+                     socket */
+  BIT(ep_wanted); /* CURLMOPT_WAIT_EPOLL */
+#endif
 };
 
 /* Setup/teardown of multi event book-keeping. */
@@ -80,4 +87,21 @@ void Curl_multi_ev_conn_done(struct Curl_multi *multi,
                              struct Curl_easy *data,
                              struct connectdata *conn);
 
+#ifdef USE_EPOLL
+/* Get the epoll instance that tracks the sockets of all transfers for
+ * curl_multi_wait()/curl_multi_poll(). Creates it on first use.
+ * Returns -1 when CURLMOPT_WAIT_EPOLL is not set, a socket callback is
+ * installed or epoll is not usable. In that case, callers need to collect
+ * pollsets themselves. */
+int Curl_multi_ev_epoll_fd(struct Curl_multi *multi);
+/* Number of sockets currently registered at the epoll instance */
+unsigned int Curl_multi_ev_epoll_count(struct Curl_multi *multi);
+/* Wait up to `timeout_ms` for events on the epoll instance. Returns the
+ * number of transfer sockets with events, at most 64, or -1 on error. */
+int Curl_multi_ev_epoll_wait(struct Curl_multi *multi, int timeout_ms);
+/* A socket callback is being installed or epoll is switched off,
+ * stop using epoll */
+void Curl_multi_ev_epoll_stop(struct Curl_multi *multi);
+#endif
+
 #endif /* HEADER_CURL_MULTI_EV_H */
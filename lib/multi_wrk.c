@@ -0,0 +1,636 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+
+#include "curl_setup.h"
+
+#include <curl/curl.h>
+
+#include "urldata.h"
+#include "multi_wrk.h"
+
+#ifdef USE_MULTI_WORKERS
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#include "curl_threads.h"
+#include "curl_trc.h"
+#include "hash.h"
+#include "llist.h"
+#include "multihandle.h"
+#include "select.h"
+#include "sendf.h"
+#include "socketpair.h"
+#include "curlx/warnless.h"
+/* The last 3 #include files should be in this order */
+#include "curl_printf.h"
+#include "curl_memory.h"
+#include "memdebug.h"
+
+/* How long a worker waits for events when nothing is happening */
+#define MWRK_IDLE_WAIT_MS   1000
+
+#define MWRK_XFER_HASH_SIZE 97
+
+typedef enum {
+  MWRK_XFER_QUEUED,   /* in worker's `adds`, not seen by worker yet */
+  MWRK_XFER_RUNNING,  /* added to the worker's multi handle */
+  MWRK_XFER_REMOVING, /* in worker's `removes`, application waits */
+  MWRK_XFER_REMOVED,  /* worker let go of it on application's request */
+  MWRK_XFER_DONE      /* done, message queued at application's multi */
+} mwrk_xfer_state;
+
+struct mwrk_worker;
+
+/* A transfer added to the application's multi handle */
+struct mwrk_xfer {
+  struct Curl_llist_node node; /* in the worker's `adds` or `removes` */
+  struct Curl_easy *data;
+  struct mwrk_worker *w;       /* the worker running it */
+  mwrk_xfer_state state;
+};
+
+struct mwrk_worker {
+  struct curl_multi_wrk *wrk;
+  struct Curl_multi *multi;    /* the worker's own multi handle */
+  curl_thread_t thread;
+  curl_mutex_t run_lock;       /* held by the worker while it uses `multi`
+                                  and its transfers */
+  pthread_cond_t handed_over;  /* signals `lock_waiters` dropping to 0 */
+  struct Curl_llist adds;      /* transfers to add to `multi` */
+  struct Curl_llist removes;   /* transfers to remove from `multi` */
+  unsigned int nxfers;         /* transfers assigned and not done */
+  unsigned int lock_waiters;   /* application threads wanting `run_lock` */
+  unsigned int opts_gen;       /* `opts_gen` of the options in `multi` */
+};
+
+struct curl_multi_wrk {
+  struct Curl_multi *multi;    /* the application's multi handle */
+  curl_mutex_t lock;           /* protects everything shared below and
+                                  the `msglist` of the `multi` */
+  struct Curl_hash xfers;      /* struct mwrk_xfer by easy handle */
+  struct mwrk_worker *workers;
+  unsigned int nworkers;
+  unsigned int running;        /* transfers not done */
+  unsigned int opts_gen;       /* changes with the options of `multi` */
+  curl_socket_t ack[2];        /* worker signals processed removals */
+  BIT(quit);                   /* workers shall stop */
+};
+
+static void mwrk_xfer_dtor(void *p)
+{
+  free(p);
+}
+
+static struct mwrk_xfer *mwrk_xfer_get(struct curl_multi_wrk *wrk,
+                                       struct Curl_easy *data)
+{
+  return Curl_hash_pick(&wrk->xfers, &data, sizeof(data));
+}
+
+static void mwrk_xfer_kill(struct curl_multi_wrk *wrk, struct Curl_easy *data)
+{
+  Curl_hash_delete(&wrk->xfers, &data, sizeof(data));
+}
+
+static void mwrk_ack(struct curl_multi_wrk *wrk)
+{
+#ifdef USE_EVENTFD
+  const uint64_t buf[1] = { 1 };
+#else
+  const char buf[1] = { 1 };
+#endif
+  (void)wakeup_write(wrk->ack[1], buf, sizeof(buf));
+}
+
+/* The worker's multi handle reported transfer `data` as done with
+ * `result`. The worker has already removed it from its multi handle. */
+static void mwrk_xfer_done(struct mwrk_worker *w, struct Curl_easy *data,
+                           CURLcode result)
+{
+  struct curl_multi_wrk *wrk = w->wrk;
+  struct mwrk_xfer *x;
+  bool wakeup = FALSE;
+
+  Curl_mutex_acquire(&wrk->lock);
+  x = mwrk_xfer_get(wrk, data);
+  DEBUGASSERT(x);
+  if(x) {
+    DEBUGASSERT(x->w == w);
+    if(x->state == MWRK_XFER_REMOVING) {
+      /* application is waiting to have it removed, no message */
+      Curl_node_remove(&x->node);
+      x->state = MWRK_XFER_REMOVED;
+      mwrk_ack(wrk);
+    }
+    else {
+      x->state = MWRK_XFER_DONE;
+      data->msg.extmsg.msg = CURLMSG_DONE;
+      data->msg.extmsg.easy_handle = data;
+      data->msg.extmsg.data.result = result;
+      Curl_llist_append(&wrk->multi->msglist, &data->msg,
+                        &data->msg.list);
+      wakeup = TRUE;
+    }
+    DEBUGASSERT(w->nxfers);
+    w->nxfers--;
+    DEBUGASSERT(wrk->running);
+    wrk->running--;
+  }
+  Curl_mutex_release(&wrk->lock);
+  if(wakeup)
+    (void)curl_multi_wakeup(wrk->multi);
+}
+
+/* Copy the options of the application's multi handle to the worker's.
+ * Called with lock held, in the worker's thread once it runs. */
+static void mwrk_copy_opts(struct mwrk_worker *w)
+{
+  struct Curl_multi *multi = w->wrk->multi;
+
+  w->multi->max_host_connections = multi->max_host_connections;
+  w->multi->max_total_connections = multi->max_total_connections;
+  w->multi->maxconnects = multi->maxconnects;
+  w->multi->max_concurrent_streams = multi->max_concurrent_streams;
+  w->multi->max_resolver_threads = multi->max_resolver_threads;
+  w->multi->multiplexing = multi->multiplexing;
+#ifdef USE_EPOLL
+  w->multi->ev.ep_wanted = multi->ev.ep_wanted;
+  if(!w->multi->ev.ep_wanted)
+    Curl_multi_ev_epoll_stop(w->multi);
+#endif
+  w->multi->push_cb = multi->push_cb;
+  w->multi->push_userp = multi->push_userp;
+  /* workers share the buffer memory limit */
+  Curl_bufcp_set_max_mem(&w->multi->bufcp, !multi->bufcp.max_mem ? 0 :
+                         CURLMAX(multi->bufcp.max_mem / w->wrk->nworkers,
+                                 multi->bufcp.chunk_size));
+  w->opts_gen = w->wrk->opts_gen;
+}
+
+/* Let application threads waiting for `run_lock` have it, before the
+ * worker takes it again. */
+static void mwrk_hand_over(struct mwrk_worker *w)
+{
+  Curl_mutex_acquire(&w->wrk->lock);
+  while(w->lock_waiters)
+    pthread_cond_wait(&w->handed_over, &w->wrk->lock);
+  Curl_mutex_release(&w->wrk->lock);
+}
+
+/* Move all transfers from `src` to `dest`, called with lock held */
+static void mwrk_take_list(struct Curl_llist *src, struct Curl_llist *dest,
+                           bool set_running)
+{
+  struct Curl_llist_node *e;
+  while((e = Curl_llist_head(src))) {
+    struct mwrk_xfer *x = Curl_node_take_elem(e);
+    if(set_running)
+      x->state = MWRK_XFER_RUNNING;
+    Curl_llist_append(dest, x, &x->node);
+  }
+}
+
+static
+#if defined(CURL_WINDOWS_UWP) || defined(UNDER_CE)
+DWORD
+#else
+unsigned int
+#endif
+CURL_STDCALL mwrk_run(void *arg)
+{
+  struct mwrk_worker *w = arg;
+  struct curl_multi_wrk *wrk = w->wrk;
+  struct Curl_llist adds, removes;
+  struct Curl_llist_node *e;
+
+  Curl_llist_init(&adds, NULL);
+  Curl_llist_init(&removes, NULL);
+
+  for(;;) {
+    struct CURLMsg *msg;
+    int running, queued;
+
+    mwrk_hand_over(w);
+    Curl_mutex_acquire(&w->run_lock);
+    Curl_mutex_acquire(&wrk->lock);
+    if(wrk->quit) {
+      Curl_mutex_release(&wrk->lock);
+      Curl_mutex_release(&w->run_lock);
+      break;
+    }
+    if(w->opts_gen != wrk->opts_gen)
+      mwrk_copy_opts(w);
+    mwrk_take_list(&w->adds, &adds, TRUE);
+    /* transfers stay in REMOVING until the worker let go of them */
+    mwrk_take_list(&w->removes, &removes, FALSE);
+    Curl_mutex_release(&wrk->lock);
+
+    while((e = Curl_llist_head(&adds))) {
+      struct mwrk_xfer *x = Curl_node_take_elem(e);
+      CURLMcode mresult = curl_multi_add_handle(w->multi, x->data);
+      if(mresult) {
+        failf(x->data, "worker could not add transfer: %s",
+              curl_multi_strerror(mresult));
+        mwrk_xfer_done(w, x->data, CURLE_OUT_OF_MEMORY);
+      }
+    }
+
+    while((e = Curl_llist_head(&removes))) {
+      struct mwrk_xfer *x = Curl_node_take_elem(e);
+      (void)curl_multi_remove_handle(w->multi, x->data);
+      Curl_mutex_acquire(&wrk->lock);
+      x->state = MWRK_XFER_REMOVED;
+      DEBUGASSERT(w->nxfers);
+      w->nxfers--;
+      DEBUGASSERT(wrk->running);
+      wrk->running--;
+      mwrk_ack(wrk);
+      Curl_mutex_release(&wrk->lock);
+    }
+
+    (void)curl_multi_perform(w->multi, &running);
+
+    while((msg = curl_multi_info_read(w->multi, &queued))) {
+      if(msg->msg == CURLMSG_DONE) {
+        struct Curl_easy *data = msg->easy_handle;
+        CURLcode result = msg->data.result;
+        (void)curl_multi_remove_handle(w->multi, data);
+        mwrk_xfer_done(w, data, result);
+      }
+    }
+
+    (void)curl_multi_poll(w->multi, NULL, 0, MWRK_IDLE_WAIT_MS, NULL);
+    Curl_mutex_release(&w->run_lock);
+  }
+  return 0;
+}
+
+static void mwrk_destroy(struct curl_multi_wrk *wrk)
+{
+  struct Curl_hash_iterator iter;
+  struct Curl_hash_element *he;
+  unsigned int i;
+
+  Curl_mutex_acquire(&wrk->lock);
+  wrk->quit = TRUE;
+  Curl_mutex_release(&wrk->lock);
+
+  for(i = 0; i < wrk->nworkers; ++i) {
+    struct mwrk_worker *w = &wrk->workers[i];
+    if(w->thread) {
+      (void)curl_multi_wakeup(w->multi);
+      Curl_thread_join(&w->thread);
+    }
+  }
+  for(i = 0; i < wrk->nworkers; ++i) {
+    struct mwrk_worker *w = &wrk->workers[i];
+    if(w->multi)
+      /* clears the association of all transfers still present */
+      curl_multi_cleanup(w->multi);
+    if(w->wrk) {
+      Curl_mutex_destroy(&w->run_lock);
+      pthread_cond_destroy(&w->handed_over);
+    }
+  }
+  Curl_hash_start_iterate(&wrk->xfers, &iter);
+  for(he = Curl_hash_next_element(&iter); he;
+      he = Curl_hash_next_element(&iter)) {
+    struct mwrk_xfer *x = he->ptr;
+    x->data->mwrk = NULL;
+  }
+  free(wrk->workers);
+  Curl_hash_destroy(&wrk->xfers);
+  if(wrk->ack[0] != CURL_SOCKET_BAD)
+    wakeup_close(wrk->ack[0]);
+#ifndef USE_EVENTFD
+  if(wrk->ack[1] != CURL_SOCKET_BAD)
+    wakeup_close(wrk->ack[1]);
+#endif
+  Curl_mutex_destroy(&wrk->lock);
+  free(wrk);
+}
+
+/* Create the worker multi handles with the options of the application's
+ * multi and start their threads. */
+static CURLMcode mwrk_start(struct Curl_multi *multi)
+{
+  struct curl_multi_wrk *wrk;
+  unsigned int i;
+
+  DEBUGASSERT(!multi->wrk);
+  wrk = calloc(1, sizeof(*wrk));
+  if(!wrk)
+    return CURLM_OUT_OF_MEMORY;
+  wrk->multi = multi;
+  Curl_mutex_init(&wrk->lock);
+  Curl_hash_init(&wrk->xfers, MWRK_XFER_HASH_SIZE, Curl_hash_str,
+                 curlx_str_key_compare, mwrk_xfer_dtor);
+  if(wakeup_create(wrk->ack, FALSE) < 0) {
+    wrk->ack[0] = wrk->ack[1] = CURL_SOCKET_BAD;
+    goto error;
+  }
+
+  wrk->workers = calloc(multi->num_workers, sizeof(struct mwrk_worker));
+  if(!wrk->workers)
+    goto error;
+  wrk->nworkers = multi->num_workers;
+
+  for(i = 0; i < wrk->nworkers; ++i) {
+    struct mwrk_worker *w = &wrk->workers[i];
+    w->wrk = wrk;
+    w->thread = curl_thread_t_null;
+    Curl_mutex_init(&w->run_lock);
+    pthread_cond_init(&w->handed_over, NULL);
+    Curl_llist_init(&w->adds, NULL);
+    Curl_llist_init(&w->removes, NULL);
+    w->multi = curl_multi_init();
+    if(!w->multi)
+      goto error;
+    mwrk_copy_opts(w);
+  }
+
+  for(i = 0; i < wrk->nworkers; ++i) {
+    struct mwrk_worker *w = &wrk->workers[i];
+    w->thread = Curl_thread_create(mwrk_run, w);
+    if(!w->thread)
+      goto error;
+  }
+
+  multi->wrk = wrk;
+  CURL_TRC_M(multi->admin, "started %u worker threads", wrk->nworkers);
+  return CURLM_OK;
+
+error:
+  mwrk_destroy(wrk);
+  return CURLM_OUT_OF_MEMORY;
+}
+
+/* TRUE if called from one of the worker threads */
+static bool mwrk_in_worker(struct curl_multi_wrk *wrk)
+{
+  unsigned int i;
+  for(i = 0; i < wrk->nworkers; ++i) {
+    if(wrk->workers[i].thread &&
+       pthread_equal(pthread_self(), *wrk->workers[i].thread))
+      return TRUE;
+  }
+  return FALSE;
+}
+
+CURLMcode Curl_mwrk_add(struct Curl_multi *multi, struct Curl_easy *data)
+{
+  struct curl_multi_wrk *wrk;
+  struct mwrk_worker *w = NULL;
+  struct mwrk_xfer *x;
+  unsigned int i;
+  CURLMcode mresult = CURLM_OK;
+
+  if(!multi->wrk) {
+    mresult = mwrk_start(multi);
+    if(mresult)
+      return mresult;
+  }
+  wrk = multi->wrk;
+
+  Curl_mutex_acquire(&wrk->lock);
+  if(mwrk_xfer_get(wrk, data)) {
+    mresult = CURLM_ADDED_ALREADY;
+    goto out;
+  }
+  /* Not known to us, so no worker touches it and we may look at it */
+  if(data->multi) {
+    mresult = CURLM_ADDED_ALREADY;
+    goto out;
+  }
+
+  x = calloc(1, sizeof(*x));
+  if(!x) {
+    mresult = CURLM_OUT_OF_MEMORY;
+    goto out;
+  }
+  if(!Curl_hash_add(&wrk->xfers, &data, sizeof(data), x)) {
+    free(x);
+    mresult = CURLM_OUT_OF_MEMORY;
+    goto out;
+  }
+
+  /* the worker with the least transfers gets it */
+  for(i = 0; i < wrk->nworkers; ++i) {
+    if(!w || (wrk->workers[i].nxfers < w->nxfers))
+      w = &wrk->workers[i];
+  }
+  x->data = data;
+  x->w = w;
+  x->state = MWRK_XFER_QUEUED;
+  data->mwrk = w;
+  Curl_llist_append(&w->adds, x, &x->node);
+  w->nxfers++;
+  wrk->running++;
+
+out:
+  Curl_mutex_release(&wrk->lock);
+  if(!mresult)
+    (void)curl_multi_wakeup(w->multi);
+  return mresult;
+}
+
+CURLMcode Curl_mwrk_remove(struct Curl_multi *multi, struct Curl_easy *data)
+{
+  struct curl_multi_wrk *wrk = multi->wrk;
+  struct mwrk_xfer *x;
+  struct mwrk_worker *w;
+
+  if(!wrk)
+    return CURLM_OK;
+  if(mwrk_in_worker(wrk))
+    return CURLM_RECURSIVE_API_CALL;
+
+  Curl_mutex_acquire(&wrk->lock);
+  x = mwrk_xfer_get(wrk, data);
+  if(!x) {
+    /* already removed, or never added */
+    Curl_mutex_release(&wrk->lock);
+    return CURLM_OK;
+  }
+
+  w = x->w;
+  switch(x->state) {
+  case MWRK_XFER_QUEUED:
+    /* the worker has not seen it yet */
+    Curl_node_remove(&x->node);
+    w->nxfers--;
+    wrk->running--;
+    break;
+  case MWRK_XFER_RUNNING:
+    x->state = MWRK_XFER_REMOVING;
+    Curl_llist_append(&w->removes, x, &x->node);
+    Curl_mutex_release(&wrk->lock);
+    (void)curl_multi_wakeup(w->multi);
+    /* Wait for the worker to let go of the transfer. Since only one
+     * thread at a time may use the multi handle, every signal on `ack`
+     * is for us. */
+    for(;;) {
+      char buf[64];
+      int rc = SOCKET_READABLE(wrk->ack[0], MWRK_IDLE_WAIT_MS);
+      if(rc > 0)
+        (void)wakeup_read(wrk->ack[0], buf, sizeof(buf));
+      Curl_mutex_acquire(&wrk->lock);
+      if(x->state == MWRK_XFER_REMOVED)
+        break;
+      Curl_mutex_release(&wrk->lock);
+    }
+    break;
+  default:
+    /* done and no longer used by the worker */
+    break;
+  }
+
+  /* make sure there is no pending message from this transfer */
+  if(Curl_node_llist(&data->msg.list) == &multi->msglist)
+    Curl_node_remove(&data->msg.list);
+  data->mwrk = NULL;
+  mwrk_xfer_kill(wrk, data);
+  Curl_mutex_release(&wrk->lock);
+  return CURLM_OK;
+}
+
+CURLMcode Curl_mwrk_perform(struct Curl_multi *multi, int *running_handles)
+{
+  struct curl_multi_wrk *wrk = multi->wrk;
+  unsigned int running = 0;
+
+  if(wrk) {
+    Curl_mutex_acquire(&wrk->lock);
+    running = wrk->running;
+    Curl_mutex_release(&wrk->lock);
+  }
+  if(running_handles)
+    *running_handles = (running < INT_MAX) ? (int)running : INT_MAX;
+  return CURLM_OK;
+}
+
+CURLMsg *Curl_mwrk_info_read(struct Curl_multi *multi, int *msgs_in_queue)
+{
+  struct curl_multi_wrk *wrk = multi->wrk;
+  struct Curl_message *msg = NULL;
+  struct Curl_llist_node *e;
+
+  *msgs_in_queue = 0;
+  if(!wrk)
+    return NULL;
+
+  Curl_mutex_acquire(&wrk->lock);
+  e = Curl_llist_head(&multi->msglist);
+  if(e) {
+    msg = Curl_node_take_elem(e);
+    *msgs_in_queue = curlx_uztosi(Curl_llist_count(&multi->msglist));
+  }
+  Curl_mutex_release(&wrk->lock);
+  return msg ? &msg->extmsg : NULL;
+}
+
+CURL **Curl_mwrk_get_handles(struct Curl_multi *multi)
+{
+  struct curl_multi_wrk *wrk = multi->wrk;
+  struct Curl_hash_iterator iter;
+  struct Curl_hash_element *he;
+  CURL **a;
+  size_t i = 0;
+
+  if(!wrk)
+    return calloc(1, sizeof(CURL *));
+
+  Curl_mutex_acquire(&wrk->lock);
+  a = malloc(sizeof(CURL *) * (Curl_hash_count(&wrk->xfers) + 1));
+  if(a) {
+    Curl_hash_start_iterate(&wrk->xfers, &iter);
+    for(he = Curl_hash_next_element(&iter); he;
+        he = Curl_hash_next_element(&iter)) {
+      struct mwrk_xfer *x = he->ptr;
+      a[i++] = x->data;
+    }
+    a[i] = NULL;
+  }
+  Curl_mutex_release(&wrk->lock);
+  return a;
+}
+
+void Curl_mwrk_setopt_lock(struct Curl_multi *multi)
+{
+  if(multi->wrk)
+    Curl_mutex_acquire(&multi->wrk->lock);
+}
+
+void Curl_mwrk_setopt_unlock(struct Curl_multi *multi)
+{
+  struct curl_multi_wrk *wrk = multi->wrk;
+  unsigned int i;
+
+  if(!wrk)
+    return;
+  wrk->opts_gen++;
+  Curl_mutex_release(&wrk->lock);
+  for(i = 0; i < wrk->nworkers; ++i)
+    (void)curl_multi_wakeup(wrk->workers[i].multi);
+}
+
+void Curl_mwrk_easy_lock(struct Curl_easy *data)
+{
+  struct mwrk_worker *w = data->mwrk;
+
+  /* callbacks run in the worker that holds the lock already */
+  if(!w || pthread_equal(pthread_self(), *w->thread))
+    return;
+  Curl_mutex_acquire(&w->wrk->lock);
+  w->lock_waiters++;
+  Curl_mutex_release(&w->wrk->lock);
+  /* get the worker out of its poll */
+  (void)curl_multi_wakeup(w->multi);
+  Curl_mutex_acquire(&w->run_lock);
+  Curl_mutex_acquire(&w->wrk->lock);
+  if(!--w->lock_waiters)
+    pthread_cond_signal(&w->handed_over);
+  Curl_mutex_release(&w->wrk->lock);
+}
+
+void Curl_mwrk_easy_unlock(struct Curl_easy *data)
+{
+  struct mwrk_worker *w = data->mwrk;
+
+  if(!w || pthread_equal(pthread_self(), *w->thread))
+    return;
+  Curl_mutex_release(&w->run_lock);
+}
+
+void Curl_mwrk_cleanup(struct Curl_multi *multi)
+{
+  if(multi->wrk) {
+    mwrk_destroy(multi->wrk);
+    multi->wrk = NULL;
+  }
+}
+
+#endif /* USE_MULTI_WORKERS */
@@ -0,0 +1,99 @@
+#ifndef HEADER_CURL_MULTI_WRK_H
+#define HEADER_CURL_MULTI_WRK_H
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+
+#include "curl_setup.h"
+
+struct Curl_easy;
+struct Curl_multi;
+
+/* Worker threads, see CURLMOPT_WORKER_THREADS. Each worker runs its own
+ * internal multi handle in its own thread. Transfers added to the
+ * application's multi handle are handed to the least busy worker.
+ * Workers remove completed transfers from their multi and queue the
+ * message at the application's multi handle. */
+#if defined(USE_THREADS_POSIX) && !defined(CURL_DISABLE_SOCKETPAIR) && \
+  !defined(USE_WINSOCK)
+#define USE_MULTI_WORKERS
+#endif
+
+/* maximum number for CURLMOPT_WORKER_THREADS */
+#define CURL_MWRK_MAX_WORKERS  256
+
+#ifdef USE_MULTI_WORKERS
+
+struct curl_multi_wrk;
+struct mwrk_worker;
+
+/* TRUE iff the multi handle runs its transfers in worker threads */
+#define Curl_mwrk_active(m)   ((m)->num_workers > 0)
+
+/* Hand the transfer to a worker, start workers on first use. */
+CURLMcode Curl_mwrk_add(struct Curl_multi *multi, struct Curl_easy *data);
+
+/* Remove the transfer from its worker. Returns once the worker no
+ * longer uses it. */
+CURLMcode Curl_mwrk_remove(struct Curl_multi *multi, struct Curl_easy *data);
+
+/* Get the number of transfers not done yet. */
+CURLMcode Curl_mwrk_perform(struct Curl_multi *multi, int *running_handles);
+
+/* Get the next message of a transfer done by a worker. */
+CURLMsg *Curl_mwrk_info_read(struct Curl_multi *multi, int *msgs_in_queue);
+
+/* Get a NULL terminated array of all added easy handles. */
+CURL **Curl_mwrk_get_handles(struct Curl_multi *multi);
+
+/* Stop all workers and release all resources. */
+void Curl_mwrk_cleanup(struct Curl_multi *multi);
+
+/* Around changing options of the application's multi handle. The
+ * workers pick up the changes on their next run. */
+void Curl_mwrk_setopt_lock(struct Curl_multi *multi);
+void Curl_mwrk_setopt_unlock(struct Curl_multi *multi);
+
+/* Around application calls on an easy handle that a worker may be
+ * running, like curl_easy_pause(). Keeps the worker from using the
+ * handle meanwhile. Does nothing when called from the worker itself. */
+void Curl_mwrk_easy_lock(struct Curl_easy *data);
+void Curl_mwrk_easy_unlock(struct Curl_easy *data);
+
+#else /* USE_MULTI_WORKERS */
+
+#define Curl_mwrk_active(m)              FALSE
+#define Curl_mwrk_add(m,d)               CURLM_INTERNAL_ERROR
+#define Curl_mwrk_remove(m,d)            CURLM_INTERNAL_ERROR
+#define Curl_mwrk_perform(m,r)           CURLM_INTERNAL_ERROR
+#define Curl_mwrk_info_read(m,q)         NULL
+#define Curl_mwrk_get_handles(m)         NULL
+#define Curl_mwrk_cleanup(m)             Curl_nop_stmt
+#define Curl_mwrk_setopt_lock(m)         Curl_nop_stmt
+#define Curl_mwrk_setopt_unlock(m)       Curl_nop_stmt
+#define Curl_mwrk_easy_lock(d)           Curl_nop_stmt
+#define Curl_mwrk_easy_unlock(d)         Curl_nop_stmt
+
+#endif /* !USE_MULTI_WORKERS */
+
+#endif /* HEADER_CURL_MULTI_WRK_H */
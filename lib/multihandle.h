@@ -26,12 +26,16 @@
 
 #include "llist.h"
 #include "hash.h"
+#include "bufq.h"
+#include "content_encoding.h"
 #include "conncache.h"
 #include "cshutdn.h"
 #include "hostip.h"
 #include "multi_ev.h"
+#include "multi_wrk.h"
 #include "psl.h"
 #include "socketpair.h"
+#include "timewheel.h"
 #include "uint-bset.h"
 #include "uint-spbset.h"
 #include "uint-table.h"
@@ -122,13 +126,20 @@ struct Curl_multi {
   struct PslCache psl;
 #endif
 
+#ifdef USE_TIMER_WHEEL
+  /* timing wheel of time nodes to figure out expire times of all
+     currently set timers */
+  struct Curl_twheel timewheel;
+#else
   /* timetree points to the splay-tree of time nodes to figure out expire
      times of all currently set timers */
   struct Curl_tree *timetree;
+#endif
 
   /* buffer used for transfer data, lazy initialized */
   char *xfer_buf; /* the actual buffer */
   size_t xfer_buf_len;      /* the allocated length */
+  struct curl_borrow *xfer_borrow; /* received data is passed from here */
   /* buffer used for upload data, lazy initialized */
   char *xfer_ulbuf; /* the actual buffer */
   size_t xfer_ulbuf_len;      /* the allocated length */
@@ -147,8 +158,19 @@ struct Curl_multi {
    * the multi handle is cleaned up (see Curl_hash_add2()).*/
   struct Curl_hash proto_hash;
 
+#ifdef USE_MULTI_WORKERS
+  struct curl_multi_wrk *wrk; /* worker threads, once started */
+  unsigned int num_workers; /* CURLMOPT_WORKER_THREADS */
+#endif
+
   struct cshutdn cshutdn; /* connection shutdown handling */
   struct cpool cpool;     /* connection pool (bundles) */
+  struct bufc_pool bufcp; /* buffer chunks for all connections in `cpool`,
+                             limited by CURLMOPT_MAX_BUFFER_MEMORY */
+  struct cdec_pool cdecp; /* spare content decoder states */
+#ifdef CURLRES_THREADED
+  struct async_thrdd_pool *resolver_pool; /* threads resolving names */
+#endif
 
   long max_host_connections; /* if >0, a fixed limit of the maximum number
                                 of connections per host */
@@ -175,6 +197,7 @@ struct Curl_multi {
   unsigned int maxconnects; /* if >0, a fixed limit of the maximum number of
                                entries we are allowed to grow the connection
                                cache to */
+  unsigned int max_resolver_threads; /* CURLMOPT_MAX_RESOLVER_THREADS */
 #define IPV6_UNKNOWN 0
 #define IPV6_DEAD    1
 #define IPV6_WORKS   2
@@ -163,6 +163,17 @@ CURLcode Curl_multi_xfer_sockbuf_borrow(struct Curl_easy *data,
  */
 void Curl_multi_xfer_sockbuf_release(struct Curl_easy *data, char *buf);
 
+/* Size of the chunks in the multi's buffer pool */
+#define CURL_MULTI_CHUNK_SIZE   (16 * 1024)
+
+/**
+ * Get the pool of buffer chunks shared by all connections of the
+ * multi handle the transfer's connections belong to. Returns NULL
+ * when connections are kept in a share, as these may outlive the
+ * multi handle.
+ */
+struct bufc_pool *Curl_multi_bufcp(struct Curl_easy *data);
+
 /**
  * Get the easy handle for the given mid.
  * Returns NULL if not found.
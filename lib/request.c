@@ -25,9 +25,11 @@
 #include "curl_setup.h"
 
 #include "urldata.h"
+#include "borrow.h"
 #include "cfilters.h"
 #include "curlx/dynbuf.h"
 #include "doh.h"
+#include "http.h"
 #include "multiif.h"
 #include "progress.h"
 #include "request.h"
@@ -70,6 +72,10 @@ CURLcode Curl_req_soft_reset(struct SingleRequest *req,
   req->httpversion_sent = 0;
   req->httpversion = 0;
   req->sendbuf_hds_len = 0;
+#ifndef CURL_DISABLE_HTTP
+  Curl_http_req_h2_free(req->h2req);
+  req->h2req = NULL;
+#endif
 
   result = Curl_client_start(data);
   if(result)
@@ -122,6 +128,10 @@ void Curl_req_hard_reset(struct SingleRequest *req, struct Curl_easy *data)
   Curl_client_reset(data);
   if(req->sendbuf_init)
     Curl_bufq_reset(&req->sendbuf);
+#ifndef CURL_DISABLE_HTTP
+  Curl_http_req_h2_free(req->h2req);
+  req->h2req = NULL;
+#endif
 
 #ifndef CURL_DISABLE_DOH
   Curl_doh_close(data);
@@ -171,6 +181,12 @@ void Curl_req_free(struct SingleRequest *req, struct Curl_easy *data)
   Curl_safefree(req->newurl);
   if(req->sendbuf_init)
     Curl_bufq_free(&req->sendbuf);
+  Curl_borrow_drop(req->borrow);
+  req->borrow = NULL;
+#ifndef CURL_DISABLE_HTTP
+  Curl_http_req_h2_free(req->h2req);
+  req->h2req = NULL;
+#endif
   Curl_client_cleanup(data);
 }
 
@@ -32,6 +32,7 @@
 
 /* forward declarations */
 struct UserDefined;
+struct http_req_h2;
 
 enum expect100 {
   EXP100_SEND_DATA,           /* enough waiting, just send the body now */
@@ -92,6 +93,8 @@ struct SingleRequest {
    * checks, pausing by client callbacks. */
   struct Curl_creader *reader_stack;
   struct bufq sendbuf; /* data which needs to be send to the server */
+  struct curl_borrow *borrow; /* receive buffer for CURLOPT_BORROWFUNCTION */
+  struct http_req_h2 *h2req; /* HTTP/2 and HTTP/3 headers of the request */
   size_t sendbuf_hds_len; /* amount of header bytes in sendbuf */
   time_t timeofdoc;
   char *location;   /* This points to an allocated version of the Location:
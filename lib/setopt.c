@@ -421,6 +421,22 @@ static CURLcode setopt_long(struct Curl_easy *data, CURLoption option,
 
     data->set.dns_cache_timeout = (int)arg;
     break;
+  case CURLOPT_DNS_NEGATIVE_TIMEOUT:
+    if(arg < 0)
+      return CURLE_BAD_FUNCTION_ARGUMENT;
+    else if(arg > INT_MAX)
+      arg = INT_MAX;
+
+    data->set.dns_negative_timeout = (int)arg;
+    break;
+  case CURLOPT_DNS_REFRESH_AHEAD:
+    if(arg < 0)
+      return CURLE_BAD_FUNCTION_ARGUMENT;
+    else if(arg > INT_MAX)
+      arg = INT_MAX;
+
+    data->set.dns_refresh_ahead = (int)arg;
+    break;
   case CURLOPT_CA_CACHE_TIMEOUT:
     if(Curl_ssl_supports(data, SSLSUPP_CA_CACHE)) {
       if(arg < -1)
@@ -633,6 +649,12 @@ static CURLcode setopt_long(struct Curl_easy *data, CURLoption option,
      */
     data->set.cookiesession = enabled;
     break;
+  case CURLOPT_COOKIEJOURNAL:
+    /*
+     * Append cookie changes to the cookie jar file as they happen.
+     */
+    data->set.cookie_journal = enabled;
+    break;
 #endif
   case CURLOPT_AUTOREFERER:
     /*
@@ -1342,6 +1364,18 @@ static CURLcode setopt_long(struct Curl_easy *data, CURLoption option,
     break;
 #else
     return CURLE_NOT_BUILT_IN;
+#endif
+  case CURLOPT_STREAM_URGENCY:
+#if defined(USE_HTTP2) || defined(USE_HTTP3)
+    if(arg == -1)
+      data->set.priority.urgency = -1;
+    else if((arg < 0) || ((arg & ~CURLURGENCY_INCREMENTAL) > 7))
+      return CURLE_BAD_FUNCTION_ARGUMENT;
+    else
+      data->set.priority.urgency = (int)arg;
+    break;
+#else
+    return CURLE_NOT_BUILT_IN;
 #endif
   case CURLOPT_SUPPRESS_CONNECT_HEADERS:
     data->set.suppress_connect_headers = enabled;
@@ -2065,6 +2099,13 @@ static CURLcode setopt_cptr(struct Curl_easy *data, CURLoption option,
     data->set.prereq_userp = ptr;
     break;
 
+  case CURLOPT_BORROWDATA:
+    /*
+     * Custom pointer to pass to the borrow callback
+     */
+    data->set.borrow_data = ptr;
+    break;
+
   case CURLOPT_ERRORBUFFER:
     /*
      * Error buffer provided by the caller to get the human readable error
@@ -2425,6 +2466,15 @@ static CURLcode setopt_cptr(struct Curl_easy *data, CURLoption option,
       return Curl_setstropt(&data->set.str[STRING_SSL_SIGNATURE_ALGORITHMS],
                             ptr);
     return CURLE_NOT_BUILT_IN;
+#endif
+  case CURLOPT_SSL_SESSION_FILE:
+    /*
+     * File to load SSL sessions from and to save new ones in.
+     */
+#ifdef USE_SSLS_FILE
+    return Curl_setstropt(&data->set.str[STRING_SSL_SESSION_FILE], ptr);
+#else
+    return CURLE_NOT_BUILT_IN;
 #endif
 #ifdef USE_SSH
   case CURLOPT_SSH_PUBLIC_KEYFILE:
@@ -2507,6 +2557,10 @@ static CURLcode setopt_cptr(struct Curl_easy *data, CURLoption option,
     /* Authorization identity (identity to act as) */
     return Curl_setstropt(&data->set.str[STRING_SASL_AUTHZID], ptr);
 
+  case CURLOPT_DNS_CACHE_FILE:
+    /* File to load the DNS cache from and to save it to */
+    return Curl_setstropt(&data->set.str[STRING_DNS_CACHE_FILE], ptr);
+
 #ifndef CURL_DISABLE_RTSP
   case CURLOPT_RTSP_SESSION_ID:
     /*
@@ -2760,6 +2814,12 @@ static CURLcode setopt_func(struct Curl_easy *data, CURLoption option,
       /* When set to NULL, reset to our internal default function */
       data->set.fwrite_func = (curl_write_callback)fwrite;
     break;
+  case CURLOPT_BORROWFUNCTION:
+    /*
+     * Set callback that borrows the received body data
+     */
+    data->set.fborrow = va_arg(param, curl_borrow_callback);
+    break;
   case CURLOPT_READFUNCTION:
     /*
      * Read data callback
@@ -3090,7 +3150,10 @@ CURLcode curl_easy_setopt(CURL *d, CURLoption tag, ...)
 
   va_start(arg, tag);
 
+  /* a worker thread may be running the transfer */
+  Curl_mwrk_easy_lock(data);
   result = Curl_vsetopt(data, tag, arg);
+  Curl_mwrk_easy_unlock(data);
 
   va_end(arg);
   if(result == CURLE_BAD_FUNCTION_ARGUMENT)
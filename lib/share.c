@@ -250,6 +250,7 @@ curl_share_cleanup(CURLSH *sh)
     Curl_cpool_destroy(&share->cpool);
   }
 
+  (void)Curl_dnscache_save(share->admin, &share->dnscache);
   Curl_dnscache_destroy(&share->dnscache);
 
 #if !defined(CURL_DISABLE_HTTP) && !defined(CURL_DISABLE_COOKIES)
@@ -0,0 +1,288 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+
+#include "curl_setup.h"
+
+#include "curlx/timeval.h"
+#include "timewheel.h"
+
+#define TWHEEL_MASK       (TWHEEL_SLOTS - 1)
+#define TWHEEL_OVERFLOW   (TWHEEL_LEVELS * TWHEEL_SLOTS)
+
+/* The level a node with tick `t` belongs to is determined by the most
+ * significant TWHEEL_BITS digit in which `t` differs from the wheel's
+ * current tick. All nodes at a level then expire before all nodes at
+ * the levels above, and a lower slot index at a level means earlier.
+ * When the wheel advances, nodes whose digit has been reached are
+ * placed again, ending up at lower levels. Nodes already due are kept
+ * in the level 0 slot of the current tick. */
+
+void Curl_twheel_init(struct Curl_twheel *w, const struct curltime *now)
+{
+  memset(w, 0, sizeof(*w));
+  w->base = *now;
+}
+
+static curl_uint64_t twheel_tick(struct Curl_twheel *w,
+                                 const struct curltime *key)
+{
+  timediff_t ms = curlx_timediff(*key, w->base);
+  return (ms > 0) ? (curl_uint64_t)ms : 0;
+}
+
+/* Get the level for a node at tick `t` */
+static unsigned int twheel_level(struct Curl_twheel *w, curl_uint64_t t)
+{
+  curl_uint64_t diff = t ^ w->now_tick;
+  unsigned int level = 0;
+
+  while((level < TWHEEL_LEVELS) && (diff >> ((level + 1) * TWHEEL_BITS)))
+    ++level;
+  return level;
+}
+
+/* Index of the lowest bit set in a non-zero `mask` */
+static unsigned int twheel_lowest(curl_uint64_t mask)
+{
+  unsigned int n = 0;
+  DEBUGASSERT(mask);
+  if(!(mask & 0xffffffff)) {
+    n += 32;
+    mask >>= 32;
+  }
+  if(!(mask & 0xffff)) {
+    n += 16;
+    mask >>= 16;
+  }
+  if(!(mask & 0xff)) {
+    n += 8;
+    mask >>= 8;
+  }
+  if(!(mask & 0xf)) {
+    n += 4;
+    mask >>= 4;
+  }
+  if(!(mask & 0x3)) {
+    n += 2;
+    mask >>= 2;
+  }
+  if(!(mask & 0x1))
+    n += 1;
+  return n;
+}
+
+static void twheel_link(struct Curl_twheel *w, struct Curl_twnode *node)
+{
+  curl_uint64_t t = (node->tick > w->now_tick) ? node->tick : w->now_tick;
+  unsigned int level = twheel_level(w, t);
+  struct Curl_twslot *slot;
+
+  if(level >= TWHEEL_LEVELS)
+    node->pos = TWHEEL_OVERFLOW;
+  else {
+    unsigned int idx = (unsigned int)(t >> (level * TWHEEL_BITS)) &
+      TWHEEL_MASK;
+    node->pos = (level * TWHEEL_SLOTS) + idx;
+    w->used[level] |= ((curl_uint64_t)1 << idx);
+  }
+
+  slot = &w->slots[node->pos];
+  node->next = NULL;
+  node->prev = slot->tail;
+  if(slot->tail)
+    slot->tail->next = node;
+  else
+    slot->head = node;
+  slot->tail = node;
+}
+
+static void twheel_unlink(struct Curl_twheel *w, struct Curl_twnode *node)
+{
+  struct Curl_twslot *slot = &w->slots[node->pos];
+
+  if(node->prev)
+    node->prev->next = node->next;
+  else
+    slot->head = node->next;
+  if(node->next)
+    node->next->prev = node->prev;
+  else
+    slot->tail = node->prev;
+  node->next = node->prev = NULL;
+
+  if(!slot->head && (node->pos != TWHEEL_OVERFLOW)) {
+    unsigned int level = node->pos / TWHEEL_SLOTS;
+    unsigned int idx = node->pos % TWHEEL_SLOTS;
+    w->used[level] &= ~((curl_uint64_t)1 << idx);
+  }
+}
+
+/* Move all nodes of the slot to the end of `list`. */
+static void twheel_take_slot(struct Curl_twheel *w, unsigned int pos,
+                             struct Curl_twslot *list)
+{
+  struct Curl_twslot *slot = &w->slots[pos];
+
+  if(!slot->head)
+    return;
+  if(list->tail) {
+    list->tail->next = slot->head;
+    slot->head->prev = list->tail;
+  }
+  else
+    list->head = slot->head;
+  list->tail = slot->tail;
+  slot->head = slot->tail = NULL;
+  if(pos != TWHEEL_OVERFLOW)
+    w->used[pos / TWHEEL_SLOTS] &= ~((curl_uint64_t)1 << (pos % TWHEEL_SLOTS));
+}
+
+/* Advance the wheel to `tick` and place all nodes again whose level
+ * changes by this. */
+static void twheel_advance(struct Curl_twheel *w, curl_uint64_t tick)
+{
+  struct Curl_twslot moved;
+  struct Curl_twnode *node;
+  unsigned int level, i;
+
+  if(tick <= w->now_tick)
+    return;
+
+  /* the highest level at which current and new tick differ */
+  level = twheel_level(w, tick);
+  moved.head = moved.tail = NULL;
+
+  if(level >= TWHEEL_LEVELS) {
+    /* everything may change place */
+    for(i = 0; i < TWHEEL_NSLOTS; ++i)
+      twheel_take_slot(w, i, &moved);
+  }
+  else {
+    unsigned int idx = (unsigned int)(tick >> (level * TWHEEL_BITS)) &
+      TWHEEL_MASK;
+    unsigned int l;
+    /* all nodes on lower levels are due now */
+    for(l = 0; l < level; ++l) {
+      while(w->used[l])
+        twheel_take_slot(w, (l * TWHEEL_SLOTS) + twheel_lowest(w->used[l]),
+                         &moved);
+    }
+    /* nodes at this level up to the new tick's slot move down */
+    while(w->used[level]) {
+      i = twheel_lowest(w->used[level]);
+      if(i > idx)
+        break;
+      twheel_take_slot(w, (level * TWHEEL_SLOTS) + i, &moved);
+    }
+  }
+
+  w->now_tick = tick;
+  node = moved.head;
+  while(node) {
+    struct Curl_twnode *next = node->next;
+    twheel_link(w, node);
+    node = next;
+  }
+}
+
+void Curl_twheel_add(struct Curl_twheel *w, struct curltime key,
+                     struct Curl_twnode *node)
+{
+  DEBUGASSERT(!node->added);
+  node->key = key;
+  node->tick = twheel_tick(w, &key);
+  twheel_link(w, node);
+  node->added = TRUE;
+  w->count++;
+}
+
+void Curl_twheel_remove(struct Curl_twheel *w, struct Curl_twnode *node)
+{
+  if(node->added) {
+    twheel_unlink(w, node);
+    node->added = FALSE;
+    DEBUGASSERT(w->count);
+    w->count--;
+  }
+}
+
+struct Curl_twnode *Curl_twheel_getbest(struct Curl_twheel *w,
+                                        const struct curltime *now)
+{
+  struct Curl_twnode *node;
+
+  if(!w->count)
+    return NULL;
+
+  twheel_advance(w, twheel_tick(w, now));
+  /* all nodes at or before `now` are in the slot of the current tick */
+  node = w->slots[w->now_tick & TWHEEL_MASK].head;
+  while(node) {
+    if(curlx_timediff_us(node->key, *now) <= 0) {
+      Curl_twheel_remove(w, node);
+      return node;
+    }
+    node = node->next;
+  }
+  return NULL;
+}
+
+bool Curl_twheel_first(struct Curl_twheel *w, struct curltime *key)
+{
+  struct Curl_twnode *node, *first = NULL;
+  unsigned int level;
+
+  if(!w->count)
+    return FALSE;
+
+  for(level = 0; level < TWHEEL_LEVELS; ++level) {
+    if(w->used[level]) {
+      node = w->slots[(level * TWHEEL_SLOTS) +
+                      twheel_lowest(w->used[level])].head;
+      break;
+    }
+  }
+  if(level == TWHEEL_LEVELS)
+    node = w->slots[TWHEEL_OVERFLOW].head;
+
+  for(; node; node = node->next) {
+    if(!first || (curlx_timediff_us(node->key, first->key) < 0))
+      first = node;
+  }
+  DEBUGASSERT(first);
+  if(!first)
+    return FALSE;
+  *key = first->key;
+  return TRUE;
+}
+
+void Curl_twheel_set(struct Curl_twnode *node, void *payload)
+{
+  node->ptr = payload;
+}
+
+void *Curl_twheel_get(struct Curl_twnode *node)
+{
+  return node->ptr;
+}
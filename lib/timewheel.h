@@ -0,0 +1,90 @@
+#ifndef HEADER_CURL_TIMEWHEEL_H
+#define HEADER_CURL_TIMEWHEEL_H
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "curl_setup.h"
+#include "curlx/timeval.h"
+
+/*
+ * A hierarchical timing wheel, an alternative to the splay tree for
+ * ordering timers. Adding and removing a node is O(1). The wheel has
+ * TWHEEL_LEVELS levels of TWHEEL_SLOTS slots each, with a resolution
+ * of one millisecond at level 0. Each level covers TWHEEL_SLOTS times
+ * the duration of the level below. Nodes are moved down the levels as
+ * the wheel advances. Nodes beyond the last level are kept in an
+ * overflow slot.
+ */
+#define TWHEEL_BITS     6
+#define TWHEEL_SLOTS    (1 << TWHEEL_BITS)
+#define TWHEEL_LEVELS   5
+/* all slots of all levels plus the overflow slot */
+#define TWHEEL_NSLOTS   ((TWHEEL_LEVELS * TWHEEL_SLOTS) + 1)
+
+/* only use function calls to access these structs */
+struct Curl_twnode {
+  struct Curl_twnode *next;
+  struct Curl_twnode *prev;
+  struct curltime key;       /* this node's expire time */
+  curl_uint64_t tick;        /* the key in ticks of the wheel */
+  void *ptr;                 /* data the wheel does not care about */
+  unsigned int pos;          /* slot index the node is in */
+  BIT(added);                /* node is in a wheel */
+};
+
+struct Curl_twslot {
+  struct Curl_twnode *head;
+  struct Curl_twnode *tail;
+};
+
+struct Curl_twheel {
+  struct Curl_twslot slots[TWHEEL_NSLOTS];
+  curl_uint64_t used[TWHEEL_LEVELS]; /* bitmask of non-empty slots */
+  struct curltime base;      /* time of tick 0 */
+  curl_uint64_t now_tick;    /* the tick the wheel has advanced to */
+  size_t count;              /* number of nodes in the wheel */
+};
+
+void Curl_twheel_init(struct Curl_twheel *w, const struct curltime *now);
+
+/* Add the node with the given key. The node must not be in a wheel. */
+void Curl_twheel_add(struct Curl_twheel *w, struct curltime key,
+                     struct Curl_twnode *node);
+
+/* Remove the node from the wheel, if it is added. */
+void Curl_twheel_remove(struct Curl_twheel *w, struct Curl_twnode *node);
+
+/* Remove and return a node whose key is not later than `now`, or
+ * NULL if there is none. Nodes expiring in the same millisecond are
+ * returned in the order they were added. */
+struct Curl_twnode *Curl_twheel_getbest(struct Curl_twheel *w,
+                                        const struct curltime *now);
+
+/* Get the earliest key in the wheel. Returns FALSE if empty. */
+bool Curl_twheel_first(struct Curl_twheel *w, struct curltime *key);
+
+/* set and get the custom payload for this wheel node */
+void Curl_twheel_set(struct Curl_twnode *node, void *payload);
+void *Curl_twheel_get(struct Curl_twnode *node);
+
+#endif /* HEADER_CURL_TIMEWHEEL_H */
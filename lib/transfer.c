@@ -61,6 +61,7 @@
 #include <curl/curl.h>
 #include "netrc.h"
 
+#include "borrow.h"
 #include "content_encoding.h"
 #include "hostip.h"
 #include "cfilters.h"
@@ -273,10 +274,21 @@ static CURLcode sendrecv_dl(struct Curl_easy *data,
   curl_off_t total_received = 0;
   bool is_multiplex = FALSE;
   bool rcvd_eagain = FALSE;
+  bool borrow = !!data->set.fborrow;
+  struct curl_borrow *prev_src = NULL;
 
-  result = Curl_multi_xfer_buf_borrow(data, &xfer_buf, &xfer_blen);
-  if(result)
-    goto out;
+  if(borrow) {
+    /* receive into `k->borrow`, renewed below when the application
+     * holds on to it */
+    xfer_buf = NULL;
+    xfer_blen = 0;
+    prev_src = Curl_borrow_set_src(data, NULL);
+  }
+  else {
+    result = Curl_multi_xfer_buf_borrow(data, &xfer_buf, &xfer_blen);
+    if(result)
+      goto out;
+  }
 
   /* This is where we loop until we have read everything there is to
      read or we get a CURLE_AGAIN */
@@ -292,6 +304,13 @@ static CURLcode sendrecv_dl(struct Curl_easy *data,
       is_multiplex = Curl_conn_is_multiplex(conn, FIRSTSOCKET);
     }
 
+    if(borrow) {
+      result = Curl_borrow_renew(&k->borrow, (size_t)data->set.buffer_size);
+      if(result)
+        goto out;
+      xfer_buf = Curl_borrow_mem(k->borrow, &xfer_blen);
+      Curl_borrow_set_src(data, k->borrow);
+    }
     buf = xfer_buf;
     bytestoread = xfer_blen;
 
@@ -379,7 +398,10 @@ static CURLcode sendrecv_dl(struct Curl_easy *data,
   }
 
 out:
-  Curl_multi_xfer_buf_release(data, xfer_buf);
+  if(borrow)
+    Curl_borrow_set_src(data, prev_src);
+  else
+    Curl_multi_xfer_buf_release(data, xfer_buf);
   if(result)
     DEBUGF(infof(data, "sendrecv_dl() -> %d", result));
   return result;
@@ -608,6 +630,9 @@ CURLcode Curl_pretransfer(struct Curl_easy *data)
   /* If there is a list of hsts files to read */
   Curl_hsts_loadfiles(data);
 
+  /* If there is a DNS cache file to read */
+  Curl_dnscache_loadfile(data);
+
   if(!result) {
     /* Allow data->set.use_port to set which port to use. This needs to be
      * disabled for example when we follow Location: headers to URLs using
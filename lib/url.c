@@ -479,6 +479,7 @@ CURLcode Curl_init_userdefined(struct Curl_easy *data)
     ;
 #if defined(USE_HTTP2) || defined(USE_HTTP3)
   memset(&set->priority, 0, sizeof(set->priority));
+  set->priority.urgency = -1;
 #endif
   set->quick_exit = 0L;
 #ifndef CURL_DISABLE_WEBSOCKETS
@@ -153,6 +153,7 @@ typedef unsigned int curl_prot_t;
 #include "hostip.h"
 #include "hash.h"
 #include "splay.h"
+#include "timewheel.h"
 #include "curlx/dynbuf.h"
 #include "dynhds.h"
 #include "request.h"
@@ -936,6 +937,8 @@ struct PureInfo {
   char *wouldredirect; /* URL this would have been redirected to if asked to */
   curl_off_t retry_after; /* info from Retry-After: header */
   unsigned int header_size;  /* size of read header(s) in bytes */
+  curl_off_t h2_window; /* largest HTTP/2 stream window granted */
+  timediff_t h2_rtt; /* HTTP/2 round trip time estimate, microseconds */
 
   /* PureInfo primary ip_quadruple is copied over from the connectdata
      struct in order to allow curl_easy_getinfo() to return this information
@@ -1056,6 +1059,7 @@ struct Curl_data_priority {
   struct Curl_data_prio_node *children;
 #endif
   int weight;
+  int urgency; /* CURLOPT_STREAM_URGENCY, -1 when not set */
 #ifdef USE_NGHTTP2
   BIT(exclusive);
 #endif
@@ -1079,6 +1083,7 @@ typedef enum {
   EXPIRE_FTP_ACCEPT,
   EXPIRE_ALPN_EYEBALLS,
   EXPIRE_SHUTDOWN,
+  EXPIRE_BUFFERS,
   EXPIRE_LAST /* not an actual timer, used as a marker only */
 } expire_id;
 
@@ -1170,7 +1175,11 @@ struct UrlState {
   BIT(provider_loaded);
 #endif /* USE_OPENSSL */
   struct curltime expiretime; /* set this with Curl_expire() only */
+#ifdef USE_TIMER_WHEEL
+  struct Curl_twnode timenode; /* for the timer wheel */
+#else
   struct Curl_tree timenode; /* for the splay stuff */
+#endif
   struct Curl_llist timeoutlist; /* list of pending timeouts */
   struct time_node expires[EXPIRE_LAST]; /* nodes for each expire type */
 
@@ -1306,6 +1315,7 @@ struct UrlState {
                     internal use and the user does not have ownership of the
                     handle. */
   BIT(http_ignorecustom); /* ignore custom method from now */
+  BIT(cpool_locked); /* holds the lock of a connection pool shard */
 };
 
 /*
@@ -1427,6 +1437,7 @@ enum dupstring {
   STRING_HSTS,                  /* CURLOPT_HSTS */
 #endif
   STRING_SASL_AUTHZID,          /* CURLOPT_SASL_AUTHZID */
+  STRING_DNS_CACHE_FILE,        /* CURLOPT_DNS_CACHE_FILE */
 #ifdef USE_ARES
   STRING_DNS_SERVERS,
   STRING_DNS_INTERFACE,
@@ -1443,6 +1454,9 @@ enum dupstring {
   STRING_ECH_CONFIG,            /* CURLOPT_ECH_CONFIG */
   STRING_ECH_PUBLIC,            /* CURLOPT_ECH_PUBLIC */
   STRING_SSL_SIGNATURE_ALGORITHMS, /* CURLOPT_SSL_SIGNATURE_ALGORITHMS */
+#ifdef USE_SSLS_FILE
+  STRING_SSL_SESSION_FILE,      /* CURLOPT_SSL_SESSION_FILE */
+#endif
 
   /* -- end of null-terminated strings -- */
 
@@ -1489,6 +1503,8 @@ struct UserDefined {
   curl_write_callback fwrite_func;   /* function that stores the output */
   curl_write_callback fwrite_header; /* function that stores headers */
   curl_write_callback fwrite_rtp;    /* function that stores interleaved RTP */
+  curl_borrow_callback fborrow; /* function that borrows the output */
+  void *borrow_data; /* CURLOPT_BORROWDATA */
   curl_read_callback fread_func_set; /* function that reads the input */
   curl_progress_callback fprogress; /* OLD and deprecated progress callback  */
   curl_xferinfo_callback fxferinfo; /* progress callback */
@@ -1554,6 +1570,8 @@ struct UserDefined {
 #endif
   struct ssl_general_config general_ssl; /* general user defined SSL stuff */
   int dns_cache_timeout; /* DNS cache timeout (seconds) */
+  int dns_negative_timeout; /* negative DNS cache timeout (seconds) */
+  int dns_refresh_ahead; /* refresh DNS cache entries this early (seconds) */
   unsigned int buffer_size;      /* size of receive buffer to use */
   unsigned int upload_buffer_size; /* size of upload buffer to use,
                                       keep it >= CURL_MAX_WRITE_SIZE */
@@ -1687,6 +1705,7 @@ struct UserDefined {
   BIT(sep_headers);     /* handle host and proxy headers separately */
 #ifndef CURL_DISABLE_COOKIES
   BIT(cookiesession);   /* new cookie session? */
+  BIT(cookie_journal);  /* append cookie changes to the jar file */
 #endif
   BIT(crlf);            /* convert crlf on ftp upload(?) */
 #ifdef USE_SSH
@@ -1829,6 +1848,10 @@ struct Curl_easy {
   struct Curl_multi *multi_easy; /* if non-NULL, points to the multi handle
                                     struct to which this "belongs" when used
                                     by the easy interface */
+#ifdef USE_MULTI_WORKERS
+  struct mwrk_worker *mwrk; /* the worker thread running the transfer,
+                               see CURLMOPT_WORKER_THREADS */
+#endif
   struct Curl_share *share;    /* Share, handles global variable mutexing */
 
   /* `meta_hash` is a general key-value store for implementations
@@ -628,8 +628,7 @@ static ssize_t cf_msh3_send(struct Curl_cfilter *cf, struct Curl_easy *data,
 {
   struct cf_msh3_ctx *ctx = cf->ctx;
   struct h3_stream_ctx *stream = H3_STREAM_CTX(ctx, data);
-  struct h1_req_parser h1;
-  struct dynhds h2_headers;
+  struct http_req_h2 *h2req = NULL;
   MSH3_HEADER *nva = NULL;
   size_t nheader, i;
   ssize_t nwritten = -1;
@@ -637,30 +636,24 @@ static ssize_t cf_msh3_send(struct Curl_cfilter *cf, struct Curl_easy *data,
 
   CF_DATA_SAVE(save, cf, data);
 
-  Curl_h1_req_parse_init(&h1, H1_PARSE_DEFAULT_MAX_LINE_LEN);
-  Curl_dynhds_init(&h2_headers, 0, DYN_HTTP_REQUEST);
-
   /* Sizes must match for cast below to work" */
   DEBUGASSERT(stream);
   CURL_TRC_CF(data, cf, "req: send %zu bytes", len);
 
   if(!stream->req) {
     /* The first send on the request contains the headers and possibly some
-       data. Parse out the headers and create the request, then if there is
-       any data left over go ahead and send it too. */
-    nwritten = Curl_h1_req_parse_read(&h1, buf, len, NULL, 0, err);
+       data. Skip the headers and create the request from the ones prepared
+       for it, then if there is any data left over go ahead and send it
+       too. */
+    nwritten = Curl_http_req_h2_take(data, len, &h2req, err);
     if(nwritten < 0)
       goto out;
-    DEBUGASSERT(h1.done);
-    DEBUGASSERT(h1.req);
-
-    *err = Curl_http_req_to_h2(&h2_headers, h1.req, data);
-    if(*err) {
-      nwritten = -1;
+    if(!h2req) {
+      /* need more data */
       goto out;
     }
 
-    nheader = Curl_dynhds_count(&h2_headers);
+    nheader = Curl_http_req_h2_count(h2req);
     nva = malloc(sizeof(MSH3_HEADER) * nheader);
     if(!nva) {
       *err = CURLE_OUT_OF_MEMORY;
@@ -669,11 +662,12 @@ static ssize_t cf_msh3_send(struct Curl_cfilter *cf, struct Curl_easy *data,
     }
 
     for(i = 0; i < nheader; ++i) {
-      struct dynhds_entry *e = Curl_dynhds_getn(&h2_headers, i);
-      nva[i].Name = e->name;
-      nva[i].NameLength = e->namelen;
-      nva[i].Value = e->value;
-      nva[i].ValueLength = e->valuelen;
+      struct http_req_h2_field f;
+      Curl_http_req_h2_getn(h2req, i, &f);
+      nva[i].Name = f.name;
+      nva[i].NameLength = f.namelen;
+      nva[i].Value = f.value;
+      nva[i].ValueLength = f.valuelen;
     }
 
     CURL_TRC_CF(data, cf, "req: send %zu headers", nheader);
@@ -712,8 +706,7 @@ static ssize_t cf_msh3_send(struct Curl_cfilter *cf, struct Curl_easy *data,
 out:
   set_quic_expire(cf, data);
   free(nva);
-  Curl_h1_req_parse_free(&h1);
-  Curl_dynhds_free(&h2_headers);
+  Curl_http_req_h2_free(h2req);
   CF_DATA_RESTORE(cf, save);
   return nwritten;
 }
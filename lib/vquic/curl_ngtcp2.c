@@ -48,6 +48,7 @@
 
 #include "../urldata.h"
 #include "../uint-hash.h"
+#include "../bufq_nocpy.h"
 #include "../sendf.h"
 #include "../strdup.h"
 #include "../rand.h"
@@ -85,27 +86,17 @@
 
 /* A stream window is the maximum amount we need to buffer for
  * each active transfer. We use HTTP/3 flow control and only ACK
- * when we take things out of the buffer.
- * Chunk size is large enough to take a full DATA frame */
+ * when we take things out of the buffer. */
 #define H3_STREAM_WINDOW_SIZE (128 * 1024)
-#define H3_STREAM_CHUNK_SIZE   (16 * 1024)
-#if H3_STREAM_CHUNK_SIZE < NGTCP2_MAX_UDP_PAYLOAD_SIZE
-#error H3_STREAM_CHUNK_SIZE smaller than NGTCP2_MAX_UDP_PAYLOAD_SIZE
-#endif
 
-/* The pool keeps spares around and half of a full stream windows
- * seems good. More does not seem to improve performance.
- * The benefit of the pool is that stream buffer to not keep
- * spares. Memory consumption goes down when streams run empty,
- * have a large upload done, etc. */
-#define H3_STREAM_POOL_SPARES \
-          (H3_STREAM_WINDOW_SIZE / H3_STREAM_CHUNK_SIZE ) / 2
-/* Receive and Send max number of chunks just follows from the
- * chunk size and window size */
-#define H3_STREAM_RECV_CHUNKS \
-          (H3_STREAM_WINDOW_SIZE / H3_STREAM_CHUNK_SIZE)
-#define H3_STREAM_SEND_CHUNKS \
-          (H3_STREAM_WINDOW_SIZE / H3_STREAM_CHUNK_SIZE)
+/* The request body is kept until the server ACKs it. Copied sends go
+ * into chunks of the connection's chunk pool, borrowed ones are
+ * referenced. The pools keep spare segments of entries and spare
+ * chunks, which streams do not keep once they run empty. */
+#define H3_STREAM_SEND_MAX      H3_STREAM_WINDOW_SIZE
+#define H3_STREAM_CHUNK_SIZE    (16 * 1024)
+#define H3_STREAM_NBUF_ENTRIES  16
+#define H3_STREAM_POOL_SPARES   8
 
 
 /*
@@ -140,7 +131,8 @@ struct cf_ngtcp2_ctx {
   nghttp3_settings h3settings;
   struct curltime started_at;        /* time the current attempt started */
   struct curltime handshake_at;      /* time connect handshake finished */
-  struct bufc_pool stream_bufcp;     /* chunk pool for streams */
+  struct bufc_pool stream_bufcp;     /* chunk pool for copied sends */
+  struct bufq_nocpy_pool stream_nbufp; /* entry pool for streams */
   struct dynbuf scratch;             /* temp buffer for header construction */
   struct uint_hash streams;          /* hash `data->mid` to `h3_stream_ctx` */
   size_t max_stream_window;          /* max flow window for one stream */
@@ -174,6 +166,8 @@ static void cf_ngtcp2_ctx_init(struct cf_ngtcp2_ctx *ctx)
   ctx->max_stream_window = H3_STREAM_WINDOW_SIZE;
   Curl_bufcp_init(&ctx->stream_bufcp, H3_STREAM_CHUNK_SIZE,
                   H3_STREAM_POOL_SPARES);
+  Curl_bufq_nocpy_pool_init(&ctx->stream_nbufp, H3_STREAM_NBUF_ENTRIES,
+                            H3_STREAM_POOL_SPARES, &ctx->stream_bufcp);
   curlx_dyn_init(&ctx->scratch, CURL_MAX_HTTP_HEADER);
   Curl_uint_hash_init(&ctx->streams, 63, h3_stream_hash_free);
   ctx->initialized = TRUE;
@@ -184,9 +178,10 @@ static void cf_ngtcp2_ctx_free(struct cf_ngtcp2_ctx *ctx)
   if(ctx && ctx->initialized) {
     Curl_vquic_tls_cleanup(&ctx->tls);
     vquic_ctx_free(&ctx->q);
-    Curl_bufcp_free(&ctx->stream_bufcp);
     curlx_dyn_free(&ctx->scratch);
     Curl_uint_hash_destroy(&ctx->streams);
+    Curl_bufq_nocpy_pool_free(&ctx->stream_nbufp);
+    Curl_bufcp_free(&ctx->stream_bufcp);
     Curl_ssl_peer_cleanup(&ctx->peer);
   }
   free(ctx);
@@ -234,6 +229,19 @@ struct pkt_io_ctx;
 static CURLcode cf_progress_ingress(struct Curl_cfilter *cf,
                                     struct Curl_easy *data,
                                     struct pkt_io_ctx *pktx);
+/* The time in ns it takes to send `len` bytes at the pacing rate of
+ * ngtcp2's congestion control: the congestion window per smoothed RTT,
+ * times 1.25. */
+static uint64_t cf_ngtcp2_pace_ns(struct cf_ngtcp2_ctx *ctx, size_t len)
+{
+  ngtcp2_conn_info cinfo;
+
+  ngtcp2_conn_get_conn_info(ctx->qconn, &cinfo);
+  if(!cinfo.cwnd)
+    return 0;
+  return (uint64_t)len * cinfo.smoothed_rtt * 4 / 5 / cinfo.cwnd;
+}
+
 static CURLcode cf_progress_egress(struct Curl_cfilter *cf,
                                    struct Curl_easy *data,
                                    struct pkt_io_ctx *pktx);
@@ -243,8 +251,7 @@ static CURLcode cf_progress_egress(struct Curl_cfilter *cf,
  */
 struct h3_stream_ctx {
   curl_int64_t id; /* HTTP/3 protocol identifier */
-  struct bufq sendbuf;   /* h3 request body */
-  struct h1_req_parser h1; /* h1 request parsing */
+  struct bufq_nocpy sendbuf; /* h3 request body */
   size_t sendbuf_len_in_flight; /* sendbuf amount "in flight" */
   curl_uint64_t error3; /* HTTP/3 stream error code */
   curl_off_t upload_left; /* number of request bytes left to upload */
@@ -259,8 +266,7 @@ struct h3_stream_ctx {
 
 static void h3_stream_ctx_free(struct h3_stream_ctx *stream)
 {
-  Curl_bufq_free(&stream->sendbuf);
-  Curl_h1_req_parse_free(&stream->h1);
+  Curl_bufq_nocpy_free(&stream->sendbuf);
   free(stream);
 }
 
@@ -289,10 +295,9 @@ static CURLcode h3_data_setup(struct Curl_cfilter *cf,
 
   stream->id = -1;
   /* on send, we control how much we put into the buffer */
-  Curl_bufq_initp(&stream->sendbuf, &ctx->stream_bufcp,
-                  H3_STREAM_SEND_CHUNKS, BUFQ_OPT_NONE);
+  Curl_bufq_nocpy_init(&stream->sendbuf, &ctx->stream_nbufp,
+                       H3_STREAM_SEND_MAX, NULL);
   stream->sendbuf_len_in_flight = 0;
-  Curl_h1_req_parse_init(&stream->h1, H1_PARSE_DEFAULT_MAX_LINE_LEN);
 
   if(!Curl_uint_hash_set(&ctx->streams, data->mid, stream)) {
     h3_stream_ctx_free(stream);
@@ -1381,11 +1386,11 @@ static int cb_h3_acked_req_body(nghttp3_conn *conn, int64_t stream_id,
     skiplen = stream->sendbuf_len_in_flight;
   else
     skiplen = (size_t)datalen;
-  Curl_bufq_skip(&stream->sendbuf, skiplen);
+  Curl_bufq_nocpy_skip(&stream->sendbuf, skiplen);
   stream->sendbuf_len_in_flight -= skiplen;
 
   /* Resume upload processing if we have more data to send */
-  if(stream->sendbuf_len_in_flight < Curl_bufq_len(&stream->sendbuf)) {
+  if(stream->sendbuf_len_in_flight < Curl_bufq_nocpy_len(&stream->sendbuf)) {
     int rv = nghttp3_conn_resume_stream(conn, stream_id);
     if(rv && rv != NGHTTP3_ERR_STREAM_NOT_FOUND) {
       return NGHTTP3_ERR_CALLBACK_FAILURE;
@@ -1421,13 +1426,13 @@ cb_h3_read_req_body(nghttp3_conn *conn, int64_t stream_id,
    * ACKed yet.
    * Any amount beyond `sendbuf_len_in_flight` we need still to pass
    * to nghttp3. Do that now, if we can. */
-  if(stream->sendbuf_len_in_flight < Curl_bufq_len(&stream->sendbuf)) {
+  if(stream->sendbuf_len_in_flight < Curl_bufq_nocpy_len(&stream->sendbuf)) {
     nvecs = 0;
     while(nvecs < veccnt &&
-          Curl_bufq_peek_at(&stream->sendbuf,
-                            stream->sendbuf_len_in_flight,
-                            CURL_UNCONST(&vec[nvecs].base),
-                            &vec[nvecs].len)) {
+          Curl_bufq_nocpy_peek_at(&stream->sendbuf,
+                                  stream->sendbuf_len_in_flight,
+                                  CURL_UNCONST(&vec[nvecs].base),
+                                  &vec[nvecs].len)) {
       stream->sendbuf_len_in_flight += vec[nvecs].len;
       nwritten += vec[nvecs].len;
       ++nvecs;
@@ -1455,7 +1460,7 @@ cb_h3_read_req_body(nghttp3_conn *conn, int64_t stream_id,
               "%d vecs%s with %zu (buffered=%zu, left=%" FMT_OFF_T ")",
               stream->id, (int)nvecs,
               *pflags == NGHTTP3_DATA_FLAG_EOF ? " EOF" : "",
-              nwritten, Curl_bufq_len(&stream->sendbuf),
+              nwritten, Curl_bufq_nocpy_len(&stream->sendbuf),
               stream->upload_left);
   return (nghttp3_ssize)nvecs;
 }
@@ -1472,7 +1477,7 @@ static ssize_t h3_stream_open(struct Curl_cfilter *cf,
   struct cf_ngtcp2_ctx *ctx = cf->ctx;
   struct h3_stream_ctx *stream = NULL;
   int64_t sid;
-  struct dynhds h2_headers;
+  struct http_req_h2 *h2req = NULL;
   size_t nheader;
   nghttp3_nv *nva = NULL;
   int rc = 0;
@@ -1481,8 +1486,6 @@ static ssize_t h3_stream_open(struct Curl_cfilter *cf,
   nghttp3_data_reader reader;
   nghttp3_data_reader *preader = NULL;
 
-  Curl_dynhds_init(&h2_headers, 0, DYN_HTTP_REQUEST);
-
   *err = h3_data_setup(cf, data);
   if(*err)
     goto out;
@@ -1493,24 +1496,16 @@ static ssize_t h3_stream_open(struct Curl_cfilter *cf,
     goto out;
   }
 
-  nwritten = Curl_h1_req_parse_read(&stream->h1, buf, len, NULL, 0, err);
+  /* skip the HTTP/1 request head, we send the headers prepared for it */
+  nwritten = Curl_http_req_h2_take(data, len, &h2req, err);
   if(nwritten < 0)
     goto out;
-  if(!stream->h1.done) {
+  if(!h2req) {
     /* need more data */
     goto out;
   }
-  DEBUGASSERT(stream->h1.req);
-
-  *err = Curl_http_req_to_h2(&h2_headers, stream->h1.req, data);
-  if(*err) {
-    nwritten = -1;
-    goto out;
-  }
-  /* no longer needed */
-  Curl_h1_req_parse_free(&stream->h1);
 
-  nheader = Curl_dynhds_count(&h2_headers);
+  nheader = Curl_http_req_h2_count(h2req);
   nva = malloc(sizeof(nghttp3_nv) * nheader);
   if(!nva) {
     *err = CURLE_OUT_OF_MEMORY;
@@ -1519,11 +1514,12 @@ static ssize_t h3_stream_open(struct Curl_cfilter *cf,
   }
 
   for(i = 0; i < nheader; ++i) {
-    struct dynhds_entry *e = Curl_dynhds_getn(&h2_headers, i);
-    nva[i].name = (unsigned char *)e->name;
-    nva[i].namelen = e->namelen;
-    nva[i].value = (unsigned char *)e->value;
-    nva[i].valuelen = e->valuelen;
+    struct http_req_h2_field f;
+    Curl_http_req_h2_getn(h2req, i, &f);
+    nva[i].name = (unsigned char *)CURL_UNCONST(f.name);
+    nva[i].namelen = f.namelen;
+    nva[i].value = (unsigned char *)CURL_UNCONST(f.value);
+    nva[i].valuelen = f.valuelen;
     nva[i].flags = NGHTTP3_NV_FLAG_NONE;
   }
 
@@ -1591,7 +1587,7 @@ static ssize_t h3_stream_open(struct Curl_cfilter *cf,
 
 out:
   free(nva);
-  Curl_dynhds_free(&h2_headers);
+  Curl_http_req_h2_free(h2req);
   return nwritten;
 }
 
@@ -1667,7 +1663,9 @@ static ssize_t cf_ngtcp2_send(struct Curl_cfilter *cf, struct Curl_easy *data,
     goto out;
   }
   else {
-    sent = Curl_bufq_write(&stream->sendbuf, buf, len, err);
+    size_t nwritten;
+    *err = Curl_bufq_nocpy_cwrite(&stream->sendbuf, buf, len, &nwritten);
+    sent = *err ? -1 : (ssize_t)nwritten;
     CURL_TRC_CF(data, cf, "[%" FMT_PRId64 "] cf_send, add to "
                 "sendbuf(len=%zu) -> %zd, %d",
                 stream->id, len, sent, *err);
@@ -1954,10 +1952,8 @@ static CURLcode cf_progress_egress(struct Curl_cfilter *cf,
       continue;
     }
 
-    if(++pktcnt >= max_pktcnt || (size_t)nread < gsolen) {
-      /* Reached MAX_PKT_BURST *or*
-       * the capacity of our buffer *or*
-       * last add was shorter than the previous ones, flush */
+    if((size_t)nread < gsolen) {
+      /* last add was shorter than the previous ones, flush */
       curlcode = vquic_send(cf, data, &ctx->q, gsolen);
       if(curlcode) {
         if(curlcode == CURLE_AGAIN) {
@@ -1966,7 +1962,22 @@ static CURLcode cf_progress_egress(struct Curl_cfilter *cf,
         }
         return curlcode;
       }
-      /* pktbuf has been completely sent */
+      pktcnt = 0;
+    }
+    else if(++pktcnt >= max_pktcnt) {
+      /* Reached MAX_PKT_BURST *or* the capacity of our buffer. Queue
+       * the burst to be sent paced after the previous one, flushes
+       * unless the socket does pacing. */
+      curlcode = vquic_send_queue(cf, data, &ctx->q, gsolen,
+                                  cf_ngtcp2_pace_ns(ctx, pktcnt * gsolen));
+      if(curlcode) {
+        if(curlcode == CURLE_AGAIN) {
+          Curl_expire(data, 1, EXPIRE_QUIC);
+          return CURLE_OK;
+        }
+        return curlcode;
+      }
+      /* burst has been queued or sent */
       pktcnt = 0;
     }
   }
@@ -2024,7 +2035,7 @@ static CURLcode cf_ngtcp2_data_event(struct Curl_cfilter *cf,
     struct h3_stream_ctx *stream = H3_STREAM_CTX(ctx, data);
     if(stream && !stream->send_closed) {
       stream->send_closed = TRUE;
-      stream->upload_left = Curl_bufq_len(&stream->sendbuf) -
+      stream->upload_left = Curl_bufq_nocpy_len(&stream->sendbuf) -
         stream->sendbuf_len_in_flight;
       (void)nghttp3_conn_resume_stream(ctx->h3conn, stream->id);
     }
@@ -2504,6 +2515,7 @@ static const struct alpn_spec ALPN_SPEC_H3 = {
                    &ctx->q.local_addrlen);
   if(rv == -1)
     return CURLE_QUIC_CONNECT_ERROR;
+  vquic_ctx_set_txtime(&ctx->q);
 
   ngtcp2_addr_init(&ctx->connected_path.local,
                    (struct sockaddr *)&ctx->q.local_addr,
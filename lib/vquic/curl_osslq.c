@@ -576,7 +576,6 @@ struct h3_stream_ctx {
   struct cf_osslq_stream s;
   struct bufq sendbuf;   /* h3 request body */
   struct bufq recvbuf;   /* h3 response body */
-  struct h1_req_parser h1; /* h1 request parsing */
   size_t sendbuf_len_in_flight; /* sendbuf amount "in flight" */
   size_t recv_buf_nonflow; /* buffered bytes, not counting for flow control */
   curl_uint64_t error3; /* HTTP/3 stream error code */
@@ -595,7 +594,6 @@ static void h3_stream_ctx_free(struct h3_stream_ctx *stream)
   cf_osslq_stream_cleanup(&stream->s);
   Curl_bufq_free(&stream->sendbuf);
   Curl_bufq_free(&stream->recvbuf);
-  Curl_h1_req_parse_free(&stream->h1);
   free(stream);
 }
 
@@ -632,7 +630,6 @@ static CURLcode h3_data_setup(struct Curl_cfilter *cf,
   Curl_bufq_initp(&stream->recvbuf, &ctx->stream_bufcp,
                   H3_STREAM_RECV_CHUNKS, BUFQ_OPT_SOFT_LIMIT);
   stream->recv_buf_nonflow = 0;
-  Curl_h1_req_parse_init(&stream->h1, H1_PARSE_DEFAULT_MAX_LINE_LEN);
 
   if(!Curl_uint_hash_set(&ctx->streams, data->mid, stream)) {
     h3_stream_ctx_free(stream);
@@ -1886,7 +1883,7 @@ static ssize_t h3_stream_open(struct Curl_cfilter *cf,
 {
   struct cf_osslq_ctx *ctx = cf->ctx;
   struct h3_stream_ctx *stream = NULL;
-  struct dynhds h2_headers;
+  struct http_req_h2 *h2req = NULL;
   size_t nheader;
   nghttp3_nv *nva = NULL;
   int rc = 0;
@@ -1895,8 +1892,6 @@ static ssize_t h3_stream_open(struct Curl_cfilter *cf,
   nghttp3_data_reader reader;
   nghttp3_data_reader *preader = NULL;
 
-  Curl_dynhds_init(&h2_headers, 0, DYN_HTTP_REQUEST);
-
   *err = h3_data_setup(cf, data);
   if(*err)
     goto out;
@@ -1907,24 +1902,16 @@ static ssize_t h3_stream_open(struct Curl_cfilter *cf,
     goto out;
   }
 
-  nwritten = Curl_h1_req_parse_read(&stream->h1, buf, len, NULL, 0, err);
+  /* skip the HTTP/1 request head, we send the headers prepared for it */
+  nwritten = Curl_http_req_h2_take(data, len, &h2req, err);
   if(nwritten < 0)
     goto out;
-  if(!stream->h1.done) {
+  if(!h2req) {
     /* need more data */
     goto out;
   }
-  DEBUGASSERT(stream->h1.req);
-
-  *err = Curl_http_req_to_h2(&h2_headers, stream->h1.req, data);
-  if(*err) {
-    nwritten = -1;
-    goto out;
-  }
-  /* no longer needed */
-  Curl_h1_req_parse_free(&stream->h1);
 
-  nheader = Curl_dynhds_count(&h2_headers);
+  nheader = Curl_http_req_h2_count(h2req);
   nva = malloc(sizeof(nghttp3_nv) * nheader);
   if(!nva) {
     *err = CURLE_OUT_OF_MEMORY;
@@ -1933,11 +1920,12 @@ static ssize_t h3_stream_open(struct Curl_cfilter *cf,
   }
 
   for(i = 0; i < nheader; ++i) {
-    struct dynhds_entry *e = Curl_dynhds_getn(&h2_headers, i);
-    nva[i].name = (unsigned char *)e->name;
-    nva[i].namelen = e->namelen;
-    nva[i].value = (unsigned char *)e->value;
-    nva[i].valuelen = e->valuelen;
+    struct http_req_h2_field f;
+    Curl_http_req_h2_getn(h2req, i, &f);
+    nva[i].name = (unsigned char *)CURL_UNCONST(f.name);
+    nva[i].namelen = f.namelen;
+    nva[i].value = (unsigned char *)CURL_UNCONST(f.value);
+    nva[i].valuelen = f.valuelen;
     nva[i].flags = NGHTTP3_NV_FLAG_NONE;
   }
 
@@ -2005,7 +1993,7 @@ static ssize_t h3_stream_open(struct Curl_cfilter *cf,
 
 out:
   free(nva);
-  Curl_dynhds_free(&h2_headers);
+  Curl_http_req_h2_free(h2req);
   return nwritten;
 }
 
@@ -77,6 +77,10 @@
           (H3_STREAM_WINDOW_SIZE / H3_STREAM_CHUNK_SIZE)
 #define H3_STREAM_SEND_CHUNKS \
           (H3_STREAM_WINDOW_SIZE / H3_STREAM_CHUNK_SIZE)
+/* Response headers and body pieces are queued without copying, one
+ * entry each. Segments of entries are shared among streams. */
+#define H3_STREAM_NBUF_ENTRIES  64
+#define H3_STREAM_NBUF_SPARES   QUIC_MAX_STREAMS
 
 /*
  * Store quiceh version info in this buffer.
@@ -99,6 +103,7 @@ struct cf_quiceh_ctx {
   struct curltime started_at;        /* time the current attempt started */
   struct curltime handshake_at;      /* time connect handshake finished */
   struct bufc_pool stream_bufcp;     /* chunk pool for streams */
+  struct bufq_nocpy_pool stream_nbufp; /* entry pool for stream recvbufs */
   struct uint_hash streams;          /* hash `data->mid` to `stream_ctx` */
   curl_off_t data_recvd;
   BIT(initialized);
@@ -128,6 +133,8 @@ static void cf_quiceh_ctx_init(struct cf_quiceh_ctx *ctx)
     debug_log_init = 1;
   }
 #endif
+  Curl_bufq_nocpy_pool_init(&ctx->stream_nbufp, H3_STREAM_NBUF_ENTRIES,
+                            H3_STREAM_NBUF_SPARES, NULL);
   Curl_uint_hash_init(&ctx->streams, 63, h3_stream_hash_free);
   ctx->data_recvd = 0;
   ctx->initialized = TRUE;
@@ -142,6 +149,7 @@ static void cf_quiceh_ctx_free(struct cf_quiceh_ctx *ctx)
     Curl_ssl_peer_cleanup(&ctx->peer);
     vquic_ctx_free(&ctx->q);
     Curl_uint_hash_destroy(&ctx->streams);
+    Curl_bufq_nocpy_pool_free(&ctx->stream_nbufp);
   }
   free(ctx);
 }
@@ -166,9 +174,8 @@ static CURLcode cf_flush_egress(struct Curl_cfilter *cf,
  */
 struct h3_stream_ctx {
   curl_uint64_t id; /* HTTP/3 protocol stream identifier */
-  BufqNoCpy* recvbuf; /* h3 response */
+  struct bufq_nocpy recvbuf; /* h3 response */
   bool bufq_empty;
-  struct h1_req_parser h1; /* h1 request parsing */
   curl_uint64_t error3; /* HTTP/3 stream error code */
   BIT(opened); /* TRUE after stream has been opened */
   BIT(closed); /* TRUE on stream close */
@@ -181,8 +188,7 @@ struct h3_stream_ctx {
 
 static void h3_stream_ctx_free(struct h3_stream_ctx *stream)
 {
-  Curl_bufq_nocpy_free(&stream->recvbuf, NULL);
-  Curl_h1_req_parse_free(&stream->h1);
+  Curl_bufq_nocpy_free(&stream->recvbuf);
   free(stream);
 }
 
@@ -269,8 +275,7 @@ static CURLcode h3_data_setup(struct Curl_cfilter *cf,
     return CURLE_OUT_OF_MEMORY;
 
   stream->id = -1;
-  stream->recvbuf = Curl_bufq_nocpy_init(512);
-  Curl_h1_req_parse_init(&stream->h1, H1_PARSE_DEFAULT_MAX_LINE_LEN);
+  Curl_bufq_nocpy_init(&stream->recvbuf, &ctx->stream_nbufp, 0, NULL);
 
   if(!Curl_uint_hash_set(&ctx->streams, data->mid, stream)) {
     h3_stream_ctx_free(stream);
@@ -348,11 +353,8 @@ static CURLcode write_resp_raw(struct Curl_cfilter *cf,
   if(!stream)
     return CURLE_RECV_ERROR;
 
-  if(!Curl_bufq_nocpy_write(stream->recvbuf, (unsigned char *)mem,
-                            memlen, alloc_method))
-    return CURLE_OUT_OF_MEMORY;
-
-  return CURLE_OK;
+  return Curl_bufq_nocpy_add(&stream->recvbuf, CURL_UNCONST(mem), memlen,
+                             alloc_method);
 }
 
 struct cb_ctx {
@@ -454,7 +456,12 @@ static ssize_t stream_resp_read(struct cf_quiceh_ctx *ctx,
       *err = CURLE_AGAIN;
       return -1;
     }
-    Curl_bufq_nocpy_write(stream->recvbuf, buf, nread, BUFQ_ALLOC_MALLOC);
+    *err = Curl_bufq_nocpy_add(&stream->recvbuf, buf, (size_t)nread,
+                               BUFQ_ALLOC_MALLOC);
+    if(*err) {
+      free(buf);
+      return -1;
+    }
   }
   else {
     *err = CURLE_AGAIN;
@@ -914,26 +921,11 @@ static size_t try_filling_buf_with_bufq(struct h3_stream_ctx *stream,
                                         unsigned char *buf, size_t len)
 {
   size_t nread;
-  size_t total_read = 0;
-  enum BUFQ_ALLOC_METHOD alloc_method;
-  unsigned char *ptr_to_free = NULL;
-  size_t ptr_to_free_size = 0;
-
-  do {
-    nread = Curl_bufq_nocpy_read_cpy(stream->recvbuf, buf, len,
-                                     &ptr_to_free, &ptr_to_free_size,
-                                     &alloc_method);
-    if(ptr_to_free) {
-      if(alloc_method == BUFQ_ALLOC_MALLOC) {
-        free(ptr_to_free);
-      }
-    }
-    buf += nread;
-    len -= nread;
-    total_read += nread;
-  } while(len > 0 && nread > 0);
 
-  return total_read;
+  (void)ctx;
+  if(Curl_bufq_nocpy_cread(&stream->recvbuf, (char *)buf, len, &nread))
+    return 0;
+  return nread;
 }
 
 static ssize_t try_filling_buf(struct h3_stream_ctx *stream,
@@ -1099,7 +1091,7 @@ static ssize_t h3_open_stream(struct Curl_cfilter *cf,
   struct h3_stream_ctx *stream = H3_STREAM_CTX(ctx, data);
   size_t nheader, i;
   curl_int64_t stream3_id;
-  struct dynhds h2_headers;
+  struct http_req_h2 *h2req = NULL;
   quiceh_h3_header *nva = NULL;
   ssize_t nwritten;
 
@@ -1112,27 +1104,17 @@ static ssize_t h3_open_stream(struct Curl_cfilter *cf,
     DEBUGASSERT(stream);
   }
 
-  Curl_dynhds_init(&h2_headers, 0, DYN_HTTP_REQUEST);
-
   DEBUGASSERT(stream);
-  nwritten = Curl_h1_req_parse_read(&stream->h1, buf, len, NULL, 0, err);
+  /* skip the HTTP/1 request head, we send the headers prepared for it */
+  nwritten = Curl_http_req_h2_take(data, len, &h2req, err);
   if(nwritten < 0)
     goto out;
-  if(!stream->h1.done) {
+  if(!h2req) {
     /* need more data */
     goto out;
   }
-  DEBUGASSERT(stream->h1.req);
-
-  *err = Curl_http_req_to_h2(&h2_headers, stream->h1.req, data);
-  if(*err) {
-    nwritten = -1;
-    goto out;
-  }
-  /* no longer needed */
-  Curl_h1_req_parse_free(&stream->h1);
 
-  nheader = Curl_dynhds_count(&h2_headers);
+  nheader = Curl_http_req_h2_count(h2req);
   nva = malloc(sizeof(quiceh_h3_header) * nheader);
   if(!nva) {
     *err = CURLE_OUT_OF_MEMORY;
@@ -1141,11 +1123,12 @@ static ssize_t h3_open_stream(struct Curl_cfilter *cf,
   }
 
   for(i = 0; i < nheader; ++i) {
-    struct dynhds_entry *e = Curl_dynhds_getn(&h2_headers, i);
-    nva[i].name = (unsigned char *)e->name;
-    nva[i].name_len = e->namelen;
-    nva[i].value = (unsigned char *)e->value;
-    nva[i].value_len = e->valuelen;
+    struct http_req_h2_field f;
+    Curl_http_req_h2_getn(h2req, i, &f);
+    nva[i].name = (unsigned char *)CURL_UNCONST(f.name);
+    nva[i].name_len = f.namelen;
+    nva[i].value = (unsigned char *)CURL_UNCONST(f.value);
+    nva[i].value_len = f.valuelen;
   }
 
   if(eos && ((size_t)nwritten == len))
@@ -1207,7 +1190,7 @@ static ssize_t h3_open_stream(struct Curl_cfilter *cf,
 
 out:
   free(nva);
-  Curl_dynhds_free(&h2_headers);
+  Curl_http_req_h2_free(h2req);
   return nwritten;
 }
 
@@ -1318,7 +1301,7 @@ static bool cf_quiceh_data_pending(struct Curl_cfilter *cf,
   struct cf_quiceh_ctx *ctx = cf->ctx;
   const struct h3_stream_ctx *stream = H3_STREAM_CTX(ctx, data);
   (void)cf;
-  return stream; /* && !Curl_bufq_nocpy_is_empty(stream->recvbuf); */
+  return stream; /* && !Curl_bufq_nocpy_is_empty(&stream->recvbuf); */
 }
 
 static CURLcode h3_data_pause(struct Curl_cfilter *cf,
@@ -30,6 +30,14 @@
 #ifdef HAVE_FCNTL_H
 #include <fcntl.h>
 #endif
+#if defined(HAVE_SENDMMSG) && defined(__linux__) && defined(UDP_SEGMENT)
+/* send all queued packet runs with a single sendmmsg() */
+#define USE_VQUIC_SENDMMSG
+#if defined(SO_TXTIME) && defined(HAVE_CLOCK_GETTIME_MONOTONIC)
+#include <linux/net_tstamp.h>
+#define USE_VQUIC_TXTIME
+#endif
+#endif
 #include "../urldata.h"
 #include "../bufq.h"
 #include "../curlx/dynbuf.h"
@@ -90,6 +98,9 @@ CURLcode vquic_ctx_init(struct cf_quic_ctx *qctx)
 #else
   qctx->no_gso = TRUE;
 #endif
+  qctx->nruns = 0;
+  qctx->tx_next = 0;
+  qctx->txtime = FALSE;
 #ifdef DEBUGBUILD
   {
     const char *p = getenv("CURL_DBG_QUIC_WBLOCK");
@@ -115,6 +126,216 @@ void vquic_ctx_update_time(struct cf_quic_ctx *qctx)
   qctx->last_op = curlx_now();
 }
 
+void vquic_ctx_set_txtime(struct cf_quic_ctx *qctx)
+{
+#ifdef USE_VQUIC_TXTIME
+  struct sock_txtime st;
+
+  memset(&st, 0, sizeof(st));
+  st.clockid = CLOCK_MONOTONIC;
+  /* Without a qdisc that honors the send time, like 'fq', the kernel
+   * accepts the option and sends right away. */
+  if(!setsockopt(qctx->sockfd, SOL_SOCKET, SO_TXTIME, (void *)&st,
+                 (socklen_t)sizeof(st)))
+    qctx->txtime = TRUE;
+#else
+  (void)qctx;
+#endif
+}
+
+#ifdef USE_VQUIC_TXTIME
+static uint64_t vquic_txtime_now(void)
+{
+  struct timespec ts;
+
+  if(clock_gettime(CLOCK_MONOTONIC, &ts))
+    return 0;
+  return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+/* length of the send buffer not part of a queued run */
+static size_t vquic_unqueued_len(struct cf_quic_ctx *qctx)
+{
+  size_t i, len = Curl_bufq_len(&qctx->sendbuf);
+
+  for(i = 0; i < qctx->nruns; ++i) {
+    DEBUGASSERT(len >= qctx->runs[i].len);
+    len -= qctx->runs[i].len;
+  }
+  return len;
+}
+
+/* queue the next `len` unqueued bytes as a run of `gsolen` packets */
+static void vquic_runs_add(struct cf_quic_ctx *qctx, size_t len,
+                           size_t gsolen, uint64_t pace_ns)
+{
+  struct vquic_send_run *run;
+
+  if(!len)
+    return;
+  DEBUGASSERT(qctx->nruns < VQUIC_SEND_RUNS);
+  run = &qctx->runs[qctx->nruns++];
+  run->len = len;
+  /* a gsolen of 0 means no clue, send as a single packet */
+  run->gsolen = gsolen ? gsolen : len;
+  run->txtime = 0;
+#ifdef USE_VQUIC_TXTIME
+  if(qctx->txtime) {
+    uint64_t now = vquic_txtime_now();
+    if(qctx->tx_next > now)
+      run->txtime = qctx->tx_next;
+    else
+      qctx->tx_next = now;
+    qctx->tx_next += pace_ns;
+  }
+#else
+  (void)pace_ns;
+#endif
+}
+
+/* remove `amount` sent bytes from the send buffer and the queued runs */
+static void vquic_runs_skip(struct cf_quic_ctx *qctx, size_t amount)
+{
+  size_t i = 0;
+
+  Curl_bufq_skip(&qctx->sendbuf, amount);
+  while(amount && (i < qctx->nruns)) {
+    size_t n = CURLMIN(amount, qctx->runs[i].len);
+    qctx->runs[i].len -= n;
+    amount -= n;
+    if(!qctx->runs[i].len)
+      ++i;
+  }
+  DEBUGASSERT(!amount);
+  if(i) {
+    qctx->nruns -= i;
+    memmove(&qctx->runs[0], &qctx->runs[i],
+            qctx->nruns * sizeof(qctx->runs[0]));
+  }
+}
+
+#ifdef USE_VQUIC_SENDMMSG
+
+/* the kernel puts at most this many segments into one GSO datagram */
+#define VQUIC_GSO_MAX_SEGMENTS  64
+/* each run may be split at a chunk boundary of the send buffer */
+#define VQUIC_MMSG_MAX  (2 * VQUIC_SEND_RUNS)
+
+union vquic_mmsg_ctrl {
+  uint8_t buf[CMSG_SPACE(sizeof(uint16_t)) + CMSG_SPACE(sizeof(uint64_t))];
+  size_t align; /* struct cmsghdr alignment */
+};
+
+/* Send the queued runs in one sendmmsg() call, using GSO for runs
+ * of several packets and SCM_TXTIME for runs with a send time. */
+static CURLcode do_sendmmsg(struct Curl_cfilter *cf,
+                            struct Curl_easy *data,
+                            struct cf_quic_ctx *qctx,
+                            size_t *psent)
+{
+  struct mmsghdr mmsg[VQUIC_MMSG_MAX];
+  struct iovec iov[VQUIC_MMSG_MAX];
+  union vquic_mmsg_ctrl ctrl[VQUIC_MMSG_MAX];
+  const unsigned char *buf;
+  size_t blen, i, n = 0, offset = 0;
+  bool first_gso = FALSE;
+  int rc;
+
+  *psent = 0;
+  memset(mmsg, 0, sizeof(mmsg));
+  memset(ctrl, 0, sizeof(ctrl));
+  for(i = 0; (i < qctx->nruns) && (n < VQUIC_MMSG_MAX); ++i) {
+    const struct vquic_send_run *run = &qctx->runs[i];
+    size_t rlen = run->len;
+    size_t max_len = qctx->no_gso ?
+      run->gsolen : (VQUIC_GSO_MAX_SEGMENTS * run->gsolen);
+
+    while(rlen && (n < VQUIC_MMSG_MAX) &&
+          Curl_bufq_peek_at(&qctx->sendbuf, offset, &buf, &blen)) {
+      struct msghdr *msg = &mmsg[n].msg_hdr;
+      struct cmsghdr *cm;
+      size_t ctrllen = 0;
+
+      blen = CURLMIN(blen, rlen);
+      blen = CURLMIN(blen, max_len);
+      iov[n].iov_base = (uint8_t *)CURL_UNCONST(buf);
+      iov[n].iov_len = blen;
+      msg->msg_iov = &iov[n];
+      msg->msg_iovlen = 1;
+      if(blen > run->gsolen) {
+        cm = (struct cmsghdr *)(void *)ctrl[n].buf;
+        cm->cmsg_level = SOL_UDP;
+        cm->cmsg_type = UDP_SEGMENT;
+        cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        *(uint16_t *)(void *)CMSG_DATA(cm) = run->gsolen & 0xffff;
+        ctrllen += CMSG_SPACE(sizeof(uint16_t));
+        if(!n)
+          first_gso = TRUE;
+      }
+#ifdef USE_VQUIC_TXTIME
+      if(run->txtime) {
+        cm = (struct cmsghdr *)(void *)(ctrl[n].buf + ctrllen);
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type = SCM_TXTIME;
+        cm->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+        memcpy(CMSG_DATA(cm), &run->txtime, sizeof(uint64_t));
+        ctrllen += CMSG_SPACE(sizeof(uint64_t));
+      }
+#endif
+      if(ctrllen) {
+        /* only set this when needed, see do_sendmsg() */
+        msg->msg_control = ctrl[n].buf;
+        msg->msg_controllen = ctrllen;
+      }
+      offset += blen;
+      rlen -= blen;
+      ++n;
+    }
+  }
+  if(!n)
+    return CURLE_OK;
+
+  while((rc = sendmmsg(qctx->sockfd, mmsg, (unsigned int)n, 0)) == -1 &&
+        SOCKERRNO == SOCKEINTR)
+    ;
+
+  if(rc == -1) {
+    switch(SOCKERRNO) {
+    case EAGAIN:
+#if EAGAIN != SOCKEWOULDBLOCK
+    case SOCKEWOULDBLOCK:
+#endif
+      return CURLE_AGAIN;
+    case SOCKEMSGSIZE:
+      /* UDP datagram is too large; caused by PMTUD. Just let it be lost. */
+      *psent = iov[0].iov_len;
+      return CURLE_OK;
+    case EIO:
+      if(first_gso) {
+        /* GSO failure, the runs are sent again without it */
+        infof(data, "sendmmsg() returned %d (errno %d); disable GSO", rc,
+              SOCKERRNO);
+        qctx->no_gso = TRUE;
+        return CURLE_OK;
+      }
+      FALLTHROUGH();
+    default:
+      failf(data, "sendmmsg() returned %d (errno %d)", rc, SOCKERRNO);
+      return CURLE_SEND_ERROR;
+    }
+  }
+
+  /* messages after the first one that failed are not sent, the error
+   * is reported again on the next call */
+  for(i = 0; i < (size_t)rc; ++i)
+    *psent += iov[i].iov_len;
+  CURL_TRC_CF(data, cf, "sendmmsg(msgs=%zu) -> %d, sent=%zu", n, rc, *psent);
+  return CURLE_OK;
+}
+
+#else /* USE_VQUIC_SENDMMSG */
+
 static CURLcode send_packet_no_gso(struct Curl_cfilter *cf,
                                    struct Curl_easy *data,
                                    struct cf_quic_ctx *qctx,
@@ -243,18 +464,25 @@ static CURLcode send_packet_no_gso(struct Curl_cfilter *cf,
   return CURLE_OK;
 }
 
+#endif /* !USE_VQUIC_SENDMMSG */
+
 static CURLcode vquic_send_packets(struct Curl_cfilter *cf,
                                    struct Curl_easy *data,
                                    struct cf_quic_ctx *qctx,
-                                   const uint8_t *pkt, size_t pktlen,
-                                   size_t gsolen, size_t *psent)
+                                   size_t *psent)
 {
   CURLcode result;
+#ifndef USE_VQUIC_SENDMMSG
+  const struct vquic_send_run *run = &qctx->runs[0];
+  const unsigned char *buf;
+  size_t blen;
+#endif
+
+  *psent = 0;
 #ifdef DEBUGBUILD
   /* simulate network blocking/partial writes */
   if(qctx->wblock_percent > 0) {
     unsigned char c;
-    *psent = 0;
     Curl_rand(data, &c, 1);
     if(c >= ((100-qctx->wblock_percent)*256/100)) {
       CURL_TRC_CF(data, cf, "vquic_flush() simulate EWOULDBLOCK");
@@ -262,12 +490,22 @@ static CURLcode vquic_send_packets(struct Curl_cfilter *cf,
     }
   }
 #endif
-  if(qctx->no_gso && pktlen > gsolen) {
-    result = send_packet_no_gso(cf, data, qctx, pkt, pktlen, gsolen, psent);
+#ifdef USE_VQUIC_SENDMMSG
+  result = do_sendmmsg(cf, data, qctx, psent);
+#else
+  /* one run at a time, up to the end of the first buffer chunk */
+  DEBUGASSERT(qctx->nruns);
+  if(!Curl_bufq_peek(&qctx->sendbuf, &buf, &blen))
+    return CURLE_OK;
+  blen = CURLMIN(blen, run->len);
+  if(qctx->no_gso && blen > run->gsolen) {
+    result = send_packet_no_gso(cf, data, qctx, buf, blen, run->gsolen,
+                                psent);
   }
   else {
-    result = do_sendmsg(cf, data, qctx, pkt, pktlen, gsolen, psent);
+    result = do_sendmsg(cf, data, qctx, buf, blen, run->gsolen, psent);
   }
+#endif
   if(!result)
     qctx->last_io = qctx->last_op;
   return result;
@@ -276,33 +514,20 @@ static CURLcode vquic_send_packets(struct Curl_cfilter *cf,
 CURLcode vquic_flush(struct Curl_cfilter *cf, struct Curl_easy *data,
                      struct cf_quic_ctx *qctx)
 {
-  const unsigned char *buf;
-  size_t blen, sent;
+  size_t sent;
   CURLcode result;
-  size_t gsolen;
-
-  while(Curl_bufq_peek(&qctx->sendbuf, &buf, &blen)) {
-    gsolen = qctx->gsolen;
-    if(qctx->split_len) {
-      gsolen = qctx->split_gsolen;
-      if(blen > qctx->split_len)
-        blen = qctx->split_len;
-    }
 
-    result = vquic_send_packets(cf, data, qctx, buf, blen, gsolen, &sent);
-    CURL_TRC_CF(data, cf, "vquic_send(len=%zu, gso=%zu) -> %d, sent=%zu",
-                blen, gsolen, result, sent);
-    if(result) {
-      if(result == CURLE_AGAIN) {
-        Curl_bufq_skip(&qctx->sendbuf, sent);
-        if(qctx->split_len)
-          qctx->split_len -= sent;
-      }
+  while(!Curl_bufq_is_empty(&qctx->sendbuf)) {
+    /* packets added since the last queued run use `qctx->gsolen` */
+    if(qctx->nruns < VQUIC_SEND_RUNS)
+      vquic_runs_add(qctx, vquic_unqueued_len(qctx), qctx->gsolen, 0);
+
+    result = vquic_send_packets(cf, data, qctx, &sent);
+    CURL_TRC_CF(data, cf, "vquic_send(len=%zu, runs=%zu) -> %d, sent=%zu",
+                Curl_bufq_len(&qctx->sendbuf), qctx->nruns, result, sent);
+    vquic_runs_skip(qctx, sent);
+    if(result)
       return result;
-    }
-    Curl_bufq_skip(&qctx->sendbuf, sent);
-    if(qctx->split_len)
-      qctx->split_len -= sent;
   }
   return CURLE_OK;
 }
@@ -314,17 +539,37 @@ CURLcode vquic_send(struct Curl_cfilter *cf, struct Curl_easy *data,
   return vquic_flush(cf, data, qctx);
 }
 
+CURLcode vquic_send_queue(struct Curl_cfilter *cf, struct Curl_easy *data,
+                          struct cf_quic_ctx *qctx, size_t gsolen,
+                          uint64_t pace_ns)
+{
+  if(!qctx->txtime)
+    return vquic_send(cf, data, qctx, gsolen);
+  if(qctx->nruns >= VQUIC_SEND_RUNS) {
+    CURLcode result = vquic_flush(cf, data, qctx);
+    if(result)
+      return result;
+  }
+  vquic_runs_add(qctx, vquic_unqueued_len(qctx), gsolen, pace_ns);
+  /* keep room for vquic_send_tail_split() */
+  if((qctx->nruns >= (VQUIC_SEND_RUNS - 2)) ||
+     Curl_bufq_is_full(&qctx->sendbuf))
+    return vquic_flush(cf, data, qctx);
+  return CURLE_OK;
+}
+
 CURLcode vquic_send_tail_split(struct Curl_cfilter *cf, struct Curl_easy *data,
                                struct cf_quic_ctx *qctx, size_t gsolen,
                                size_t tail_len, size_t tail_gsolen)
 {
-  DEBUGASSERT(Curl_bufq_len(&qctx->sendbuf) > tail_len);
-  qctx->split_len = Curl_bufq_len(&qctx->sendbuf) - tail_len;
-  qctx->split_gsolen = gsolen;
+  size_t len = vquic_unqueued_len(qctx);
+
+  DEBUGASSERT(len > tail_len);
+  DEBUGASSERT(qctx->nruns < VQUIC_SEND_RUNS);
+  vquic_runs_add(qctx, len - tail_len, gsolen, 0);
   qctx->gsolen = tail_gsolen;
   CURL_TRC_CF(data, cf, "vquic_send_tail_split: [%zu gso=%zu][%zu gso=%zu]",
-              qctx->split_len, qctx->split_gsolen,
-              tail_len, qctx->gsolen);
+              len - tail_len, gsolen, tail_len, qctx->gsolen);
   return vquic_flush(cf, data, qctx);
 }
 
@@ -31,6 +31,15 @@
 
 #define MAX_PKT_BURST 10
 #define MAX_UDP_PAYLOAD_SIZE  1452
+/* maximum number of packet runs queued in the send buffer */
+#define VQUIC_SEND_RUNS  8
+
+/* a run of packets of the same length at the start of the send buffer */
+struct vquic_send_run {
+  size_t len; /* length of the run in the send buffer */
+  size_t gsolen; /* length of the individual packets */
+  uint64_t txtime; /* CLOCK_MONOTONIC ns to send the run at, or 0 */
+};
 
 struct cf_quic_ctx {
   curl_socket_t sockfd; /* connected UDP socket */
@@ -41,14 +50,16 @@ struct cf_quic_ctx {
   struct curltime first_byte_at;     /* when first byte was recvd */
   struct curltime last_op; /* last (attempted) send/recv operation */
   struct curltime last_io; /* last successful socket IO */
-  size_t gsolen; /* length of individual packets in send buf */
-  size_t split_len; /* if != 0, buffer length after which GSO differs */
-  size_t split_gsolen; /* length of individual packets after split_len */
+  struct vquic_send_run runs[VQUIC_SEND_RUNS]; /* queued packet runs */
+  size_t nruns; /* number of queued runs */
+  size_t gsolen; /* length of individual packets in send buf after runs */
+  uint64_t tx_next; /* CLOCK_MONOTONIC ns the next run may be sent at */
 #ifdef DEBUGBUILD
   int wblock_percent; /* percent of writes doing EAGAIN */
 #endif
   BIT(got_first_byte); /* if first byte was received */
   BIT(no_gso); /* do not use gso on sending */
+  BIT(txtime); /* socket paces sending with SO_TXTIME */
 };
 
 #define H3_STREAM_CTX(ctx,data)                                         \
@@ -59,6 +70,10 @@ void vquic_ctx_free(struct cf_quic_ctx *qctx);
 
 void vquic_ctx_update_time(struct cf_quic_ctx *qctx);
 
+/* Make the kernel pace sent packets by the send time of their run,
+ * if the socket supports SO_TXTIME. Call once `sockfd` is set. */
+void vquic_ctx_set_txtime(struct cf_quic_ctx *qctx);
+
 void vquic_push_blocked_pkt(struct Curl_cfilter *cf,
                             struct cf_quic_ctx *qctx,
                             const uint8_t *pkt, size_t pktlen, size_t gsolen);
@@ -70,6 +85,14 @@ CURLcode vquic_send_blocked_pkts(struct Curl_cfilter *cf,
 CURLcode vquic_send(struct Curl_cfilter *cf, struct Curl_easy *data,
                         struct cf_quic_ctx *qctx, size_t gsolen);
 
+/* Queue the packets of `gsolen` length added to the send buffer since
+ * the last queued run. When the socket paces, the next run is sent
+ * `pace_ns` after this one and several runs go out in one syscall.
+ * Otherwise, or when no more runs can be queued, flush the buffer. */
+CURLcode vquic_send_queue(struct Curl_cfilter *cf, struct Curl_easy *data,
+                          struct cf_quic_ctx *qctx, size_t gsolen,
+                          uint64_t pace_ns);
+
 CURLcode vquic_send_tail_split(struct Curl_cfilter *cf, struct Curl_easy *data,
                                struct cf_quic_ctx *qctx, size_t gsolen,
                                size_t tail_len, size_t tail_gsolen);
@@ -42,6 +42,7 @@
 #include "vtls.h" /* generic SSL protos etc */
 #include "vtls_int.h"
 #include "vtls_scache.h"
+#include "vtls_sfile.h"
 #include "vtls_spack.h"
 
 #include "../strcase.h"
@@ -61,6 +62,9 @@
 
 
 static bool cf_ssl_peer_key_is_global(const char *peer_key);
+struct scache_sfile_save;
+
+#define CURL_SSL_TICKET_MAX   (16*1024)
 
 /* a peer+tls-config we cache sessions for */
 struct Curl_ssl_scache_peer {
@@ -89,6 +93,9 @@ struct Curl_ssl_scache {
   size_t peer_count;
   int default_lifetime_secs;
   long age;
+#ifdef USE_SSLS_FILE
+  struct Curl_ssl_sfile *sfile; /* see CURLOPT_SSL_SESSION_FILE */
+#endif
 };
 
 static struct Curl_ssl_scache *cf_ssl_scache_get(struct Curl_easy *data)
@@ -356,6 +363,9 @@ void Curl_ssl_scache_destroy(struct Curl_ssl_scache *scache)
     for(i = 0; i < scache->peer_count; ++i) {
       cf_ssl_scache_clear_peer(&scache->peers[i]);
     }
+#ifdef USE_SSLS_FILE
+    Curl_ssl_sfile_close(scache->sfile);
+#endif
     free(scache->peers);
     free(scache);
   }
@@ -790,11 +800,144 @@ static void cf_scache_peer_add_session(struct Curl_ssl_scache_peer *peer,
   }
 }
 
+#ifdef USE_SSLS_FILE
+
+/* Get a reference to the session file the transfer wants to use, or NULL.
+ * Called with the scache locked, the file itself is accessed later,
+ * without holding the lock. */
+static struct Curl_ssl_sfile *cf_scache_sfile_get(struct Curl_easy *data,
+                                                  struct Curl_ssl_scache *sc)
+{
+  const char *path = data->set.str[STRING_SSL_SESSION_FILE];
+
+  if(!path || !path[0])
+    return NULL;
+  if(sc->sfile && !Curl_ssl_sfile_is(sc->sfile, path)) {
+    Curl_ssl_sfile_close(sc->sfile);
+    sc->sfile = NULL;
+  }
+  if(!sc->sfile && Curl_ssl_sfile_open(path, &sc->sfile))
+    return NULL;
+  Curl_ssl_sfile_ref(sc->sfile);
+  return sc->sfile;
+}
+
+/* Drop a reference from cf_scache_sfile_get() */
+static void cf_scache_sfile_release(struct Curl_easy *data,
+                                    struct Curl_ssl_sfile *sf)
+{
+  Curl_ssl_scache_lock(data);
+  Curl_ssl_sfile_close(sf);
+  Curl_ssl_scache_unlock(data);
+}
+
+/* A session to save in the session file once the scache is unlocked */
+struct scache_sfile_save {
+  struct Curl_ssl_sfile *sf;
+  struct dynbuf sbuf;
+  curl_off_t valid_until;
+  BIT(once);
+};
+
+/* Prepare saving session `s` in the session file, if the transfer uses
+ * one. TLSv1.3 tickets are for single use (RFC 8446 C.4). They go into
+ * the file only and the first process loading one takes it. Tickets that
+ * allow early data are never saved. Return TRUE when `s` is handed to
+ * the file only. */
+static bool cf_scache_sfile_prepare(struct Curl_easy *data,
+                                    struct Curl_ssl_scache *scache,
+                                    struct Curl_ssl_scache_peer *peer,
+                                    struct Curl_ssl_session *s,
+                                    struct scache_sfile_save *save)
+{
+  if(!peer->exportable || !peer->ssl_peer_key || s->earlydata_max)
+    return FALSE;
+  save->sf = cf_scache_sfile_get(data, scache);
+  if(!save->sf)
+    return FALSE;
+  if(Curl_ssl_session_pack(data, s, &save->sbuf)) {
+    Curl_ssl_sfile_close(save->sf);
+    save->sf = NULL;
+    return FALSE;
+  }
+  save->valid_until = s->valid_until;
+  save->once = (s->ietf_tls_id == CURL_IETF_PROTO_TLS1_3);
+  return save->once;
+}
+
+/* Save the prepared session, with the scache unlocked */
+static void cf_scache_sfile_save(struct Curl_easy *data,
+                                 const char *ssl_peer_key,
+                                 struct scache_sfile_save *save)
+{
+  CURLcode r;
+
+  r = Curl_ssl_sfile_append(data, save->sf, ssl_peer_key,
+                            (curl_off_t)time(NULL), save->valid_until,
+                            save->once, curlx_dyn_uptr(&save->sbuf),
+                            curlx_dyn_len(&save->sbuf));
+  if(!r)
+    CURL_TRC_SSLS(data, "saved session for %s in file", ssl_peer_key);
+  cf_scache_sfile_release(data, save->sf);
+  save->sf = NULL;
+}
+
+static CURLcode cf_scache_sfile_load_cb(struct Curl_easy *data,
+                                        void *user_data,
+                                        const void *sdata, size_t sdata_len)
+{
+  struct Curl_llist *sessions = user_data;
+  struct Curl_ssl_session *s;
+
+  if(Curl_ssl_session_unpack(data, sdata, sdata_len, &s))
+    CURL_TRC_SSLS(data, "skipping unreadable session in file");
+  else
+    Curl_llist_append(sessions, s, &s->list);
+  return CURLE_OK;
+}
+
+/* Load the sessions for `ssl_peer_key` from the session file into
+ * `sessions`, if the transfer uses one. Called with the scache locked,
+ * unlocks it while reading the file. */
+static void cf_scache_sfile_load(struct Curl_easy *data,
+                                 struct Curl_ssl_scache *scache,
+                                 const char *ssl_peer_key,
+                                 struct ssl_primary_config *conn_config,
+                                 struct Curl_llist *sessions)
+{
+  struct Curl_ssl_sfile *sf;
+  CURLcode r;
+
+  /* only sessions without confidential information are saved */
+  if(!cf_ssl_peer_key_is_global(ssl_peer_key) ||
+     (conn_config && conn_config->clientcert)
+#ifdef USE_TLS_SRP
+     || (conn_config && (conn_config->username || conn_config->password))
+#endif
+    )
+    return;
+
+  sf = cf_scache_sfile_get(data, scache);
+  if(!sf)
+    return;
+  Curl_ssl_scache_unlock(data);
+  r = Curl_ssl_sfile_load(data, sf, ssl_peer_key, (curl_off_t)time(NULL),
+                          cf_scache_sfile_load_cb, sessions);
+  Curl_ssl_scache_lock(data);
+  Curl_ssl_sfile_close(sf);
+  if(Curl_llist_count(sessions))
+    CURL_TRC_SSLS(data, "loaded %zu sessions for %s from file, error=%d",
+                  Curl_llist_count(sessions), ssl_peer_key, r);
+}
+
+#endif /* USE_SSLS_FILE */
+
 static CURLcode cf_scache_add_session(struct Curl_cfilter *cf,
                                       struct Curl_easy *data,
                                       struct Curl_ssl_scache *scache,
                                       const char *ssl_peer_key,
-                                      struct Curl_ssl_session *s)
+                                      struct Curl_ssl_session *s,
+                                      struct scache_sfile_save *save)
 {
   struct Curl_ssl_scache_peer *peer = NULL;
   struct ssl_primary_config *conn_config = Curl_ssl_cf_get_primary_config(cf);
@@ -829,6 +972,15 @@ static CURLcode cf_scache_add_session(struct Curl_cfilter *cf,
     goto out;
   }
 
+#ifdef USE_SSLS_FILE
+  if(save && cf_scache_sfile_prepare(data, scache, peer, s, save)) {
+    CURL_TRC_SSLS(data, "handing session for %s to the file", ssl_peer_key);
+    Curl_ssl_session_destroy(s);
+    return CURLE_OK;
+  }
+#else
+  (void)save;
+#endif
   cf_scache_peer_add_session(peer, s, now);
 
 out:
@@ -846,14 +998,18 @@ out:
   return result;
 }
 
-CURLcode Curl_ssl_scache_put(struct Curl_cfilter *cf,
-                             struct Curl_easy *data,
-                             const char *ssl_peer_key,
-                             struct Curl_ssl_session *s)
+static CURLcode cf_scache_put(struct Curl_cfilter *cf,
+                              struct Curl_easy *data,
+                              const char *ssl_peer_key,
+                              struct Curl_ssl_session *s,
+                              bool persist)
 {
   struct Curl_ssl_scache *scache = cf_ssl_scache_get(data);
   struct ssl_config_data *ssl_config = Curl_ssl_cf_get_config(cf, data);
   CURLcode result;
+#ifdef USE_SSLS_FILE
+  struct scache_sfile_save save;
+#endif
   DEBUGASSERT(ssl_config);
 
   if(!scache || !ssl_config->primary.cache_session) {
@@ -861,12 +1017,34 @@ CURLcode Curl_ssl_scache_put(struct Curl_cfilter *cf,
     return CURLE_OK;
   }
 
+#ifdef USE_SSLS_FILE
+  memset(&save, 0, sizeof(save));
+  curlx_dyn_init(&save.sbuf, CURL_SSL_TICKET_MAX);
+  Curl_ssl_scache_lock(data);
+  result = cf_scache_add_session(cf, data, scache, ssl_peer_key, s,
+                                 persist ? &save : NULL);
+  Curl_ssl_scache_unlock(data);
+  /* no file I/O while holding the lock */
+  if(save.sf)
+    cf_scache_sfile_save(data, ssl_peer_key, &save);
+  curlx_dyn_free(&save.sbuf);
+#else
+  (void)persist;
   Curl_ssl_scache_lock(data);
-  result = cf_scache_add_session(cf, data, scache, ssl_peer_key, s);
+  result = cf_scache_add_session(cf, data, scache, ssl_peer_key, s, NULL);
   Curl_ssl_scache_unlock(data);
+#endif
   return result;
 }
 
+CURLcode Curl_ssl_scache_put(struct Curl_cfilter *cf,
+                             struct Curl_easy *data,
+                             const char *ssl_peer_key,
+                             struct Curl_ssl_session *s)
+{
+  return cf_scache_put(cf, data, ssl_peer_key, s, TRUE);
+}
+
 void Curl_ssl_scache_return(struct Curl_cfilter *cf,
                            struct Curl_easy *data,
                            const char *ssl_peer_key,
@@ -875,7 +1053,7 @@ void Curl_ssl_scache_return(struct Curl_cfilter *cf,
   /* See RFC 8446 C.4:
    * "Clients SHOULD NOT reuse a ticket for multiple connections." */
   if(s && s->ietf_tls_id < 0x304)
-    (void)Curl_ssl_scache_put(cf, data, ssl_peer_key, s);
+    (void)cf_scache_put(cf, data, ssl_peer_key, s, FALSE);
   else
     Curl_ssl_session_destroy(s);
 }
@@ -899,6 +1077,26 @@ CURLcode Curl_ssl_scache_take(struct Curl_cfilter *cf,
   Curl_ssl_scache_lock(data);
   result = cf_ssl_find_peer_by_key(data, scache, ssl_peer_key, conn_config,
                                    &peer);
+#ifdef USE_SSLS_FILE
+  if(!result && (!peer || !Curl_llist_count(&peer->sessions))) {
+    struct Curl_llist sessions;
+    Curl_llist_init(&sessions, cf_ssl_scache_session_ldestroy);
+    cf_scache_sfile_load(data, scache, ssl_peer_key, conn_config, &sessions);
+    /* the scache was unlocked meanwhile, look for the peer again */
+    if(Curl_llist_count(&sessions))
+      result = cf_ssl_add_peer(data, scache, ssl_peer_key, conn_config,
+                               &peer);
+    else
+      result = cf_ssl_find_peer_by_key(data, scache, ssl_peer_key,
+                                       conn_config, &peer);
+    while(!result && peer && Curl_llist_count(&sessions)) {
+      struct Curl_ssl_session *ls =
+        Curl_node_take_elem(Curl_llist_head(&sessions));
+      cf_scache_peer_add_session(peer, ls, (curl_off_t)time(NULL));
+    }
+    Curl_llist_destroy(&sessions, NULL);
+  }
+#endif
   if(!result && peer) {
     cf_scache_peer_remove_expired(peer, (curl_off_t)time(NULL));
     n = Curl_llist_head(&peer->sessions);
@@ -1005,8 +1203,6 @@ void Curl_ssl_scache_remove_all(struct Curl_cfilter *cf,
 
 #ifdef USE_SSLS_EXPORT
 
-#define CURL_SSL_TICKET_MAX   (16*1024)
-
 static CURLcode cf_ssl_scache_peer_set_hmac(struct Curl_ssl_scache_peer *peer)
 {
   CURLcode result;
@@ -0,0 +1,687 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "../curl_setup.h"
+
+#ifdef USE_SSLS_FILE
+
+#ifdef HAVE_SYS_TYPES_H
+#include <sys/types.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#include <sys/mman.h>
+
+#include "../urldata.h"
+#include "../curl_trc.h"
+#include "../curl_hmac.h"
+#include "../curl_sha256.h"
+#include "../curl_threads.h"
+#include "../hash.h"
+#include "../rand.h"
+#include "../rename.h"
+#include "../curlx/dynbuf.h"
+#include "vtls_sfile.h"
+#include "../strdup.h"
+
+/* The last 3 #include files should be in this order */
+#include "../curl_printf.h"
+#include "../curl_memory.h"
+#include "../memdebug.h"
+
+/* A session file starts with a magic, the salt for the keys and the
+ * length the file had when it was written, followed by records of:
+ *   4 bytes  length of the rest of the record
+ *  32 bytes  key, see sfile_key()
+ *   8 bytes  seconds since EPOCH until the session expires, 0 when
+ *            a session for single use has been taken
+ *   8 bytes  random id of the record
+ *   1 byte   flags
+ *   n bytes  the session as packed by Curl_ssl_session_pack()
+ * Numbers are in network byte order. The file is only accessed while
+ * holding an exclusive lock on it. Records are appended until the file
+ * has doubled in size. The next writer then copies the records still
+ * worth keeping into a new file that replaces the old one. Other users
+ * notice the replacement when they lock the file the next time. */
+#define SFILE_MAGIC       "curlSSF2"
+#define SFILE_MAGIC_LEN   8
+#define SFILE_SALT_LEN    CURL_SHA256_DIGEST_LENGTH
+#define SFILE_HEADER_LEN  (SFILE_MAGIC_LEN + SFILE_SALT_LEN + 8)
+#define SFILE_KEY_LEN     CURL_SHA256_DIGEST_LENGTH
+
+/* offsets into a record */
+#define SFILE_OFF_KEY     4
+#define SFILE_OFF_VALID   (SFILE_OFF_KEY + SFILE_KEY_LEN)
+#define SFILE_OFF_ID      (SFILE_OFF_VALID + 8)
+#define SFILE_OFF_FLAGS   (SFILE_OFF_ID + 8)
+#define SFILE_OFF_SDATA   (SFILE_OFF_FLAGS + 1)
+
+#define SFILE_REC_MIN     (SFILE_OFF_SDATA - 4)
+#define SFILE_REC_MAX     (64 * 1024)
+#define SFILE_ID_LEN      8
+
+#define SFILE_REC_ONCE    0x01  /* the first process loading it takes it */
+
+/* A file is not replaced before it reaches this size */
+#define SFILE_COMPACT_MIN (64 * 1024)
+/* Number of the most recent sessions kept per key on replacing */
+#define SFILE_KEY_MAX     8
+
+struct Curl_ssl_sfile {
+  char *path;
+  const unsigned char *map; /* the file, mapped into memory */
+  size_t map_len;
+  size_t end;             /* offset after the last complete record */
+  size_t base_len;        /* length of the file when it was written */
+  struct Curl_hash used;  /* ids of records used by this process */
+  unsigned char salt[SFILE_SALT_LEN];
+  unsigned int refcount;
+  int fd;
+#ifdef USE_THREADS_POSIX
+  curl_mutex_t mutex;     /* for the threads of this process */
+#endif
+  BIT(failed);            /* the file is not usable */
+};
+
+static size_t sfile_dec32(const unsigned char *p)
+{
+  return (size_t)p[0] << 24 | (size_t)p[1] << 16 |
+         (size_t)p[2] << 8 | p[3];
+}
+
+static curl_uint64_t sfile_dec64(const unsigned char *p)
+{
+  return (curl_uint64_t)sfile_dec32(p) << 32 | sfile_dec32(p + 4);
+}
+
+static CURLcode sfile_enc32(struct dynbuf *buf, size_t val)
+{
+  unsigned char nval[4];
+  nval[0] = (unsigned char)(val >> 24);
+  nval[1] = (unsigned char)(val >> 16);
+  nval[2] = (unsigned char)(val >> 8);
+  nval[3] = (unsigned char)val;
+  return curlx_dyn_addn(buf, nval, sizeof(nval));
+}
+
+static CURLcode sfile_enc64(struct dynbuf *buf, curl_uint64_t val)
+{
+  CURLcode result = sfile_enc32(buf, (size_t)(val >> 32) & 0xffffffff);
+  if(!result)
+    result = sfile_enc32(buf, (size_t)val & 0xffffffff);
+  return result;
+}
+
+static void sfile_used_dtor(void *p)
+{
+  (void)p;
+}
+
+/* Lock the whole file with `type`, wait until it is available. */
+static int sfile_lock(int fd, int type)
+{
+  struct flock fl;
+
+  memset(&fl, 0, sizeof(fl));
+  fl.l_type = (short)type;
+  fl.l_whence = SEEK_SET;
+  while(fcntl(fd, F_SETLKW, &fl) == -1) {
+    if(SOCKERRNO != SOCKEINTR)
+      return -1;
+  }
+  return 0;
+}
+
+#define sfile_unlock(fd)    (void)sfile_lock(fd, F_UNLCK)
+
+static CURLcode sfile_write(int fd, size_t offset,
+                            const void *buf, size_t len)
+{
+  const char *p = buf;
+
+  if(lseek(fd, (off_t)offset, SEEK_SET) == (off_t)-1)
+    return CURLE_WRITE_ERROR;
+  while(len) {
+    ssize_t n = write(fd, p, len);
+    if(n < 0) {
+      if(SOCKERRNO == SOCKEINTR)
+        continue;
+      return CURLE_WRITE_ERROR;
+    }
+    p += n;
+    len -= (size_t)n;
+  }
+  return CURLE_OK;
+}
+
+static void sfile_unmap(struct Curl_ssl_sfile *sf)
+{
+  if(sf->map)
+    munmap(CURL_UNCONST(sf->map), sf->map_len);
+  sf->map = NULL;
+  sf->map_len = 0;
+}
+
+static void sfile_fclose(struct Curl_ssl_sfile *sf)
+{
+  sfile_unmap(sf);
+  if(sf->fd != -1)
+    close(sf->fd);
+  sf->fd = -1;
+}
+
+/* Length of the record at `offset` or 0 when it is incomplete */
+static size_t sfile_rec_len(struct Curl_ssl_sfile *sf, size_t offset)
+{
+  size_t rlen;
+
+  if(sf->map_len - offset < 4)
+    return 0;
+  rlen = sfile_dec32(sf->map + offset);
+  if((rlen < SFILE_REC_MIN) || (rlen > SFILE_REC_MAX) ||
+     (rlen > sf->map_len - offset - 4))
+    return 0;
+  return 4 + rlen;
+}
+
+/* Map the file as it is now, check its header and find the end of its
+ * records. */
+static CURLcode sfile_map(struct Curl_easy *data, struct Curl_ssl_sfile *sf,
+                          size_t flen)
+{
+  size_t offset, rlen;
+
+  if(flen != sf->map_len) {
+    void *map;
+    sfile_unmap(sf);
+    map = mmap(NULL, flen, PROT_READ, MAP_SHARED, sf->fd, 0);
+    if(map == MAP_FAILED) {
+      CURL_TRC_SSLS(data, "unable to map session file %s, errno=%d",
+                    sf->path, errno);
+      return CURLE_READ_ERROR;
+    }
+    sf->map = map;
+    sf->map_len = flen;
+  }
+
+  if(memcmp(sf->map, SFILE_MAGIC, SFILE_MAGIC_LEN)) {
+    CURL_TRC_SSLS(data, "%s is not a session file", sf->path);
+    sf->failed = TRUE;
+    return CURLE_BAD_FUNCTION_ARGUMENT;
+  }
+  memcpy(sf->salt, sf->map + SFILE_MAGIC_LEN, sizeof(sf->salt));
+  sf->base_len = (size_t)sfile_dec64(sf->map + SFILE_MAGIC_LEN +
+                                     SFILE_SALT_LEN);
+
+  for(offset = SFILE_HEADER_LEN; offset < flen; offset += rlen) {
+    rlen = sfile_rec_len(sf, offset);
+    if(!rlen)
+      break;
+  }
+  sf->end = offset;
+  if(sf->end < flen) {
+    /* a writer died while appending, remove its incomplete record */
+    CURL_TRC_SSLS(data, "session file %s has an incomplete record at %zu",
+                  sf->path, sf->end);
+    if(ftruncate(sf->fd, (off_t)sf->end))
+      return CURLE_WRITE_ERROR;
+  }
+  return CURLE_OK;
+}
+
+/* Write a new file header into `buf` */
+static CURLcode sfile_header(struct dynbuf *buf, const unsigned char *salt,
+                             size_t flen)
+{
+  CURLcode result = curlx_dyn_addn(buf, SFILE_MAGIC, SFILE_MAGIC_LEN);
+  if(!result)
+    result = curlx_dyn_addn(buf, salt, SFILE_SALT_LEN);
+  if(!result)
+    result = sfile_enc64(buf, (curl_uint64_t)flen);
+  return result;
+}
+
+/* Open the file, when not done already, and lock it. When another user
+ * has replaced or removed the file in the meantime, use the file now at
+ * `path`. A new file is created with a random salt. */
+static CURLcode sfile_begin(struct Curl_easy *data, struct Curl_ssl_sfile *sf)
+{
+  struct stat st, pst;
+  CURLcode result;
+
+  if(sf->failed)
+    return CURLE_READ_ERROR;
+  for(;;) {
+    if(sf->fd == -1) {
+      int flags = O_RDWR | O_CREAT;
+#ifdef O_CLOEXEC
+      flags |= O_CLOEXEC;
+#endif
+      /* the file holds secrets, only the owner may access it */
+      sf->fd = open(sf->path, flags, 0600);
+      if(sf->fd == -1) {
+        CURL_TRC_SSLS(data, "unable to open session file %s, errno=%d",
+                      sf->path, errno);
+        return CURLE_READ_ERROR;
+      }
+    }
+    if(sfile_lock(sf->fd, F_WRLCK)) {
+      sfile_fclose(sf);
+      return CURLE_READ_ERROR;
+    }
+    if(fstat(sf->fd, &st)) {
+      sfile_unlock(sf->fd);
+      sfile_fclose(sf);
+      return CURLE_READ_ERROR;
+    }
+    if(!stat(sf->path, &pst) &&
+       (st.st_ino == pst.st_ino) && (st.st_dev == pst.st_dev))
+      break;
+    sfile_unlock(sf->fd);
+    sfile_fclose(sf);
+  }
+
+  if(!st.st_size) {
+    struct dynbuf buf;
+    unsigned char salt[SFILE_SALT_LEN];
+
+    curlx_dyn_init(&buf, SFILE_HEADER_LEN + 1);
+    result = Curl_rand(data, salt, sizeof(salt));
+    if(!result)
+      result = sfile_header(&buf, salt, SFILE_HEADER_LEN);
+    if(!result)
+      result = sfile_write(sf->fd, 0, curlx_dyn_ptr(&buf),
+                           curlx_dyn_len(&buf));
+    curlx_dyn_free(&buf);
+    if(result)
+      goto out;
+    st.st_size = SFILE_HEADER_LEN;
+  }
+
+  if((st.st_size < SFILE_HEADER_LEN) ||
+     ((curl_off_t)(size_t)st.st_size != st.st_size)) {
+    CURL_TRC_SSLS(data, "%s is not a session file", sf->path);
+    sf->failed = TRUE;
+    result = CURLE_BAD_FUNCTION_ARGUMENT;
+    goto out;
+  }
+  result = sfile_map(data, sf, (size_t)st.st_size);
+
+out:
+  if(result) {
+    sfile_unlock(sf->fd);
+    sfile_fclose(sf);
+  }
+  return result;
+}
+
+static void sfile_end(struct Curl_ssl_sfile *sf)
+{
+  if(sf->fd != -1)
+    sfile_unlock(sf->fd);
+}
+
+static CURLcode sfile_key(struct Curl_ssl_sfile *sf,
+                          const char *ssl_peer_key,
+                          unsigned char *key)
+{
+  return Curl_hmacit(&Curl_HMAC_SHA256, sf->salt, sizeof(sf->salt),
+                     (const unsigned char *)ssl_peer_key,
+                     strlen(ssl_peer_key), key);
+}
+
+static bool sfile_is_used(struct Curl_ssl_sfile *sf, const unsigned char *rec)
+{
+  return !!Curl_hash_pick(&sf->used, CURL_UNCONST(rec + SFILE_OFF_ID),
+                          SFILE_ID_LEN);
+}
+
+static CURLcode sfile_set_used(struct Curl_ssl_sfile *sf,
+                               const unsigned char *id)
+{
+  if(!Curl_hash_add(&sf->used, CURL_UNCONST(id), SFILE_ID_LEN, sf))
+    return CURLE_OUT_OF_MEMORY;
+  return CURLE_OK;
+}
+
+/* TRUE when the record is still worth keeping at `now` */
+static bool sfile_rec_live(const unsigned char *rec, curl_off_t now)
+{
+  return (curl_off_t)sfile_dec64(rec + SFILE_OFF_VALID) > now;
+}
+
+/* Write the records of the file that have not expired, at most
+ * SFILE_KEY_MAX per key, followed by `rec` into a new file that
+ * replaces the current one. Called with the current file locked. */
+static CURLcode sfile_replace(struct Curl_easy *data,
+                              struct Curl_ssl_sfile *sf, curl_off_t now,
+                              const void *rec, size_t rec_len)
+{
+  struct Curl_hash keys;
+  struct dynbuf buf;
+  size_t *live = NULL, *kcount = NULL;
+  size_t nlive = 0, offset, i, rlen;
+  unsigned char randbuf[9];
+  char *tmp = NULL;
+  int fd = -1;
+  CURLcode result = CURLE_OUT_OF_MEMORY;
+
+  Curl_hash_init(&keys, 63, Curl_hash_str, curlx_str_key_compare,
+                 sfile_used_dtor);
+  curlx_dyn_init(&buf, SFILE_HEADER_LEN + sf->end + rec_len + 1);
+
+  /* find the live records, newest last */
+  for(offset = SFILE_HEADER_LEN; offset < sf->end; offset += rlen) {
+    rlen = sfile_rec_len(sf, offset);
+    if(sfile_rec_live(sf->map + offset, now))
+      ++nlive;
+  }
+  if(nlive) {
+    live = calloc(nlive, sizeof(*live));
+    kcount = calloc(nlive, sizeof(*kcount));
+    if(!live || !kcount)
+      goto out;
+  }
+  nlive = 0;
+  for(offset = SFILE_HEADER_LEN; offset < sf->end; offset += rlen) {
+    rlen = sfile_rec_len(sf, offset);
+    if(sfile_rec_live(sf->map + offset, now))
+      live[nlive++] = offset;
+  }
+  /* drop all but the newest records of each key */
+  for(i = nlive; i > 0; --i) {
+    void *key = CURL_UNCONST(sf->map + live[i - 1] + SFILE_OFF_KEY);
+    size_t *count = Curl_hash_pick(&keys, key, SFILE_KEY_LEN);
+    if(!count) {
+      count = &kcount[i - 1];
+      if(!Curl_hash_add(&keys, key, SFILE_KEY_LEN, count))
+        goto out;
+    }
+    if(++(*count) > SFILE_KEY_MAX)
+      live[i - 1] = 0;
+  }
+
+  /* the length of the new file goes into its header */
+  offset = SFILE_HEADER_LEN + rec_len;
+  for(i = 0; i < nlive; ++i) {
+    if(live[i])
+      offset += sfile_rec_len(sf, live[i]);
+  }
+  result = sfile_header(&buf, sf->salt, offset);
+  for(i = 0; !result && (i < nlive); ++i) {
+    if(live[i])
+      result = curlx_dyn_addn(&buf, sf->map + live[i],
+                              sfile_rec_len(sf, live[i]));
+  }
+  if(!result)
+    result = curlx_dyn_addn(&buf, rec, rec_len);
+  if(result)
+    goto out;
+
+  result = Curl_rand_alnum(data, randbuf, sizeof(randbuf));
+  if(result)
+    goto out;
+  tmp = aprintf("%s.%s.tmp", sf->path, randbuf);
+  if(!tmp) {
+    result = CURLE_OUT_OF_MEMORY;
+    goto out;
+  }
+  fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL, 0600);
+  if(fd == -1) {
+    result = CURLE_WRITE_ERROR;
+    goto out;
+  }
+  result = sfile_write(fd, 0, curlx_dyn_ptr(&buf), curlx_dyn_len(&buf));
+  close(fd);
+  if(!result && Curl_rename(tmp, sf->path))
+    result = CURLE_WRITE_ERROR;
+  if(result)
+    unlink(tmp);
+  else
+    CURL_TRC_SSLS(data, "replaced session file %s of %zu bytes with %zu",
+                  sf->path, sf->end, curlx_dyn_len(&buf));
+
+out:
+  free(tmp);
+  free(live);
+  free(kcount);
+  Curl_hash_destroy(&keys);
+  curlx_dyn_free(&buf);
+  return result;
+}
+
+CURLcode Curl_ssl_sfile_open(const char *path, struct Curl_ssl_sfile **psf)
+{
+  struct Curl_ssl_sfile *sf;
+
+  *psf = NULL;
+  sf = calloc(1, sizeof(*sf));
+  if(!sf)
+    return CURLE_OUT_OF_MEMORY;
+  sf->path = strdup(path);
+  if(!sf->path) {
+    free(sf);
+    return CURLE_OUT_OF_MEMORY;
+  }
+  sf->fd = -1;
+  sf->refcount = 1;
+  Curl_hash_init(&sf->used, 63, Curl_hash_str, curlx_str_key_compare,
+                 sfile_used_dtor);
+#ifdef USE_THREADS_POSIX
+  Curl_mutex_init(&sf->mutex);
+#endif
+  *psf = sf;
+  return CURLE_OK;
+}
+
+void Curl_ssl_sfile_ref(struct Curl_ssl_sfile *sf)
+{
+  sf->refcount++;
+}
+
+void Curl_ssl_sfile_close(struct Curl_ssl_sfile *sf)
+{
+  if(sf && !--sf->refcount) {
+    sfile_fclose(sf);
+#ifdef USE_THREADS_POSIX
+    Curl_mutex_destroy(&sf->mutex);
+#endif
+    Curl_hash_destroy(&sf->used);
+    free(sf->path);
+    free(sf);
+  }
+}
+
+bool Curl_ssl_sfile_is(struct Curl_ssl_sfile *sf, const char *path)
+{
+  return sf && path && !strcmp(sf->path, path);
+}
+
+static CURLcode sfile_append(struct Curl_easy *data,
+                             struct Curl_ssl_sfile *sf,
+                             const char *ssl_peer_key,
+                             curl_off_t now, curl_off_t valid_until,
+                             bool once, struct dynbuf *buf,
+                             const void *sdata, size_t sdata_len)
+{
+  unsigned char key[SFILE_KEY_LEN];
+  unsigned char id[SFILE_ID_LEN];
+  unsigned char flags = once ? SFILE_REC_ONCE : 0;
+  size_t rec_len;
+  CURLcode result;
+
+  result = sfile_begin(data, sf);
+  if(result)
+    return result;
+
+  result = sfile_key(sf, ssl_peer_key, key);
+  if(!result)
+    result = Curl_rand(data, id, sizeof(id));
+  if(!result)
+    result = sfile_enc32(buf, SFILE_REC_MIN + sdata_len);
+  if(!result)
+    result = curlx_dyn_addn(buf, key, sizeof(key));
+  if(!result)
+    result = sfile_enc64(buf, (curl_uint64_t)valid_until);
+  if(!result)
+    result = curlx_dyn_addn(buf, id, sizeof(id));
+  if(!result)
+    result = curlx_dyn_addn(buf, &flags, 1);
+  if(!result)
+    result = curlx_dyn_addn(buf, sdata, sdata_len);
+  if(result) {
+    sfile_end(sf);
+    return result;
+  }
+
+  rec_len = curlx_dyn_len(buf);
+  if(sf->end + rec_len > CURLMAX(SFILE_COMPACT_MIN, 2 * sf->base_len)) {
+    result = sfile_replace(data, sf, now, curlx_dyn_ptr(buf), rec_len);
+    /* the file we have locked is gone, use the new one next time */
+    sfile_end(sf);
+    sfile_fclose(sf);
+  }
+  else {
+    result = sfile_write(sf->fd, sf->end, curlx_dyn_ptr(buf), rec_len);
+    if(result && ftruncate(sf->fd, (off_t)sf->end))
+      CURL_TRC_SSLS(data, "unable to restore session file %s", sf->path);
+    sfile_end(sf);
+  }
+  /* a session for single use is left for the first one to load it */
+  if(!result && !once)
+    result = sfile_set_used(sf, id);
+  return result;
+}
+
+CURLcode Curl_ssl_sfile_append(struct Curl_easy *data,
+                               struct Curl_ssl_sfile *sf,
+                               const char *ssl_peer_key,
+                               curl_off_t now, curl_off_t valid_until,
+                               bool once,
+                               const void *sdata, size_t sdata_len)
+{
+  struct dynbuf buf;
+  CURLcode result;
+
+  if(!sdata_len || (sdata_len > (SFILE_REC_MAX - SFILE_REC_MIN)))
+    return CURLE_BAD_FUNCTION_ARGUMENT;
+
+  curlx_dyn_init(&buf, SFILE_REC_MAX + 5);
+#ifdef USE_THREADS_POSIX
+  Curl_mutex_acquire(&sf->mutex);
+#endif
+  result = sfile_append(data, sf, ssl_peer_key, now, valid_until, once,
+                        &buf, sdata, sdata_len);
+#ifdef USE_THREADS_POSIX
+  Curl_mutex_release(&sf->mutex);
+#endif
+  curlx_dyn_free(&buf);
+  if(result)
+    CURL_TRC_SSLS(data, "failed to append session to %s, error=%d",
+                  sf->path, result);
+  return result;
+}
+
+/* Copy the sessions of `ssl_peer_key` to `buf`, each preceded by its
+ * length as a size_t. */
+static CURLcode sfile_load(struct Curl_easy *data,
+                           struct Curl_ssl_sfile *sf,
+                           const char *ssl_peer_key,
+                           curl_off_t now, struct dynbuf *buf)
+{
+  unsigned char key[SFILE_KEY_LEN];
+  size_t offset, rlen;
+  CURLcode result;
+
+  result = sfile_begin(data, sf);
+  if(result)
+    return result;
+
+  result = sfile_key(sf, ssl_peer_key, key);
+  for(offset = SFILE_HEADER_LEN; !result && (offset < sf->end);
+      offset += rlen) {
+    const unsigned char *rec = sf->map + offset;
+    size_t slen;
+
+    rlen = sfile_rec_len(sf, offset);
+    if(memcmp(rec + SFILE_OFF_KEY, key, sizeof(key)) ||
+       sfile_is_used(sf, rec))
+      continue;
+    result = sfile_set_used(sf, rec + SFILE_OFF_ID);
+    if(result || !sfile_rec_live(rec, now))
+      continue;
+    if(rec[SFILE_OFF_FLAGS] & SFILE_REC_ONCE) {
+      /* See RFC 8446 C.4: take it, so that no other process uses it */
+      static const unsigned char expired[8];
+      result = sfile_write(sf->fd, offset + SFILE_OFF_VALID,
+                           expired, sizeof(expired));
+      if(result)
+        continue;
+    }
+    slen = rlen - SFILE_OFF_SDATA;
+    result = curlx_dyn_addn(buf, &slen, sizeof(slen));
+    if(!result)
+      result = curlx_dyn_addn(buf, rec + SFILE_OFF_SDATA, slen);
+  }
+  sfile_end(sf);
+  return result;
+}
+
+CURLcode Curl_ssl_sfile_load(struct Curl_easy *data,
+                             struct Curl_ssl_sfile *sf,
+                             const char *ssl_peer_key,
+                             curl_off_t now,
+                             Curl_ssl_sfile_cb *cb, void *user_data)
+{
+  struct dynbuf buf;
+  const unsigned char *p;
+  size_t len, slen;
+  CURLcode result;
+
+  curlx_dyn_init(&buf, CURL_MAX_INPUT_LENGTH);
+#ifdef USE_THREADS_POSIX
+  Curl_mutex_acquire(&sf->mutex);
+#endif
+  result = sfile_load(data, sf, ssl_peer_key, now, &buf);
+#ifdef USE_THREADS_POSIX
+  Curl_mutex_release(&sf->mutex);
+#endif
+
+  /* hand out the sessions with the file unlocked */
+  p = curlx_dyn_uptr(&buf);
+  len = curlx_dyn_len(&buf);
+  while(!result && len) {
+    memcpy(&slen, p, sizeof(slen));
+    result = cb(data, user_data, p + sizeof(slen), slen);
+    p += sizeof(slen) + slen;
+    len -= sizeof(slen) + slen;
+  }
+  curlx_dyn_free(&buf);
+  return result;
+}
+
+#endif /* USE_SSLS_FILE */
@@ -0,0 +1,76 @@
+#ifndef HEADER_CURL_VTLS_SFILE_H
+#define HEADER_CURL_VTLS_SFILE_H
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "../curl_setup.h"
+
+#ifdef USE_SSLS_FILE
+
+struct Curl_easy;
+struct Curl_ssl_sfile;
+
+/* Create the session file instance for `path`. The file is opened, or
+ * created when it does not exist, on first use. Several processes may
+ * use the same file at the same time. */
+CURLcode Curl_ssl_sfile_open(const char *path, struct Curl_ssl_sfile **psf);
+
+/* Add a reference to `sf`. Callers serialize Curl_ssl_sfile_ref() and
+ * Curl_ssl_sfile_close() with a lock of their own. */
+void Curl_ssl_sfile_ref(struct Curl_ssl_sfile *sf);
+
+/* Drop a reference to `sf`, close it when it was the last one. */
+void Curl_ssl_sfile_close(struct Curl_ssl_sfile *sf);
+
+/* TRUE iff the session file was opened with `path` */
+bool Curl_ssl_sfile_is(struct Curl_ssl_sfile *sf, const char *path);
+
+/* Append the packed session `sdata` for `ssl_peer_key` to the file. The
+ * peer key itself is never written to the file. A session for `once`
+ * use is taken by the first process that loads it, including this one.
+ * Other sessions count as used by this process, Curl_ssl_sfile_load()
+ * does not return them. When the file has grown too much, it is
+ * replaced by one holding only the sessions not expired at `now`. */
+CURLcode Curl_ssl_sfile_append(struct Curl_easy *data,
+                               struct Curl_ssl_sfile *sf,
+                               const char *ssl_peer_key,
+                               curl_off_t now, curl_off_t valid_until,
+                               bool once,
+                               const void *sdata, size_t sdata_len);
+
+typedef CURLcode Curl_ssl_sfile_cb(struct Curl_easy *data, void *user_data,
+                                   const void *sdata, size_t sdata_len);
+
+/* Invoke `cb` for all sessions of `ssl_peer_key` that have not expired
+ * at `now` and have not been used by this process before, oldest first.
+ * All sessions of `ssl_peer_key` count as used afterwards. `cb` is
+ * invoked after the file has been unlocked again. */
+CURLcode Curl_ssl_sfile_load(struct Curl_easy *data,
+                             struct Curl_ssl_sfile *sf,
+                             const char *ssl_peer_key,
+                             curl_off_t now,
+                             Curl_ssl_sfile_cb *cb, void *user_data);
+
+#endif /* USE_SSLS_FILE */
+
+#endif /* HEADER_CURL_VTLS_SFILE_H */
@@ -1096,6 +1096,7 @@ curl_easy_setopt_ccsid(CURL *easy, CURLoption tag, ...)
   case CURLOPT_CRLFILE:
   case CURLOPT_CUSTOMREQUEST:
   case CURLOPT_DEFAULT_PROTOCOL:
+  case CURLOPT_DNS_CACHE_FILE:
   case CURLOPT_DNS_INTERFACE:
   case CURLOPT_DNS_LOCAL_IP4:
   case CURLOPT_DNS_LOCAL_IP6:
@@ -1164,6 +1165,7 @@ curl_easy_setopt_ccsid(CURL *easy, CURLoption tag, ...)
   case CURLOPT_SSLKEYTYPE:
   case CURLOPT_SSL_CIPHER_LIST:
   case CURLOPT_SSL_EC_CURVES:
+  case CURLOPT_SSL_SESSION_FILE:
   case CURLOPT_SSL_SIGNATURE_ALGORITHMS:
   case CURLOPT_TLS13_CIPHERS:
   case CURLOPT_TLSAUTH_PASSWORD:
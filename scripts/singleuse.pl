@@ -52,6 +52,7 @@ my %wl = (
 );
 
 my %api = (
+    'curl_borrow_release' => 'API',
     'curl_easy_cleanup' => 'API',
     'curl_easy_duphandle' => 'API',
     'curl_easy_escape' => 'API',
@@ -0,0 +1,262 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+/*
+ * A harness for microbenchmarks of libcurl internals. It runs each
+ * benchmark until its operations take a measurable amount of time,
+ * repeats that a number of rounds and writes the median time and the
+ * allocations per operation as JSON to stdout.
+ *
+ * Usage: bench [-t ms] [-r rounds] [-l] [name...]
+ */
+#include "bench.h"
+
+#include <curl/mprintf.h>
+
+#include "curlx/strparse.h"
+
+/* This file counts libcurl's allocations and needs the real functions.
+ * It does not include curl_memory.h and memdebug.h for that reason. */
+
+#define BENCH_DEF_TIME_MS  200  /* default time to spend per round */
+#define BENCH_DEF_ROUNDS   5    /* default number of rounds */
+#define BENCH_MAX_ROUNDS   101
+
+static size_t alloc_count;
+static size_t alloc_bytes;
+
+static void *bench_malloc(size_t size)
+{
+  ++alloc_count;
+  alloc_bytes += size;
+  return (malloc)(size);
+}
+
+static void bench_free(void *ptr)
+{
+  (free)(ptr);
+}
+
+static void *bench_realloc(void *ptr, size_t size)
+{
+  ++alloc_count;
+  alloc_bytes += size;
+  return (realloc)(ptr, size);
+}
+
+static char *bench_strdup(const char *str)
+{
+  size_t len = strlen(str) + 1;
+  char *p = bench_malloc(len);
+  if(p)
+    memcpy(p, str, len);
+  return p;
+}
+
+static void *bench_calloc(size_t nmemb, size_t size)
+{
+  ++alloc_count;
+  alloc_bytes += nmemb * size;
+  return (calloc)(nmemb, size);
+}
+
+void bench_start(struct bench_run *r)
+{
+  r->allocs = alloc_count;
+  r->alloc_bytes = alloc_bytes;
+  r->started = curlx_now();
+}
+
+void bench_stop(struct bench_run *r)
+{
+  r->elapsed_us = curlx_timediff_us(curlx_now(), r->started);
+  r->allocs = alloc_count - r->allocs;
+  r->alloc_bytes = alloc_bytes - r->alloc_bytes;
+}
+
+static volatile unsigned char bench_sink;
+
+void bench_use(const void *p, size_t n)
+{
+  if(p && n)
+    bench_sink = ((const unsigned char *)p)[n - 1];
+}
+
+static const struct bench_def *bench_all[] = {
+  bench_base64,
+  bench_bufq,
+  bench_cookie,
+  bench_dynhds,
+  bench_hash,
+  bench_http,
+  bench_strparse,
+  NULL
+};
+
+static bool bench_selected(const char *name, int argc, char **argv)
+{
+  int i;
+
+  if(!argc)
+    return TRUE;
+  for(i = 0; i < argc; ++i) {
+    /* a name selects itself and all benchmarks it is a prefix of */
+    if(!strncmp(name, argv[i], strlen(argv[i])))
+      return TRUE;
+  }
+  return FALSE;
+}
+
+static int cmp_ns(const void *a, const void *b)
+{
+  double da = *(const double *)a;
+  double db = *(const double *)b;
+  return (da < db) ? -1 : ((da > db) ? 1 : 0);
+}
+
+static CURLcode bench_measure(const struct bench_def *def,
+                              timediff_t round_us, int rounds,
+                              bool *pfirst)
+{
+  struct bench_run r;
+  double ns[BENCH_MAX_ROUNDS];
+  size_t n = 1;
+  CURLcode result;
+  int i;
+
+  /* find the number of operations that take about a round */
+  for(;;) {
+    memset(&r, 0, sizeof(r));
+    r.n = n;
+    result = def->func(&r);
+    if(result)
+      return result;
+    if((r.elapsed_us >= round_us) || (n >= ((size_t)1 << 30)))
+      break;
+    if(r.elapsed_us < 1000)
+      n *= 10;
+    else
+      n = (size_t)((double)n * (double)round_us * 1.2 /
+                   (double)r.elapsed_us) + 1;
+  }
+
+  for(i = 0; i < rounds; ++i) {
+    memset(&r, 0, sizeof(r));
+    r.n = n;
+    result = def->func(&r);
+    if(result)
+      return result;
+    ns[i] = (double)r.elapsed_us * 1000.0 / (double)n;
+  }
+  qsort(ns, (size_t)rounds, sizeof(ns[0]), cmp_ns);
+
+  curl_mprintf("%s    {\"name\": \"%s\", \"iterations\": %zu, "
+               "\"ns_per_op\": %.2f, \"ns_per_op_min\": %.2f, "
+               "\"allocs_per_op\": %.3f, \"bytes_per_op\": %.1f}",
+               *pfirst ? "" : ",\n", def->name, n, ns[rounds / 2], ns[0],
+               (double)r.allocs / (double)n,
+               (double)r.alloc_bytes / (double)n);
+  *pfirst = FALSE;
+  return CURLE_OK;
+}
+
+static void usage(void)
+{
+  curl_mfprintf(stderr,
+                "Usage: bench [-t ms] [-r rounds] [-l] [name...]\n"
+                "  -t ms      time to spend in each round (default %d)\n"
+                "  -r rounds  rounds to run for the median (default %d)\n"
+                "  -l         list the benchmarks\n"
+                "  name       run benchmarks starting with name only\n",
+                BENCH_DEF_TIME_MS, BENCH_DEF_ROUNDS);
+}
+
+int main(int argc, char **argv)
+{
+  const struct bench_def **pdefs, *def;
+  curl_off_t round_ms = BENCH_DEF_TIME_MS;
+  curl_off_t rounds = BENCH_DEF_ROUNDS;
+  bool list = FALSE, first = TRUE;
+  CURLcode result = CURLE_OK;
+  int i;
+
+  for(i = 1; i < argc && argv[i][0] == '-'; ++i) {
+    const char *p;
+    if(!strcmp(argv[i], "-l"))
+      list = TRUE;
+    else if(!strcmp(argv[i], "-t") && (i + 1 < argc)) {
+      p = argv[++i];
+      if(curlx_str_number(&p, &round_ms, 60000) || !round_ms) {
+        usage();
+        return 1;
+      }
+    }
+    else if(!strcmp(argv[i], "-r") && (i + 1 < argc)) {
+      p = argv[++i];
+      if(curlx_str_number(&p, &rounds, BENCH_MAX_ROUNDS) || !rounds) {
+        usage();
+        return 1;
+      }
+    }
+    else {
+      usage();
+      return 1;
+    }
+  }
+  argc -= i;
+  argv += i;
+
+  if(list) {
+    for(pdefs = bench_all; *pdefs; ++pdefs) {
+      for(def = *pdefs; def->name; ++def)
+        curl_mprintf("%s\n", def->name);
+    }
+    return 0;
+  }
+
+#ifdef _WIN32
+  curlx_now_init();
+#endif
+  if(curl_global_init_mem(CURL_GLOBAL_ALL, bench_malloc, bench_free,
+                          bench_realloc, bench_strdup, bench_calloc)) {
+    curl_mfprintf(stderr, "curl_global_init_mem() failed\n");
+    return 1;
+  }
+
+  curl_mprintf("{\n  \"version\": \"%s\",\n  \"benchmarks\": [\n",
+               curl_version_info(CURLVERSION_NOW)->version);
+  for(pdefs = bench_all; !result && *pdefs; ++pdefs) {
+    for(def = *pdefs; !result && def->name; ++def) {
+      if(!bench_selected(def->name, argc, argv))
+        continue;
+      result = bench_measure(def, (timediff_t)round_ms * 1000,
+                             (int)rounds, &first);
+      if(result)
+        curl_mfprintf(stderr, "%s failed: %d\n", def->name, (int)result);
+    }
+  }
+  curl_mprintf("\n  ]\n}\n");
+
+  curl_global_cleanup();
+  return result ? 1 : 0;
+}
@@ -0,0 +1,66 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#ifndef HEADER_CURL_BENCH_H
+#define HEADER_CURL_BENCH_H
+
+#include "curl_setup.h"
+
+#include <curl/curl.h>
+#include "curlx/timeval.h"
+
+/* One run of a benchmark, doing `n` operations. */
+struct bench_run {
+  size_t n;                  /* the number of operations to do */
+  struct curltime started;   /* when bench_start() was called */
+  timediff_t elapsed_us;     /* time between bench_start() and bench_stop() */
+  size_t allocs;             /* allocations between start and stop */
+  size_t alloc_bytes;        /* bytes allocated between start and stop */
+};
+
+/* A benchmark does its setup, calls bench_start(), does the `n`
+ * operations, calls bench_stop() and then cleans up. Only the time
+ * and the allocations between start and stop are measured. */
+typedef CURLcode bench_func(struct bench_run *r);
+
+struct bench_def {
+  const char *name;
+  bench_func *func;
+};
+
+void bench_start(struct bench_run *r);
+void bench_stop(struct bench_run *r);
+
+/* Keep the compiler from optimizing away a result */
+void bench_use(const void *p, size_t n);
+
+/* The benchmarks of each source file, terminated by a NULL name */
+extern const struct bench_def bench_base64[];
+extern const struct bench_def bench_bufq[];
+extern const struct bench_def bench_cookie[];
+extern const struct bench_def bench_dynhds[];
+extern const struct bench_def bench_hash[];
+extern const struct bench_def bench_http[];
+extern const struct bench_def bench_strparse[];
+
+#endif /* HEADER_CURL_BENCH_H */
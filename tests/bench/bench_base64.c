@@ -0,0 +1,86 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "bench.h"
+
+#include "curlx/base64.h"
+
+/* The last 3 #include files should be in this order */
+#include "curl_printf.h"
+#include "curl_memory.h"
+#include "memdebug.h"
+
+static char b64_data[1024];
+
+/* encode 1KB of binary data */
+static CURLcode base64_encode(struct bench_run *r)
+{
+  char *out;
+  size_t i, outlen;
+  CURLcode result = CURLE_OK;
+
+  for(i = 0; i < sizeof(b64_data); ++i)
+    b64_data[i] = (char)(i * 7);
+  bench_start(r);
+  for(i = 0; !result && i < r->n; ++i) {
+    result = curlx_base64_encode(b64_data, sizeof(b64_data), &out, &outlen);
+    if(!result) {
+      bench_use(out, outlen);
+      free(out);
+    }
+  }
+  bench_stop(r);
+  return result;
+}
+
+/* decode the base64 of 1KB of binary data */
+static CURLcode base64_decode(struct bench_run *r)
+{
+  char *enc;
+  unsigned char *out;
+  size_t i, enclen, outlen;
+  CURLcode result;
+
+  for(i = 0; i < sizeof(b64_data); ++i)
+    b64_data[i] = (char)(i * 7);
+  result = curlx_base64_encode(b64_data, sizeof(b64_data), &enc, &enclen);
+  if(result)
+    return result;
+  bench_start(r);
+  for(i = 0; !result && i < r->n; ++i) {
+    result = curlx_base64_decode(enc, &out, &outlen);
+    if(!result) {
+      bench_use(out, outlen);
+      free(out);
+    }
+  }
+  bench_stop(r);
+  free(enc);
+  return result;
+}
+
+const struct bench_def bench_base64[] = {
+  { "base64_encode", base64_encode },
+  { "base64_decode", base64_decode },
+  { NULL, NULL }
+};
@@ -0,0 +1,86 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "bench.h"
+
+#include "bufq.h"
+
+/* The last 3 #include files should be in this order */
+#include "curl_printf.h"
+#include "curl_memory.h"
+#include "memdebug.h"
+
+static unsigned char bufq_data[16 * 1024];
+
+/* write and read 4KB through a bufq of 16KB chunks */
+static CURLcode bufq_write_read(struct bench_run *r)
+{
+  struct bufq q;
+  size_t i, nwritten, nread;
+  CURLcode result = CURLE_OK;
+
+  Curl_bufq_init(&q, 16 * 1024, 4);
+  bench_start(r);
+  for(i = 0; !result && i < r->n; ++i) {
+    result = Curl_bufq_cwrite(&q, (const char *)bufq_data, 4096, &nwritten);
+    if(!result)
+      result = Curl_bufq_cread(&q, (char *)bufq_data, 4096, &nread);
+  }
+  bench_stop(r);
+  Curl_bufq_free(&q);
+  return result;
+}
+
+/* write 40KB in small pieces into a pooled bufq, then drain it
+ * with peek and skip, returning its chunks to the pool */
+static CURLcode bufq_pool_cycle(struct bench_run *r)
+{
+  struct bufc_pool pool;
+  struct bufq q;
+  const unsigned char *buf;
+  size_t i, j, nwritten, blen;
+  CURLcode result = CURLE_OK;
+
+  Curl_bufcp_init(&pool, 16 * 1024, 4);
+  Curl_bufq_initp(&q, &pool, 4, BUFQ_OPT_NONE);
+  bench_start(r);
+  for(i = 0; !result && i < r->n; ++i) {
+    for(j = 0; !result && j < 40; ++j)
+      result = Curl_bufq_cwrite(&q, (const char *)bufq_data, 1024,
+                                &nwritten);
+    while(Curl_bufq_peek(&q, &buf, &blen)) {
+      bench_use(buf, blen);
+      Curl_bufq_skip(&q, blen);
+    }
+  }
+  bench_stop(r);
+  Curl_bufq_free(&q);
+  Curl_bufcp_free(&pool);
+  return result;
+}
+
+const struct bench_def bench_bufq[] = {
+  { "bufq_write_read", bufq_write_read },
+  { "bufq_pool_cycle", bufq_pool_cycle },
+  { NULL, NULL }
+};
@@ -0,0 +1,95 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "bench.h"
+
+#include "urldata.h"
+#include "cookie.h"
+
+/* The last 3 #include files should be in this order */
+#include "curl_printf.h"
+#include "curl_memory.h"
+#include "memdebug.h"
+
+#if !defined(CURL_DISABLE_HTTP) && !defined(CURL_DISABLE_COOKIES)
+
+#define COOKIE_DOMAINS  50
+#define COOKIE_PER_DOMAIN 4
+
+/* match the cookies for a request in a jar of 200 cookies
+ * set by 50 domains */
+static CURLcode cookie_getlist(struct bench_run *r)
+{
+  CURL *curl = curl_easy_init();
+  struct Curl_easy *data = curl;
+  struct CookieInfo *ci;
+  struct Curl_llist list;
+  char line[128], domain[64];
+  size_t i, j, matches = 0;
+  CURLcode result = CURLE_OK;
+
+  if(!curl)
+    return CURLE_OUT_OF_MEMORY;
+  ci = Curl_cookie_init(data, NULL, NULL, TRUE);
+  if(!ci) {
+    curl_easy_cleanup(curl);
+    return CURLE_OUT_OF_MEMORY;
+  }
+  for(i = 0; i < COOKIE_DOMAINS; ++i) {
+    curl_msnprintf(domain, sizeof(domain), "www.site%zu.example", i);
+    for(j = 0; j < COOKIE_PER_DOMAIN; ++j) {
+      curl_msnprintf(line, sizeof(line),
+                     "c%zu=value%zu; domain=site%zu.example; path=/%s",
+                     j, j, i, (j % 2) ? "app" : "");
+      Curl_cookie_add(data, ci, TRUE, FALSE, line, domain, "/", FALSE);
+    }
+  }
+
+  bench_start(r);
+  for(i = 0; i < r->n; ++i) {
+    curl_msnprintf(domain, sizeof(domain), "www.site%zu.example",
+                   i % COOKIE_DOMAINS);
+    if(!Curl_cookie_getlist(data, ci, domain, "/app/index.html", FALSE,
+                            &list))
+      matches += Curl_llist_count(&list);
+  }
+  bench_stop(r);
+  if(r->n && !matches)
+    result = CURLE_FAILED_INIT;
+  Curl_cookie_cleanup(ci);
+  curl_easy_cleanup(curl);
+  return result;
+}
+
+const struct bench_def bench_cookie[] = {
+  { "cookie_getlist", cookie_getlist },
+  { NULL, NULL }
+};
+
+#else
+
+const struct bench_def bench_cookie[] = {
+  { NULL, NULL }
+};
+
+#endif
@@ -0,0 +1,104 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "bench.h"
+
+#include "dynhds.h"
+
+/* The last 3 #include files should be in this order */
+#include "curl_printf.h"
+#include "curl_memory.h"
+#include "memdebug.h"
+
+static const char *const dynhds_lines[] = {
+  "Date: Tue, 07 Oct 2025 10:12:44 GMT",
+  "Content-Type: text/html; charset=UTF-8",
+  "Content-Length: 135623",
+  "Connection: keep-alive",
+  "Cache-Control: private, max-age=0, must-revalidate",
+  "ETag: \"8d7a1f0c2b3e4d5f\"",
+  "Last-Modified: Mon, 06 Oct 2025 08:00:00 GMT",
+  "Server: bench/1.0",
+  "Strict-Transport-Security: max-age=31536000; includeSubDomains",
+  "Vary: Accept-Encoding",
+  "X-Content-Type-Options: nosniff",
+  "X-Frame-Options: SAMEORIGIN",
+  "Set-Cookie: session=0123456789abcdef; Path=/; Secure; HttpOnly",
+  "Accept-Ranges: bytes",
+  "Age: 12",
+  "Alt-Svc: h3=\":443\"; ma=86400",
+};
+
+/* parse 16 HTTP/1 header lines into a dynhds and look up 4 of them */
+static CURLcode dynhds_h1_lines(struct bench_run *r)
+{
+  struct dynhds hds;
+  size_t i, j;
+  CURLcode result = CURLE_OK;
+
+  Curl_dynhds_init(&hds, 128, 16 * 1024);
+  bench_start(r);
+  for(i = 0; !result && i < r->n; ++i) {
+    for(j = 0; !result && j < CURL_ARRAYSIZE(dynhds_lines); ++j)
+      result = Curl_dynhds_h1_cadd_line(&hds, dynhds_lines[j]);
+    if(!Curl_dynhds_cget(&hds, "content-length") ||
+       !Curl_dynhds_cget(&hds, "content-type") ||
+       !Curl_dynhds_cget(&hds, "etag") ||
+       Curl_dynhds_cget(&hds, "location"))
+      result = CURLE_FAILED_INIT;
+    Curl_dynhds_reset(&hds);
+  }
+  bench_stop(r);
+  Curl_dynhds_free(&hds);
+  return result;
+}
+
+/* serialize 16 headers for an HTTP/1 request */
+static CURLcode dynhds_h1_print(struct bench_run *r)
+{
+  struct dynhds hds;
+  struct dynbuf dbuf;
+  size_t i;
+  CURLcode result = CURLE_OK;
+
+  Curl_dynhds_init(&hds, 128, 16 * 1024);
+  curlx_dyn_init(&dbuf, 64 * 1024);
+  for(i = 0; !result && i < CURL_ARRAYSIZE(dynhds_lines); ++i)
+    result = Curl_dynhds_h1_cadd_line(&hds, dynhds_lines[i]);
+  bench_start(r);
+  for(i = 0; !result && i < r->n; ++i) {
+    result = Curl_dynhds_h1_dprint(&hds, &dbuf);
+    bench_use(curlx_dyn_ptr(&dbuf), curlx_dyn_len(&dbuf));
+    curlx_dyn_reset(&dbuf);
+  }
+  bench_stop(r);
+  curlx_dyn_free(&dbuf);
+  Curl_dynhds_free(&hds);
+  return result;
+}
+
+const struct bench_def bench_dynhds[] = {
+  { "dynhds_h1_lines", dynhds_h1_lines },
+  { "dynhds_h1_print", dynhds_h1_print },
+  { NULL, NULL }
+};
@@ -0,0 +1,106 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "bench.h"
+
+#include "hash.h"
+
+/* The last 3 #include files should be in this order */
+#include "curl_printf.h"
+#include "curl_memory.h"
+#include "memdebug.h"
+
+#define HASH_KEYS  1000
+
+static char hash_keys[HASH_KEYS][32];
+
+static void hash_make_keys(void)
+{
+  size_t i;
+  for(i = 0; i < HASH_KEYS; ++i)
+    curl_msnprintf(hash_keys[i], sizeof(hash_keys[i]),
+                   "host%zu.example.com:443", i);
+}
+
+/* the hash does not own the entries */
+static void hash_nop_dtor(void *p)
+{
+  (void)p;
+}
+
+/* look up keys in a hash of 1000 string keys, 1 in 10 are misses */
+static CURLcode hash_lookup(struct bench_run *r)
+{
+  struct Curl_hash h;
+  size_t i;
+  CURLcode result = CURLE_OK;
+
+  hash_make_keys();
+  Curl_hash_init(&h, 97, Curl_hash_str, curlx_str_key_compare,
+                 hash_nop_dtor);
+  for(i = 0; i < HASH_KEYS; ++i) {
+    if(i % 10)
+      Curl_hash_add(&h, hash_keys[i], strlen(hash_keys[i]) + 1,
+                    hash_keys[i]);
+  }
+  bench_start(r);
+  for(i = 0; i < r->n; ++i) {
+    const char *key = hash_keys[(i * 7) % HASH_KEYS];
+    void *p = Curl_hash_pick(&h, CURL_UNCONST(key), strlen(key) + 1);
+    if(!p != !(((i * 7) % HASH_KEYS) % 10))
+      result = CURLE_FAILED_INIT;
+  }
+  bench_stop(r);
+  Curl_hash_destroy(&h);
+  return result;
+}
+
+/* add string keys, emptying the hash after every 1000 */
+static CURLcode hash_add(struct bench_run *r)
+{
+  struct Curl_hash h;
+  size_t i, j;
+  CURLcode result = CURLE_OK;
+
+  hash_make_keys();
+  Curl_hash_init(&h, 97, Curl_hash_str, curlx_str_key_compare,
+                 hash_nop_dtor);
+  bench_start(r);
+  for(i = 0; !result && i < r->n; ++i) {
+    j = i % HASH_KEYS;
+    if(!Curl_hash_add(&h, hash_keys[j], strlen(hash_keys[j]) + 1,
+                      hash_keys[j]))
+      result = CURLE_OUT_OF_MEMORY;
+    else if(j == HASH_KEYS - 1)
+      Curl_hash_clean(&h);
+  }
+  bench_stop(r);
+  Curl_hash_destroy(&h);
+  return result;
+}
+
+const struct bench_def bench_hash[] = {
+  { "hash_lookup", hash_lookup },
+  { "hash_add", hash_add },
+  { NULL, NULL }
+};
@@ -0,0 +1,217 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "bench.h"
+
+#include "urldata.h"
+#include "http1.h"
+#include "socketpair.h"
+
+/* The last 3 #include files should be in this order */
+#include "curl_printf.h"
+#include "curl_memory.h"
+#include "memdebug.h"
+
+#ifndef CURL_DISABLE_HTTP
+
+static const char h1_request[] =
+  "GET /docs/manual/index.html?lang=en&x=1 HTTP/1.1\r\n"
+  "Host: www.example.com\r\n"
+  "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101\r\n"
+  "Accept: text/html,application/xhtml+xml\r\n"
+  "Accept-Language: en-US,en;q=0.5\r\n"
+  "Accept-Encoding: gzip, deflate, br\r\n"
+  "Connection: keep-alive\r\n"
+  "Cookie: session=0123456789abcdef; theme=dark\r\n"
+  "Upgrade-Insecure-Requests: 1\r\n"
+  "\r\n";
+
+/* parse an HTTP/1.1 request with 8 headers */
+static CURLcode http1_req_parse(struct bench_run *r)
+{
+  struct h1_req_parser p;
+  size_t i;
+  ssize_t nread;
+  CURLcode result = CURLE_OK;
+
+  bench_start(r);
+  for(i = 0; !result && i < r->n; ++i) {
+    Curl_h1_req_parse_init(&p, H1_PARSE_DEFAULT_MAX_LINE_LEN);
+    nread = Curl_h1_req_parse_read(&p, h1_request, sizeof(h1_request) - 1,
+                                   NULL, 0, &result);
+    if(!result && ((nread != (ssize_t)sizeof(h1_request) - 1) || !p.done))
+      result = CURLE_FAILED_INIT;
+    Curl_h1_req_parse_free(&p);
+  }
+  bench_stop(r);
+  return result;
+}
+
+#ifndef CURL_DISABLE_SOCKETPAIR
+
+#ifdef HAVE_SOCKETPAIR
+#define BENCH_SP_FAMILY AF_UNIX
+#else
+#define BENCH_SP_FAMILY AF_INET
+#endif
+
+static const char h1_response[] =
+  "HTTP/1.1 200 OK\r\n"
+  "Date: Tue, 07 Oct 2025 10:12:44 GMT\r\n"
+  "Content-Type: text/html; charset=UTF-8\r\n"
+  "Connection: keep-alive\r\n"
+  "Cache-Control: private, max-age=0, must-revalidate\r\n"
+  "ETag: \"8d7a1f0c2b3e4d5f\"\r\n"
+  "Last-Modified: Mon, 06 Oct 2025 08:00:00 GMT\r\n"
+  "Server: bench/1.0\r\n"
+  "Strict-Transport-Security: max-age=31536000; includeSubDomains\r\n"
+  "Vary: Accept-Encoding\r\n"
+  "X-Content-Type-Options: nosniff\r\n"
+  "X-Frame-Options: SAMEORIGIN\r\n"
+  "Set-Cookie: session=0123456789abcdef; Path=/; Secure; HttpOnly\r\n"
+  "Accept-Ranges: bytes\r\n"
+  "Age: 12\r\n"
+  "Alt-Svc: h3=\":443\"; ma=86400\r\n"
+  "Content-Length: 5\r\n"
+  "\r\n"
+  "hello";
+
+static curl_socket_t h1_opensocket(void *clientp, curlsocktype purpose,
+                                   struct curl_sockaddr *address)
+{
+  curl_socket_t *psock = clientp;
+  curl_socket_t s = *psock;
+  (void)purpose;
+  (void)address;
+  /* the connection is reused, it is opened once */
+  *psock = CURL_SOCKET_BAD;
+  return s;
+}
+
+static int h1_sockopt(void *clientp, curl_socket_t s, curlsocktype purpose)
+{
+  (void)clientp;
+  (void)s;
+  (void)purpose;
+  return CURL_SOCKOPT_ALREADY_CONNECTED;
+}
+
+static size_t h1_sink(char *ptr, size_t size, size_t nmemb, void *userp)
+{
+  (void)ptr;
+  (void)userp;
+  return size * nmemb;
+}
+
+/* Receive a response with 16 headers on a kept alive connection. The
+ * server end is a socketpair, so this measures libcurl's side of an
+ * HTTP/1.1 transfer, dominated by response header parsing. */
+static CURLcode http1_response(struct bench_run *r)
+{
+  curl_socket_t socks[2];
+  curl_socket_t csock;
+  struct curl_slist *resolve = NULL;
+  CURLM *multi = NULL;
+  CURL *curl = NULL;
+  CURLMsg *msg;
+  char buf[1024];
+  size_t i;
+  int running, queued;
+  CURLcode result = CURLE_OK;
+
+  if(Curl_socketpair(BENCH_SP_FAMILY, SOCK_STREAM, 0, socks, TRUE))
+    return CURLE_COULDNT_CONNECT;
+  csock = socks[0];
+  resolve = curl_slist_append(NULL, "bench.invalid:80:127.0.0.1");
+  multi = curl_multi_init();
+  curl = curl_easy_init();
+  if(!resolve || !multi || !curl) {
+    result = CURLE_OUT_OF_MEMORY;
+    goto out;
+  }
+  curl_easy_setopt(curl, CURLOPT_URL, "http://bench.invalid/");
+  curl_easy_setopt(curl, CURLOPT_RESOLVE, resolve);
+  curl_easy_setopt(curl, CURLOPT_OPENSOCKETFUNCTION, h1_opensocket);
+  curl_easy_setopt(curl, CURLOPT_OPENSOCKETDATA, &csock);
+  curl_easy_setopt(curl, CURLOPT_SOCKOPTFUNCTION, h1_sockopt);
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, h1_sink);
+
+  bench_start(r);
+  for(i = 0; !result && i < r->n; ++i) {
+    bool responded = FALSE;
+
+    if(curl_multi_add_handle(multi, curl)) {
+      result = CURLE_FAILED_INIT;
+      break;
+    }
+    do {
+      if(curl_multi_perform(multi, &running)) {
+        result = CURLE_FAILED_INIT;
+        break;
+      }
+      /* respond once the request has arrived */
+      if(!responded && (sread(socks[1], buf, sizeof(buf)) > 0)) {
+        while(sread(socks[1], buf, sizeof(buf)) > 0)
+          ;
+        if(swrite(socks[1], h1_response, sizeof(h1_response) - 1) !=
+           (ssize_t)sizeof(h1_response) - 1) {
+          result = CURLE_SEND_ERROR;
+          break;
+        }
+        responded = TRUE;
+      }
+    } while(running);
+    msg = curl_multi_info_read(multi, &queued);
+    if(!result && (!msg || msg->data.result))
+      result = msg ? msg->data.result : CURLE_FAILED_INIT;
+    curl_multi_remove_handle(multi, curl);
+  }
+  bench_stop(r);
+
+out:
+  curl_easy_cleanup(curl);
+  curl_multi_cleanup(multi);
+  curl_slist_free_all(resolve);
+  if(csock != CURL_SOCKET_BAD)
+    sclose(csock);
+  sclose(socks[1]);
+  return result;
+}
+
+#endif /* !CURL_DISABLE_SOCKETPAIR */
+
+const struct bench_def bench_http[] = {
+  { "http1_req_parse", http1_req_parse },
+#ifndef CURL_DISABLE_SOCKETPAIR
+  { "http1_response", http1_response },
+#endif
+  { NULL, NULL }
+};
+
+#else
+
+const struct bench_def bench_http[] = {
+  { NULL, NULL }
+};
+
+#endif /* !CURL_DISABLE_HTTP */
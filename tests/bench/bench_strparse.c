@@ -0,0 +1,84 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "bench.h"
+
+#include "curlx/strparse.h"
+
+/* The last 3 #include files should be in this order */
+#include "curl_printf.h"
+#include "curl_memory.h"
+#include "memdebug.h"
+
+/* parse a status line and a few header values the way the HTTP code
+ * does it */
+static CURLcode strparse_http(struct bench_run *r)
+{
+  static const char status[] = "HTTP/1.1 200 OK\r\n";
+  static const char clen[] = "  135623\r\n";
+  static const char chunk[] = "7ffa;ext=1\r\n";
+  static const char cctrl[] = "private, max-age=3600, must-revalidate";
+  size_t i;
+  CURLcode result = CURLE_OK;
+
+  bench_start(r);
+  for(i = 0; !result && i < r->n; ++i) {
+    struct Curl_str word;
+    curl_off_t num, sum = 0;
+    const char *p;
+
+    p = status;
+    if(curlx_str_word(&p, &word, 32) || curlx_str_singlespace(&p) ||
+       curlx_str_number(&p, &num, 999) || curlx_str_singlespace(&p) ||
+       curlx_str_untilnl(&p, &word, 64) || curlx_str_newline(&p))
+      result = CURLE_FAILED_INIT;
+    sum += num;
+
+    p = clen;
+    if(curlx_str_numblanks(&p, &num))
+      result = CURLE_FAILED_INIT;
+    sum += num;
+
+    p = chunk;
+    if(curlx_str_hex(&p, &num, CURL_OFF_T_MAX) || curlx_str_single(&p, ';'))
+      result = CURLE_FAILED_INIT;
+    sum += num;
+
+    p = cctrl;
+    while(!curlx_str_cspn(&p, &word, ",")) {
+      curlx_str_trimblanks(&word);
+      if(curlx_str_casecompare(&word, "must-revalidate"))
+        ++sum;
+      if(curlx_str_single(&p, ','))
+        break;
+    }
+    bench_use(&sum, sizeof(sum));
+  }
+  bench_stop(r);
+  return result;
+}
+
+const struct bench_def bench_strparse[] = {
+  { "strparse_http", strparse_http },
+  { NULL, NULL }
+};
@@ -0,0 +1,151 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+/*
+ * Run several transfers with CURLMOPT_WORKER_THREADS and collect their
+ * results via curl_multi_info_read().
+ */
+
+#include "test.h"
+
+#include "testutil.h"
+#include "warnless.h"
+#include "memdebug.h"
+
+#define TEST_HANG_TIMEOUT 60 * 1000
+
+#define NUM_HANDLES 4
+
+static size_t write_cb(char *ptr, size_t size, size_t nmemb, void *userp)
+{
+  (void)ptr;
+  (void)userp;
+  return size * nmemb;
+}
+
+CURLcode test(char *URL)
+{
+  CURLcode res = CURLE_OK;
+  CURL *curl[NUM_HANDLES] = {0};
+  CURLcode results[NUM_HANDLES];
+  int running;
+  int done = 0;
+  int numfds;
+  CURLM *m = NULL;
+  CURLMcode mc;
+  int i;
+
+  start_test_timing();
+
+  global_init(CURL_GLOBAL_ALL);
+
+  multi_init(m);
+
+  mc = curl_multi_wait(NULL, NULL, 0, 0, &numfds);
+  if(mc != CURLM_BAD_HANDLE) {
+    curl_mfprintf(stderr, "curl_multi_wait(NULL) returned %d\n", (int)mc);
+    res = TEST_ERR_MULTI;
+    goto test_cleanup;
+  }
+
+  /* without worker support, the transfers run in this thread */
+  mc = curl_multi_setopt(m, CURLMOPT_WORKER_THREADS, 2L);
+  if(mc && (mc != CURLM_UNKNOWN_OPTION)) {
+    curl_mfprintf(stderr, "setting CURLMOPT_WORKER_THREADS failed: %d\n",
+                  (int)mc);
+    res = TEST_ERR_MULTI;
+    goto test_cleanup;
+  }
+
+  for(i = 0; i < NUM_HANDLES; i++) {
+    results[i] = CURLE_FAILED_INIT;
+    easy_init(curl[i]);
+    easy_setopt(curl[i], CURLOPT_URL, URL);
+    easy_setopt(curl[i], CURLOPT_WRITEFUNCTION, write_cb);
+    multi_add_handle(m, curl[i]);
+  }
+
+  /* not possible to change once transfers are added */
+  mc = curl_multi_setopt(m, CURLMOPT_WORKER_THREADS, 3L);
+  if(mc != CURLM_BAD_FUNCTION_ARGUMENT && mc != CURLM_UNKNOWN_OPTION) {
+    curl_mfprintf(stderr, "changing CURLMOPT_WORKER_THREADS returned %d\n",
+                  (int)mc);
+    res = TEST_ERR_MULTI;
+    goto test_cleanup;
+  }
+
+  /* running workers pick up changed options */
+  multi_setopt(m, CURLMOPT_MAXCONNECTS, 8L);
+
+  while(done < NUM_HANDLES) {
+    CURLMsg *msg;
+    int msgs_left;
+    long code;
+
+    multi_perform(m, &running);
+
+    abort_on_test_timeout();
+
+    /* the handles may be used while a worker runs them */
+    for(i = 0; i < NUM_HANDLES; i++) {
+      res = curl_easy_getinfo(curl[i], CURLINFO_RESPONSE_CODE, &code);
+      if(res)
+        goto test_cleanup;
+      easy_setopt(curl[i], CURLOPT_MAXFILESIZE_LARGE, (curl_off_t)100000);
+    }
+
+    while((msg = curl_multi_info_read(m, &msgs_left))) {
+      if(msg->msg != CURLMSG_DONE)
+        continue;
+      for(i = 0; i < NUM_HANDLES; i++) {
+        if(msg->easy_handle == curl[i]) {
+          results[i] = msg->data.result;
+          done++;
+        }
+      }
+    }
+    if(done == NUM_HANDLES)
+      break;
+
+    multi_poll(m, NULL, 0, 1000, &numfds);
+
+    abort_on_test_timeout();
+  }
+
+  multi_perform(m, &running);
+  curl_mprintf("running: %d\n", running);
+  for(i = 0; i < NUM_HANDLES; i++)
+    curl_mprintf("transfer %d: %d\n", i, (int)results[i]);
+
+test_cleanup:
+
+  for(i = 0; i < NUM_HANDLES; i++) {
+    curl_multi_remove_handle(m, curl[i]);
+    curl_easy_cleanup(curl[i]);
+  }
+
+  curl_multi_cleanup(m);
+  curl_global_cleanup();
+
+  return res;
+}
@@ -0,0 +1,213 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+/*
+ * Threads doing transfers to two destinations via a shared connection pool,
+ * first with lock callbacks on the share, then without. The pool locks
+ * itself in both runs and does not call the callbacks for
+ * CURL_LOCK_DATA_CONNECT.
+ */
+#include "test.h"
+#include "testutil.h"
+#include "memdebug.h"
+
+#include <stdio.h>
+
+#if defined(USE_THREADS_POSIX) || defined(USE_THREADS_WIN32)
+#if defined(USE_THREADS_POSIX)
+#include <pthread.h>
+#endif
+#include "curl_threads.h"
+#endif
+
+#define THREAD_SIZE 8
+#define PER_THREAD_SIZE 4
+
+/* number of CURL_LOCK_DATA_CONNECT lock callback calls */
+static int connect_locks = 0;
+
+struct Ctx {
+  const char *URL;
+  CURLSH *share;
+  CURLcode result;
+  size_t nread;
+};
+
+static size_t write_cb(char *contents, size_t size, size_t nmemb,
+                       void *userp)
+{
+  struct Ctx *ctx = (struct Ctx *)userp;
+  (void)contents;
+  ctx->nread += size * nmemb;
+  return size * nmemb;
+}
+
+static
+#if defined(USE_THREADS_POSIX) || defined(USE_THREADS_WIN32)
+#if defined(CURL_WINDOWS_UWP) || defined(UNDER_CE)
+DWORD
+#else
+unsigned int
+#endif
+CURL_STDCALL
+#else
+unsigned int
+#endif
+test_thread(void *ptr)
+{
+  struct Ctx *ctx = (struct Ctx *)ptr;
+  CURLcode res = CURLE_OK;
+  int i;
+
+  for(i = 0; i < PER_THREAD_SIZE; i++) {
+    CURL *curl = curl_easy_init();
+    if(curl) {
+      curl_easy_setopt(curl, CURLOPT_URL, (char *)CURL_UNCONST(ctx->URL));
+      curl_easy_setopt(curl, CURLOPT_SHARE, ctx->share);
+      curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
+      curl_easy_setopt(curl, CURLOPT_WRITEDATA, ptr);
+
+      res = curl_easy_perform(curl);
+
+      /* the connection stays in the shared pool */
+      curl_easy_cleanup(curl);
+      if(res != CURLE_OK) {
+        curl_mfprintf(stderr, "curl_easy_perform() failed: %s\n",
+                      curl_easy_strerror(res));
+        break;
+      }
+    }
+  }
+
+  /* keep the failure of an earlier run */
+  if(res != CURLE_OK)
+    ctx->result = res;
+  return 0;
+}
+
+#if defined(USE_THREADS_POSIX) || defined(USE_THREADS_WIN32)
+
+static void test_lock(CURL *handle, curl_lock_data data,
+                      curl_lock_access laccess, void *useptr)
+{
+  curl_mutex_t *mutexes = (curl_mutex_t*) useptr;
+  (void)handle;
+  (void)laccess;
+  Curl_mutex_acquire(&mutexes[data]);
+  if(data == CURL_LOCK_DATA_CONNECT)
+    connect_locks++;
+}
+
+static void test_unlock(CURL *handle, curl_lock_data data, void *useptr)
+{
+  curl_mutex_t *mutexes = (curl_mutex_t*) useptr;
+  (void)handle;
+  Curl_mutex_release(&mutexes[data]);
+}
+
+static void execute(CURLSH *share, struct Ctx *ctx, int use_locks)
+{
+  int i;
+  curl_mutex_t mutexes[CURL_LOCK_DATA_LAST - 1];
+  curl_thread_t thread[THREAD_SIZE];
+  for(i = 0; i < CURL_LOCK_DATA_LAST - 1; i++) {
+    Curl_mutex_init(&mutexes[i]);
+  }
+  if(use_locks) {
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, test_lock);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, test_unlock);
+    curl_share_setopt(share, CURLSHOPT_USERDATA, (void *)mutexes);
+  }
+
+  for(i = 0; i < THREAD_SIZE; i++) {
+    thread[i] = Curl_thread_create(test_thread, (void *)&ctx[i]);
+  }
+  for(i = 0; i < THREAD_SIZE; i++) {
+    if(thread[i]) {
+      Curl_thread_join(&thread[i]);
+      Curl_thread_destroy(&thread[i]);
+    }
+  }
+  curl_share_setopt(share, CURLSHOPT_LOCKFUNC, NULL);
+  curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, NULL);
+  for(i = 0; i < CURL_LOCK_DATA_LAST - 1; i++) {
+    Curl_mutex_destroy(&mutexes[i]);
+  }
+}
+
+#else /* without threads, run serially */
+
+static void execute(CURLSH *share, struct Ctx *ctx, int use_locks)
+{
+  int i;
+  (void) share;
+  (void) use_locks;
+  for(i = 0; i < THREAD_SIZE; i++) {
+    test_thread((void *)&ctx[i]);
+  }
+}
+
+#endif
+
+CURLcode test(char *URL)
+{
+  CURLcode res = CURLE_OK;
+  int i;
+  CURLSH* share;
+  struct Ctx ctx[THREAD_SIZE];
+
+  curl_global_init(CURL_GLOBAL_ALL);
+
+  share = curl_share_init();
+  if(!share) {
+    curl_mfprintf(stderr, "curl_share_init() failed\n");
+    goto test_cleanup;
+  }
+  /* only the connection pool is safe to share without lock callbacks */
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+
+  for(i = 0; i < THREAD_SIZE; i++) {
+    ctx[i].share = share;
+    /* every other thread uses the second destination */
+    ctx[i].URL = (i % 2) ? libtest_arg2 : URL;
+    ctx[i].result = CURLE_OK;
+    ctx[i].nread = 0;
+  }
+
+  execute(share, ctx, 1);
+  execute(share, ctx, 0);
+
+  for(i = 0; i < THREAD_SIZE; i++) {
+    curl_mprintf("thread %d: %d, %zu bytes\n", i, (int)ctx[i].result,
+                 ctx[i].nread);
+    if(ctx[i].result)
+      res = ctx[i].result;
+  }
+  curl_mprintf("connect locks: %d\n", connect_locks);
+
+test_cleanup:
+  if(share)
+    curl_share_cleanup(share);
+  curl_global_cleanup();
+  return res;
+}
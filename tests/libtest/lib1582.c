@@ -0,0 +1,88 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "test.h"
+
+#include "memdebug.h"
+
+#define MAX_BORROWS 200
+
+struct borrowed {
+  struct curl_borrow *borrow[MAX_BORROWS];
+  char *ptr[MAX_BORROWS];
+  size_t len[MAX_BORROWS];
+  int count;
+};
+
+static size_t borrow_cb(char *ptr, size_t nbytes,
+                        struct curl_borrow *borrow, void *userdata)
+{
+  struct borrowed *b = userdata;
+
+  if(b->count >= MAX_BORROWS) {
+    curl_mfprintf(stderr, "too many borrows\n");
+    return CURL_WRITEFUNC_ERROR;
+  }
+  /* keep the data without copying it */
+  b->borrow[b->count] = borrow;
+  b->ptr[b->count] = ptr;
+  b->len[b->count] = nbytes;
+  b->count++;
+  return nbytes;
+}
+
+CURLcode test(char *URL)
+{
+  CURL *curl = NULL;
+  CURLcode res = CURLE_OK;
+  struct borrowed b;
+  int i;
+
+  memset(&b, 0, sizeof(b));
+
+  global_init(CURL_GLOBAL_ALL);
+
+  easy_init(curl);
+
+  easy_setopt(curl, CURLOPT_URL, URL);
+  /* receive in small pieces, so that buffers are renewed */
+  easy_setopt(curl, CURLOPT_BUFFERSIZE, 1024L);
+  easy_setopt(curl, CURLOPT_BORROWFUNCTION, borrow_cb);
+  easy_setopt(curl, CURLOPT_BORROWDATA, &b);
+
+  res = curl_easy_perform(curl);
+
+test_cleanup:
+
+  curl_easy_cleanup(curl);
+
+  /* the borrowed data stays valid until released */
+  for(i = 0; i < b.count; i++) {
+    fwrite(b.ptr[i], 1, b.len[i], stdout);
+    curl_borrow_release(b.borrow[i]);
+  }
+
+  curl_global_cleanup();
+
+  return res;
+}
@@ -0,0 +1,82 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "test.h"
+
+#include "memdebug.h"
+
+/*
+ * Download over HTTP/2 and check that the transfer reports the stream
+ * window it was granted and the round trip time measured.
+ */
+CURLcode test(char *URL)
+{
+  CURLcode res = CURLE_OK;
+  CURL *curl = NULL;
+  curl_off_t window = -1;
+  curl_off_t rtt = -1;
+
+  global_init(CURL_GLOBAL_ALL);
+  easy_init(curl);
+
+  easy_setopt(curl, CURLOPT_URL, URL);
+  easy_setopt(curl, CURLOPT_HTTP_VERSION,
+              (long)CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE);
+
+  res = curl_easy_perform(curl);
+  if(res) {
+    curl_mfprintf(stderr, "curl_easy_perform() failed with code %d (%s)\n",
+                  res, curl_easy_strerror(res));
+    goto test_cleanup;
+  }
+
+  res = curl_easy_getinfo(curl, CURLINFO_HTTP2_WINDOW_T, &window);
+  if(!res)
+    res = curl_easy_getinfo(curl, CURLINFO_HTTP2_RTT_T, &rtt);
+  if(res)
+    goto test_cleanup;
+
+  /* between the minimum and maximum window libcurl uses */
+  if(window >= (128 * 1024) && window <= (10 * 1024 * 1024))
+    curl_mprintf("window in range\n");
+  else
+    curl_mprintf("window out of range: %" CURL_FORMAT_CURL_OFF_T "\n",
+                 window);
+  if(rtt >= 0)
+    curl_mprintf("rtt in range\n");
+  else
+    curl_mprintf("rtt out of range: %" CURL_FORMAT_CURL_OFF_T "\n", rtt);
+
+  /* a reset handle has no HTTP/2 info */
+  curl_easy_reset(curl);
+  curl_easy_getinfo(curl, CURLINFO_HTTP2_WINDOW_T, &window);
+  curl_easy_getinfo(curl, CURLINFO_HTTP2_RTT_T, &rtt);
+  curl_mprintf("after reset: %" CURL_FORMAT_CURL_OFF_T " %"
+               CURL_FORMAT_CURL_OFF_T "\n", window, rtt);
+
+test_cleanup:
+  curl_easy_cleanup(curl);
+  curl_global_cleanup();
+
+  return res;
+}
@@ -0,0 +1,65 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "test.h"
+
+#include "memdebug.h"
+
+/*
+ * CURLOPT_STREAM_URGENCY: check the accepted values and that an HTTP/2
+ * request carries the priority field.
+ */
+CURLcode test(char *URL)
+{
+  CURLcode res = CURLE_OK;
+  CURL *curl = NULL;
+
+  global_init(CURL_GLOBAL_ALL);
+  easy_init(curl);
+
+  if(curl_easy_setopt(curl, CURLOPT_STREAM_URGENCY, 24L) !=
+     CURLE_BAD_FUNCTION_ARGUMENT)
+    curl_mprintf("urgency 24 was accepted\n");
+  if(curl_easy_setopt(curl, CURLOPT_STREAM_URGENCY, -2L) !=
+     CURLE_BAD_FUNCTION_ARGUMENT)
+    curl_mprintf("urgency -2 was accepted\n");
+  if(curl_easy_setopt(curl, CURLOPT_STREAM_URGENCY, 16L) !=
+     CURLE_BAD_FUNCTION_ARGUMENT)
+    curl_mprintf("urgency 16 was accepted\n");
+
+  easy_setopt(curl, CURLOPT_STREAM_URGENCY, 7L);
+  easy_setopt(curl, CURLOPT_STREAM_URGENCY, -1L);
+  easy_setopt(curl, CURLOPT_STREAM_URGENCY, 1L | CURLURGENCY_INCREMENTAL);
+
+  easy_setopt(curl, CURLOPT_URL, URL);
+  easy_setopt(curl, CURLOPT_HTTP_VERSION,
+              (long)CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE);
+
+  res = curl_easy_perform(curl);
+
+test_cleanup:
+  curl_easy_cleanup(curl);
+  curl_global_cleanup();
+
+  return res;
+}
@@ -0,0 +1,115 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+/*
+ * Run several transfers with CURLMOPT_WAIT_EPOLL, waiting for them with
+ * curl_multi_poll().
+ */
+
+#include "test.h"
+
+#include "testutil.h"
+#include "warnless.h"
+#include "memdebug.h"
+
+#define TEST_HANG_TIMEOUT 60 * 1000
+
+#define NUM_HANDLES 4
+
+static size_t write_cb(char *ptr, size_t size, size_t nmemb, void *userp)
+{
+  (void)ptr;
+  (void)userp;
+  return size * nmemb;
+}
+
+CURLcode test(char *URL)
+{
+  CURLcode res = CURLE_OK;
+  CURL *curl[NUM_HANDLES] = {0};
+  CURLcode results[NUM_HANDLES];
+  int running;
+  int done = 0;
+  int numfds;
+  CURLM *m = NULL;
+  int i;
+
+  start_test_timing();
+
+  global_init(CURL_GLOBAL_ALL);
+
+  multi_init(m);
+
+  /* without epoll, this has no effect */
+  multi_setopt(m, CURLMOPT_WAIT_EPOLL, 1L);
+
+  for(i = 0; i < NUM_HANDLES; i++) {
+    results[i] = CURLE_FAILED_INIT;
+    easy_init(curl[i]);
+    easy_setopt(curl[i], CURLOPT_URL, URL);
+    easy_setopt(curl[i], CURLOPT_WRITEFUNCTION, write_cb);
+    multi_add_handle(m, curl[i]);
+  }
+
+  while(done < NUM_HANDLES) {
+    CURLMsg *msg;
+    int msgs_left;
+
+    multi_perform(m, &running);
+
+    abort_on_test_timeout();
+
+    while((msg = curl_multi_info_read(m, &msgs_left))) {
+      if(msg->msg != CURLMSG_DONE)
+        continue;
+      for(i = 0; i < NUM_HANDLES; i++) {
+        if(msg->easy_handle == curl[i]) {
+          results[i] = msg->data.result;
+          done++;
+        }
+      }
+    }
+    if(done == NUM_HANDLES)
+      break;
+
+    multi_poll(m, NULL, 0, 1000, &numfds);
+
+    abort_on_test_timeout();
+  }
+
+  curl_mprintf("running: %d\n", running);
+  for(i = 0; i < NUM_HANDLES; i++)
+    curl_mprintf("transfer %d: %d\n", i, (int)results[i]);
+
+test_cleanup:
+
+  for(i = 0; i < NUM_HANDLES; i++) {
+    curl_multi_remove_handle(m, curl[i]);
+    curl_easy_cleanup(curl[i]);
+  }
+
+  curl_multi_cleanup(m);
+  curl_global_cleanup();
+
+  return res;
+}
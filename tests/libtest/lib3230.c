@@ -0,0 +1,139 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+/*
+ * Run transfers with CURLMOPT_WAIT_EPOLL against a server that answers them
+ * one at a time and slowly. While the transfers wait, curl_multi_poll() must
+ * not get the pollsets of all of them again.
+ */
+
+#include "test.h"
+
+#include "testutil.h"
+#include "warnless.h"
+#include "memdebug.h"
+
+#define TEST_HANG_TIMEOUT 60 * 1000
+
+#define NUM_HANDLES 8
+
+static bool in_poll;
+static int wait_assessed;
+
+static size_t write_cb(char *ptr, size_t size, size_t nmemb, void *userp)
+{
+  (void)ptr;
+  (void)userp;
+  return size * nmemb;
+}
+
+static int debug_cb(CURL *handle, curl_infotype type,
+                    char *data, size_t size, void *userp)
+{
+  (void)handle;
+  (void)userp;
+  if(in_poll && (type == CURLINFO_TEXT)) {
+    char line[256];
+    size_t len = CURLMIN(size, sizeof(line) - 1);
+    memcpy(line, data, len);
+    line[len] = 0;
+    /* the multi trace of a transfer's pollset */
+    if(strstr(line, " pollset["))
+      wait_assessed++;
+  }
+  return 0;
+}
+
+CURLcode test(char *URL)
+{
+  CURLcode res = CURLE_OK;
+  CURL *curl[NUM_HANDLES] = {0};
+  int running;
+  int done = 0;
+  int numfds;
+  int polls = 0;
+  CURLM *m = NULL;
+  int i;
+
+  start_test_timing();
+
+  global_init(CURL_GLOBAL_ALL);
+  curl_global_trace("multi");
+
+  multi_init(m);
+
+  multi_setopt(m, CURLMOPT_WAIT_EPOLL, 1L);
+
+  for(i = 0; i < NUM_HANDLES; i++) {
+    easy_init(curl[i]);
+    easy_setopt(curl[i], CURLOPT_URL, URL);
+    easy_setopt(curl[i], CURLOPT_WRITEFUNCTION, write_cb);
+    easy_setopt(curl[i], CURLOPT_DEBUGFUNCTION, debug_cb);
+    easy_setopt(curl[i], CURLOPT_VERBOSE, 1L);
+    multi_add_handle(m, curl[i]);
+  }
+
+  while(done < NUM_HANDLES) {
+    CURLMsg *msg;
+    int msgs_left;
+
+    multi_perform(m, &running);
+
+    abort_on_test_timeout();
+
+    while((msg = curl_multi_info_read(m, &msgs_left))) {
+      if(msg->msg == CURLMSG_DONE)
+        done++;
+    }
+    if(done == NUM_HANDLES)
+      break;
+
+    /* the first wait creates the epoll instance and adds all transfers */
+    in_poll = (polls > 0);
+    multi_poll(m, NULL, 0, 1000, &numfds);
+    in_poll = FALSE;
+    polls++;
+
+    abort_on_test_timeout();
+  }
+
+  curl_mprintf("done: %d, polled: %s\n", done, (polls > 1) ? "yes" : "no");
+#ifdef USE_EPOLL
+  /* with epoll, waiting does not look at the transfers */
+  curl_mprintf("pollsets got while waiting: %d\n", wait_assessed);
+#else
+  curl_mprintf("pollsets got while waiting: 0\n");
+#endif
+
+test_cleanup:
+
+  for(i = 0; i < NUM_HANDLES; i++) {
+    curl_multi_remove_handle(m, curl[i]);
+    curl_easy_cleanup(curl[i]);
+  }
+
+  curl_multi_cleanup(m);
+  curl_global_cleanup();
+
+  return res;
+}
@@ -717,6 +717,7 @@ sub checksystemfeatures {
             $feature{"threadsafe"} = $feat =~ /threadsafe/i;
             $feature{"HTTPSRR"} = $feat =~ /HTTPSRR/;
             $feature{"ECH"} = $feat =~ /ECH/;
+            $feature{"SSLS-EXPORT"} = $feat =~ /SSLS-EXPORT/;
         }
         #
         # Test harness currently uses a non-stunnel server in order to
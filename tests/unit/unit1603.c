@@ -170,6 +170,18 @@ UNITTEST_START
   fail_unless(rc == 0, "hash delete failed");
   fail_unless(elem_dtor_calls == 2, "element destructor count should be 1");
 
+  /* Move the entries to a larger table */
+  nodep = Curl_hash_add(&hash_static, &key4, strlen(key4), &key4);
+  fail_unless(nodep, "insertion into hash failed");
+  rc = Curl_hash_resize(&hash_static, 17);
+  fail_unless(rc == 0, "hash resize failed");
+  fail_unless(Curl_hash_count(&hash_static) == 3, "hash count changed");
+  nodep = Curl_hash_pick(&hash_static, &key2, strlen(key2));
+  fail_unless(nodep == key2, "hash retrieval after resize failed");
+  nodep = Curl_hash_pick(&hash_static, &key3, strlen(key3));
+  fail_unless(nodep == key3, "hash retrieval after resize failed");
+  nodep = Curl_hash_pick(&hash_static, &key4, strlen(key4));
+  fail_unless(nodep == key4, "hash retrieval after resize failed");
 
   /* Clean up */
   Curl_hash_clean(&hash_static);
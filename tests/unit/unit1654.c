@@ -131,6 +131,23 @@ UNITTEST_START
 
   Curl_altsvc_save(curl, asi, outname);
 
+  /* lookups ignore case and a trailing dot, and remove expired entries */
+  {
+    struct altsvc *as = NULL;
+    fail_unless(Curl_altsvc_lookup(asi, ALPN_h1, "3.EXAMPLE.org.", 8080,
+                                   &as, ALPN_h3) &&
+                !strcmp(as->dst.host, "yesyes.com"), "h3 lookup failed");
+    fail_unless(Curl_altsvc_lookup(asi, ALPN_h1, "3.example.org", 8080,
+                                   &as, ALPN_h2) &&
+                !strcmp(as->dst.host, "example.com"), "h2 lookup failed");
+    fail_if(Curl_altsvc_lookup(asi, ALPN_h1, "3.example.org", 80,
+                               &as, ALPN_h2), "wrong port matched");
+    fail_if(Curl_altsvc_lookup(asi, ALPN_h1, "curl.se", 80,
+                               &as, ALPN_h2 | ALPN_h3), "cleared matched");
+    fail_unless(Curl_llist_count(&asi->list) == 8,
+                "expired entries not removed");
+  }
+
   curl_easy_cleanup(curl);
 fail:
   Curl_altsvc_cleanup(&asi);
@@ -172,6 +172,19 @@ UNITTEST_START
 
   curl_msnprintf(savename, sizeof(savename), "%s.save", arg);
   (void)Curl_hsts_save(easy, h, savename);
+
+  /* a large cache still finds names and their parent domains */
+  for(i = 0; i < 1000; i++) {
+    char host[64];
+    curl_msnprintf(host, sizeof(host), "host%d.example", i);
+    result = Curl_hsts_parse(h, host, "max-age=1000; includeSubDomains");
+    fail_unless(!result, "Curl_hsts_parse() failed");
+  }
+  chost = "a.b.HOST999.example";
+  e = Curl_hsts(h, chost, strlen(chost), TRUE);
+  fail_unless(e && !strcmp(e->host, "host999.example"), "parent not found");
+  e = Curl_hsts(h, chost, strlen(chost), FALSE);
+  fail_unless(!e, "subdomain matched without subdomain matching");
   Curl_hsts_cleanup(&h);
   curl_easy_cleanup(easy);
   curl_global_cleanup();
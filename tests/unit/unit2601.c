@@ -250,6 +250,62 @@ static void check_bufq(size_t pool_spares,
     Curl_bufcp_free(&pool);
 }
 
+static void check_bufcp_limit(void)
+{
+  struct bufc_pool pool;
+  struct bufq q1, q2;
+  struct buf_chunk *chunk;
+  size_t chunk_mem = sizeof(struct buf_chunk) + 1024;
+  size_t nwritten, nread;
+  CURLcode result;
+
+  Curl_bufcp_init(&pool, 1024, 2);
+  Curl_bufcp_set_max_mem(&pool, 3 * chunk_mem);
+  Curl_bufq_initp(&q1, &pool, 8, BUFQ_OPT_NONE);
+  Curl_bufq_initp(&q2, &pool, 8, BUFQ_OPT_NONE);
+
+  /* the pool limit stops q1 before its own limit */
+  result = Curl_bufq_cwrite(&q1, (const char *)test_data, 8 * 1024,
+                            &nwritten);
+  fail_unless(!result && nwritten == 3 * 1024, "limit: q1 not limited");
+  result = Curl_bufq_cwrite(&q1, (const char *)test_data, 1, &nwritten);
+  fail_unless(result == CURLE_AGAIN, "limit: write beyond limit");
+  fail_unless(Curl_bufq_is_full(&q1) == FALSE, "limit: q1 is full");
+  fail_unless(pool.stats.denied == 2, "limit: denials not counted");
+  fail_unless(Curl_bufq_is_gated(&q1), "limit: q1 not gated");
+  fail_unless(!Curl_bufq_is_gated(&q2), "limit: empty q2 gated");
+
+  /* a bufq without chunks always gets one */
+  result = Curl_bufq_cwrite(&q2, (const char *)test_data, 2048, &nwritten);
+  fail_unless(!result && nwritten == 1024, "limit: q2 got no chunk");
+  fail_unless(pool.mem == 4 * chunk_mem, "limit: wrong pool mem");
+  fail_unless(pool.stats.peak_mem == 4 * chunk_mem, "limit: wrong peak");
+
+  /* reading q1 empty frees chunks above the limit, then keeps spares */
+  result = Curl_bufq_cread(&q1, (char *)test_data, 3 * 1024, &nread);
+  fail_unless(!result && nread == 3 * 1024, "limit: q1 read failed");
+  fail_unless(pool.mem == 3 * chunk_mem, "limit: chunks not released");
+  fail_unless(pool.spare_count == 2, "limit: spares not kept");
+  fail_unless(!Curl_bufq_is_gated(&q1), "limit: q1 still gated");
+
+  /* spares are reused last in, first out */
+  chunk = pool.spare;
+  result = Curl_bufq_cwrite(&q1, (const char *)test_data, 10, &nwritten);
+  fail_unless(!result && q1.head == chunk, "limit: spare not LIFO");
+  fail_unless(pool.stats.reused == 1, "limit: reuse not counted");
+  fail_unless(pool.stats.allocated == 4, "limit: allocations wrong");
+
+  Curl_bufq_free(&q1);
+  Curl_bufq_free(&q2);
+  fail_unless(pool.spare_count == 2 && pool.mem == 2 * chunk_mem,
+              "limit: free did not return chunks");
+  Curl_bufcp_set_max_mem(&pool, chunk_mem);
+  fail_unless(pool.spare_count == 1 && pool.mem == chunk_mem,
+              "limit: lowering the limit kept spares");
+  Curl_bufcp_free(&pool);
+  fail_unless(pool.mem == 0, "limit: memory left in pool");
+}
+
 UNITTEST_START
   struct bufq q;
   ssize_t n;
@@ -278,4 +334,6 @@ UNITTEST_START
   check_bufq(8, 8000, 10, 1234, 1234, BUFQ_OPT_NONE);
   check_bufq(8, 1024, 4, 129, 127, BUFQ_OPT_NO_SPARES);
 
+  check_bufcp_limit();
+
 UNITTEST_STOP
@@ -0,0 +1,183 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "curlcheck.h"
+
+#include "splay.h"
+#include "timewheel.h"
+#include "warnless.h"
+
+static CURLcode unit_setup(void)
+{
+  return CURLE_OK;
+}
+
+static void unit_stop(void)
+{
+
+}
+
+/* number of timers */
+#define NUM_NODES 2000
+/* number of simulated milliseconds */
+#define NUM_STEPS 100000
+
+static unsigned int rnd_state = 3214;
+
+static unsigned int rnd(void)
+{
+  rnd_state = rnd_state * 1103515245 + 12345;
+  return (rnd_state >> 8) & 0xffffff;
+}
+
+/* a timeout as transfers set them: mostly short ones that get renewed,
+ * some connect and transfer timeouts in the seconds and minutes */
+static timediff_t rnd_timeout(void)
+{
+  unsigned int r = rnd() % 100;
+  if(r < 60)
+    return rnd() % 10;
+  if(r < 85)
+    return 200 + (rnd() % 1000);
+  if(r < 97)
+    return 30000 + (rnd() % 5000);
+  return 300000 + (rnd() % 600000);
+}
+
+static struct curltime add_ms(struct curltime t, timediff_t ms)
+{
+  t.tv_sec += (time_t)(ms / 1000);
+  t.tv_usec += (int)((ms % 1000) * 1000);
+  if(t.tv_usec >= 1000000) {
+    t.tv_sec++;
+    t.tv_usec -= 1000000;
+  }
+  return t;
+}
+
+UNITTEST_START
+{
+  static struct Curl_tree tnodes[NUM_NODES];
+  static struct Curl_twnode wnodes[NUM_NODES];
+  static struct curltime keys[NUM_NODES];
+  static unsigned char expired[NUM_NODES];
+  static size_t ids[NUM_NODES];
+  static size_t due[NUM_NODES];
+  size_t ndue;
+  struct Curl_twheel wheel;
+  struct Curl_tree *root = NULL;
+  struct curltime now = {1000, 0};
+  struct curltime first;
+  size_t i, step;
+  size_t nsplay = 0, nwheel = 0;
+  timediff_t us_splay = 0, us_wheel = 0;
+  struct curltime t0;
+
+  Curl_twheel_init(&wheel, &now);
+  fail_unless(!Curl_twheel_first(&wheel, &first), "empty wheel has first");
+
+  for(i = 0; i < NUM_NODES; i++) {
+    ids[i] = i;
+    keys[i] = add_ms(now, rnd_timeout());
+    Curl_splayset(&tnodes[i], &ids[i]);
+    root = Curl_splayinsert(keys[i], root, &tnodes[i]);
+    Curl_twheel_set(&wnodes[i], &ids[i]);
+    Curl_twheel_add(&wheel, keys[i], &wnodes[i]);
+  }
+
+  for(step = 0; step < NUM_STEPS; step++) {
+    struct Curl_tree *t;
+    struct Curl_twnode *w;
+
+    now = add_ms(now, 1);
+
+    /* expire all timers in the splay tree, then in the wheel. Both
+       must report the same set of timers. */
+    ndue = 0;
+    t0 = curlx_now();
+    root = Curl_splaygetbest(now, root, &t);
+    while(t) {
+      i = *(size_t *)Curl_splayget(t);
+      fail_unless(curlx_timediff_us(keys[i], now) <= 0, "splay too early");
+      expired[i] = 1;
+      due[ndue++] = i;
+      root = Curl_splaygetbest(now, root, &t);
+    }
+    us_splay += curlx_timediff_us(curlx_now(), t0);
+    nsplay += ndue;
+    t0 = curlx_now();
+    w = Curl_twheel_getbest(&wheel, &now);
+    while(w) {
+      i = *(size_t *)Curl_twheel_get(w);
+      fail_unless(curlx_timediff_us(keys[i], now) <= 0, "wheel too early");
+      fail_unless(expired[i] == 1, "wheel expired a timer splay did not");
+      expired[i] = 2;
+      nwheel++;
+      w = Curl_twheel_getbest(&wheel, &now);
+    }
+    us_wheel += curlx_timediff_us(curlx_now(), t0);
+    fail_unless(nsplay == nwheel, "splay and wheel expired differently");
+
+    /* expired timers get a new timeout */
+    for(i = 0; i < ndue; i++) {
+      fail_unless(expired[due[i]] == 2, "splay expired a timer wheel did not");
+      expired[due[i]] = 0;
+      keys[due[i]] = add_ms(now, rnd_timeout());
+    }
+    t0 = curlx_now();
+    for(i = 0; i < ndue; i++)
+      root = Curl_splayinsert(keys[due[i]], root, &tnodes[due[i]]);
+    us_splay += curlx_timediff_us(curlx_now(), t0);
+    t0 = curlx_now();
+    for(i = 0; i < ndue; i++)
+      Curl_twheel_add(&wheel, keys[due[i]], &wnodes[due[i]]);
+    us_wheel += curlx_timediff_us(curlx_now(), t0);
+
+    /* a running timer gets replaced by a sooner one */
+    i = rnd() % NUM_NODES;
+    keys[i] = add_ms(now, rnd() % 50);
+    t0 = curlx_now();
+    fail_unless(!Curl_splayremove(root, &tnodes[i], &root),
+                "splay remove failed");
+    root = Curl_splayinsert(keys[i], root, &tnodes[i]);
+    us_splay += curlx_timediff_us(curlx_now(), t0);
+    t0 = curlx_now();
+    Curl_twheel_remove(&wheel, &wnodes[i]);
+    Curl_twheel_add(&wheel, keys[i], &wnodes[i]);
+    us_wheel += curlx_timediff_us(curlx_now(), t0);
+
+    /* both agree on the earliest timer */
+    if(!(step % 1000)) {
+      struct curltime tv_zero = {0, 0};
+      root = Curl_splay(tv_zero, root);
+      fail_unless(Curl_twheel_first(&wheel, &first), "wheel is empty");
+      fail_unless(root && !curlx_timediff_us(root->key, first),
+                  "earliest timer differs");
+    }
+  }
+  fail_unless(nsplay > NUM_NODES, "too few timers expired");
+  curl_mfprintf(stderr, "expired %zu timers, splay: %" FMT_TIMEDIFF_T
+                "us, wheel: %" FMT_TIMEDIFF_T "us\n",
+                nsplay, us_splay, us_wheel);
+}
+UNITTEST_STOP
@@ -0,0 +1,197 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "curlcheck.h"
+
+#include "urldata.h"
+#include "vtls/vtls_sfile.h"
+
+#include "memdebug.h" /* LAST include file */
+
+static CURL *easy;
+
+static CURLcode unit_setup(void)
+{
+  CURLcode res = CURLE_OK;
+
+  global_init(CURL_GLOBAL_ALL);
+  easy = curl_easy_init();
+  if(!easy) {
+    curl_global_cleanup();
+    return CURLE_OUT_OF_MEMORY;
+  }
+  return res;
+}
+
+static void unit_stop(void)
+{
+  curl_easy_cleanup(easy);
+  curl_global_cleanup();
+}
+
+#ifdef USE_SSLS_FILE
+
+struct loaded {
+  char data[4][32];
+  size_t count;
+};
+
+static CURLcode load_cb(struct Curl_easy *data, void *user_data,
+                        const void *sdata, size_t sdata_len)
+{
+  struct loaded *l = user_data;
+  (void)data;
+  if((l->count < 4) && (sdata_len < sizeof(l->data[0]))) {
+    memcpy(l->data[l->count], sdata, sdata_len);
+    l->data[l->count][sdata_len] = 0;
+  }
+  l->count++;
+  return CURLE_OK;
+}
+
+static size_t load(struct Curl_ssl_sfile *sf, const char *peer,
+                   curl_off_t now, struct loaded *l)
+{
+  CURLcode result;
+
+  memset(l, 0, sizeof(*l));
+  result = Curl_ssl_sfile_load(easy, sf, peer, now, load_cb, l);
+  fail_unless(!result, "load failed");
+  return l->count;
+}
+
+#endif
+
+UNITTEST_START
+#ifdef USE_SSLS_FILE
+{
+  struct Curl_easy *data = easy;
+  struct Curl_ssl_sfile *sf1 = NULL, *sf2 = NULL, *sf3 = NULL;
+  const char *peer_a = "a.example:443:IMPL-test:G";
+  const char *peer_b = "b.example:443:IMPL-test:G";
+  const char *peer_c = "c.example:443:IMPL-test:G";
+  char big[1000];
+  struct loaded l;
+  curl_off_t now = 1000000;
+  struct_stat st;
+  size_t count;
+  int i;
+  FILE *f;
+  CURLcode result;
+
+  /* a file that is not a session file */
+  f = fopen(arg, "wb");
+  abort_unless(f, "cannot create file");
+  fputs("this is not a session file at all, not at all, not at all", f);
+  fclose(f);
+  result = Curl_ssl_sfile_open(arg, &sf1);
+  abort_unless(!result && sf1, "cannot create session file instance");
+  fail_unless(Curl_ssl_sfile_is(sf1, arg), "wrong path");
+  fail_unless(!Curl_ssl_sfile_is(sf1, "other"), "wrong path");
+  result = Curl_ssl_sfile_load(data, sf1, peer_a, now, load_cb, &l);
+  fail_unless(result, "loaded from a file that is no session file");
+  Curl_ssl_sfile_close(sf1);
+  remove(arg);
+
+  /* a new file */
+  result = Curl_ssl_sfile_open(arg, &sf1);
+  abort_unless(!result && sf1, "cannot create session file instance");
+  fail_unless(!Curl_ssl_sfile_append(data, sf1, peer_a, now, now + 100,
+                                     FALSE, "a-one", 5), "append");
+  fail_unless(!Curl_ssl_sfile_append(data, sf1, peer_a, now, now - 100,
+                                     FALSE, "a-expired", 9), "append");
+  fail_unless(!Curl_ssl_sfile_append(data, sf1, peer_b, now, now + 100,
+                                     FALSE, "b-one", 5), "append");
+  fail_unless(!Curl_ssl_sfile_append(data, sf1, peer_a, now, now + 200,
+                                     FALSE, "a-two", 5), "append");
+
+  /* sessions written by us are not loaded again */
+  fail_unless(load(sf1, peer_a, now, &l) == 0, "loaded own sessions");
+
+  /* another user of the file gets the same keys and all sessions */
+  result = Curl_ssl_sfile_open(arg, &sf2);
+  abort_unless(!result && sf2, "cannot open session file again");
+  fail_unless(load(sf2, peer_a, now, &l) == 2, "wrong number of sessions");
+  fail_unless(!strcmp(l.data[0], "a-one"), "wrong first session");
+  fail_unless(!strcmp(l.data[1], "a-two"), "wrong second session");
+  /* only once */
+  fail_unless(load(sf2, peer_a, now, &l) == 0, "sessions loaded twice");
+
+  /* an append by another user is seen */
+  fail_unless(!Curl_ssl_sfile_append(data, sf2, peer_b, now, now + 100,
+                                     FALSE, "b-two", 5), "append");
+  fail_unless(load(sf1, peer_b, now, &l) == 1, "wrong number of sessions");
+  fail_unless(!strcmp(l.data[0], "b-two"), "wrong appended session");
+  fail_unless(load(sf2, peer_b, now, &l) == 1, "wrong number of sessions");
+  fail_unless(!strcmp(l.data[0], "b-one"), "wrong first session");
+
+  /* an incomplete record at the end, as left by a crashed writer */
+  f = fopen(arg, "ab");
+  abort_unless(f, "cannot append to file");
+  fwrite("\0\0\0\x40xyz", 1, 7, f);
+  fclose(f);
+  result = Curl_ssl_sfile_open(arg, &sf3);
+  abort_unless(!result && sf3, "cannot open file with incomplete record");
+  fail_unless(load(sf3, peer_b, now, &l) == 2, "wrong number of sessions");
+  fail_unless(!Curl_ssl_sfile_append(data, sf3, peer_a, now, now + 300,
+                                     FALSE, "a-three", 7), "append");
+  fail_unless(load(sf1, peer_a, now, &l) == 1, "wrong number of sessions");
+  fail_unless(!strcmp(l.data[0], "a-three"), "wrong session after repair");
+  fail_unless(load(sf2, peer_a, now, &l) == 1, "wrong number of sessions");
+  fail_unless(!strcmp(l.data[0], "a-three"), "wrong session after repair");
+
+  /* a session for single use is taken by the first one loading it,
+   * even the one that saved it */
+  fail_unless(!Curl_ssl_sfile_append(data, sf1, peer_a, now, now + 100,
+                                     TRUE, "a-once", 6), "append");
+  fail_unless(load(sf1, peer_a, now, &l) == 1, "single use not loaded");
+  fail_unless(!strcmp(l.data[0], "a-once"), "wrong single use session");
+  fail_unless(load(sf2, peer_a, now, &l) == 0, "single use loaded twice");
+  fail_unless(load(sf3, peer_a, now, &l) == 2, "wrong number of sessions");
+  fail_unless(!strcmp(l.data[1], "a-two"), "single use loaded twice");
+
+  /* the file is replaced before it grows without bounds */
+  memset(big, 'c', sizeof(big));
+  for(i = 0; i < 200; ++i) {
+    fail_unless(!Curl_ssl_sfile_append(data, sf1, peer_c, now, now + 100,
+                                       FALSE, big, sizeof(big)), "append");
+  }
+  fail_unless(!stat(arg, &st), "stat");
+  fail_unless(st.st_size < 200 * (curl_off_t)sizeof(big) / 2,
+              "session file was not replaced");
+  /* users of the replaced file switch to the new one */
+  count = load(sf2, peer_c, now, &l);
+  fail_unless(count && (count < 200), "wrong number of sessions");
+  fail_unless(load(sf1, peer_c, now, &l) == 0, "loaded own sessions");
+  fail_unless(load(sf3, peer_b, now, &l) == 0, "sessions loaded twice");
+  fail_unless(!Curl_ssl_sfile_append(data, sf3, peer_b, now, now + 100,
+                                     FALSE, "b-three", 7), "append");
+  fail_unless(load(sf2, peer_b, now, &l) == 1, "wrong number of sessions");
+  fail_unless(!strcmp(l.data[0], "b-three"), "wrong session after replace");
+
+  Curl_ssl_sfile_close(sf1);
+  Curl_ssl_sfile_close(sf2);
+  Curl_ssl_sfile_close(sf3);
+}
+#endif
+UNITTEST_STOP
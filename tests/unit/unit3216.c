@@ -0,0 +1,267 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "curlcheck.h"
+
+#include "urldata.h"
+#include "bufq_nocpy.h"
+#include "borrow.h"
+#include "memdebug.h"
+
+static CURLcode unit_setup(void)
+{
+  CURLcode res = CURLE_OK;
+  return res;
+}
+
+static void unit_stop(void)
+{
+}
+
+static int ext_frees;
+
+static void ext_free(void *mem)
+{
+  ++ext_frees;
+  free(mem);
+}
+
+static void check_pool(size_t seg_entries, size_t spare_max,
+                       size_t nqueues, size_t nadds)
+{
+  struct bufq_nocpy_pool pool;
+  struct bufq_nocpy q[4];
+  char buf[64];
+  size_t i, j, nread;
+  CURLcode result;
+
+  DEBUGASSERT(nqueues <= CURL_ARRAYSIZE(q));
+  memset(buf, 'x', sizeof(buf));
+  Curl_bufq_nocpy_pool_init(&pool, seg_entries, spare_max, NULL);
+  for(i = 0; i < nqueues; ++i)
+    Curl_bufq_nocpy_init(&q[i], &pool, 0, NULL);
+
+  for(i = 0; i < nqueues; ++i) {
+    for(j = 0; j < nadds; ++j) {
+      char *mem = malloc(j + 1);
+      fail_unless(mem, "out of memory");
+      if(!mem)
+        return;
+      memcpy(mem, buf, j + 1);
+      result = Curl_bufq_nocpy_add(&q[i], mem, j + 1, BUFQ_ALLOC_MALLOC);
+      fail_unless(!result, "pool: add failed");
+    }
+  }
+  fail_unless(pool.mem == nqueues * (nadds * (nadds + 1) / 2),
+              "pool: wrong memory accounted");
+  fail_unless(pool.seg_count ==
+              nqueues * ((nadds + seg_entries - 1) / seg_entries),
+              "pool: wrong segment count");
+
+  /* reading a queue empty gives its segments back to the pool */
+  do {
+    result = Curl_bufq_nocpy_cread(&q[0], buf, sizeof(buf), &nread);
+  } while(!result);
+  fail_unless(result == CURLE_AGAIN, "pool: cread empty wrong result");
+  fail_unless(!q[0].head && !q[0].tail, "pool: empty queue holds segment");
+  fail_unless(pool.spare_count <= spare_max, "pool: too many spares");
+
+  for(i = 0; i < nqueues; ++i)
+    Curl_bufq_nocpy_free(&q[i]);
+  fail_unless(pool.mem == 0, "pool: memory left after free");
+  fail_unless(pool.seg_count == pool.spare_count,
+              "pool: segments in use after free");
+  Curl_bufq_nocpy_pool_free(&pool);
+}
+
+static void check_chunks(void)
+{
+  struct bufc_pool bufcp;
+  struct bufq_nocpy_pool pool;
+  struct bufq_nocpy q;
+  const unsigned char *ptr;
+  char buf[64];
+  size_t n, nwritten, nread;
+  CURLcode result;
+
+  Curl_bufcp_init(&bufcp, 8, 4);
+  Curl_bufq_nocpy_pool_init(&pool, 4, 2, &bufcp);
+  Curl_bufq_nocpy_init(&q, &pool, 0, NULL);
+
+  /* small writes share a chunk, larger ones continue in new chunks */
+  result = Curl_bufq_nocpy_cwrite(&q, "012", 3, &nwritten);
+  fail_unless(!result && nwritten == 3, "chunks: cwrite failed");
+  result = Curl_bufq_nocpy_cwrite(&q, "345", 3, &nwritten);
+  fail_unless(!result && nwritten == 3, "chunks: cwrite failed");
+  fail_unless(bufcp.stats.allocated == 1, "chunks: write not appended");
+  fail_unless(Curl_bufq_nocpy_mem(&q) == 8, "chunks: wrong memory");
+  result = Curl_bufq_nocpy_cwrite(&q, "6789abcdefghij", 14, &nwritten);
+  fail_unless(!result && nwritten == 14, "chunks: cwrite failed");
+  fail_unless(bufcp.stats.allocated == 3, "chunks: wrong chunk count");
+  fail_unless(Curl_bufq_nocpy_len(&q) == 20, "chunks: wrong length");
+  fail_unless(Curl_bufq_nocpy_peek(&q, &ptr, &n) && n == 8 &&
+              !memcmp(ptr, "01234567", 8), "chunks: peek wrong");
+
+  /* a partly read chunk is appended to */
+  Curl_bufq_nocpy_skip(&q, 18);
+  result = Curl_bufq_nocpy_cwrite(&q, "kl", 2, &nwritten);
+  fail_unless(!result && nwritten == 2, "chunks: cwrite failed");
+  fail_unless(bufcp.spare_count == 2, "chunks: read chunks not returned");
+  result = Curl_bufq_nocpy_cread(&q, buf, sizeof(buf), &nread);
+  fail_unless(!result && nread == 4 && !memcmp(buf, "ijkl", 4),
+              "chunks: cread wrong");
+
+  /* chunks read are reused */
+  result = Curl_bufq_nocpy_cwrite(&q, "0123456789abcdef", 16, &nwritten);
+  fail_unless(!result && nwritten == 16, "chunks: cwrite failed");
+  fail_unless(bufcp.stats.allocated == 3 && bufcp.stats.reused == 2,
+              "chunks: spares not reused");
+
+  /* a pool limit stops writes once the queue holds a chunk */
+  Curl_bufq_nocpy_reset(&q);
+  Curl_bufcp_set_max_mem(&bufcp, bufcp.mem);
+  result = Curl_bufq_nocpy_cwrite(&q, buf, sizeof(buf), &nwritten);
+  fail_unless(!result && nwritten == 24, "chunks: limit not applied");
+  result = Curl_bufq_nocpy_cwrite(&q, buf, 1, &nwritten);
+  fail_unless(result == CURLE_AGAIN && !nwritten, "chunks: over limit");
+
+  Curl_bufq_nocpy_free(&q);
+  Curl_bufq_nocpy_pool_free(&pool);
+  Curl_bufcp_free(&bufcp);
+}
+
+UNITTEST_START
+  struct bufq_nocpy q;
+  const unsigned char *ptr;
+  char buf[32];
+  char *mem;
+  size_t n, nread, nwritten;
+  CURLcode result;
+
+  /* empty queue */
+  Curl_bufq_nocpy_init(&q, NULL, 0, ext_free);
+  fail_unless(Curl_bufq_nocpy_is_empty(&q), "init: not empty");
+  fail_unless(!Curl_bufq_nocpy_is_full(&q), "init: full");
+  result = Curl_bufq_nocpy_cread(&q, buf, sizeof(buf), &nread);
+  fail_unless(result == CURLE_AGAIN && !nread, "read empty fail");
+  fail_unless(!Curl_bufq_nocpy_peek(&q, &ptr, &n), "peek empty fail");
+
+  /* entries of all kinds, read across their boundaries */
+  result = Curl_bufq_nocpy_add(&q, CURL_UNCONST("0123"), 4,
+                               BUFQ_ALLOC_STATIC);
+  fail_unless(!result, "add static failed");
+  mem = strdup("45678");
+  abort_unless(mem, "out of memory");
+  result = Curl_bufq_nocpy_add(&q, mem, 5, BUFQ_ALLOC_MALLOC);
+  fail_unless(!result, "add malloc failed");
+  mem = strdup("9ab");
+  abort_unless(mem, "out of memory");
+  result = Curl_bufq_nocpy_add(&q, mem, 3, BUFQ_ALLOC_EXTERNAL);
+  fail_unless(!result, "add external failed");
+  result = Curl_bufq_nocpy_cwrite(&q, "cdef", 4, &nwritten);
+  fail_unless(!result && nwritten == 4, "cwrite failed");
+  fail_unless(Curl_bufq_nocpy_len(&q) == 16, "wrong length");
+  fail_unless(Curl_bufq_nocpy_mem(&q) == 8 + BUFQ_NOCPY_CHUNK_SIZE,
+              "wrong memory accounted");
+
+  fail_unless(Curl_bufq_nocpy_peek(&q, &ptr, &n) && n == 4 &&
+              !memcmp(ptr, "0123", 4), "peek wrong");
+  fail_unless(Curl_bufq_nocpy_peek_at(&q, 6, &ptr, &n) && n == 3 &&
+              !memcmp(ptr, "678", 3), "peek_at wrong");
+  fail_unless(Curl_bufq_nocpy_peek_at(&q, 15, &ptr, &n) && n == 1 &&
+              *ptr == 'f', "peek_at last wrong");
+  fail_unless(!Curl_bufq_nocpy_peek_at(&q, 16, &ptr, &n),
+              "peek_at beyond end succeeded");
+
+  Curl_bufq_nocpy_skip(&q, 2);
+  result = Curl_bufq_nocpy_cread(&q, buf, 9, &nread);
+  fail_unless(!result && nread == 9 && !memcmp(buf, "23456789a", 9),
+              "cread wrong");
+  fail_unless(ext_frees == 0, "external memory released while unread");
+  result = Curl_bufq_nocpy_cread(&q, buf, sizeof(buf), &nread);
+  fail_unless(!result && nread == 5 && !memcmp(buf, "bcdef", 5),
+              "cread rest wrong");
+  fail_unless(ext_frees == 1, "external memory not released");
+  fail_unless(Curl_bufq_nocpy_is_empty(&q), "not empty after read");
+  fail_unless(!Curl_bufq_nocpy_mem(&q), "memory held after read");
+
+  /* adding nothing releases right away */
+  mem = strdup("");
+  abort_unless(mem, "out of memory");
+  result = Curl_bufq_nocpy_add(&q, mem, 0, BUFQ_ALLOC_EXTERNAL);
+  fail_unless(!result && ext_frees == 2, "empty add not released");
+  fail_unless(Curl_bufq_nocpy_is_empty(&q), "empty add not empty");
+
+  /* reset releases unread entries */
+  mem = strdup("xyz");
+  abort_unless(mem, "out of memory");
+  result = Curl_bufq_nocpy_add(&q, mem, 3, BUFQ_ALLOC_EXTERNAL);
+  fail_unless(!result, "add external failed");
+  Curl_bufq_nocpy_reset(&q);
+  fail_unless(ext_frees == 3, "reset did not release");
+  fail_unless(Curl_bufq_nocpy_is_empty(&q), "not empty after reset");
+  Curl_bufq_nocpy_free(&q);
+
+  /* copying writes stop at max_len, references do not */
+  Curl_bufq_nocpy_init(&q, NULL, 10, NULL);
+  result = Curl_bufq_nocpy_cwrite(&q, "0123456789abcde", 15, &nwritten);
+  fail_unless(!result && nwritten == 10, "cwrite not limited");
+  fail_unless(Curl_bufq_nocpy_is_full(&q), "not full");
+  result = Curl_bufq_nocpy_cwrite(&q, "x", 1, &nwritten);
+  fail_unless(result == CURLE_AGAIN && !nwritten, "cwrite on full");
+  result = Curl_bufq_nocpy_add(&q, CURL_UNCONST("ghij"), 4,
+                               BUFQ_ALLOC_STATIC);
+  fail_unless(!result && Curl_bufq_nocpy_len(&q) == 14, "add on full");
+  Curl_bufq_nocpy_skip(&q, 5);
+  result = Curl_bufq_nocpy_cwrite(&q, "x", 1, &nwritten);
+  fail_unless(!result && nwritten == 1, "cwrite after skip");
+  Curl_bufq_nocpy_free(&q);
+
+  /* borrowed memory is held by the queue until read */
+  {
+    struct curl_borrow *b = Curl_borrow_create(16);
+    char *bmem;
+    size_t bsize;
+
+    abort_unless(b, "out of memory");
+    bmem = Curl_borrow_mem(b, &bsize);
+    memcpy(bmem, "borrowed", 8);
+    Curl_bufq_nocpy_init(&q, NULL, 0, NULL);
+    result = Curl_bufq_nocpy_add_borrow(&q, b, bmem, 4);
+    fail_unless(!result, "add_borrow failed");
+    result = Curl_bufq_nocpy_add_borrow(&q, b, bmem + 4, 4);
+    fail_unless(!result, "add_borrow failed");
+    Curl_borrow_drop(b);
+    result = Curl_bufq_nocpy_cread(&q, buf, sizeof(buf), &nread);
+    fail_unless(!result && nread == 8 && !memcmp(buf, "borrowed", 8),
+                "borrow read wrong");
+    Curl_bufq_nocpy_free(&q);
+  }
+
+  check_chunks();
+  check_pool(4, 2, 1, 3);
+  check_pool(4, 2, 2, 9);
+  check_pool(1, 0, 3, 5);
+  check_pool(16, 8, 4, 40);
+
+UNITTEST_STOP
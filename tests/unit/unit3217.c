@@ -0,0 +1,141 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "curlcheck.h"
+
+#include "urldata.h"
+#include "asyn.h"
+#include "hostip.h"
+#include "memdebug.h"
+
+#define NUM_EASY 3
+
+static CURLM *multi;
+static CURL *easy[NUM_EASY];
+static struct connectdata conn;
+
+static CURLcode unit_setup(void)
+{
+  size_t i;
+
+  if(curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK)
+    return CURLE_FAILED_INIT;
+  multi = curl_multi_init();
+  if(!multi)
+    return CURLE_OUT_OF_MEMORY;
+  /* one thread, so that lookups wait in the queue */
+  curl_multi_setopt(multi, CURLMOPT_MAX_RESOLVER_THREADS, 1L);
+  conn.transport = TRNSPRT_TCP;
+  for(i = 0; i < NUM_EASY; ++i) {
+    struct Curl_easy *data;
+    easy[i] = curl_easy_init();
+    if(!easy[i] || curl_multi_add_handle(multi, easy[i]))
+      return CURLE_OUT_OF_MEMORY;
+    data = easy[i];
+    data->conn = &conn;
+  }
+  return CURLE_OK;
+}
+
+static void unit_stop(void)
+{
+  size_t i;
+
+  for(i = 0; i < NUM_EASY; ++i) {
+    struct Curl_easy *data = easy[i];
+    if(data) {
+      data->conn = NULL;
+      curl_multi_remove_handle(multi, data);
+      curl_easy_cleanup(data);
+    }
+  }
+  curl_multi_cleanup(multi);
+  curl_global_cleanup();
+}
+
+#ifdef CURLRES_THREADED
+static void check_resolved(struct Curl_easy *data, int port)
+{
+  struct Curl_dns_entry *dns = NULL;
+  CURLcode result;
+
+  result = Curl_async_await(data, &dns);
+  fail_unless(!result, "resolve failed");
+  fail_unless(dns, "no dns entry");
+  if(dns) {
+    const struct sockaddr_in *sin = (void *)dns->addr->ai_addr;
+    fail_unless(dns->addr->ai_family == AF_INET, "not IPv4");
+    fail_unless(ntohs(sin->sin_port) == port, "wrong port");
+  }
+  fail_unless(!data->state.async.thrdd.addr, "lookup not released");
+  Curl_resolv_unlink(data, &data->state.async.dns);
+  /* done with the resolve, as a transfer would be */
+  Curl_async_destroy(data);
+}
+#endif
+
+UNITTEST_START
+{
+#ifdef CURLRES_THREADED
+  struct Curl_easy *data[NUM_EASY];
+  int waitp;
+  size_t i;
+
+  for(i = 0; i < NUM_EASY; ++i)
+    data[i] = easy[i];
+
+  /* two transfers resolving the same name share one lookup, the held
+   * thread does not finish it before the second one asks */
+  Curl_async_thrdd_pool_hold(multi, TRUE);
+  Curl_async_getaddrinfo(data[0], "127.0.0.1", 80, CURL_IPRESOLVE_V4, &waitp);
+  abort_unless(waitp, "lookup not started");
+  Curl_async_getaddrinfo(data[1], "127.0.0.1", 80, CURL_IPRESOLVE_V4, &waitp);
+  abort_unless(waitp, "lookup not started");
+  fail_unless(data[0]->state.async.thrdd.addr ==
+              data[1]->state.async.thrdd.addr, "lookup not shared");
+
+  /* another port is a lookup of its own, queued for the one thread */
+  Curl_async_getaddrinfo(data[2], "127.0.0.1", 81, CURL_IPRESOLVE_V4, &waitp);
+  abort_unless(waitp, "lookup not started");
+  fail_unless(data[2]->state.async.thrdd.addr !=
+              data[0]->state.async.thrdd.addr, "lookup wrongly shared");
+
+  Curl_async_thrdd_pool_hold(multi, FALSE);
+  check_resolved(data[2], 81);
+  check_resolved(data[0], 80);
+  check_resolved(data[1], 80);
+
+  /* a transfer giving up on its lookup does not affect the others */
+  Curl_async_getaddrinfo(data[0], "127.0.0.1", 82, CURL_IPRESOLVE_V4, &waitp);
+  abort_unless(waitp, "lookup not started");
+  Curl_async_getaddrinfo(data[1], "127.0.0.1", 82, CURL_IPRESOLVE_V4, &waitp);
+  abort_unless(waitp, "lookup not started");
+  Curl_async_getaddrinfo(data[2], "127.0.0.1", 83, CURL_IPRESOLVE_V4, &waitp);
+  abort_unless(waitp, "lookup not started");
+  Curl_async_shutdown(data[0]);
+  Curl_async_shutdown(data[2]);
+  fail_unless(!data[0]->state.async.thrdd.addr, "lookup not released");
+  check_resolved(data[1], 82);
+#endif
+}
+UNITTEST_STOP
@@ -0,0 +1,187 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "curlcheck.h"
+
+#include "urldata.h"
+#include "asyn.h"
+#include "hostip.h"
+#include "multihandle.h"
+#include "memdebug.h"
+
+#define NUM_EASY 2
+
+/* in hostip.c */
+void Curl_dnscache_add_negative(struct Curl_easy *data,
+                                const char *hostname, int port,
+                                int ip_version);
+#ifdef USE_CURL_ASYNC
+void Curl_dnscache_add_pending(struct Curl_easy *data);
+#endif
+
+static CURLM *multi;
+static CURL *easy[NUM_EASY];
+static struct connectdata conn;
+static char dispname[] = "example.invalid";
+static char localhost_ip[] = "127.0.0.1";
+
+static CURLcode unit_setup(void)
+{
+  size_t i;
+
+  if(curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK)
+    return CURLE_FAILED_INIT;
+  multi = curl_multi_init();
+  if(!multi)
+    return CURLE_OUT_OF_MEMORY;
+  conn.transport = TRNSPRT_TCP;
+  conn.host.dispname = dispname;
+  for(i = 0; i < NUM_EASY; ++i) {
+    struct Curl_easy *data;
+    easy[i] = curl_easy_init();
+    if(!easy[i] || curl_multi_add_handle(multi, easy[i]))
+      return CURLE_OUT_OF_MEMORY;
+    data = easy[i];
+    data->conn = &conn;
+  }
+  return CURLE_OK;
+}
+
+static void unit_stop(void)
+{
+  size_t i;
+
+  for(i = 0; i < NUM_EASY; ++i) {
+    struct Curl_easy *data = easy[i];
+    if(data) {
+      data->conn = NULL;
+      curl_multi_remove_handle(multi, data);
+      curl_easy_cleanup(data);
+    }
+  }
+  curl_multi_cleanup(multi);
+  curl_global_cleanup();
+}
+
+#ifdef USE_CURL_ASYNC
+/* make 'data' look like it runs a lookup of 'name' */
+static bool start_pending(struct Curl_easy *data, const char *name)
+{
+  data->state.async.hostname = strdup(name);
+  if(!data->state.async.hostname)
+    return FALSE;
+  data->state.async.port = 80;
+  data->state.async.ip_version = CURL_IPRESOLVE_WHATEVER;
+  Curl_dnscache_add_pending(data);
+  return data->state.async.pending;
+}
+#endif
+
+UNITTEST_START
+{
+  struct Curl_multi *m = multi;
+  struct Curl_easy *data[NUM_EASY];
+  struct Curl_dns_entry *dns = NULL;
+  CURLcode result;
+  char name[64];
+  int i;
+
+  for(i = 0; i < NUM_EASY; ++i) {
+    data[i] = easy[i];
+    /* failed names are not remembered by default */
+    fail_unless(!data[i]->set.dns_negative_timeout, "wrong default");
+    curl_easy_setopt(data[i], CURLOPT_DNS_NEGATIVE_TIMEOUT, 5L);
+  }
+
+  /* a failed name fails right away, without a lookup */
+  Curl_dnscache_add_negative(data[0], "nxdomain.invalid", 80,
+                             CURL_IPRESOLVE_WHATEVER);
+  result = Curl_resolv(data[1], "nxdomain.invalid", 80,
+                       CURL_IPRESOLVE_WHATEVER, FALSE, &dns);
+  fail_unless(result == CURLE_COULDNT_RESOLVE_HOST, "negative entry unused");
+  fail_unless(!dns, "dns entry for failed name");
+#ifdef USE_CURL_ASYNC
+  fail_unless(!data[1]->state.async.hostname, "lookup started");
+#endif
+
+  /* the negative cache is bounded */
+  for(i = 0; i < 150; ++i) {
+    msnprintf(name, sizeof(name), "nx%d.invalid", i);
+    Curl_dnscache_add_negative(data[0], name, 80, CURL_IPRESOLVE_WHATEVER);
+  }
+  fail_unless(Curl_hash_count(&m->dnscache.negative) == 100,
+              "negative cache not bounded");
+
+  /* nothing is remembered with a zero timeout */
+  curl_easy_setopt(data[0], CURLOPT_DNS_NEGATIVE_TIMEOUT, 0L);
+  Curl_dnscache_prune(data[0]);
+  fail_unless(!Curl_hash_count(&m->dnscache.negative),
+              "negative cache not pruned");
+  Curl_dnscache_add_negative(data[0], "nxdomain.invalid", 80,
+                             CURL_IPRESOLVE_WHATEVER);
+  fail_unless(!Curl_hash_count(&m->dnscache.negative),
+              "negative entry added with zero timeout");
+  curl_easy_setopt(data[0], CURLOPT_DNS_NEGATIVE_TIMEOUT, 5L);
+
+#ifdef USE_CURL_ASYNC
+  /* a second transfer waits for the ongoing lookup and gets its result */
+  abort_unless(start_pending(data[0], "pending.invalid"),
+               "lookup not registered");
+  result = Curl_resolv(data[1], "pending.invalid", 80,
+                       CURL_IPRESOLVE_WHATEVER, FALSE, &dns);
+  fail_unless(result == CURLE_AGAIN, "not waiting");
+  fail_unless(data[1]->state.async.coalesced, "not coalesced");
+  result = Curl_resolv_check(data[1], &dns);
+  fail_unless(!result && !dns, "not waiting anymore");
+
+  dns = Curl_dnscache_mk_entry(data[0], Curl_str2addr(localhost_ip, 80),
+                               "pending.invalid", 0, 80, FALSE);
+  abort_unless(dns, "out of memory");
+  fail_unless(!Curl_dnscache_add(data[0], dns), "cache add failed");
+  Curl_resolv_unlink(data[0], &dns);
+  Curl_async_shutdown(data[0]);
+  fail_unless(!Curl_hash_count(&m->dnscache.pending), "lookup not dropped");
+
+  result = Curl_resolv_check(data[1], &dns);
+  fail_unless(!result && dns, "result not shared");
+  fail_unless(!data[1]->state.async.coalesced, "still coalesced");
+  Curl_resolv_unlink(data[1], &dns);
+  data[1]->state.async.dns = NULL;
+  Curl_async_shutdown(data[1]);
+
+  /* a failed lookup fails the waiting transfer as well */
+  abort_unless(start_pending(data[0], "failing.invalid"),
+               "lookup not registered");
+  result = Curl_resolv(data[1], "failing.invalid", 80,
+                       CURL_IPRESOLVE_WHATEVER, FALSE, &dns);
+  fail_unless(result == CURLE_AGAIN, "not waiting");
+  Curl_dnscache_add_negative(data[0], "failing.invalid", 80,
+                             CURL_IPRESOLVE_WHATEVER);
+  Curl_async_shutdown(data[0]);
+  result = Curl_resolv_check(data[1], &dns);
+  fail_unless(result == CURLE_COULDNT_RESOLVE_HOST, "failure not shared");
+  fail_unless(!dns, "dns entry for failed name");
+  Curl_async_shutdown(data[1]);
+#endif
+}
+UNITTEST_STOP
@@ -0,0 +1,191 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "curlcheck.h"
+
+#include "urldata.h"
+#include "hostip.h"
+#include "multihandle.h"
+#include "parsedate.h"
+#include "select.h"
+#include "memdebug.h"
+
+static CURLM *multi;
+static CURL *easy;
+static struct connectdata conn;
+static char dispname[] = "example.invalid";
+static char addr_ip4[] = "192.0.2.7";
+#ifdef CURLRES_THREADED
+static char localhost_ip[] = "127.0.0.1";
+#endif
+
+static CURLcode unit_setup(void)
+{
+  struct Curl_easy *data;
+
+  if(curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK)
+    return CURLE_FAILED_INIT;
+  multi = curl_multi_init();
+  easy = curl_easy_init();
+  if(!multi || !easy || curl_multi_add_handle(multi, easy))
+    return CURLE_OUT_OF_MEMORY;
+  conn.transport = TRNSPRT_TCP;
+  conn.host.dispname = dispname;
+  data = easy;
+  data->conn = &conn;
+  return CURLE_OK;
+}
+
+static void unit_stop(void)
+{
+  struct Curl_easy *data = easy;
+
+  if(data) {
+    data->conn = NULL;
+    curl_multi_remove_handle(multi, data);
+    curl_easy_cleanup(data);
+  }
+  curl_multi_cleanup(multi);
+  curl_global_cleanup();
+}
+
+/* write a cache file with entries resolved 'age' seconds ago */
+static bool write_cachefile(const char *file, time_t age)
+{
+  struct tm stamp;
+  FILE *fp;
+
+  if(Curl_gmtime(time(NULL) - age, &stamp))
+    return FALSE;
+  fp = fopen(file, FOPEN_WRITETEXT);
+  if(!fp)
+    return FALSE;
+  fprintf(fp, "# DNS cache\n"
+          "fresh.example 443 \"%d%02d%02d %02d:%02d:%02d\" "
+          "192.0.2.1 192.0.2.2\n"
+          "stale.example 443 \"20200101 00:00:00\" 192.0.2.3\n"
+          "future.example 443 \"30000101 00:00:00\" 192.0.2.4\n"
+          "noaddr.example 443 \"%d%02d%02d %02d:%02d:%02d\"\n"
+          "badaddr.example 443 \"%d%02d%02d %02d:%02d:%02d\" 192.0.2\n",
+          stamp.tm_year + 1900, stamp.tm_mon + 1, stamp.tm_mday,
+          stamp.tm_hour, stamp.tm_min, stamp.tm_sec,
+          stamp.tm_year + 1900, stamp.tm_mon + 1, stamp.tm_mday,
+          stamp.tm_hour, stamp.tm_min, stamp.tm_sec,
+          stamp.tm_year + 1900, stamp.tm_mon + 1, stamp.tm_mday,
+          stamp.tm_hour, stamp.tm_min, stamp.tm_sec);
+  fclose(fp);
+  return TRUE;
+}
+
+/* return TRUE if the cache has the name with 'naddr' addresses */
+static bool cached(struct Curl_easy *data, const char *name, int naddr)
+{
+  struct Curl_dns_entry *dns;
+  struct Curl_addrinfo *ai;
+  int n = 0;
+
+  dns = Curl_dnscache_get(data, name, 443, CURL_IPRESOLVE_WHATEVER);
+  if(!dns)
+    return FALSE;
+  for(ai = dns->addr; ai; ai = ai->ai_next)
+    n++;
+  Curl_resolv_unlink(data, &dns);
+  return n == naddr;
+}
+
+UNITTEST_START
+{
+  struct Curl_easy *data = easy;
+  struct Curl_multi *m = multi;
+  struct Curl_dns_entry *dns;
+
+  abort_unless(write_cachefile(arg, 5), "cannot write cache file");
+  curl_easy_setopt(data, CURLOPT_DNS_CACHE_FILE, arg);
+
+  /* only fresh and complete entries are loaded */
+  Curl_dnscache_loadfile(data);
+  fail_unless(cached(data, "fresh.example", 2), "fresh entry not loaded");
+  fail_unless(!cached(data, "stale.example", 1), "stale entry loaded");
+  fail_unless(!cached(data, "future.example", 1), "future entry loaded");
+  fail_unless(!cached(data, "noaddr.example", 0), "empty entry loaded");
+  fail_unless(Curl_hash_count(&m->dnscache.entries) == 1,
+              "bad entry loaded");
+  fail_unless(!m->dnscache.dirty, "loading made the cache dirty");
+
+  /* a cache is loaded once */
+  Curl_hash_clean(&m->dnscache.entries);
+  Curl_dnscache_loadfile(data);
+  fail_unless(!Curl_hash_count(&m->dnscache.entries), "loaded again");
+
+  /* a new name is saved to the file */
+  dns = Curl_dnscache_mk_entry(data, Curl_str2addr(addr_ip4, 443),
+                               "added.example", 0, 443, FALSE);
+  abort_unless(dns, "out of memory");
+  fail_unless(!Curl_dnscache_add(data, dns), "cache add failed");
+  Curl_resolv_unlink(data, &dns);
+  fail_unless(m->dnscache.dirty, "cache not dirty");
+  fail_unless(!Curl_dnscache_save(data, &m->dnscache), "save failed");
+  fail_unless(!m->dnscache.dirty, "cache dirty after save");
+
+  Curl_hash_clean(&m->dnscache.entries);
+  Curl_safefree(m->dnscache.filename);
+  Curl_dnscache_loadfile(data);
+  fail_unless(cached(data, "added.example", 1), "saved entry not loaded");
+  fail_unless(!cached(data, "fresh.example", 2), "dropped entry saved");
+
+#ifdef CURLRES_THREADED
+  /* an often used entry about to expire is refreshed in the background */
+  {
+    int i;
+    time_t old;
+
+    curl_easy_setopt(data, CURLOPT_DNS_CACHE_TIMEOUT, 60L);
+    curl_easy_setopt(data, CURLOPT_DNS_REFRESH_AHEAD, 10L);
+    dns = Curl_dnscache_mk_entry(data, Curl_str2addr(localhost_ip, 80),
+                                 "localhost", 0, 80, FALSE);
+    abort_unless(dns, "out of memory");
+    old = dns->timestamp = time(NULL) - 55;
+    fail_unless(!Curl_dnscache_add(data, dns), "cache add failed");
+    Curl_resolv_unlink(data, &dns);
+
+    for(i = 0; i < 2; ++i) {
+      fail_unless(Curl_resolv(data, "localhost", 80, CURL_IPRESOLVE_WHATEVER,
+                              FALSE, &dns) == CURLE_OK, "not in cache");
+      fail_unless(dns && (dns->timestamp == old), "entry replaced");
+      Curl_resolv_unlink(data, &dns);
+    }
+    for(i = 0; i < 500; ++i) {
+      dns = Curl_dnscache_get(data, "localhost", 80,
+                              CURL_IPRESOLVE_WHATEVER);
+      abort_unless(dns, "entry gone");
+      if(dns->timestamp != old)
+        break;
+      Curl_resolv_unlink(data, &dns);
+      Curl_wait_ms(10);
+    }
+    fail_unless(dns && (dns->timestamp != old), "entry not refreshed");
+    Curl_resolv_unlink(data, &dns);
+  }
+#endif
+}
+UNITTEST_STOP
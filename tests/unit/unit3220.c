@@ -0,0 +1,170 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "curlcheck.h"
+
+#include "urldata.h"
+#include "cookie.h"
+#include "memdebug.h"
+
+static CURL *easy;
+
+static CURLcode unit_setup(void)
+{
+  if(curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK)
+    return CURLE_FAILED_INIT;
+  easy = curl_easy_init();
+  if(!easy)
+    return CURLE_OUT_OF_MEMORY;
+  return CURLE_OK;
+}
+
+static void unit_stop(void)
+{
+  curl_easy_cleanup(easy);
+  curl_global_cleanup();
+}
+
+#if defined(CURL_DISABLE_HTTP) || defined(CURL_DISABLE_COOKIES)
+UNITTEST_START
+{
+  puts("nothing to do when HTTP or cookies are disabled");
+}
+UNITTEST_STOP
+#else
+
+#define NUM_DOMAINS 2000
+
+/* write the names of the cookies to send, separated by spaces */
+static void getnames(struct CookieInfo *ci, const char *host,
+                     const char *path, bool secure, char *out, size_t outlen)
+{
+  struct Curl_easy *data = easy;
+  struct Curl_llist list;
+  struct Curl_llist_node *n;
+  size_t len = 0;
+
+  out[0] = 0;
+  if(Curl_cookie_getlist(data, ci, host, path, secure, &list))
+    return;
+  for(n = Curl_llist_head(&list); n; n = Curl_node_next(n)) {
+    struct Cookie *co = Curl_node_elem(n);
+    msnprintf(&out[len], outlen - len, "%s%s", len ? " " : "", co->name);
+    len = strlen(out);
+  }
+  Curl_llist_destroy(&list, NULL);
+}
+
+static bool addcookie(struct CookieInfo *ci, const char *line,
+                      const char *host, const char *path, bool secure)
+{
+  struct Curl_easy *data = easy;
+  /* each as if received in a response of its own */
+  data->req.setcookies = 0;
+  return !!Curl_cookie_add(data, ci, TRUE, FALSE, line, host, path, secure);
+}
+
+UNITTEST_START
+{
+  struct Curl_easy *data = easy;
+  struct CookieInfo *ci = Curl_cookie_init(data, NULL, NULL, FALSE);
+  char names[256];
+  char line[128];
+  char host[64];
+  int i;
+
+  abort_unless(ci, "cookie init");
+
+  /* a cookie for each of many domains, all sent to their subdomains */
+  for(i = 0; i < NUM_DOMAINS; i++) {
+    msnprintf(host, sizeof(host), "d%d.example", i);
+    msnprintf(line, sizeof(line), "a%d=1; domain=%s; path=/", i, host);
+    abort_unless(addcookie(ci, line, host, "/", FALSE), line);
+  }
+  fail_unless(ci->numcookies == NUM_DOMAINS, "cookies in the jar");
+
+  abort_unless(addcookie(ci, "b=2; path=/sub", "www.d7.example", "/",
+                         FALSE), "add b");
+  abort_unless(addcookie(ci, "c=3; path=/sub/deeper", "www.d7.example", "/",
+                         FALSE), "add c");
+  abort_unless(addcookie(ci, "s=4; domain=d7.example; secure",
+                         "d7.example", "/", TRUE), "add s");
+
+  /* longest path first, the domain cookie last */
+  getnames(ci, "www.d7.example", "/sub/deeper/x", FALSE,
+           names, sizeof(names));
+  fail_unless(!strcmp(names, "c b a7"), names);
+
+  /* the same request again is answered from the cache */
+  getnames(ci, "WWW.d7.example", "/sub/deeper/x", FALSE,
+           names, sizeof(names));
+  fail_unless(!strcmp(names, "c b a7"), names);
+
+  getnames(ci, "www.d7.example", "/sub", TRUE, names, sizeof(names));
+  fail_unless(!strcmp(names, "b a7 s"), names);
+
+  getnames(ci, "www.d7.example", "/other", FALSE, names, sizeof(names));
+  fail_unless(!strcmp(names, "a7"), names);
+
+  /* host-only cookies are not sent to other hosts of the domain */
+  getnames(ci, "d7.example", "/sub/deeper", FALSE, names, sizeof(names));
+  fail_unless(!strcmp(names, "a7"), names);
+
+  getnames(ci, "xd7.example", "/", FALSE, names, sizeof(names));
+  fail_unless(!names[0], names);
+  getnames(ci, "d7.example.org", "/", FALSE, names, sizeof(names));
+  fail_unless(!names[0], names);
+
+  /* a new cookie is seen by the next request */
+  abort_unless(addcookie(ci, "d=5; path=/sub/deeper/x", "www.d7.example",
+                         "/", FALSE), "add d");
+  getnames(ci, "www.d7.example", "/sub/deeper/x", FALSE,
+           names, sizeof(names));
+  fail_unless(!strcmp(names, "d c b a7"), names);
+
+  /* replacing keeps the number of cookies */
+  abort_unless(addcookie(ci, "c=6; path=/sub/deeper", "www.d7.example", "/",
+                         FALSE), "replace c");
+  fail_unless(ci->numcookies == NUM_DOMAINS + 4, "cookies after replace");
+  getnames(ci, "www.d7.example", "/sub/deeper/x", FALSE,
+           names, sizeof(names));
+  fail_unless(!strcmp(names, "d c b a7"), names);
+
+  /* an expired cookie removes the present one */
+  addcookie(ci, "b=2; path=/sub; max-age=-1", "www.d7.example", "/", FALSE);
+  getnames(ci, "www.d7.example", "/sub/deeper/x", FALSE,
+           names, sizeof(names));
+  fail_unless(!strcmp(names, "d c a7"), names);
+  fail_unless(ci->numcookies == NUM_DOMAINS + 3, "cookies after expire");
+
+  Curl_cookie_clearsess(ci);
+  fail_unless(ci->numcookies == 0, "no cookies after clearing session");
+  getnames(ci, "www.d7.example", "/sub/deeper/x", FALSE,
+           names, sizeof(names));
+  fail_unless(!names[0], names);
+
+  Curl_cookie_cleanup(ci);
+}
+UNITTEST_STOP
+
+#endif
@@ -0,0 +1,186 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "curlcheck.h"
+
+#include "urldata.h"
+#include "cookie.h"
+#include "memdebug.h"
+
+static CURL *easy;
+
+static CURLcode unit_setup(void)
+{
+  if(curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK)
+    return CURLE_FAILED_INIT;
+  easy = curl_easy_init();
+  if(!easy)
+    return CURLE_OUT_OF_MEMORY;
+  return CURLE_OK;
+}
+
+static void unit_stop(void)
+{
+  curl_easy_cleanup(easy);
+  curl_global_cleanup();
+}
+
+#if defined(CURL_DISABLE_HTTP) || defined(CURL_DISABLE_COOKIES)
+UNITTEST_START
+{
+  puts("nothing to do when HTTP or cookies are disabled");
+}
+UNITTEST_STOP
+#else
+
+static bool addcookie(const char *line)
+{
+  struct Curl_easy *data = easy;
+  /* each as if received in a response of its own */
+  data->req.setcookies = 0;
+  return !!Curl_cookie_add(data, data->cookies, TRUE, FALSE, line,
+                           "example.com", "/", FALSE);
+}
+
+static bool writejar(const char *file, const char *content)
+{
+  FILE *fp = fopen(file, FOPEN_WRITETEXT);
+  if(!fp)
+    return FALSE;
+  fputs(content, fp);
+  fclose(fp);
+  return TRUE;
+}
+
+/* return the number of cookie lines in the file and copy the last one */
+static int readjar(const char *file, char *last, size_t lastlen)
+{
+  struct Curl_easy *data = easy;
+  char line[256];
+  int lines = 0;
+  FILE *fp;
+
+  if(data->cookies && data->cookies->journal)
+    fflush(data->cookies->journal);
+  fp = fopen(file, FOPEN_READTEXT);
+  last[0] = 0;
+  if(!fp)
+    return -1;
+  while(fgets(line, sizeof(line), fp)) {
+    if((line[0] == '#') || (line[0] == '\n'))
+      continue;
+    lines++;
+    line[strcspn(line, "\n")] = 0;
+    msnprintf(last, lastlen, "%s", line);
+  }
+  fclose(fp);
+  return lines;
+}
+
+UNITTEST_START
+{
+  struct Curl_easy *data = easy;
+  struct CookieInfo *ci;
+  struct Curl_llist list;
+  struct Curl_llist_node *n;
+  char last[256];
+  char value[128];
+  char gen[256];
+  int i;
+
+  abort_unless(!curl_easy_setopt(easy, CURLOPT_COOKIEJAR, arg), "jar");
+  abort_unless(!curl_easy_setopt(easy, CURLOPT_COOKIEJOURNAL, 1L),
+               "journal");
+  abort_unless(writejar(arg, "example.com\tFALSE\t/\tFALSE\t0\tz\t9\n"),
+               "stale jar");
+
+  /* a jar that was not read is not appended to but written in full */
+  abort_unless(addcookie("a=1"), "add a");
+  fail_unless(readjar(arg, last, sizeof(last)) == 1, "not appended");
+  Curl_flush_cookies(data, FALSE);
+  fail_unless(readjar(arg, last, sizeof(last)) == 1, "written in full");
+  fail_unless(!strcmp(last, "example.com\tFALSE\t/\tFALSE\t0\ta\t1"), last);
+
+  /* then each change is appended when it happens */
+  abort_unless(addcookie("b=2"), "add b");
+  fail_unless(readjar(arg, last, sizeof(last)) == 2, "two lines");
+  abort_unless(addcookie("a=3"), "replace a");
+  abort_unless(addcookie("b=; max-age=0"), "remove b");
+  Curl_flush_cookies(data, FALSE);
+  fail_unless(readjar(arg, last, sizeof(last)) == 4, "four lines");
+  fail_unless(!strcmp(last, "example.com\tFALSE\t/\tFALSE\t1\tb\t"), last);
+
+  /* loading the journal replays it */
+  ci = Curl_cookie_init(data, arg, NULL, FALSE);
+  abort_unless(ci, "load journal");
+  fail_unless(ci->numcookies == 1, "one cookie loaded");
+  abort_unless(!Curl_cookie_getlist(data, ci, "example.com", "/", FALSE,
+                                    &list), "getlist");
+  n = Curl_llist_head(&list);
+  fail_unless(n && !strcmp(((struct Cookie *)Curl_node_elem(n))->value, "3"),
+              "replaced value loaded");
+  Curl_llist_destroy(&list, NULL);
+  Curl_cookie_cleanup(ci);
+
+  /* the files libcurl writes are checked for the cookie prefixes too */
+  msnprintf(gen, sizeof(gen), "%s.gen", arg);
+  abort_unless(writejar(gen,
+                        "# Netscape HTTP Cookie File\n"
+                        "# This file was generated by libcurl! Edit at your "
+                        "own risk.\n\n"
+                        "example.com\tFALSE\t/\tFALSE\t0\t__Secure-s\t1\n"
+                        ".example.com\tTRUE\t/\tTRUE\t0\t__Host-h\t1\n"
+                        "example.com\tFALSE\t/a\tTRUE\t0\t__Host-p\t1\n"
+                        "example.com\tFALSE\t/\tTRUE\t0\t__Host-ok\t1\n"),
+               "generated file");
+  ci = Curl_cookie_init(data, gen, NULL, FALSE);
+  abort_unless(ci, "load generated file");
+  fail_unless(ci->numcookies == 1, "prefixed cookies checked");
+  Curl_cookie_cleanup(ci);
+  unlink(gen);
+
+  /* a journal mostly made of replaced cookies is written in full */
+  memset(value, 'x', sizeof(value) - 1);
+  value[sizeof(value) - 1] = 0;
+  for(i = 0; i < 1000; i++) {
+    char line[200];
+    msnprintf(line, sizeof(line), "a=%d%s", i, value);
+    abort_unless(addcookie(line), "replace a");
+  }
+  fail_unless(readjar(arg, last, sizeof(last)) == 1004, "appended lines");
+  Curl_flush_cookies(data, FALSE);
+  fail_unless(readjar(arg, last, sizeof(last)) == 1, "compacted");
+
+  /* and appended to again */
+  abort_unless(addcookie("c=4"), "add c");
+  fail_unless(readjar(arg, last, sizeof(last)) == 2, "appended after");
+  fail_unless(!strcmp(last, "example.com\tFALSE\t/\tFALSE\t0\tc\t4"), last);
+
+  /* clearing all cookies is not journaled, the jar is written in full */
+  abort_unless(!curl_easy_setopt(easy, CURLOPT_COOKIELIST, "ALL"), "clear");
+  Curl_flush_cookies(data, FALSE);
+  fail_unless(readjar(arg, last, sizeof(last)) == 0, "cleared");
+}
+UNITTEST_STOP
+
+#endif
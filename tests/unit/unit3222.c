@@ -0,0 +1,180 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "curlcheck.h"
+
+#include "urldata.h"
+#include "http1.h"
+#include "strcase.h"
+#include "memdebug.h"
+
+static CURLcode unit_setup(void)
+{
+  return CURLE_OK;
+}
+
+static void unit_stop(void)
+{
+}
+
+#ifdef CURL_DISABLE_HTTP
+UNITTEST_START
+{
+  puts("nothing to do when HTTP is disabled");
+}
+UNITTEST_STOP
+#else
+
+#define NUM_ROUNDS 200000
+
+static const struct {
+  const char *name; /* with the colon, as the prefix checks did it */
+  enum h1_hd_id id;
+} known[] = {
+  { "Alt-Svc:", H1_HD_ALT_SVC },
+  { "Connection:", H1_HD_CONNECTION },
+  { "Content-Encoding:", H1_HD_CONTENT_ENCODING },
+  { "Content-Length:", H1_HD_CONTENT_LENGTH },
+  { "Content-Range:", H1_HD_CONTENT_RANGE },
+  { "Content-Type:", H1_HD_CONTENT_TYPE },
+  { "Last-Modified:", H1_HD_LAST_MODIFIED },
+  { "Location:", H1_HD_LOCATION },
+  { "Persistent-Auth:", H1_HD_PERSISTENT_AUTH },
+  { "Proxy-authenticate:", H1_HD_PROXY_AUTHENTICATE },
+  { "Proxy-Connection:", H1_HD_PROXY_CONNECTION },
+  { "Retry-After:", H1_HD_RETRY_AFTER },
+  { "Set-Cookie:", H1_HD_SET_COOKIE },
+  { "Strict-Transport-Security:", H1_HD_STRICT_TRANSPORT_SECURITY },
+  { "Trailer:", H1_HD_TRAILER },
+  { "Transfer-Encoding:", H1_HD_TRANSFER_ENCODING },
+  { "WWW-Authenticate:", H1_HD_WWW_AUTHENTICATE },
+};
+
+static unsigned int rnd_state = 3222;
+
+static unsigned int rnd(unsigned int max)
+{
+  rnd_state = rnd_state * 1103515245 + 12345;
+  return (rnd_state >> 8) % max;
+}
+
+/* the byte wise parsing the scanner replaces */
+static size_t ref_scan(const char *hd, size_t hdlen, bool *pnul)
+{
+  const char *p = memchr(hd, ':', hdlen);
+  *pnul = !!memchr(hd, 0, hdlen);
+  return p ? (size_t)(p - hd) : hdlen;
+}
+
+/* the prefix checks the name lookup replaces */
+static enum h1_hd_id ref_id(const char *hd, size_t hdlen)
+{
+  size_t i;
+  for(i = 0; i < CURL_ARRAYSIZE(known); i++) {
+    size_t len = strlen(known[i].name);
+    if((hdlen >= len) && curl_strnequal(known[i].name, hd, len))
+      return known[i].id;
+  }
+  return H1_HD_UNKNOWN;
+}
+
+/* fill `buf` with a header line likely to hit the interesting cases */
+static size_t mkline(char *buf, size_t buflen)
+{
+  static const char chars[] = "aZ-: \t\r\n\x80\xff";
+  size_t len = 0;
+  size_t max = rnd(2) ? 40 : buflen;
+  size_t i;
+
+  if(rnd(4)) {
+    /* start with a known name, maybe mangled */
+    const char *n = known[rnd(CURL_ARRAYSIZE(known))].name;
+    size_t nlen = strlen(n);
+    if(!rnd(4))
+      nlen = rnd((unsigned int)nlen + 1);
+    for(i = 0; i < nlen; i++) {
+      char c = n[i];
+      if(!rnd(3))
+        c = ISUPPER(c) ? Curl_raw_tolower(c) : Curl_raw_toupper(c);
+      else if(!rnd(20))
+        c = chars[rnd(sizeof(chars))]; /* includes the zero */
+      buf[len++] = c;
+    }
+  }
+  max = rnd((unsigned int)max + 1);
+  while(len < max)
+    buf[len++] = chars[rnd(sizeof(chars))];
+  return len;
+}
+
+UNITTEST_START
+{
+  char buf[200];
+  size_t i;
+
+  /* every known name is found, in any case, and only with its length */
+  for(i = 0; i < CURL_ARRAYSIZE(known); i++) {
+    const char *n = known[i].name;
+    size_t nlen = strlen(n) - 1;
+    size_t j;
+    fail_unless(Curl_h1_hd_id(n, nlen) == known[i].id, "known name");
+    for(j = 0; j < nlen; j++)
+      buf[j] = Curl_raw_toupper(n[j]);
+    fail_unless(Curl_h1_hd_id(buf, nlen) == known[i].id, "upper case");
+    for(j = 0; j < nlen; j++)
+      buf[j] = Curl_raw_tolower(n[j]);
+    fail_unless(Curl_h1_hd_id(buf, nlen) == known[i].id, "lower case");
+    fail_unless(Curl_h1_hd_id(n, nlen - 1) == H1_HD_UNKNOWN, "shorter");
+    fail_unless(Curl_h1_hd_id(n, nlen + 1) == H1_HD_UNKNOWN, "longer");
+  }
+  fail_unless(Curl_h1_hd_id("", 0) == H1_HD_UNKNOWN, "empty");
+  fail_unless(Curl_h1_hd_id("Content-Lengt", 13) == H1_HD_UNKNOWN, "typo");
+  fail_unless(Curl_h1_hd_id("Set-Cookie2", 11) == H1_HD_UNKNOWN, "longer");
+
+  /* random lines at all alignments agree with the byte wise parsing */
+  for(i = 0; i < NUM_ROUNDS; i++) {
+    size_t offs = rnd(16);
+    size_t len = mkline(&buf[offs], sizeof(buf) - offs);
+    const char *hd = &buf[offs];
+    bool nul, ref_nul;
+    size_t colon = Curl_h1_hd_scan(hd, len, &nul);
+    size_t ref_colon = ref_scan(hd, len, &ref_nul);
+
+    fail_unless(nul == ref_nul, "zero byte detection differs");
+    if(nul != ref_nul)
+      break;
+    if(nul)
+      continue; /* the line is rejected */
+    fail_unless(colon == ref_colon, "colon position differs");
+    if(colon != ref_colon)
+      break;
+    if(colon < len) {
+      fail_unless(Curl_h1_hd_id(hd, colon) == ref_id(hd, len),
+                  "header name differs");
+    }
+    else
+      fail_unless(ref_id(hd, len) == H1_HD_UNKNOWN, "name without colon");
+  }
+}
+UNITTEST_STOP
+#endif
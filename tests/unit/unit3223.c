@@ -0,0 +1,305 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "curlcheck.h"
+
+#include "urldata.h"
+#include "sendf.h"
+#include "http_chunks.h"
+#include "strcase.h"
+#include "curlx/dynbuf.h"
+#include "memdebug.h"
+
+static CURL *easy;
+
+static CURLcode unit_setup(void)
+{
+  if(curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK)
+    return CURLE_FAILED_INIT;
+  easy = curl_easy_init();
+  if(!easy)
+    return CURLE_OUT_OF_MEMORY;
+  return CURLE_OK;
+}
+
+static void unit_stop(void)
+{
+  curl_easy_cleanup(easy);
+  curl_global_cleanup();
+}
+
+#ifdef CURL_DISABLE_HTTP
+UNITTEST_START
+{
+  puts("nothing to do when HTTP is disabled");
+}
+UNITTEST_STOP
+#else
+
+#define NUM_ROUNDS 3000
+
+static unsigned int rnd_state = 3223;
+
+static unsigned int rnd(unsigned int max)
+{
+  rnd_state = rnd_state * 1103515245 + 12345;
+  return (rnd_state >> 8) % max;
+}
+
+/* collects what the chunked decoder writes */
+struct collector {
+  struct Curl_cwriter super;
+  struct dynbuf body;
+  struct dynbuf trailers;
+  size_t body_writes;
+};
+
+static CURLcode collect_init(struct Curl_easy *data,
+                             struct Curl_cwriter *writer)
+{
+  struct collector *ctx = writer->ctx;
+  (void)data;
+  curlx_dyn_init(&ctx->body, 1024 * 1024);
+  curlx_dyn_init(&ctx->trailers, 1024 * 1024);
+  return CURLE_OK;
+}
+
+static CURLcode collect_write(struct Curl_easy *data,
+                              struct Curl_cwriter *writer, int type,
+                              const char *buf, size_t blen)
+{
+  struct collector *ctx = writer->ctx;
+  (void)data;
+  if(type & CLIENTWRITE_TRAILER)
+    return curlx_dyn_addn(&ctx->trailers, buf, blen);
+  ctx->body_writes++;
+  return curlx_dyn_addn(&ctx->body, buf, blen);
+}
+
+static void collect_close(struct Curl_easy *data,
+                          struct Curl_cwriter *writer)
+{
+  struct collector *ctx = writer->ctx;
+  (void)data;
+  curlx_dyn_free(&ctx->body);
+  curlx_dyn_free(&ctx->trailers);
+}
+
+static const struct Curl_cwtype cw_collect = {
+  "collect",
+  NULL,
+  collect_init,
+  collect_write,
+  collect_close,
+  sizeof(struct collector)
+};
+
+struct outcome {
+  CURLcode result;
+  char body[64 * 1024];
+  size_t bodylen;
+  char trailers[64 * 1024];
+  size_t trailerslen;
+  size_t body_writes;
+  bool done;
+};
+
+static bool gen_failed;
+
+/* add to a generated stream, remember failures */
+static void putn(struct dynbuf *d, const char *p, size_t len)
+{
+  if(curlx_dyn_addn(d, p, len))
+    gen_failed = TRUE;
+}
+
+static void put(struct dynbuf *d, const char *str)
+{
+  putn(d, str, strlen(str));
+}
+
+static void addhex(struct dynbuf *d, size_t n)
+{
+  char hex[40];
+  size_t i;
+  size_t zeros = rnd(4) ? 0 : rnd(4);
+  msnprintf(hex, sizeof(hex), "%0*zx", (int)zeros, n);
+  for(i = 0; hex[i]; i++)
+    if(rnd(2))
+      hex[i] = Curl_raw_toupper(hex[i]);
+  put(d, hex);
+  if(!rnd(5))
+    put(d, rnd(2) ? ";name=value" : "; foo=\"b\rar\"");
+  put(d, rnd(8) ? "\r\n" : "\n");
+}
+
+/* make a chunked encoded stream and the body and trailers it decodes to,
+   returns the number of chunks with data */
+static size_t mkstream(struct dynbuf *s, struct dynbuf *body,
+                       struct dynbuf *trailers)
+{
+  size_t nchunks = rnd(8);
+  size_t ntrailers = rnd(3) ? 0 : rnd(3) + 1;
+  size_t i;
+
+  for(i = 0; i < nchunks; i++) {
+    size_t len = rnd(4) ? rnd(64) + 1 : rnd(4000) + 1;
+    size_t j;
+    addhex(s, len);
+    for(j = 0; j < len; j++) {
+      char c = (char)(rnd(4) ? 'a' + rnd(26) : rnd(256));
+      putn(s, &c, 1);
+      putn(body, &c, 1);
+    }
+    put(s, rnd(8) ? "\r\n" : "\n");
+  }
+  addhex(s, 0);
+  for(i = 0; i < ntrailers; i++) {
+    char line[64];
+    msnprintf(line, sizeof(line), "X-Trailer-%zu: %u", i, rnd(100000));
+    put(s, line);
+    put(s, "\r\n");
+    put(trailers, line);
+    put(trailers, "\r\n");
+  }
+  put(s, "\r\n");
+  if(!rnd(4))
+    put(s, "leftover");
+  return nchunks;
+}
+
+/* decode `buf` feeding pieces of at most `step` bytes, 0 for random */
+static void decode(const char *buf, size_t blen, size_t step,
+                   struct outcome *out)
+{
+  struct Curl_easy *data = easy;
+  struct Curl_cwriter *chunked = NULL;
+  struct Curl_cwriter *collect = NULL;
+  struct collector *ctx;
+
+  memset(out, 0, sizeof(*out));
+  data->req.download_done = FALSE;
+  out->result = Curl_cwriter_create(&chunked, data, &Curl_httpchunk_unencoder,
+                                    CURL_CW_TRANSFER_DECODE);
+  if(!out->result)
+    out->result = Curl_cwriter_create(&collect, data, &cw_collect,
+                                      CURL_CW_CLIENT);
+  if(out->result)
+    goto out;
+  chunked->next = collect;
+  ctx = collect->ctx;
+
+  while(blen && !out->result && !data->req.download_done) {
+    size_t n = step ? step : rnd(64) + 1;
+    if(n > blen)
+      n = blen;
+    out->result = Curl_cwriter_write(data, chunked, CLIENTWRITE_BODY, buf, n);
+    buf += n;
+    blen -= n;
+  }
+  out->done = !!data->req.download_done;
+  out->bodylen = curlx_dyn_len(&ctx->body);
+  if(out->bodylen)
+    memcpy(out->body, curlx_dyn_ptr(&ctx->body), out->bodylen);
+  out->trailerslen = curlx_dyn_len(&ctx->trailers);
+  if(out->trailerslen)
+    memcpy(out->trailers, curlx_dyn_ptr(&ctx->trailers), out->trailerslen);
+  out->body_writes = ctx->body_writes;
+out:
+  Curl_cwriter_free(data, chunked);
+  Curl_cwriter_free(data, collect);
+}
+
+static bool same(const struct outcome *a, const struct outcome *b)
+{
+  return (a->result == b->result) && (a->done == b->done) &&
+    (a->bodylen == b->bodylen) &&
+    !memcmp(a->body, b->body, a->bodylen) &&
+    (a->trailerslen == b->trailerslen) &&
+    !memcmp(a->trailers, b->trailers, a->trailerslen);
+}
+
+UNITTEST_START
+{
+  static struct outcome whole, bytes, pieces;
+  static const char junk[] = "0fG; \r\n\x00z";
+  struct dynbuf s, body, trailers;
+  size_t i;
+
+  curlx_dyn_init(&s, 1024 * 1024);
+  curlx_dyn_init(&body, 1024 * 1024);
+  curlx_dyn_init(&trailers, 1024 * 1024);
+
+  /* The decoder takes runs of bytes at a time where it can. Fed a single
+     byte at a time it steps through each state like it did byte by byte,
+     so all ways to feed a stream must decode it the same. */
+  for(i = 0; i < NUM_ROUNDS; i++) {
+    size_t nchunks;
+    bool corrupt = !rnd(4);
+
+    curlx_dyn_reset(&s);
+    curlx_dyn_reset(&body);
+    curlx_dyn_reset(&trailers);
+    nchunks = mkstream(&s, &body, &trailers);
+    fail_unless(!gen_failed, "out of memory");
+    if(corrupt) {
+      size_t n = rnd(3) + 1;
+      char *p = curlx_dyn_ptr(&s);
+      while(n--)
+        p[rnd((unsigned int)curlx_dyn_len(&s))] = junk[rnd(sizeof(junk))];
+    }
+
+    decode(curlx_dyn_ptr(&s), curlx_dyn_len(&s), curlx_dyn_len(&s), &whole);
+    decode(curlx_dyn_ptr(&s), curlx_dyn_len(&s), 1, &bytes);
+    decode(curlx_dyn_ptr(&s), curlx_dyn_len(&s), 0, &pieces);
+
+    fail_unless(same(&whole, &bytes), "byte wise decode differs");
+    fail_unless(same(&whole, &pieces), "piece wise decode differs");
+    if(!corrupt) {
+      fail_unless(!whole.result, "valid stream fails");
+      fail_unless(whole.done, "valid stream not done");
+      fail_unless(whole.bodylen == curlx_dyn_len(&body) &&
+                  !memcmp(whole.body, curlx_dyn_ptr(&body), whole.bodylen),
+                  "wrong body");
+      fail_unless(whole.trailerslen == curlx_dyn_len(&trailers) &&
+                  !memcmp(whole.trailers, curlx_dyn_ptr(&trailers),
+                          whole.trailerslen), "wrong trailers");
+      /* every chunk is passed on in one piece */
+      fail_unless(whole.body_writes == nchunks, "chunk written in parts");
+    }
+  }
+
+  /* a chunk size with too many digits fails, also when split */
+  decode(STRCONST("00000000000000001\r\nx\r\n0\r\n\r\n"), 100, &whole);
+  fail_unless(whole.result == CURLE_RECV_ERROR, "17 digits accepted");
+  decode(STRCONST("00000000000000001\r\nx\r\n0\r\n\r\n"), 1, &bytes);
+  fail_unless(bytes.result == CURLE_RECV_ERROR, "17 digits accepted");
+  decode(STRCONST("0000000000000001\r\nx\r\n0\r\n\r\n"), 100, &whole);
+  fail_unless(!whole.result && whole.done, "16 digits rejected");
+
+  curlx_dyn_free(&s);
+  curlx_dyn_free(&body);
+  curlx_dyn_free(&trailers);
+}
+UNITTEST_STOP
+#endif
@@ -0,0 +1,239 @@
+/***************************************************************************
+ *                                  _   _ ____  _
+ *  Project                     ___| | | |  _ \| |
+ *                             / __| | | | |_) | |
+ *                            | (__| |_| |  _ <| |___
+ *                             \___|\___/|_| \_\_____|
+ *
+ * Copyright (C) Daniel Stenberg, <daniel@haxx.se>, et al.
+ *
+ * This software is licensed as described in the file COPYING, which
+ * you should have received as part of this distribution. The terms
+ * are also available at https://curl.se/docs/copyright.html.
+ *
+ * You may opt to use, copy, modify, merge, publish, distribute and/or sell
+ * copies of the Software, and permit persons to whom the Software is
+ * furnished to do so, under the terms of the COPYING file.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ * SPDX-License-Identifier: curl
+ *
+ ***************************************************************************/
+#include "curlcheck.h"
+
+#include "urldata.h"
+#include "http.h"
+#include "http1.h"
+#include "dynhds.h"
+#include "memdebug.h"
+
+static CURL *easy;
+
+static CURLcode unit_setup(void)
+{
+  if(curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK)
+    return CURLE_FAILED_INIT;
+  easy = curl_easy_init();
+  if(!easy)
+    return CURLE_OUT_OF_MEMORY;
+  return CURLE_OK;
+}
+
+static void unit_stop(void)
+{
+  curl_easy_cleanup(easy);
+  curl_global_cleanup();
+}
+
+#ifdef CURL_DISABLE_HTTP
+UNITTEST_START
+{
+  puts("nothing to do when HTTP is disabled");
+}
+UNITTEST_STOP
+#else
+
+CURLcode Curl_http_req_h2_make(struct http_req_h2 **ph2);
+CURLcode Curl_http_req_h2_start(struct http_req_h2 *h2,
+                                struct Curl_easy *data,
+                                const char *method,
+                                const char *target, size_t tlen);
+CURLcode Curl_http_req_h2_field(struct http_req_h2 *h2,
+                                const char *name, size_t namelen,
+                                const char *value, size_t valuelen);
+CURLcode Curl_http_req_h2_lines(struct http_req_h2 *h2,
+                                const char *buf, size_t len);
+CURLcode Curl_http_req_h2_done(struct http_req_h2 *h2,
+                               struct Curl_easy *data,
+                               size_t head_len);
+
+struct tcase {
+  const char *method;
+  const char *target;
+  const char *headers; /* header lines, each ending in CRLF */
+};
+
+static const struct tcase TESTS[] = {
+  { "GET", "/", "Host: example.com\r\nUser-Agent: curl\r\n"
+    "Accept: */*\r\n" },
+  { "GET", "/path?q=1", "Host: example.com\r\nAccept: */*\r\n"
+    "Connection: close\r\nKeep-Alive: 5\r\nUpgrade: h2c\r\n"
+    "Proxy-Connection: Keep-Alive\r\nTransfer-Encoding: chunked\r\n" },
+  { "GET", "/", "HOST: Example.COM\r\nX-Mixed-CASE: Value\r\n"
+    "host: second.example\r\n" },
+  { "GET", "/", "Host: example.com\r\nTE: gzip, trailers\r\n" },
+  { "GET", "/", "Host: example.com\r\nTE: deflate;q=\"x,trailers\"\r\n" },
+  { "GET", "/", "Host: example.com\r\nTE: deflate;q=\"unclosed\r\n" },
+  { "GET", "/", "Host: example.com\r\nte:trailers  \r\n" },
+  { "GET", "/", "Host: example.com\r\nPriority: u=5\r\n" },
+  { "POST", "/form", "Host: example.com\r\nContent-Length: 5\r\n"
+    "Content-Type: application/x-www-form-urlencoded\r\n"
+    "Expect: 100-continue\r\n" },
+  { "GET", "http://proxied.example:8080/a/b?c", "Host: example.com\r\n"
+    "Accept: */*\r\n" },
+  { "GET", "https://user:pw@proxied.example/", "" },
+  { "OPTIONS", "*", "Host: example.com\r\n" },
+  { "CONNECT", "tunnel.example:443", "Host: tunnel.example:443\r\n" },
+  { "GET", "relative", "Host: example.com\r\nX-Empty:\r\n" },
+};
+
+static void check_same(const struct tcase *t, struct dynhds *exp,
+                       struct http_req_h2 *h2)
+{
+  struct http_req_h2_field f;
+  size_t i, n = Curl_dynhds_count(exp);
+
+  if(Curl_http_req_h2_count(h2) != n) {
+    curl_mfprintf(stderr, "%s %s: expected %zu headers, got %zu\n",
+                  t->method, t->target, n, Curl_http_req_h2_count(h2));
+    fail("header count differs");
+    return;
+  }
+  for(i = 0; i < n; ++i) {
+    struct dynhds_entry *e = Curl_dynhds_getn(exp, i);
+
+    fail_unless(Curl_http_req_h2_getn(h2, i, &f), "header missing");
+    if((f.namelen != e->namelen) || memcmp(f.name, e->name, f.namelen) ||
+       (f.valuelen != e->valuelen) ||
+       memcmp(f.value, e->value, f.valuelen)) {
+      curl_mfprintf(stderr, "%s %s: header %zu expected '%s: %s', "
+                    "got '%.*s: %.*s'\n", t->method, t->target, i,
+                    e->name, e->value, (int)f.namelen, f.name,
+                    (int)f.valuelen, f.value);
+      fail("header differs");
+    }
+  }
+  fail_if(Curl_http_req_h2_getn(h2, n, &f), "header beyond count");
+}
+
+static void check_case(struct Curl_easy *data, const struct tcase *t)
+{
+  struct h1_req_parser parser;
+  struct dynhds exp;
+  struct http_req_h2 *h2 = NULL;
+  struct dynbuf head;
+  CURLcode result;
+  ssize_t nread;
+
+  curlx_dyn_init(&head, DYN_HTTP_REQUEST);
+  Curl_h1_req_parse_init(&parser, H1_PARSE_DEFAULT_MAX_LINE_LEN);
+  Curl_dynhds_init(&exp, 0, DYN_HTTP_REQUEST);
+
+  /* the way the HTTP/2 and HTTP/3 filters did it: parse the HTTP/1 head */
+  result = curlx_dyn_addf(&head, "%s %s HTTP/2\r\n%s\r\n",
+                          t->method, t->target, t->headers);
+  fail_unless(!result, "head formatting failed");
+  nread = Curl_h1_req_parse_read(&parser, curlx_dyn_ptr(&head),
+                                 curlx_dyn_len(&head), NULL, 0, &result);
+  fail_unless(nread == (ssize_t)curlx_dyn_len(&head), "head not parsed");
+  fail_unless(parser.done && parser.req, "no request parsed");
+  if(!parser.req)
+    goto out;
+  result = Curl_http_req_to_h2(&exp, parser.req, data);
+  fail_unless(!result, "Curl_http_req_to_h2 failed");
+
+  /* what Curl_http() collects while writing the head */
+  result = Curl_http_req_h2_make(&h2);
+  fail_unless(!result, "make failed");
+  if(result)
+    goto out;
+  result = Curl_http_req_h2_start(h2, data, t->method, t->target,
+                                  strlen(t->target));
+  fail_unless(!result, "start failed");
+  if(!result)
+    result = Curl_http_req_h2_lines(h2, t->headers, strlen(t->headers));
+  fail_unless(!result, "lines failed");
+  if(!result)
+    result = Curl_http_req_h2_done(h2, data, curlx_dyn_len(&head));
+  fail_unless(!result, "done failed");
+  if(!result)
+    check_same(t, &exp, h2);
+
+out:
+  Curl_http_req_h2_free(h2);
+  Curl_dynhds_free(&exp);
+  Curl_h1_req_parse_free(&parser);
+  curlx_dyn_free(&head);
+}
+
+UNITTEST_START
+{
+  struct Curl_easy *data = easy;
+  struct http_req_h2 *h2 = NULL;
+  struct http_req_h2_field f;
+  size_t i;
+
+  for(i = 0; i < CURL_ARRAYSIZE(TESTS); ++i)
+    check_case(data, &TESTS[i]);
+
+  /* with RFC 9218 priority, when built with HTTP/2 or HTTP/3 */
+  (void)curl_easy_setopt(easy, CURLOPT_STREAM_URGENCY,
+                         2L | CURLURGENCY_INCREMENTAL);
+  for(i = 0; i < CURL_ARRAYSIZE(TESTS); ++i)
+    check_case(data, &TESTS[i]);
+
+  /* fields given as name and value, like the custom headers */
+  abort_unless(!Curl_http_req_h2_make(&h2), "make failed");
+  fail_unless(!Curl_http_req_h2_start(h2, data, "GET", STRCONST("/x")),
+              "start failed");
+  fail_unless(!Curl_http_req_h2_field(h2, STRCONST("X-Blank"), "", 0),
+              "field failed");
+  fail_unless(!Curl_http_req_h2_field(h2, STRCONST("Host"),
+                                      STRCONST("custom.example")),
+              "field failed");
+  fail_unless(!Curl_http_req_h2_done(h2, data, 0), "done failed");
+  /* :method, :scheme, :authority, :path, x-blank, priority */
+  fail_unless(Curl_http_req_h2_getn(h2, 2, &f) &&
+              (f.valuelen == strlen("custom.example")) &&
+              !memcmp(f.value, "custom.example", f.valuelen),
+              "Host is not the :authority");
+  fail_unless(Curl_http_req_h2_getn(h2, 4, &f) &&
+              (f.namelen == 7) && !memcmp(f.name, "x-blank", 7) &&
+              !f.valuelen, "blank header wrong");
+
+  /* the filters skip the HTTP/1 head, in as many sends as it takes */
+  {
+    CURLcode err;
+    struct http_req_h2 *taken = NULL;
+
+    fail_unless(Curl_http_req_h2_take(data, 10, &taken, &err) == -1 &&
+                err == CURLE_SEND_ERROR, "take without headers");
+    Curl_http_req_h2_free(h2);
+    h2 = NULL;
+    abort_unless(!Curl_http_req_h2_make(&h2), "make failed");
+    fail_unless(!Curl_http_req_h2_start(h2, data, "GET", STRCONST("/")),
+                "start failed");
+    fail_unless(!Curl_http_req_h2_done(h2, data, 20), "done failed");
+    data->req.h2req = h2;
+    fail_unless(Curl_http_req_h2_take(data, 15, &taken, &err) == 15 &&
+                !err && !taken, "partial take");
+    fail_unless(Curl_http_req_h2_take(data, 100, &taken, &err) == 5 &&
+                !err && taken == h2 && !data->req.h2req, "final take");
+  }
+  Curl_http_req_h2_free(h2);
+}
+UNITTEST_STOP
+
+#endif